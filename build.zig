@@ -126,6 +126,28 @@ pub fn build(b: *std.Build) void {
         fetch_third_party_cmd.addArgs(args);
     }
 
+    const bench_exe = b.addExecutable(.{
+        .name = "zc-bench",
+        .root_module = b.createModule(.{
+            .root_source_file = b.path("src/bench.zig"),
+            .target = target,
+            .optimize = optimize,
+        }),
+    });
+    configureNativeDeps(b, bench_exe);
+    bench_exe.step.dependOn(&vert_spv.step);
+    bench_exe.step.dependOn(&frag_spv.step);
+
+    const run_bench = b.addRunArtifact(bench_exe);
+    run_bench.addPathDir(b.pathJoin(&.{ ffmpeg_base, "bin" }));
+    run_bench.addPathDir(b.pathJoin(&.{ "third_party", "sdl3", "3.4.2", "SDL3-3.4.2", "x86_64-w64-mingw32", "bin" }));
+    if (b.args) |args| {
+        run_bench.addArgs(args);
+    }
+
+    const bench_step = b.step("bench", "Run media benchmarks");
+    bench_step.dependOn(&run_bench.step);
+
     const unit_tests = b.addTest(.{
         .root_module = b.createModule(.{
             .root_source_file = b.path("src/root.zig"),
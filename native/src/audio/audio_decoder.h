@@ -21,10 +21,12 @@ typedef struct {
     int sent_eof;
     uint8_t* output_buffer;
     int output_buffer_size;
+    AVCodecParameters* params;
 } AudioDecoder;
 
 int audio_decoder_init(AudioDecoder* dec, AVStream* stream);
 void audio_decoder_destroy(AudioDecoder* dec);
+int audio_decoder_reuse(AudioDecoder* dec, AVStream* stream);
 void audio_decoder_flush(AudioDecoder* dec);
 int audio_decoder_decode_frame(AudioDecoder* dec, struct Demuxer* demuxer);
 int audio_decoder_get_samples(AudioDecoder* dec, uint8_t** data, int* nb_samples);
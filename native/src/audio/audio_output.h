@@ -13,6 +13,8 @@ typedef struct {
     SDL_AudioStream* stream;
     SDL_Thread* decode_thread;
     int decode_running;
+    int decode_parked;
+    int decode_idle;
     int paused;
     Uint64 pause_started_ns;
     Uint64 paused_total_ns;
@@ -42,6 +44,8 @@ typedef struct {
 int audio_output_init(AudioOutput* output, Player* player);
 int audio_output_start(AudioOutput* output);
 void audio_output_reset(AudioOutput* output);
+void audio_output_park(AudioOutput* output);
+int audio_output_reuse(AudioOutput* output, Player* player);
 void audio_output_set_volume(AudioOutput* output, double volume);
 void audio_output_set_playback_speed(AudioOutput* output, double speed);
 void audio_output_set_paused(AudioOutput* output, int paused);
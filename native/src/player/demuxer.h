@@ -5,17 +5,110 @@
 #include <libavformat/avformat.h>
 #include <libavcodec/packet.h>
 
-#define DEMUXER_PACKET_QUEUE_CAPACITY 256
+#include "demuxer_io.h"
+#include "stream_info_cache.h"
+
+#define DEMUXER_PACKET_QUEUE_CAPACITY 1024
+
+typedef struct {
+    int64_t max_bytes;
+    double max_duration;
+    double low_watermark;
+} DemuxerQueueLimits;
+
+typedef struct {
+    int packets;
+    int64_t bytes;
+    double duration;
+    double fill;
+    int packet_shells;
+    int starvation_overflows;
+} DemuxerQueueStats;
+
+typedef enum {
+    DEMUXER_PROBE_FAST = 0,
+    DEMUXER_PROBE_FULL = 1,
+} DemuxerProbeMode;
+
+typedef enum {
+    DEMUXER_PROBE_SOURCE_FULL = 0,
+    DEMUXER_PROBE_SOURCE_BOUNDED = 1,
+    DEMUXER_PROBE_SOURCE_CACHE = 2,
+    DEMUXER_PROBE_SOURCE_LIVE = 3,
+} DemuxerProbeSource;
+
+typedef enum {
+    DEMUXER_SOURCE_FILE = 0,
+    DEMUXER_SOURCE_PIPE = 1,
+    DEMUXER_SOURCE_MEMORY = 2,
+    DEMUXER_SOURCE_NETWORK = 3,
+    DEMUXER_SOURCE_SEQUENCE = 4,
+} DemuxerSourceKind;
+
+typedef struct {
+    int io_backend;
+    int probe_mode;
+    const uint8_t* memory_data;
+    int64_t memory_size;
+    int live;
+} DemuxerOpenOptions;
+
+typedef struct {
+    int stream_index;
+    int media_type;
+    int codec_id;
+    int selected;
+    int is_default;
+    int width;
+    int height;
+    int sample_rate;
+    int channels;
+    char language[16];
+    char title[64];
+} DemuxerTrackInfo;
+
+typedef struct {
+    int variant_count;
+    int current_variant;
+    int64_t variant_bitrate;
+    int64_t bandwidth_estimate;
+    int switches;
+    double last_switch_latency_ms;
+    int rebuffers;
+    int64_t segment_prefetch_hits;
+    int64_t segment_misses;
+} DemuxerAbrStats;
+
+typedef struct {
+    int read_ahead;
+    int64_t prefetch_hits;
+    int64_t misses;
+    int64_t bytes_read;
+    int64_t failed_reads;
+} DemuxerSequenceStats;
 
 typedef struct {
     AVPacket* packets[DEMUXER_PACKET_QUEUE_CAPACITY];
-    int head;
-    int tail;
-    int count;
+    int durations_us[DEMUXER_PACKET_QUEUE_CAPACITY];
+    int generations[DEMUXER_PACKET_QUEUE_CAPACITY];
+    SDL_AtomicInt head;
+    SDL_AtomicInt tail;
+    SDL_AtomicInt bytes;
+    SDL_AtomicInt duration_us;
+    SDL_AtomicInt consumer_waiting;
+    SDL_AtomicInt producer_waiting;
+    int packet_shells;
+    int overflowing;
+    int starvation_overflows;
+    DemuxerQueueLimits limits;
 } DemuxerPacketQueue;
 
 typedef struct Demuxer {
     AVFormatContext* fmt_ctx;
+    DemuxerIo io;
+    int source_kind;
+    int probe_source;
+    int live;
     int video_stream_index;
     int audio_stream_index;
     AVStream* video_stream;
@@ -30,18 +123,60 @@ typedef struct Demuxer {
     SDL_Condition* can_write;
 
     SDL_Thread* thread;
-    int thread_running;
-    int stop_requested;
-    int eof;
+    SDL_AtomicInt thread_running;
+    SDL_AtomicInt stop_requested;
+    SDL_AtomicInt eof;
+
+    double seek_target;
+    SDL_AtomicInt seek_pending;
+    SDL_AtomicInt seek_generation;
+    SDL_AtomicInt demux_generation;
+    int seek_result_generation;
+    int seek_result;
+    double seek_resume_time;
+    int64_t read_position_us;
+
+    int routed_video_stream_index;
+    int routed_audio_stream_index;
+    int skip_forward;
+    int64_t skip_target_us;
+
+    void* keyframe_index;
+    void* packet_cache;
+    void* segment_prefetcher;
+    void* sequence_reader;
+    void* abr;
+    SDL_AtomicInt rebuffers;
+    int video_delivered_generation;
+    int video_catch_up;
+    int video_catch_up_generation;
+    int64_t video_catch_up_us;
+    double live_edge_pts;
+    uint64_t live_edge_received_ns;
+    SDL_Thread* index_thread;
+    SDL_AtomicInt index_scan_stop;
 } Demuxer;
 
 int demuxer_open(Demuxer* demuxer, const char* filepath);
+int demuxer_probe_mode_from_environment(void);
+int demuxer_live_mode_from_environment(const char* filepath);
+int demuxer_open_with_options(Demuxer* demuxer, const char* filepath, const DemuxerOpenOptions* options);
 int demuxer_start(Demuxer* demuxer);
 void demuxer_stop(Demuxer* demuxer);
 void demuxer_close(Demuxer* demuxer);
 int demuxer_seek(Demuxer* demuxer, double time_seconds);
+int demuxer_get_seek_result(Demuxer* demuxer, int generation, double* resume_seconds);
 int demuxer_pop_video_packet(Demuxer* demuxer, AVPacket* out_packet);
+int demuxer_skip_video_to_keyframe(Demuxer* demuxer, double target_seconds);
 int demuxer_pop_audio_packet(Demuxer* demuxer, AVPacket* out_packet);
 int demuxer_is_eof(Demuxer* demuxer);
+int demuxer_is_seekable(Demuxer* demuxer);
+int demuxer_get_track_count(Demuxer* demuxer);
+int demuxer_get_track_info(Demuxer* demuxer, int stream_index, DemuxerTrackInfo* info);
+int demuxer_select_track(Demuxer* demuxer, int stream_index, double resume_seconds);
+int demuxer_get_queue_stats(Demuxer* demuxer, DemuxerQueueStats* video_stats, DemuxerQueueStats* audio_stats);
+int demuxer_get_abr_stats(Demuxer* demuxer, DemuxerAbrStats* stats);
+int demuxer_get_sequence_stats(Demuxer* demuxer, DemuxerSequenceStats* stats);
+int demuxer_get_live_edge(Demuxer* demuxer, double* edge_pts, double* edge_age_seconds);
 
 #endif
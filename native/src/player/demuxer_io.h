@@ -0,0 +1,65 @@
+#ifndef CPLAYER_DEMUXER_IO_H
+#define CPLAYER_DEMUXER_IO_H
+
+#include <stdint.h>
+#include <libavformat/avformat.h>
+
+#define DEMUXER_IO_LATENCY_BUCKETS 20
+
+typedef enum {
+    DEMUXER_IO_BACKEND_DEFAULT = 0,
+    DEMUXER_IO_BACKEND_MMAP = 1,
+    DEMUXER_IO_BACKEND_PREFETCH = 2,
+    DEMUXER_IO_BACKEND_PIPE = 3,
+    DEMUXER_IO_BACKEND_MEMORY = 4,
+    DEMUXER_IO_BACKEND_HTTP = 5,
+} DemuxerIoBackend;
+
+typedef struct {
+    int64_t read_calls;
+    int64_t bytes_read;
+    int64_t seek_calls;
+    int64_t advise_calls;
+    int64_t prefetch_hits;
+    int64_t prefetch_stalls;
+    int64_t prefetch_stall_us;
+    int64_t prefetch_failed_reads;
+    int64_t pipe_reader_stalls;
+    int64_t pipe_writer_stalls;
+    int64_t pipe_peak_buffered;
+    int64_t http_cache_hits;
+    int64_t http_cache_misses;
+    int64_t http_bytes_downloaded;
+    int64_t http_failed_fetches;
+    int64_t latency_us_histogram[DEMUXER_IO_LATENCY_BUCKETS];
+} DemuxerIoStats;
+
+typedef struct {
+    int backend;
+    AVIOContext* avio;
+    void* prefetch;
+    void* pipe;
+    void* http;
+    uint8_t* map_base;
+    const uint8_t* memory_base;
+    int64_t size;
+    int64_t position;
+    int64_t advised_start;
+    int64_t advised_end;
+    int64_t readahead_bytes;
+    DemuxerIoStats stats;
+} DemuxerIo;
+
+int demuxer_io_backend_from_environment(void);
+int demuxer_io_open(DemuxerIo* io, const char* filepath, int backend);
+int demuxer_io_pipe_fd(const char* filepath);
+int demuxer_io_open_pipe(DemuxerIo* io, int fd);
+int demuxer_io_open_memory(DemuxerIo* io, const uint8_t* data, int64_t size);
+int demuxer_io_is_http_url(const char* filepath);
+int demuxer_io_open_http(DemuxerIo* io, const char* url);
+void demuxer_io_cancel(DemuxerIo* io);
+void demuxer_io_rearm(DemuxerIo* io);
+void demuxer_io_close(DemuxerIo* io);
+int demuxer_io_get_stats(const DemuxerIo* io, DemuxerIoStats* out_stats);
+
+#endif
@@ -45,6 +45,20 @@ typedef enum {
     VIDEO_FALLBACK_REASON_FORMAT_NOT_SUPPORTED = 4,
 } VideoFallbackReason;
 
+#define PLAYBACK_MAX_TRACKS 16
+
+typedef enum {
+    PLAYBACK_TRACK_VIDEO = 0,
+    PLAYBACK_TRACK_AUDIO = 1,
+} PlaybackTrackKind;
+
+typedef struct {
+    int stream_index;
+    int kind;
+    int selected;
+    char label[64];
+} PlaybackTrack;
+
 typedef struct {
     PlayerState state;
     double current_time;
@@ -61,12 +75,44 @@ typedef struct {
     int media_bitrate_kbps;
     char video_codec[32];
     int video_bitrate_kbps;
+    char video_decode_threads[32];
+    int video_decode_skip;
+    int video_catch_ups;
+    double video_convert_ms;
+    int video_scale_threads;
     int video_fps_num;
     int video_fps_den;
     char audio_codec[32];
     int audio_bitrate_kbps;
     int audio_sample_rate;
     int audio_channels;
+    int demux_video_buffered_kb;
+    int demux_video_buffered_ms;
+    int demux_video_fill_percent;
+    int demux_audio_buffered_kb;
+    int demux_audio_buffered_ms;
+    int demux_audio_fill_percent;
+    int demux_starvation_overflows;
+    int net_cache_hits;
+    int net_cache_misses;
+    int net_downloaded_kb;
+    int rebuffers;
+    int abr_variant_count;
+    int abr_variant_kbps;
+    int abr_bandwidth_kbps;
+    int abr_switches;
+    int abr_switch_latency_ms;
+    int live;
+    int live_latency_ms;
+    int live_target_ms;
+    int live_catching_up;
+    int live_trims;
+    char open_probe[32];
+    int open_to_first_frame_ms;
+    int switch_ms;
+    char switch_reused[32];
+    int track_count;
+    PlaybackTrack tracks[PLAYBACK_MAX_TRACKS];
 } PlaybackSnapshot;
 
 typedef struct {
@@ -32,22 +32,29 @@ typedef struct {
     double duration;
     double volume;
     double playback_speed;
+    double rate_adjust;
     int width;
     int height;
     int eof;
     int seek_pending;
     double seek_target;
+    int seek_unconfirmed;
+    int seek_generation;
     SDL_Mutex* video_decode_mutex;
     SDL_Mutex* audio_decode_mutex;
     Demuxer demuxer;
     VideoDecoder decoder;
     AudioDecoder audio_decoder;
     int has_audio;
+    int decoder_reuse;
+    int video_decoder_reused;
+    int audio_decoder_reused;
 } Player;
 
 int player_init(Player* player);
 void player_destroy(Player* player);
 int player_open(Player* player, const char* filepath);
+int player_open_memory(Player* player, const uint8_t* data, int64_t size, const char* name);
 int player_command(Player* player, PlayerCommand command);
 PlayerState player_get_state(Player* player);
 int player_has_media_loaded(Player* player);
@@ -56,9 +63,14 @@ void player_pause(Player* player);
 void player_stop(Player* player);
 void player_seek(Player* player, double time);
 int player_apply_seek(Player* player);
+int player_poll_seek(Player* player);
+int player_select_track(Player* player, int stream_index);
 void player_set_volume(Player* player, double volume);
 void player_set_playback_speed(Player* player, double speed);
 double player_get_playback_speed(Player* player);
+void player_set_rate_adjust(Player* player, double factor);
+double player_get_clock_speed(Player* player);
+int player_is_live(Player* player);
 double player_get_time(Player* player);
 int player_decode_frame(Player* player);
 int player_get_video_frame(Player* player, uint8_t** data, int* linesize);
@@ -0,0 +1,10 @@
+#ifndef CPLAYER_STREAM_INFO_CACHE_H
+#define CPLAYER_STREAM_INFO_CACHE_H
+
+#include <libavformat/avformat.h>
+
+int stream_info_cache_load(AVFormatContext* fmt_ctx, const char* filepath);
+int stream_info_cache_store(const AVFormatContext* fmt_ctx, const char* filepath);
+void stream_info_cache_invalidate(const char* filepath);
+
+#endif
@@ -13,11 +13,97 @@
 #define VIDEO_FORMAT_RGBA 0
 #define VIDEO_FORMAT_NV12 1
 #define VIDEO_FORMAT_YUV420P 2
+#define VIDEO_FORMAT_P010 3
+#define VIDEO_FORMAT_YUV420P10 4
+#define VIDEO_FORMAT_YUV422P 5
+#define VIDEO_FORMAT_YUV444P 6
+#define VIDEO_FORMAT_YUV422P10 7
+#define VIDEO_FORMAT_YUV444P10 8
+
+#define VIDEO_SHADER_MODE_RGBA 0
+#define VIDEO_SHADER_MODE_SEMI_PLANAR 1
+#define VIDEO_SHADER_MODE_PLANAR 2
 
 typedef struct {
     int mode;
+    float sample_scale;
 } VideoPushConstants;
 
+typedef struct {
+    int plane_count;
+    int chroma_shift_x;
+    int chroma_shift_y;
+    VkFormat luma_format;
+    VkFormat chroma_format;
+    size_t bytes_per_sample;
+    int shader_mode;
+    float sample_scale;
+} VideoPlaneLayout;
+
+// Samples are rescaled so that the 8-bit limited-range constants in the
+// shader apply unchanged: low-bit 10-bit values by 65535/1020, high-bit
+// 16-bit words (P010, P016) by 65535/65280.
+static int video_plane_layout(int video_format, VideoPlaneLayout* layout) {
+    const float scale_low_10 = 65535.0f / 1020.0f;
+    const float scale_high_16 = 65535.0f / 65280.0f;
+
+    switch (video_format) {
+        case VIDEO_FORMAT_NV12:
+            *layout = (VideoPlaneLayout){2, 1, 1, VK_FORMAT_R8_UNORM, VK_FORMAT_R8G8_UNORM, 1, VIDEO_SHADER_MODE_SEMI_PLANAR, 1.0f};
+            return 0;
+        case VIDEO_FORMAT_P010:
+            *layout = (VideoPlaneLayout){2, 1, 1, VK_FORMAT_R16_UNORM, VK_FORMAT_R16G16_UNORM, 2, VIDEO_SHADER_MODE_SEMI_PLANAR, scale_high_16};
+            return 0;
+        case VIDEO_FORMAT_YUV420P:
+            *layout = (VideoPlaneLayout){3, 1, 1, VK_FORMAT_R8_UNORM, VK_FORMAT_R8_UNORM, 1, VIDEO_SHADER_MODE_PLANAR, 1.0f};
+            return 0;
+        case VIDEO_FORMAT_YUV420P10:
+            *layout = (VideoPlaneLayout){3, 1, 1, VK_FORMAT_R16_UNORM, VK_FORMAT_R16_UNORM, 2, VIDEO_SHADER_MODE_PLANAR, scale_low_10};
+            return 0;
+        case VIDEO_FORMAT_YUV422P:
+            *layout = (VideoPlaneLayout){3, 1, 0, VK_FORMAT_R8_UNORM, VK_FORMAT_R8_UNORM, 1, VIDEO_SHADER_MODE_PLANAR, 1.0f};
+            return 0;
+        case VIDEO_FORMAT_YUV444P:
+            *layout = (VideoPlaneLayout){3, 0, 0, VK_FORMAT_R8_UNORM, VK_FORMAT_R8_UNORM, 1, VIDEO_SHADER_MODE_PLANAR, 1.0f};
+            return 0;
+        case VIDEO_FORMAT_YUV422P10:
+            *layout = (VideoPlaneLayout){3, 1, 0, VK_FORMAT_R16_UNORM, VK_FORMAT_R16_UNORM, 2, VIDEO_SHADER_MODE_PLANAR, scale_low_10};
+            return 0;
+        case VIDEO_FORMAT_YUV444P10:
+            *layout = (VideoPlaneLayout){3, 0, 0, VK_FORMAT_R16_UNORM, VK_FORMAT_R16_UNORM, 2, VIDEO_SHADER_MODE_PLANAR, scale_low_10};
+            return 0;
+        default:
+            return -1;
+    }
+}
+
+static int chroma_extent(int size, int shift) {
+    return (size + (1 << shift) - 1) >> shift;
+}
+
+static int video_format_for_frame_format(int frame_format) {
+    switch (frame_format) {
+        case VIDEO_FRAME_FORMAT_NV12:
+            return VIDEO_FORMAT_NV12;
+        case VIDEO_FRAME_FORMAT_YUV420P:
+            return VIDEO_FORMAT_YUV420P;
+        case VIDEO_FRAME_FORMAT_P010:
+            return VIDEO_FORMAT_P010;
+        case VIDEO_FRAME_FORMAT_YUV420P10:
+            return VIDEO_FORMAT_YUV420P10;
+        case VIDEO_FRAME_FORMAT_YUV422P:
+            return VIDEO_FORMAT_YUV422P;
+        case VIDEO_FRAME_FORMAT_YUV444P:
+            return VIDEO_FORMAT_YUV444P;
+        case VIDEO_FRAME_FORMAT_YUV422P10:
+            return VIDEO_FORMAT_YUV422P10;
+        case VIDEO_FRAME_FORMAT_YUV444P10:
+            return VIDEO_FORMAT_YUV444P10;
+        default:
+            return VIDEO_FORMAT_RGBA;
+    }
+}
+
 static VkShaderModule create_shader_module_from_bytes(VkDevice device, const uint8_t* data, size_t size, const char* debug_name) {
     if (data == NULL || size == 0 || (size % 4) != 0) {
         fprintf(stderr, "Invalid shader bytecode: %s\n", debug_name);
@@ -101,8 +187,10 @@ static int create_staging_plane_resources(App* app, int width, int height, VkFor
     VkDeviceSize data_size = (VkDeviceSize)(size_t)width * (VkDeviceSize)(size_t)height;
     if (format == VK_FORMAT_R8G8B8A8_UNORM) {
         data_size *= 4;
-    } else if (format == VK_FORMAT_R8G8_UNORM) {
+    } else if (format == VK_FORMAT_R8G8_UNORM || format == VK_FORMAT_R16_UNORM) {
         data_size *= 2;
+    } else if (format == VK_FORMAT_R16G16_UNORM) {
+        data_size *= 4;
     }
 
     if (create_buffer(app, data_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, staging_buffer, staging_memory) != 0) {
@@ -668,6 +756,54 @@ static int create_video_slot_staging_only_yuv420p(Renderer* ren, RendererVideoSl
     return 0;
 }
 
+static int create_video_slot_resources_layout(Renderer* ren, RendererVideoSlot* slot, int width, int height, const VideoPlaneLayout* layout) {
+    int chroma_width = chroma_extent(width, layout->chroma_shift_x);
+    int chroma_height = chroma_extent(height, layout->chroma_shift_y);
+
+    if (create_video_plane_resources(ren->app, width, height, layout->luma_format, &slot->image, &slot->image_memory, &slot->image_view, &slot->staging_buffer, &slot->staging_memory, &slot->staging_mapped) != 0) {
+        destroy_video_slot_resources(ren, slot);
+        return -1;
+    }
+    if (create_video_plane_resources(ren->app, chroma_width, chroma_height, layout->chroma_format, &slot->uv_image, &slot->uv_image_memory, &slot->uv_image_view, &slot->uv_staging_buffer, &slot->uv_staging_memory, &slot->uv_staging_mapped) != 0) {
+        destroy_video_slot_resources(ren, slot);
+        return -1;
+    }
+    if (layout->plane_count > 2 && create_video_plane_resources(ren->app, chroma_width, chroma_height, layout->chroma_format, &slot->v_image, &slot->v_image_memory, &slot->v_image_view, &slot->v_staging_buffer, &slot->v_staging_memory, &slot->v_staging_mapped) != 0) {
+        destroy_video_slot_resources(ren, slot);
+        return -1;
+    }
+
+    update_slot_descriptor(ren, slot);
+
+    slot->yuv_initialized = 1;
+    slot->image_initialized = 0;
+    slot->imported_external = 0;
+    return 0;
+}
+
+static int create_video_slot_staging_only_layout(Renderer* ren, RendererVideoSlot* slot, int width, int height, const VideoPlaneLayout* layout) {
+    int chroma_width = chroma_extent(width, layout->chroma_shift_x);
+    int chroma_height = chroma_extent(height, layout->chroma_shift_y);
+
+    if (create_staging_plane_resources(ren->app, width, height, layout->luma_format, &slot->staging_buffer, &slot->staging_memory, &slot->staging_mapped) != 0) {
+        destroy_video_slot_resources(ren, slot);
+        return -1;
+    }
+    if (create_staging_plane_resources(ren->app, chroma_width, chroma_height, layout->chroma_format, &slot->uv_staging_buffer, &slot->uv_staging_memory, &slot->uv_staging_mapped) != 0) {
+        destroy_video_slot_resources(ren, slot);
+        return -1;
+    }
+    if (layout->plane_count > 2 && create_staging_plane_resources(ren->app, chroma_width, chroma_height, layout->chroma_format, &slot->v_staging_buffer, &slot->v_staging_memory, &slot->v_staging_mapped) != 0) {
+        destroy_video_slot_resources(ren, slot);
+        return -1;
+    }
+
+    slot->yuv_initialized = 1;
+    slot->image_initialized = 0;
+    slot->imported_external = 0;
+    return 0;
+}
+
 static int recreate_video_resources(Renderer* ren, int width, int height, int video_format) {
     for (uint32_t i = 0; i < VIDEO_UPLOAD_SLOTS; i++) {
         destroy_video_slot_resources(ren, &ren->video_slots[i]);
@@ -688,6 +824,13 @@ static int recreate_video_resources(Renderer* ren, int width, int height, int vi
             result = is_shared_image_slot
                 ? create_video_slot_resources_yuv420p(ren, &ren->video_slots[i], width, height)
                 : create_video_slot_staging_only_yuv420p(ren, &ren->video_slots[i], width, height);
+        } else {
+            VideoPlaneLayout layout;
+            if (video_plane_layout(video_format, &layout) == 0) {
+                result = is_shared_image_slot
+                    ? create_video_slot_resources_layout(ren, &ren->video_slots[i], width, height, &layout)
+                    : create_video_slot_staging_only_layout(ren, &ren->video_slots[i], width, height, &layout);
+            }
         }
 
         if (result != 0) {
@@ -708,6 +851,18 @@ static int recreate_video_resources(Renderer* ren, int width, int height, int vi
     return 0;
 }
 
+// Frames copied straight from decoder memory stay referenced until the
+// slot's copy has finished.
+static void release_slot_frame(RendererVideoSlot* slot) {
+    if (slot->retained_frame_token == 0) {
+        return;
+    }
+
+    AVFrame* frame = (AVFrame*)(uintptr_t)slot->retained_frame_token;
+    av_frame_free(&frame);
+    slot->retained_frame_token = 0;
+}
+
 static int acquire_upload_slot(Renderer* ren, uint32_t* out_slot_index) {
     App* app = ren->app;
 
@@ -720,6 +875,7 @@ static int acquire_upload_slot(Renderer* ren, uint32_t* out_slot_index) {
             if (vkResetFences(app->device, 1, &slot->upload_fence) != VK_SUCCESS) {
                 return -1;
             }
+            release_slot_frame(slot);
 
             ren->next_slot = (idx + 1) % VIDEO_UPLOAD_SLOTS;
             *out_slot_index = idx;
@@ -749,6 +905,203 @@ static void copy_plane_rows(uint8_t* dst, size_t dst_row_size, const uint8_t* sr
     }
 }
 
+// Decoded frames land directly in these blocks (video_decoder_set_frame_allocator)
+// and are copied to the video images from there, skipping the staging copy.
+// Decoders read their reference frames back, so the memory has to be host
+// cached; write-combined or device-local host-visible memory would turn
+// every motion-compensated read into a bus round trip.
+#define FRAME_POOL_BUDGET_BYTES ((VkDeviceSize)512 * 1024 * 1024)
+
+static void destroy_frame_block(Renderer* ren, RendererFrameBlock* block) {
+    App* app = ren->app;
+    RendererFramePool* pool = &ren->frame_pool;
+
+    if (block->mapped) {
+        vkUnmapMemory(app->device, block->memory);
+    }
+    if (block->buffer) {
+        vkDestroyBuffer(app->device, block->buffer, NULL);
+    }
+    if (block->memory) {
+        vkFreeMemory(app->device, block->memory, NULL);
+    }
+    pool->allocated_bytes -= block->size;
+    memset(block, 0, sizeof(*block));
+}
+
+static int create_frame_block(Renderer* ren, RendererFrameBlock* block, VkDeviceSize size) {
+    App* app = ren->app;
+    RendererFramePool* pool = &ren->frame_pool;
+
+    block->size = size;
+    pool->allocated_bytes += size;
+    if (create_buffer(app, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, pool->memory_flags, &block->buffer, &block->memory) != 0) {
+        destroy_frame_block(ren, block);
+        return -1;
+    }
+
+    void* mapped = NULL;
+    if (vkMapMemory(app->device, block->memory, 0, VK_WHOLE_SIZE, 0, &mapped) != VK_SUCCESS) {
+        destroy_frame_block(ren, block);
+        return -1;
+    }
+    block->mapped = (uint8_t*)mapped;
+    return 0;
+}
+
+// Takes the smallest idle block that fits without wasting more than half of
+// it. Idle blocks sized for another resolution are dropped to make room.
+static uint8_t* frame_pool_acquire(void* userdata, size_t size, void** out_block) {
+    Renderer* ren = (Renderer*)userdata;
+    RendererFramePool* pool = &ren->frame_pool;
+    RendererFrameBlock* found = NULL;
+
+    SDL_LockMutex(pool->mutex);
+    for (uint32_t i = 0; i < RENDERER_FRAME_POOL_BLOCKS; i++) {
+        RendererFrameBlock* block = &pool->blocks[i];
+        if (block->mapped == NULL || block->in_use || block->size < size || block->size / 2 > size) {
+            continue;
+        }
+        if (found == NULL || block->size < found->size) {
+            found = block;
+        }
+    }
+
+    if (found == NULL) {
+        for (uint32_t i = 0; i < RENDERER_FRAME_POOL_BLOCKS; i++) {
+            RendererFrameBlock* block = &pool->blocks[i];
+            if (block->mapped != NULL && !block->in_use && (block->size < size || block->size / 2 > size)) {
+                destroy_frame_block(ren, block);
+            }
+        }
+        for (uint32_t i = 0; i < RENDERER_FRAME_POOL_BLOCKS; i++) {
+            RendererFrameBlock* block = &pool->blocks[i];
+            if (block->mapped != NULL || pool->allocated_bytes + size > FRAME_POOL_BUDGET_BYTES) {
+                continue;
+            }
+            if (create_frame_block(ren, block, size) == 0) {
+                found = block;
+            }
+            break;
+        }
+    }
+
+    uint8_t* data = NULL;
+    if (found != NULL) {
+        found->in_use = 1;
+        *out_block = found;
+        data = found->mapped;
+    }
+    SDL_UnlockMutex(pool->mutex);
+    return data;
+}
+
+static void frame_pool_release(void* userdata, void* block) {
+    Renderer* ren = (Renderer*)userdata;
+    SDL_LockMutex(ren->frame_pool.mutex);
+    ((RendererFrameBlock*)block)->in_use = 0;
+    SDL_UnlockMutex(ren->frame_pool.mutex);
+}
+
+// The block `frame` was decoded into, provided every plane lies inside it.
+static RendererFrameBlock* frame_pool_find_block(Renderer* ren, const AVFrame* frame, int plane_count) {
+    RendererFramePool* pool = &ren->frame_pool;
+    RendererFrameBlock* found = NULL;
+
+    SDL_LockMutex(pool->mutex);
+    for (uint32_t i = 0; i < RENDERER_FRAME_POOL_BLOCKS && found == NULL; i++) {
+        RendererFrameBlock* block = &pool->blocks[i];
+        if (!block->in_use || frame->data[0] < block->mapped || frame->data[0] >= block->mapped + block->size) {
+            continue;
+        }
+        found = block;
+        for (int p = 1; p < plane_count; p++) {
+            if (frame->data[p] < block->mapped || frame->data[p] >= block->mapped + block->size) {
+                found = NULL;
+            }
+        }
+    }
+    SDL_UnlockMutex(pool->mutex);
+    return found;
+}
+
+// Without a host-cached memory type, or with ZC_DIRECT_UPLOAD=off, decoders
+// keep FFmpeg's own buffers and frames go through staging.
+static void frame_pool_init(Renderer* ren) {
+    App* app = ren->app;
+    RendererFramePool* pool = &ren->frame_pool;
+
+    const char* value = getenv("ZC_DIRECT_UPLOAD");
+    if (value != NULL && (SDL_strcasecmp(value, "off") == 0 || strcmp(value, "0") == 0)) {
+        return;
+    }
+
+    VkBufferCreateInfo probe_info = {
+        .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+        .size = 4096,
+        .usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+    };
+    VkBuffer probe = VK_NULL_HANDLE;
+    if (vkCreateBuffer(app->device, &probe_info, NULL, &probe) != VK_SUCCESS) {
+        return;
+    }
+    VkMemoryRequirements mem_reqs;
+    vkGetBufferMemoryRequirements(app->device, probe, &mem_reqs);
+    vkDestroyBuffer(app->device, probe, NULL);
+
+    const VkMemoryPropertyFlags cached = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+    if (find_memory_type(app, mem_reqs.memoryTypeBits, cached | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != UINT32_MAX) {
+        pool->memory_flags = cached | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    } else if (find_memory_type(app, mem_reqs.memoryTypeBits, cached) != UINT32_MAX) {
+        pool->memory_flags = cached;
+    } else {
+        return;
+    }
+
+    VkPhysicalDeviceProperties props;
+    vkGetPhysicalDeviceProperties(app->gpu, &props);
+    VkDeviceSize alignment = 4;
+    const VkDeviceSize wanted[2] = {props.limits.optimalBufferCopyOffsetAlignment, props.limits.optimalBufferCopyRowPitchAlignment};
+    for (int i = 0; i < 2; i++) {
+        if (wanted[i] > alignment && (wanted[i] & (wanted[i] - 1)) == 0 && wanted[i] <= 4096) {
+            alignment = wanted[i];
+        }
+    }
+    pool->alignment = alignment;
+
+    pool->mutex = SDL_CreateMutex();
+    if (pool->mutex == NULL) {
+        return;
+    }
+
+    const VideoFrameAllocator allocator = {
+        .userdata = ren,
+        .acquire = frame_pool_acquire,
+        .release = frame_pool_release,
+        .alignment = (size_t)pool->alignment,
+    };
+    video_decoder_set_frame_allocator(&allocator);
+}
+
+// Runs once the device is idle and every decoder is gone; blocks still
+// referenced by a frame at this point would be freed under it.
+static void frame_pool_destroy(Renderer* ren) {
+    RendererFramePool* pool = &ren->frame_pool;
+    if (pool->mutex == NULL) {
+        return;
+    }
+
+    video_decoder_set_frame_allocator(NULL);
+    for (uint32_t i = 0; i < RENDERER_FRAME_POOL_BLOCKS; i++) {
+        if (pool->blocks[i].mapped != NULL) {
+            destroy_frame_block(ren, &pool->blocks[i]);
+        }
+    }
+    SDL_DestroyMutex(pool->mutex);
+    pool->mutex = NULL;
+}
+
 static Uint32 sdl_pixel_format_for_video_format(int video_format) {
     switch (video_format) {
         case VIDEO_FORMAT_NV12:
@@ -1076,6 +1429,7 @@ int renderer_init(Renderer* ren, App* app) {
     ren->video_format = VIDEO_FORMAT_RGBA;
     ren->video_image_initialized = 0;
     ren->video_yuv_initialized = 0;
+    frame_pool_init(ren);
     return 0;
 
 fail:
@@ -1103,6 +1457,11 @@ void renderer_destroy(Renderer* ren) {
         vkDeviceWaitIdle(app->device);
     }
 
+    for (uint32_t i = 0; i < VIDEO_UPLOAD_SLOTS; i++) {
+        release_slot_frame(&ren->video_slots[i]);
+    }
+    frame_pool_destroy(ren);
+
     for (uint32_t i = 0; i < VIDEO_UPLOAD_SLOTS; i++) {
         destroy_video_slot_resources(ren, &ren->video_slots[i]);
         if (ren->video_slots[i].upload_fence) {
@@ -1178,6 +1537,7 @@ void renderer_trim_video_resources(Renderer* ren) {
 
     vkDeviceWaitIdle(ren->app->device);
     for (uint32_t i = 0; i < VIDEO_UPLOAD_SLOTS; i++) {
+        release_slot_frame(&ren->video_slots[i]);
         destroy_video_slot_resources(ren, &ren->video_slots[i]);
     }
 
@@ -1761,6 +2121,306 @@ int renderer_upload_video_yuv420p(Renderer* ren, uint8_t* y_plane, int y_linesiz
     return 0;
 }
 
+static int renderer_supports_video_format(Renderer* ren, int video_format) {
+    VideoPlaneLayout layout;
+    if (video_format == VIDEO_FORMAT_RGBA) {
+        return 1;
+    }
+    if (video_plane_layout(video_format, &layout) != 0) {
+        return 0;
+    }
+
+    App* app = ren->app;
+    if (app->render_backend == APP_RENDER_BACKEND_SDL) {
+        return video_format == VIDEO_FORMAT_NV12 || video_format == VIDEO_FORMAT_YUV420P;
+    }
+
+    // R8 and R8G8 sampling is guaranteed; the 16-bit plane formats are not.
+    const VkFormatFeatureFlags required = VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+    const VkFormat formats[2] = {layout.luma_format, layout.chroma_format};
+    for (int i = 0; i < 2; i++) {
+        VkFormatProperties props;
+        vkGetPhysicalDeviceFormatProperties(app->gpu, formats[i], &props);
+        if ((props.optimalTilingFeatures & required) != required) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+uint32_t renderer_native_video_formats(Renderer* ren) {
+    static const int frame_formats[] = {
+        VIDEO_FRAME_FORMAT_RGBA,
+        VIDEO_FRAME_FORMAT_YUV420P,
+        VIDEO_FRAME_FORMAT_NV12,
+        VIDEO_FRAME_FORMAT_P010,
+        VIDEO_FRAME_FORMAT_YUV420P10,
+        VIDEO_FRAME_FORMAT_YUV422P,
+        VIDEO_FRAME_FORMAT_YUV444P,
+        VIDEO_FRAME_FORMAT_YUV422P10,
+        VIDEO_FRAME_FORMAT_YUV444P10,
+    };
+
+    if (ren == NULL || ren->app == NULL) {
+        return 1u << VIDEO_FRAME_FORMAT_RGBA;
+    }
+
+    uint32_t mask = 0;
+    for (size_t i = 0; i < sizeof(frame_formats) / sizeof(frame_formats[0]); i++) {
+        if (renderer_supports_video_format(ren, video_format_for_frame_format(frame_formats[i]))) {
+            mask |= 1u << frame_formats[i];
+        }
+    }
+    return mask;
+}
+
+// Copies each plane from its buffer into the shared video images and makes
+// `slot` the active one. A row length of 0 means tightly packed rows.
+static int submit_video_plane_copies(
+    Renderer* ren,
+    RendererVideoSlot* slot,
+    uint32_t slot_index,
+    uint32_t plane_count,
+    const VkImage* images,
+    const VkBuffer* buffers,
+    const VkDeviceSize* buffer_offsets,
+    const uint32_t* buffer_row_lengths,
+    const int* plane_widths,
+    const int* plane_heights
+) {
+    App* app = ren->app;
+
+    if (vkResetCommandBuffer(slot->upload_cmd, 0) != VK_SUCCESS) {
+        return -1;
+    }
+
+    VkCommandBufferBeginInfo begin_info = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+    };
+    if (vkBeginCommandBuffer(slot->upload_cmd, &begin_info) != VK_SUCCESS) {
+        return -1;
+    }
+
+    VkImageMemoryBarrier pre_barriers[3];
+    VkImageMemoryBarrier post_barriers[3];
+    for (uint32_t i = 0; i < plane_count; i++) {
+        pre_barriers[i] = (VkImageMemoryBarrier){
+            .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            .oldLayout = ren->video_image_initialized ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED,
+            .newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image = images[i],
+            .subresourceRange = {
+                .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                .baseMipLevel = 0,
+                .levelCount = 1,
+                .baseArrayLayer = 0,
+                .layerCount = 1,
+            },
+            .srcAccessMask = ren->video_image_initialized ? VK_ACCESS_SHADER_READ_BIT : 0,
+            .dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+        };
+        post_barriers[i] = pre_barriers[i];
+        post_barriers[i].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        post_barriers[i].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        post_barriers[i].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        post_barriers[i].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    }
+    VkPipelineStageFlags pre_src_stage = ren->video_image_initialized ? VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+    vkCmdPipelineBarrier(slot->upload_cmd, pre_src_stage, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, NULL, 0, NULL, plane_count, pre_barriers);
+
+    for (uint32_t i = 0; i < plane_count; i++) {
+        VkBufferImageCopy region = {
+            .bufferOffset = buffer_offsets[i],
+            .bufferRowLength = buffer_row_lengths[i],
+            .bufferImageHeight = 0,
+            .imageSubresource = {
+                .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                .mipLevel = 0,
+                .baseArrayLayer = 0,
+                .layerCount = 1,
+            },
+            .imageOffset = {0, 0, 0},
+            .imageExtent = {(uint32_t)plane_widths[i], (uint32_t)plane_heights[i], 1},
+        };
+        vkCmdCopyBufferToImage(slot->upload_cmd, buffers[i], images[i], VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+    }
+
+    vkCmdPipelineBarrier(slot->upload_cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, NULL, 0, NULL, plane_count, post_barriers);
+
+    if (vkEndCommandBuffer(slot->upload_cmd) != VK_SUCCESS) {
+        return -1;
+    }
+
+    VkSubmitInfo submit_info = {
+        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+        .commandBufferCount = 1,
+        .pCommandBuffers = &slot->upload_cmd,
+    };
+    if (vkQueueSubmit(app->graphics_queue, 1, &submit_info, slot->upload_fence) != VK_SUCCESS) {
+        return -1;
+    }
+
+    ren->video_image_initialized = 1;
+    ren->video_yuv_initialized = 1;
+    ren->active_slot = slot_index;
+    ren->has_video = 1;
+    return 0;
+}
+
+int renderer_upload_video_planes(Renderer* ren, int format, uint8_t* const* planes, const int* linesizes, int width, int height) {
+    if (ren == NULL || planes == NULL || linesizes == NULL || width <= 0 || height <= 0) {
+        return -1;
+    }
+
+    const int video_format = video_format_for_frame_format(format);
+    if (video_format == VIDEO_FORMAT_NV12) {
+        return renderer_upload_video_nv12(ren, planes[0], linesizes[0], planes[1], linesizes[1], width, height);
+    }
+    if (video_format == VIDEO_FORMAT_YUV420P) {
+        return renderer_upload_video_yuv420p(ren, planes[0], linesizes[0], planes[1], linesizes[1], planes[2], linesizes[2], width, height);
+    }
+
+    VideoPlaneLayout layout;
+    if (video_plane_layout(video_format, &layout) != 0 || !renderer_supports_video_format(ren, video_format)) {
+        return -1;
+    }
+
+    const int chroma_width = chroma_extent(width, layout.chroma_shift_x);
+    const int chroma_height = chroma_extent(height, layout.chroma_shift_y);
+    const size_t chroma_samples = layout.plane_count == 2 ? 2 : 1;
+    const uint32_t plane_count = (uint32_t)layout.plane_count;
+    int plane_widths[3] = {width, chroma_width, chroma_width};
+    int plane_heights[3] = {height, chroma_height, chroma_height};
+    size_t row_sizes[3] = {
+        (size_t)width * layout.bytes_per_sample,
+        (size_t)chroma_width * chroma_samples * layout.bytes_per_sample,
+        (size_t)chroma_width * layout.bytes_per_sample,
+    };
+
+    for (uint32_t i = 0; i < plane_count; i++) {
+        if (planes[i] == NULL || linesizes[i] < (int)row_sizes[i]) {
+            return -1;
+        }
+    }
+
+    RendererVideoSlot* image_slot = &ren->video_slots[0];
+    if (ren->video_width != width || ren->video_height != height || ren->video_format != video_format || image_slot->image == VK_NULL_HANDLE || image_slot->uv_image == VK_NULL_HANDLE || (plane_count > 2 && image_slot->v_image == VK_NULL_HANDLE)) {
+        if (recreate_video_resources(ren, width, height, video_format) != 0) {
+            return -1;
+        }
+    }
+
+    uint32_t slot_index = 0;
+    int slot_status = acquire_upload_slot(ren, &slot_index);
+    if (slot_status != 0) {
+        return slot_status > 0 ? 1 : -1;
+    }
+
+    RendererVideoSlot* slot = &ren->video_slots[slot_index];
+    uint8_t* staging_mapped[3] = {slot->staging_mapped, slot->uv_staging_mapped, slot->v_staging_mapped};
+    VkBuffer staging_buffers[3] = {slot->staging_buffer, slot->uv_staging_buffer, slot->v_staging_buffer};
+    VkImage images[3] = {image_slot->image, image_slot->uv_image, image_slot->v_image};
+
+    for (uint32_t i = 0; i < plane_count; i++) {
+        if (staging_mapped[i] == NULL) {
+            return -1;
+        }
+        copy_plane_rows(staging_mapped[i], row_sizes[i], planes[i], linesizes[i], plane_heights[i]);
+    }
+
+    const VkDeviceSize buffer_offsets[3] = {0, 0, 0};
+    const uint32_t buffer_row_lengths[3] = {0, 0, 0};
+    return submit_video_plane_copies(ren, slot, slot_index, plane_count, images, staging_buffers, buffer_offsets, buffer_row_lengths, plane_widths, plane_heights);
+}
+
+// Frames the decoder wrote into the frame pool are copied to the video images
+// straight from there; anything else goes through staging as usual.
+int renderer_upload_decoded_frame(Renderer* ren, uint64_t frame_token, int format, int width, int height) {
+    if (ren == NULL || frame_token == 0 || width <= 0 || height <= 0) {
+        return -1;
+    }
+
+    const AVFrame* frame = (const AVFrame*)(uintptr_t)frame_token;
+    uint8_t* const planes[3] = {frame->data[0], frame->data[1], frame->data[2]};
+    const int linesizes[3] = {frame->linesize[0], frame->linesize[1], frame->linesize[2]};
+
+    const int video_format = video_format_for_frame_format(format);
+    VideoPlaneLayout layout;
+    RendererFrameBlock* block = NULL;
+    if (ren->frame_pool.mutex != NULL && video_plane_layout(video_format, &layout) == 0 && renderer_supports_video_format(ren, video_format)) {
+        block = frame_pool_find_block(ren, frame, layout.plane_count);
+    }
+    if (block == NULL) {
+        return renderer_upload_video_planes(ren, format, planes, linesizes, width, height);
+    }
+
+    const int chroma_width = chroma_extent(width, layout.chroma_shift_x);
+    const int chroma_height = chroma_extent(height, layout.chroma_shift_y);
+    const size_t chroma_samples = layout.plane_count == 2 ? 2 : 1;
+    const uint32_t plane_count = (uint32_t)layout.plane_count;
+    int plane_widths[3] = {width, chroma_width, chroma_width};
+    int plane_heights[3] = {height, chroma_height, chroma_height};
+    const size_t texel_sizes[3] = {
+        layout.bytes_per_sample,
+        layout.bytes_per_sample * chroma_samples,
+        layout.bytes_per_sample,
+    };
+    VkDeviceSize buffer_offsets[3] = {0, 0, 0};
+    uint32_t buffer_row_lengths[3] = {0, 0, 0};
+    VkBuffer buffers[3] = {block->buffer, block->buffer, block->buffer};
+
+    for (uint32_t i = 0; i < plane_count; i++) {
+        const size_t offset = (size_t)(planes[i] - block->mapped);
+        const size_t row_bytes = (size_t)plane_widths[i] * texel_sizes[i];
+        if (linesizes[i] < (int)row_bytes || linesizes[i] % (int)texel_sizes[i] != 0 || offset % 4 != 0 || offset % texel_sizes[i] != 0 ||
+            offset + (size_t)linesizes[i] * (size_t)(plane_heights[i] - 1) + row_bytes > block->size) {
+            return renderer_upload_video_planes(ren, format, planes, linesizes, width, height);
+        }
+        buffer_offsets[i] = offset;
+        buffer_row_lengths[i] = (uint32_t)((size_t)linesizes[i] / texel_sizes[i]);
+    }
+
+    RendererVideoSlot* image_slot = &ren->video_slots[0];
+    if (ren->video_width != width || ren->video_height != height || ren->video_format != video_format || image_slot->image == VK_NULL_HANDLE || image_slot->uv_image == VK_NULL_HANDLE || (plane_count > 2 && image_slot->v_image == VK_NULL_HANDLE)) {
+        if (recreate_video_resources(ren, width, height, video_format) != 0) {
+            return -1;
+        }
+    }
+
+    uint32_t slot_index = 0;
+    int slot_status = acquire_upload_slot(ren, &slot_index);
+    if (slot_status != 0) {
+        return slot_status > 0 ? 1 : -1;
+    }
+
+    RendererVideoSlot* slot = &ren->video_slots[slot_index];
+    AVFrame* retained = av_frame_clone(frame);
+    if (retained == NULL) {
+        return -1;
+    }
+    slot->retained_frame_token = (uint64_t)(uintptr_t)retained;
+
+    if ((ren->frame_pool.memory_flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) == 0) {
+        VkMappedMemoryRange range = {
+            .sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE,
+            .memory = block->memory,
+            .offset = 0,
+            .size = VK_WHOLE_SIZE,
+        };
+        vkFlushMappedMemoryRanges(ren->app->device, 1, &range);
+    }
+
+    VkImage images[3] = {image_slot->image, image_slot->uv_image, image_slot->v_image};
+    if (submit_video_plane_copies(ren, slot, slot_index, plane_count, images, buffers, buffer_offsets, buffer_row_lengths, plane_widths, plane_heights) != 0) {
+        release_slot_frame(slot);
+        return -1;
+    }
+    return 0;
+}
+
 int renderer_submit_interop_handle(Renderer* ren, uint64_t handle_token, int width, int height, int format) {
     if (ren == NULL || width <= 0 || height <= 0) {
         return -1;
@@ -1801,6 +2461,10 @@ int renderer_submit_interop_handle(Renderer* ren, uint64_t handle_token, int wid
         );
     }
 
+    if (video_format_for_frame_format(format) != VIDEO_FORMAT_RGBA) {
+        return renderer_upload_video_planes(ren, format, frame->planes, frame->linesizes, width, height);
+    }
+
     return renderer_upload_video(
         ren,
         frame->planes[0],
@@ -2012,9 +2676,15 @@ void renderer_render(Renderer* ren) {
 
     vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, ren->pipeline);
     vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, ren->pipeline_layout, 0, 1, &slot->descriptor_set, 0, NULL);
+    VideoPlaneLayout layout;
     VideoPushConstants push_constants = {
-        .mode = ren->video_format,
+        .mode = VIDEO_SHADER_MODE_RGBA,
+        .sample_scale = 1.0f,
     };
+    if (video_plane_layout(ren->video_format, &layout) == 0) {
+        push_constants.mode = layout.shader_mode;
+        push_constants.sample_scale = layout.sample_scale;
+    }
     vkCmdPushConstants(cmd, ren->pipeline_layout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(push_constants), &push_constants);
     vkCmdDraw(cmd, 6, 1, 0, 0);
 }
@@ -6,6 +6,7 @@
 #include "app/app.h"
 
 #define VIDEO_UPLOAD_SLOTS 2
+#define RENDERER_FRAME_POOL_BLOCKS 32
 
 typedef enum {
     RENDERER_INTEROP_PAYLOAD_HOST = 0,
@@ -51,8 +52,25 @@ typedef struct {
     int imported_external;
     int image_initialized;
     int yuv_initialized;
+    uint64_t retained_frame_token;
 } RendererVideoSlot;
 
+typedef struct {
+    VkBuffer buffer;
+    VkDeviceMemory memory;
+    uint8_t* mapped;
+    VkDeviceSize size;
+    int in_use;
+} RendererFrameBlock;
+
+typedef struct {
+    SDL_Mutex* mutex;
+    RendererFrameBlock blocks[RENDERER_FRAME_POOL_BLOCKS];
+    VkMemoryPropertyFlags memory_flags;
+    VkDeviceSize alignment;
+    VkDeviceSize allocated_bytes;
+} RendererFramePool;
+
 typedef struct {
     App* app;
     VkShaderModule vert_module;
@@ -65,6 +83,7 @@ typedef struct {
     VkDeviceMemory vertex_memory;
     VkSampler video_sampler;
     RendererVideoSlot video_slots[VIDEO_UPLOAD_SLOTS];
+    RendererFramePool frame_pool;
     uint32_t active_slot;
     uint32_t next_slot;
     int video_width;
@@ -81,6 +100,9 @@ void renderer_destroy(Renderer* ren);
 int renderer_upload_video(Renderer* ren, uint8_t* data, int width, int height, int linesize);
 int renderer_upload_video_nv12(Renderer* ren, uint8_t* y_plane, int y_linesize, uint8_t* uv_plane, int uv_linesize, int width, int height);
 int renderer_upload_video_yuv420p(Renderer* ren, uint8_t* y_plane, int y_linesize, uint8_t* u_plane, int u_linesize, uint8_t* v_plane, int v_linesize, int width, int height);
+int renderer_upload_video_planes(Renderer* ren, int format, uint8_t* const* planes, const int* linesizes, int width, int height);
+int renderer_upload_decoded_frame(Renderer* ren, uint64_t frame_token, int format, int width, int height);
+uint32_t renderer_native_video_formats(Renderer* ren);
 int renderer_submit_interop_handle(Renderer* ren, uint64_t handle_token, int width, int height, int format);
 int renderer_submit_true_zero_copy_handle(Renderer* ren, uint64_t handle_token, int width, int height, int format);
 int renderer_recreate_for_swapchain(Renderer* ren);
@@ -122,6 +122,21 @@ static const char* hw_backend_label(int backend) {
     }
 }
 
+static const char* decode_skip_label(int skip) {
+    switch (skip) {
+        case VIDEO_DECODE_SKIP_NONE:
+            return "none";
+        case VIDEO_DECODE_SKIP_LOOP_FILTER:
+            return "loop filter";
+        case VIDEO_DECODE_SKIP_NONREF:
+            return "loop filter + non-ref frames";
+        case VIDEO_DECODE_SKIP_IDCT:
+            return "loop filter + non-ref frames + idct";
+        default:
+            return "unknown";
+    }
+}
+
 static const char* hw_policy_label(int policy) {
     switch (policy) {
         case VIDEO_HW_POLICY_AUTO:
@@ -154,6 +169,39 @@ static const char* render_backend_label(const App* app) {
     }
 }
 
+static void draw_track_combo(const PlaybackSnapshot* snapshot, int kind, const char* label) {
+    int count = 0;
+    const PlaybackTrack* selected = NULL;
+    for (int i = 0; i < snapshot->track_count && i < PLAYBACK_MAX_TRACKS; i++) {
+        if (snapshot->tracks[i].kind == kind) {
+            count++;
+            if (snapshot->tracks[i].selected) {
+                selected = &snapshot->tracks[i];
+            }
+        }
+    }
+    if (count < 2) {
+        return;
+    }
+
+    ImGui::SameLine();
+    ImGui::SetNextItemWidth(160.0f);
+    if (ImGui::BeginCombo(label, selected ? selected->label : "none")) {
+        for (int i = 0; i < snapshot->track_count && i < PLAYBACK_MAX_TRACKS; i++) {
+            const PlaybackTrack* track = &snapshot->tracks[i];
+            if (track->kind != kind) {
+                continue;
+            }
+            ImGui::PushID(track->stream_index);
+            if (ImGui::Selectable(track->label, track->selected != 0) && !track->selected) {
+                queue_action(UI_ACTION_SELECT_TRACK, (double)track->stream_index);
+            }
+            ImGui::PopID();
+        }
+        ImGui::EndCombo();
+    }
+}
+
 static void draw_debug_panel(const PlaybackSnapshot* snapshot) {
     if (!snapshot) {
         return;
@@ -176,6 +224,19 @@ static void draw_debug_panel(const PlaybackSnapshot* snapshot) {
 
     ImGui::Text("Video Codec: %s", snapshot->video_codec[0] ? snapshot->video_codec : "unknown");
     ImGui::Text("Video Bitrate: %d kbps", snapshot->video_bitrate_kbps);
+    if (snapshot->video_decode_threads[0]) {
+        ImGui::Text("Decode Threads: %s", snapshot->video_decode_threads);
+    }
+    if (snapshot->has_media) {
+        ImGui::Text("Decode Skip: %s, %d keyframe catch-ups",
+                    decode_skip_label(snapshot->video_decode_skip),
+                    snapshot->video_catch_ups);
+    }
+    if (snapshot->video_convert_ms > 0.0) {
+        ImGui::Text("RGBA Convert: %.2f ms/frame, %d threads",
+                    snapshot->video_convert_ms,
+                    snapshot->video_scale_threads);
+    }
     if (snapshot->video_fps_num > 0 && snapshot->video_fps_den > 0) {
         ImGui::Text("FPS: %.3f (%d/%d)",
                     (double)snapshot->video_fps_num / (double)snapshot->video_fps_den,
@@ -192,6 +253,49 @@ static void draw_debug_panel(const PlaybackSnapshot* snapshot) {
         ImGui::Text("Audio: %d Hz / %d ch", snapshot->audio_sample_rate, snapshot->audio_channels);
     }
 
+    ImGui::Separator();
+    ImGui::Text("Demux Video: %d KiB / %d ms (%d%%)",
+                snapshot->demux_video_buffered_kb,
+                snapshot->demux_video_buffered_ms,
+                snapshot->demux_video_fill_percent);
+    ImGui::Text("Demux Audio: %d KiB / %d ms (%d%%)",
+                snapshot->demux_audio_buffered_kb,
+                snapshot->demux_audio_buffered_ms,
+                snapshot->demux_audio_fill_percent);
+    ImGui::Text("Demux Starvation Overflows: %d", snapshot->demux_starvation_overflows);
+    if (snapshot->net_cache_hits + snapshot->net_cache_misses > 0) {
+        ImGui::Text("Network Cache: %d hit / %d miss chunks, %d KiB downloaded",
+                    snapshot->net_cache_hits,
+                    snapshot->net_cache_misses,
+                    snapshot->net_downloaded_kb);
+    }
+    if (snapshot->abr_variant_count > 0) {
+        ImGui::Text("ABR: %d kbps variant, %d kbps estimate, %d variants, %d switches (last %d ms)",
+                    snapshot->abr_variant_kbps,
+                    snapshot->abr_bandwidth_kbps,
+                    snapshot->abr_variant_count,
+                    snapshot->abr_switches,
+                    snapshot->abr_switch_latency_ms);
+    }
+    if (snapshot->live) {
+        ImGui::Text("Live: %d ms behind (target %d ms)%s, %d trims",
+                    snapshot->live_latency_ms,
+                    snapshot->live_target_ms,
+                    snapshot->live_catching_up ? ", catching up" : "",
+                    snapshot->live_trims);
+    }
+    if (snapshot->has_media) {
+        ImGui::Text("Rebuffers: %d", snapshot->rebuffers);
+        ImGui::Text("Open: %s probe, first frame %d ms",
+                    snapshot->open_probe[0] ? snapshot->open_probe : "unknown",
+                    snapshot->open_to_first_frame_ms);
+        if (snapshot->switch_ms > 0) {
+            ImGui::Text("Switch: %d ms, reused %s",
+                        snapshot->switch_ms,
+                        snapshot->switch_reused);
+        }
+    }
+
     ImGui::Separator();
     ImGui::Text("Render Backend: %s", render_backend_label(g_ui_runtime.app));
     ImGui::Text("HW Decode: %s", snapshot->video_hw_enabled ? "on" : "off");
@@ -499,6 +603,8 @@ void ui_render(UIState* ui, const PlaybackSnapshot* snapshot) {
             g_ui_runtime.show_debug_panel = !g_ui_runtime.show_debug_panel;
         }
 
+        draw_track_combo(snapshot, PLAYBACK_TRACK_VIDEO, "Video");
+        draw_track_combo(snapshot, PLAYBACK_TRACK_AUDIO, "Audio");
     }
     ImGui::End();
     ImGui::PopStyleVar(4);
@@ -24,6 +24,7 @@ typedef enum {
     UI_ACTION_SEEK_ABS,
     UI_ACTION_SET_VOLUME,
     UI_ACTION_SET_SPEED,
+    UI_ACTION_SELECT_TRACK,
 } UIActionType;
 
 typedef struct {
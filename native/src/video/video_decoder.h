@@ -27,16 +27,25 @@ typedef struct {
     enum AVPixelFormat hw_pix_fmt;
     enum AVHWDeviceType hw_device_type;
     int hw_enabled;
-    uint8_t* temp_data[4];
-    int temp_linesize[4];
-    uint8_t* buffer;
-    int buffer_size;
+    int skip_level;
+    AVFrame* rgba_frame;
+    int scale_threads;
+    double convert_ms;
+    AVCodecParameters* params;
+    void* intra_pool;
+    int intra_instances;
 } VideoDecoder;
 
 typedef enum {
     VIDEO_FRAME_FORMAT_RGBA = 0,
     VIDEO_FRAME_FORMAT_YUV420P = 1,
     VIDEO_FRAME_FORMAT_NV12 = 2,
+    VIDEO_FRAME_FORMAT_P010 = 3,
+    VIDEO_FRAME_FORMAT_YUV420P10 = 4,
+    VIDEO_FRAME_FORMAT_YUV422P = 5,
+    VIDEO_FRAME_FORMAT_YUV444P = 6,
+    VIDEO_FRAME_FORMAT_YUV422P10 = 7,
+    VIDEO_FRAME_FORMAT_YUV444P10 = 8,
 } VideoFrameFormat;
 
 typedef enum {
@@ -46,6 +55,34 @@ typedef enum {
     VIDEO_HW_BACKEND_DXVA2 = 3,
 } VideoHwBackend;
 
+typedef enum {
+    VIDEO_DECODE_THREADS_AUTO = 0,
+    VIDEO_DECODE_THREADS_FRAME = 1,
+    VIDEO_DECODE_THREADS_SLICE = 2,
+    VIDEO_DECODE_THREADS_OFF = 3,
+    /* Intra-only streams: independent decoder instances, one frame each. */
+    VIDEO_DECODE_THREADS_INSTANCES = 4,
+} VideoDecodeThreadMode;
+
+typedef struct {
+    int mode;
+    int thread_count;
+} VideoDecodeThreading;
+
+typedef struct {
+    const char* decoder_name;
+    const VideoDecodeThreading* threading;
+    /* 0 reads ZC_INTRA_DECODERS; -1 disables; otherwise the instance count. */
+    int intra_instances;
+} VideoDecoderOptions;
+
+typedef enum {
+    VIDEO_DECODE_SKIP_NONE = 0,
+    VIDEO_DECODE_SKIP_LOOP_FILTER = 1,
+    VIDEO_DECODE_SKIP_NONREF = 2,
+    VIDEO_DECODE_SKIP_IDCT = 3,
+} VideoDecodeSkipLevel;
+
 typedef enum {
     VIDEO_HW_POLICY_AUTO = 0,
     VIDEO_HW_POLICY_OFF = 1,
@@ -54,10 +91,26 @@ typedef enum {
     VIDEO_HW_POLICY_VIDEOTOOLBOX = 4,
 } VideoHwPolicy;
 
+/* Mapped memory the renderer can copy to the GPU from directly. `acquire`
+   returns a block of at least `size` bytes and stores its handle in `block`,
+   or returns NULL when none is free; `release` hands a block back once no
+   frame refers to it. Rows and planes are aligned to `alignment` bytes. */
+typedef struct {
+    void* userdata;
+    uint8_t* (*acquire)(void* userdata, size_t size, void** block);
+    void (*release)(void* userdata, void* block);
+    size_t alignment;
+} VideoFrameAllocator;
+
 int video_decoder_init(VideoDecoder* dec, AVStream* stream);
+int video_decoder_init_with_threading(VideoDecoder* dec, AVStream* stream, const VideoDecodeThreading* threading);
+int video_decoder_init_with_options(VideoDecoder* dec, AVStream* stream, const VideoDecoderOptions* options);
 void video_decoder_destroy(VideoDecoder* dec);
+int video_decoder_reuse(VideoDecoder* dec, AVStream* stream);
 void video_decoder_flush(VideoDecoder* dec);
 int video_decoder_decode_frame(VideoDecoder* dec, struct Demuxer* demuxer);
+int video_decoder_send_packet(VideoDecoder* dec, const AVPacket* packet);
+int video_decoder_receive_frame(VideoDecoder* dec);
 int video_decoder_get_image(VideoDecoder* dec, uint8_t** data, int* linesize);
 int video_decoder_get_planes(VideoDecoder* dec, uint8_t** planes, int* linesizes, int* plane_count);
 int video_decoder_get_format(VideoDecoder* dec);
@@ -65,5 +118,9 @@ int video_decoder_is_hw_enabled(VideoDecoder* dec);
 int video_decoder_get_hw_backend(VideoDecoder* dec);
 int video_decoder_get_hw_policy(void);
 uint64_t video_decoder_get_hw_frame_token(VideoDecoder* dec);
+int video_decoder_get_threading(VideoDecoder* dec, VideoDecodeThreading* threading);
+void video_decoder_set_skip_level(VideoDecoder* dec, int level);
+void video_decoder_set_native_formats(uint32_t format_mask);
+void video_decoder_set_frame_allocator(const VideoFrameAllocator* allocator);
 
 #endif
@@ -24,6 +24,8 @@ typedef struct {
     Player* player;
     SDL_Thread* decode_thread;
     int decode_running;
+    int decode_parked;
+    int decode_idle;
 
     VideoPipelineFrame frames[VIDEO_FRAME_QUEUE_CAPACITY];
     int head;
@@ -50,15 +52,23 @@ typedef struct {
 
     double clock_base_pts;
     Uint64 clock_base_time_ns;
+    double clock_speed;
     double expected_start_pts;
     int pts_offset_valid;
     double pts_offset;
+
+    double render_clock;
+    int degrade_reset;
+    int decode_skip_level;
+    int catch_ups;
 } VideoPipeline;
 
 int video_pipeline_init(VideoPipeline* pipeline, Player* player);
 int video_pipeline_start(VideoPipeline* pipeline);
 void video_pipeline_stop(VideoPipeline* pipeline);
 void video_pipeline_reset(VideoPipeline* pipeline);
+void video_pipeline_park(VideoPipeline* pipeline);
+void video_pipeline_unpark(VideoPipeline* pipeline);
 void video_pipeline_destroy(VideoPipeline* pipeline);
 int video_pipeline_get_frame_for_render(
     VideoPipeline* pipeline,
@@ -74,5 +84,7 @@ int video_pipeline_get_frame_for_render(
 );
 
 void video_pipeline_set_true_zero_copy_active(VideoPipeline* pipeline, int active);
+int video_pipeline_get_decode_skip_level(VideoPipeline* pipeline);
+int video_pipeline_get_catch_up_count(VideoPipeline* pipeline);
 
 #endif
@@ -6,12 +6,15 @@ const VideoBackendStatus = SnapshotMod.VideoBackendStatus;
 const VideoFallbackReason = SnapshotMod.VideoFallbackReason;
 const VideoHwBackend = SnapshotMod.VideoHwBackend;
 const VideoHwPolicy = SnapshotMod.VideoHwPolicy;
+const VideoDecodeSkip = SnapshotMod.VideoDecodeSkip;
+const Snapshot = SnapshotMod.Snapshot;
 const gui = @import("../ffi/gui.zig").c;
 
 const UploadPath = enum {
     rgba,
     nv12,
     yuv420p,
+    planes,
 };
 
 const InteropSubmitPath = enum {
@@ -28,7 +31,17 @@ fn selectUploadPath(format: c_int, plane_count: c_int) UploadPath {
     if (format == gui.VIDEO_FRAME_FORMAT_YUV420P and plane_count >= 3) {
         return .yuv420p;
     }
-    return .rgba;
+    const required_planes: c_int = switch (format) {
+        gui.VIDEO_FRAME_FORMAT_P010 => 2,
+        gui.VIDEO_FRAME_FORMAT_YUV420P10,
+        gui.VIDEO_FRAME_FORMAT_YUV422P,
+        gui.VIDEO_FRAME_FORMAT_YUV444P,
+        gui.VIDEO_FRAME_FORMAT_YUV422P10,
+        gui.VIDEO_FRAME_FORMAT_YUV444P10,
+        => 3,
+        else => return .rgba,
+    };
+    return if (plane_count >= required_planes) .planes else .rgba;
 }
 
 fn playerStateFromValue(value: c_int) gui.PlayerState {
@@ -77,6 +90,15 @@ fn toGuiHwBackend(backend: VideoHwBackend) c_int {
     };
 }
 
+fn toGuiDecodeSkip(skip: VideoDecodeSkip) c_int {
+    return switch (skip) {
+        .none => gui.VIDEO_DECODE_SKIP_NONE,
+        .loop_filter => gui.VIDEO_DECODE_SKIP_LOOP_FILTER,
+        .nonref => gui.VIDEO_DECODE_SKIP_NONREF,
+        .idct => gui.VIDEO_DECODE_SKIP_IDCT,
+    };
+}
+
 fn toGuiHwPolicy(policy: VideoHwPolicy) c_int {
     return switch (policy) {
         .auto => gui.VIDEO_HW_POLICY_AUTO,
@@ -87,6 +109,21 @@ fn toGuiHwPolicy(policy: VideoHwPolicy) c_int {
     };
 }
 
+fn toGuiTracks(snapshot: *const Snapshot) [gui.PLAYBACK_MAX_TRACKS]gui.PlaybackTrack {
+    var tracks = std.mem.zeroes([gui.PLAYBACK_MAX_TRACKS]gui.PlaybackTrack);
+    const count = @min(@as(usize, @intCast(@max(snapshot.track_count, 0))), tracks.len);
+    for (snapshot.tracks[0..count], tracks[0..count]) |track, *out| {
+        out.stream_index = track.stream_index;
+        out.kind = switch (track.kind) {
+            .video => gui.PLAYBACK_TRACK_VIDEO,
+            .audio => gui.PLAYBACK_TRACK_AUDIO,
+        };
+        out.selected = if (track.selected) 1 else 0;
+        out.label = track.label;
+    }
+    return tracks;
+}
+
 fn selectInteropSubmitPath(status: VideoBackendStatus) InteropSubmitPath {
     return if (status == .true_zero_copy) .true_zero_copy else .interop_handle;
 }
@@ -174,6 +211,7 @@ pub const App = struct {
             return error.RendererInitFailed;
         }
         defer gui.renderer_destroy(&renderer);
+        gui.video_decoder_set_native_formats(gui.renderer_native_video_formats(&renderer));
 
         gui.app_set_render_callback(&app, renderVideoCallback, &renderer);
         gui.app_set_swapchain_recreate_callback(&app, swapchainRecreatedCallback, &renderer);
@@ -238,6 +276,9 @@ pub const App = struct {
                     gui.UI_ACTION_SET_SPEED => {
                         _ = self.engine.sendSpeed(action.value) catch {};
                     },
+                    gui.UI_ACTION_SELECT_TRACK => {
+                        _ = self.engine.sendSelectTrack(@intFromFloat(action.value)) catch {};
+                    },
                     gui.UI_ACTION_NONE => {},
                     else => {},
                 }
@@ -252,7 +293,15 @@ pub const App = struct {
                     switch (frame) {
                         .software => |sw| {
                             const path = selectUploadPath(@intFromEnum(sw.format), sw.plane_count);
-                            switch (path) {
+                            if (path != .rgba and sw.frame_token != 0) {
+                                _ = gui.renderer_upload_decoded_frame(
+                                    &renderer,
+                                    sw.frame_token,
+                                    @intFromEnum(sw.format),
+                                    sw.width,
+                                    sw.height,
+                                );
+                            } else switch (path) {
                                 .nv12 => {
                                     _ = gui.renderer_upload_video_nv12(
                                         &renderer,
@@ -277,6 +326,16 @@ pub const App = struct {
                                         sw.height,
                                     );
                                 },
+                                .planes => {
+                                    _ = gui.renderer_upload_video_planes(
+                                        &renderer,
+                                        @intFromEnum(sw.format),
+                                        &sw.planes,
+                                        &sw.linesizes,
+                                        sw.width,
+                                        sw.height,
+                                    );
+                                },
                                 .rgba => {
                                     _ = gui.renderer_upload_video(
                                         &renderer,
@@ -344,12 +403,44 @@ pub const App = struct {
                 .media_bitrate_kbps = snapshot.media_bitrate_kbps,
                 .video_codec = snapshot.video_codec,
                 .video_bitrate_kbps = snapshot.video_bitrate_kbps,
+                .video_decode_threads = snapshot.video_decode_threads,
+                .video_decode_skip = toGuiDecodeSkip(snapshot.video_decode_skip),
+                .video_catch_ups = snapshot.video_catch_ups,
+                .video_convert_ms = snapshot.video_convert_ms,
+                .video_scale_threads = snapshot.video_scale_threads,
                 .video_fps_num = snapshot.video_fps_num,
                 .video_fps_den = snapshot.video_fps_den,
                 .audio_codec = snapshot.audio_codec,
                 .audio_bitrate_kbps = snapshot.audio_bitrate_kbps,
                 .audio_sample_rate = snapshot.audio_sample_rate,
                 .audio_channels = snapshot.audio_channels,
+                .demux_video_buffered_kb = snapshot.demux_video_buffered_kb,
+                .demux_video_buffered_ms = snapshot.demux_video_buffered_ms,
+                .demux_video_fill_percent = snapshot.demux_video_fill_percent,
+                .demux_audio_buffered_kb = snapshot.demux_audio_buffered_kb,
+                .demux_audio_buffered_ms = snapshot.demux_audio_buffered_ms,
+                .demux_audio_fill_percent = snapshot.demux_audio_fill_percent,
+                .demux_starvation_overflows = snapshot.demux_starvation_overflows,
+                .net_cache_hits = snapshot.net_cache_hits,
+                .net_cache_misses = snapshot.net_cache_misses,
+                .net_downloaded_kb = snapshot.net_downloaded_kb,
+                .rebuffers = snapshot.rebuffers,
+                .abr_variant_count = snapshot.abr_variant_count,
+                .abr_variant_kbps = snapshot.abr_variant_kbps,
+                .abr_bandwidth_kbps = snapshot.abr_bandwidth_kbps,
+                .abr_switches = snapshot.abr_switches,
+                .abr_switch_latency_ms = snapshot.abr_switch_latency_ms,
+                .live = if (snapshot.live) 1 else 0,
+                .live_latency_ms = snapshot.live_latency_ms,
+                .live_target_ms = snapshot.live_target_ms,
+                .live_catching_up = if (snapshot.live_catching_up) 1 else 0,
+                .live_trims = snapshot.live_trims,
+                .open_probe = snapshot.open_probe,
+                .open_to_first_frame_ms = snapshot.open_to_first_frame_ms,
+                .switch_ms = snapshot.switch_ms,
+                .switch_reused = snapshot.switch_reused,
+                .track_count = snapshot.track_count,
+                .tracks = toGuiTracks(&snapshot),
             };
 
             gui.ui_new_frame();
@@ -384,6 +475,13 @@ test "selectUploadPath prefers nv12 and yuv420p over rgba" {
 test "selectUploadPath falls back to rgba when planes are incomplete" {
     try std.testing.expectEqual(.rgba, selectUploadPath(gui.VIDEO_FRAME_FORMAT_NV12, 1));
     try std.testing.expectEqual(.rgba, selectUploadPath(gui.VIDEO_FRAME_FORMAT_YUV420P, 2));
+    try std.testing.expectEqual(.rgba, selectUploadPath(gui.VIDEO_FRAME_FORMAT_YUV444P10, 2));
+}
+
+test "selectUploadPath sends high bit depth and 4:2:2/4:4:4 through the plane path" {
+    try std.testing.expectEqual(.planes, selectUploadPath(gui.VIDEO_FRAME_FORMAT_P010, 2));
+    try std.testing.expectEqual(.planes, selectUploadPath(gui.VIDEO_FRAME_FORMAT_YUV420P10, 3));
+    try std.testing.expectEqual(.planes, selectUploadPath(gui.VIDEO_FRAME_FORMAT_YUV422P, 3));
 }
 
 test "toGuiBackendStatus maps interop statuses" {
@@ -36,6 +36,22 @@ pub const AudioOutput = struct {
         c.audio_output_reset(&self.handle);
     }
 
+    pub fn park(self: *AudioOutput) void {
+        if (!self.initialized) {
+            return;
+        }
+        c.audio_output_park(&self.handle);
+    }
+
+    /// False when the open device cannot play the player's new audio; the
+    /// output is left parked and still needs `destroy`.
+    pub fn reuse(self: *AudioOutput, player: *Player) bool {
+        if (!self.initialized) {
+            return false;
+        }
+        return c.audio_output_reuse(&self.handle, player.raw()) == 0;
+    }
+
     pub fn setPaused(self: *AudioOutput, paused: bool) void {
         if (!self.initialized) {
             return;
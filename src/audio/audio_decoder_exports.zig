@@ -32,6 +32,7 @@ pub export fn audio_decoder_init(dec: ?*c.AudioDecoder, stream: ?*c.AVStream) c_
         audio_decoder_destroy(d);
         return -1;
     }
+    d.codec_ctx.*.pkt_timebase = stream.?.time_base;
 
     if (c.avcodec_open2(d.codec_ctx, codec, null) < 0) {
         audio_decoder_destroy(d);
@@ -45,7 +46,8 @@ pub export fn audio_decoder_init(dec: ?*c.AudioDecoder, stream: ?*c.AVStream) c_
 
     d.packet = c.av_packet_alloc();
     d.frame = c.av_frame_alloc();
-    if (d.packet == null or d.frame == null) {
+    d.params = c.avcodec_parameters_alloc();
+    if (d.packet == null or d.frame == null or d.params == null or c.avcodec_parameters_copy(d.params, stream.?.codecpar) < 0) {
         audio_decoder_destroy(d);
         return -1;
     }
@@ -137,6 +139,10 @@ pub export fn audio_decoder_destroy(dec: ?*c.AudioDecoder) void {
         c.avcodec_free_context(&d.codec_ctx);
     }
 
+    if (d.params != null) {
+        c.avcodec_parameters_free(&d.params);
+    }
+
     d.stream = null;
     d.sample_rate = 0;
     d.channels = 0;
@@ -146,6 +152,40 @@ pub export fn audio_decoder_destroy(dec: ?*c.AudioDecoder) void {
     d.sent_eof = 0;
 }
 
+fn sameDecoderParameters(a: *const c.AVCodecParameters, b: *const c.AVCodecParameters) bool {
+    if (a.codec_type != b.codec_type or a.codec_id != b.codec_id or a.format != b.format or a.sample_rate != b.sample_rate) {
+        return false;
+    }
+    if (c.av_channel_layout_compare(&a.ch_layout, &b.ch_layout) != 0 or a.extradata_size != b.extradata_size) {
+        return false;
+    }
+    const len: usize = @intCast(@max(a.extradata_size, 0));
+    return len == 0 or std.mem.eql(u8, a.extradata[0..len], b.extradata[0..len]);
+}
+
+/// Keeps the open decoder and resampler for `stream` when it matches the
+/// stream the decoder was opened for; -1 means destroy and re-init.
+pub export fn audio_decoder_reuse(dec: ?*c.AudioDecoder, stream: ?*c.AVStream) c_int {
+    const d = dec orelse return -1;
+    if (d.codec_ctx == null or d.params == null or d.swr_ctx == null or stream == null or stream.?.codecpar == null) {
+        return -1;
+    }
+    if (!sameDecoderParameters(d.params, stream.?.codecpar)) {
+        return -1;
+    }
+
+    audio_decoder_flush(d);
+    // Drops samples the resampler still holds from the previous stream.
+    if (c.swr_init(d.swr_ctx) < 0) {
+        return -1;
+    }
+    // Equal codec parameters say nothing about the container's time base.
+    d.codec_ctx.*.pkt_timebase = stream.?.time_base;
+    d.stream = stream;
+    d.pts = 0.0;
+    return 0;
+}
+
 pub export fn audio_decoder_flush(dec: ?*c.AudioDecoder) void {
     if (dec == null or dec.?.codec_ctx == null) {
         return;
@@ -279,3 +319,53 @@ pub export fn audio_decoder_get_samples(dec: ?*c.AudioDecoder, data: [*c][*c]u8,
     nb_samples.* = converted_samples;
     return 0;
 }
+
+test "sameDecoderParameters requires matching rate, layout and sample format" {
+    var a = std.mem.zeroes(c.AVCodecParameters);
+    a.codec_type = c.AVMEDIA_TYPE_AUDIO;
+    a.codec_id = c.AV_CODEC_ID_AAC;
+    a.format = c.AV_SAMPLE_FMT_FLTP;
+    a.sample_rate = 48000;
+    c.av_channel_layout_default(&a.ch_layout, 2);
+
+    var b = a;
+    try std.testing.expect(sameDecoderParameters(&a, &b));
+
+    b.sample_rate = 44100;
+    try std.testing.expect(!sameDecoderParameters(&a, &b));
+
+    b = a;
+    c.av_channel_layout_default(&b.ch_layout, 6);
+    try std.testing.expect(!sameDecoderParameters(&a, &b));
+}
+
+test "a reused decoder takes the packet time base of its new stream" {
+    const fmt_ctx = c.avformat_alloc_context();
+    defer c.avformat_free_context(fmt_ctx);
+
+    var streams: [2]*c.AVStream = undefined;
+    for (&streams, [_]c_int{ 48000, 1000 }) |*stream, den| {
+        const created = c.avformat_new_stream(fmt_ctx, null);
+        if (created == null) {
+            return error.OutOfMemory;
+        }
+        stream.* = created;
+        stream.*.time_base = .{ .num = 1, .den = den };
+        const par = stream.*.codecpar;
+        par.*.codec_type = c.AVMEDIA_TYPE_AUDIO;
+        par.*.codec_id = c.AV_CODEC_ID_PCM_S16LE;
+        par.*.format = c.AV_SAMPLE_FMT_S16;
+        par.*.sample_rate = 48000;
+        c.av_channel_layout_default(&par.*.ch_layout, 2);
+    }
+
+    var decoder: c.AudioDecoder = undefined;
+    if (audio_decoder_init(&decoder, streams[0]) != 0) {
+        return error.SkipZigTest;
+    }
+    defer audio_decoder_destroy(&decoder);
+    try std.testing.expectEqual(@as(c_int, 48000), decoder.codec_ctx.*.pkt_timebase.den);
+
+    try std.testing.expectEqual(@as(c_int, 0), audio_decoder_reuse(&decoder, streams[1]));
+    try std.testing.expectEqual(@as(c_int, 1000), decoder.codec_ctx.*.pkt_timebase.den);
+}
@@ -14,6 +14,8 @@ const PLAYING_STATE = switch (@typeInfo(c.PlayerState)) {
 const AUDIO_RING_MIN_SIZE: usize = 32768;
 const AUDIO_CALLBACK_CHUNK_BYTES: usize = 4096;
 const AUDIO_RING_SIZE_SECONDS: usize = 1;
+// Every buffered second of a live stream is a second behind the live edge.
+const AUDIO_RING_LIVE_SIZE_MS: usize = 250;
 const AUDIO_RING_TARGET_NUM: usize = 3;
 const AUDIO_RING_TARGET_DEN: usize = 4;
 const AUDIO_RING_RESUME_NUM: usize = 1;
@@ -83,6 +85,12 @@ fn audioDecodeThreadMain(userdata: ?*anyopaque) callconv(.c) c_int {
         }
 
         _ = c.SDL_LockMutex(output.ring_mutex);
+        while (output.decode_running != 0 and output.decode_parked != 0) {
+            output.decode_idle = 1;
+            _ = c.SDL_BroadcastCondition(output.can_write);
+            _ = c.SDL_WaitCondition(output.can_write, output.ring_mutex);
+        }
+        output.decode_idle = 0;
         var running = output.decode_running;
         _ = c.SDL_UnlockMutex(output.ring_mutex);
 
@@ -180,7 +188,7 @@ fn audioDecodeThreadMain(userdata: ?*anyopaque) callconv(.c) c_int {
             output.clock_base_pts = output.decoded_end_pts;
         }
 
-        while (output.decode_running != 0 and bytes_remaining > 0) {
+        while (output.decode_running != 0 and output.decode_parked == 0 and bytes_remaining > 0) {
             const writable = output.ring_size - output.ring_used;
             if (writable == 0) {
                 _ = c.SDL_WaitCondition(output.can_write, output.ring_mutex);
@@ -261,6 +269,18 @@ fn audioCallback(userdata: ?*anyopaque, stream: ?*c.SDL_AudioStream, additional_
     }
 }
 
+fn ringSizeFor(sample_rate: c_int, channels: c_int, live: bool) usize {
+    const bytes_per_second = @as(usize, @intCast(sample_rate)) * @as(usize, @intCast(channels)) * @sizeOf(f32);
+    var ring_size = bytes_per_second * AUDIO_RING_SIZE_SECONDS;
+    if (live) {
+        ring_size = bytes_per_second * AUDIO_RING_LIVE_SIZE_MS / 1000;
+    }
+    if (ring_size < AUDIO_RING_MIN_SIZE) {
+        ring_size = AUDIO_RING_MIN_SIZE;
+    }
+    return ring_size;
+}
+
 pub export fn audio_output_init(output: ?*c.AudioOutput, player: ?*c.Player) c_int {
     if (output == null or player == null) {
         return -1;
@@ -307,12 +327,7 @@ pub export fn audio_output_start(output: ?*c.AudioOutput) c_int {
 
     const sample_rate = o.sample_rate;
     const channels = c.player_get_audio_channels(o.player);
-
-    const bytes_per_second = @as(usize, @intCast(sample_rate)) * @as(usize, @intCast(channels)) * @sizeOf(f32);
-    var ring_size = bytes_per_second * AUDIO_RING_SIZE_SECONDS;
-    if (ring_size < AUDIO_RING_MIN_SIZE) {
-        ring_size = AUDIO_RING_MIN_SIZE;
-    }
+    const ring_size = ringSizeFor(sample_rate, channels, c.player_is_live(o.player) != 0);
 
     o.ring_data = @ptrCast(c.malloc(ring_size));
     if (o.ring_data == null) {
@@ -425,6 +440,71 @@ pub export fn audio_output_reset(output: ?*c.AudioOutput) void {
     }
 }
 
+/// Holds the decode thread off the player and silences the device, keeping
+/// both open for `audio_output_reuse`. Returns once the thread is idle.
+pub export fn audio_output_park(output: ?*c.AudioOutput) void {
+    const o = output orelse return;
+    if (o.enabled == 0 or o.ring_mutex == null) {
+        return;
+    }
+
+    _ = c.SDL_LockMutex(o.ring_mutex);
+    o.decode_parked = 1;
+    if (o.can_write != null) {
+        _ = c.SDL_BroadcastCondition(o.can_write);
+    }
+    while (o.decode_thread != null and o.decode_running != 0 and o.decode_idle == 0) {
+        _ = c.SDL_WaitCondition(o.can_write, o.ring_mutex);
+    }
+    o.ring_read_pos = 0;
+    o.ring_write_pos = 0;
+    o.ring_used = 0;
+    _ = c.SDL_UnlockMutex(o.ring_mutex);
+
+    if (o.stream != null) {
+        _ = c.SDL_PauseAudioStreamDevice(o.stream);
+        _ = c.SDL_ClearAudioStream(o.stream);
+    }
+}
+
+/// Resumes a parked output on the player's newly opened audio when the open
+/// device stream and ring fit it as they are. Returns -1, leaving the output
+/// parked, when the sample rate, channel count or ring sizing differ or the
+/// new media has no audio.
+pub export fn audio_output_reuse(output: ?*c.AudioOutput, player: ?*c.Player) c_int {
+    const o = output orelse return -1;
+    const p = player orelse return -1;
+    if (o.enabled == 0 or o.device_opened == 0 or o.stream == null or o.ring_mutex == null or o.decode_parked == 0) {
+        return -1;
+    }
+    if (c.player_has_audio(p) == 0) {
+        return -1;
+    }
+
+    const channels = c.player_get_audio_channels(p);
+    var sample_rate = c.player_get_audio_sample_rate(p);
+    if (sample_rate <= 0) {
+        sample_rate = 48000;
+    }
+    if (channels <= 0 or sample_rate != o.sample_rate or channels * @as(c_int, @intCast(@sizeOf(f32))) != o.bytes_per_frame) {
+        return -1;
+    }
+    if (ringSizeFor(sample_rate, channels, c.player_is_live(p) != 0) != o.ring_size) {
+        return -1;
+    }
+
+    o.player = p;
+    audio_output_reset(o);
+
+    _ = c.SDL_LockMutex(o.ring_mutex);
+    o.decode_parked = 0;
+    if (o.can_write != null) {
+        _ = c.SDL_BroadcastCondition(o.can_write);
+    }
+    _ = c.SDL_UnlockMutex(o.ring_mutex);
+    return 0;
+}
+
 pub export fn audio_output_set_volume(output: ?*c.AudioOutput, volume: f64) void {
     if (output == null or output.?.enabled == 0 or output.?.stream == null) {
         return;
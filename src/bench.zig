@@ -0,0 +1,59 @@
+const std = @import("std");
+const DecodeThreadsBench = @import("bench/DecodeThreadsBench.zig");
+const DecodersBench = @import("bench/DecodersBench.zig");
+const DemuxIoBench = @import("bench/DemuxIoBench.zig");
+const SequenceBench = @import("bench/SequenceBench.zig");
+const SwitchBench = @import("bench/SwitchBench.zig");
+
+fn printUsage() void {
+    std.debug.print(
+        \\usage: zc-bench <benchmark> [args]
+        \\
+        \\benchmarks:
+        \\  demux-io <media> [iterations]                             compare demuxer I/O backends
+        \\  decode-threads <media> [packets] [iterations] [policy...]   compare decoder threading policies
+        \\  decoders <media> [packets] [iterations] [--record]         rank the decoders for the video codec
+        \\  switch <media> <media> [switches]                           time file-to-file switches with and without reuse
+        \\  sequence <pattern[@fps]> [frames]                          decode an image sequence against its frame rate
+        \\
+    , .{});
+}
+
+pub fn main() !void {
+    var gpa = std.heap.GeneralPurposeAllocator(.{}){};
+    defer _ = gpa.deinit();
+
+    const allocator = gpa.allocator();
+
+    const args = try std.process.argsAlloc(allocator);
+    defer std.process.argsFree(allocator, args);
+
+    if (args.len < 2) {
+        printUsage();
+        return error.MissingBenchmark;
+    }
+
+    if (std.mem.eql(u8, args[1], "demux-io")) {
+        try DemuxIoBench.run(allocator, args[2..]);
+        return;
+    }
+    if (std.mem.eql(u8, args[1], "decode-threads")) {
+        try DecodeThreadsBench.run(allocator, args[2..]);
+        return;
+    }
+    if (std.mem.eql(u8, args[1], "decoders")) {
+        try DecodersBench.run(allocator, args[2..]);
+        return;
+    }
+    if (std.mem.eql(u8, args[1], "switch")) {
+        try SwitchBench.run(allocator, args[2..]);
+        return;
+    }
+    if (std.mem.eql(u8, args[1], "sequence")) {
+        try SequenceBench.run(allocator, args[2..]);
+        return;
+    }
+
+    printUsage();
+    return error.UnknownBenchmark;
+}
@@ -0,0 +1,218 @@
+const std = @import("std");
+const c = @import("../ffi/cplayer.zig").c;
+const DecodeThreading = @import("../video/DecodeThreading.zig");
+const DemuxIoBench = @import("DemuxIoBench.zig");
+
+// Decodes the same run of video packets once per threading policy and reports
+// decode throughput and CPU time. Packets are read into memory up front, so
+// only the decoder is timed. Intra-only codecs also run on one decoder
+// instance per physical core; the other variants keep those off.
+
+const Variant = struct {
+    name: []const u8,
+    policy: DecodeThreading.Policy,
+    intra_instances: c_int = -1,
+};
+
+pub const Result = struct {
+    frames: u64 = 0,
+    wall_ns: u64 = 0,
+    cpu_user_us: i64 = 0,
+    cpu_system_us: i64 = 0,
+    threading: c.VideoDecodeThreading = .{ .mode = c.VIDEO_DECODE_THREADS_OFF, .thread_count = 1 },
+    hw_enabled: bool = false,
+};
+
+fn modeTag(mode: DecodeThreading.Mode) c_int {
+    return switch (mode) {
+        .auto => c.VIDEO_DECODE_THREADS_AUTO,
+        .frame => c.VIDEO_DECODE_THREADS_FRAME,
+        .slice => c.VIDEO_DECODE_THREADS_SLICE,
+        .off => c.VIDEO_DECODE_THREADS_OFF,
+    };
+}
+
+pub fn modeLabel(tag: c_int) []const u8 {
+    return switch (tag) {
+        c.VIDEO_DECODE_THREADS_FRAME => "frame",
+        c.VIDEO_DECODE_THREADS_SLICE => "slice",
+        c.VIDEO_DECODE_THREADS_INSTANCES => "instances",
+        else => "single",
+    };
+}
+
+pub fn readPackets(allocator: std.mem.Allocator, demuxer: *c.Demuxer, max_packets: usize) !std.ArrayListUnmanaged(*c.AVPacket) {
+    var packets: std.ArrayListUnmanaged(*c.AVPacket) = .empty;
+    errdefer freePackets(allocator, &packets);
+
+    var packet = c.av_packet_alloc();
+    if (packet == null) {
+        return error.OutOfMemory;
+    }
+    defer c.av_packet_free(&packet);
+
+    while (packets.items.len < max_packets and c.av_read_frame(demuxer.fmt_ctx, packet) >= 0) {
+        defer c.av_packet_unref(packet);
+        if (packet.*.stream_index != demuxer.video_stream_index) {
+            continue;
+        }
+        var copy = c.av_packet_clone(packet);
+        if (copy == null) {
+            return error.OutOfMemory;
+        }
+        packets.append(allocator, copy) catch |err| {
+            c.av_packet_free(&copy);
+            return err;
+        };
+    }
+    return packets;
+}
+
+pub fn freePackets(allocator: std.mem.Allocator, packets: *std.ArrayListUnmanaged(*c.AVPacket)) void {
+    for (packets.items) |packet| {
+        var p: [*c]c.AVPacket = packet;
+        c.av_packet_free(&p);
+    }
+    packets.deinit(allocator);
+}
+
+fn drainFrames(decoder: *c.VideoDecoder, result: *Result) void {
+    while (c.video_decoder_receive_frame(decoder) == 0) {
+        result.frames += 1;
+        c.av_frame_unref(decoder.frame);
+    }
+}
+
+pub fn decodeOnce(stream: *c.AVStream, packets: []const *c.AVPacket, options: c.VideoDecoderOptions) !Result {
+    var decoder = std.mem.zeroes(c.VideoDecoder);
+    if (c.video_decoder_init_with_options(&decoder, stream, &options) != 0) {
+        return error.DecoderInitFailed;
+    }
+    defer c.video_decoder_destroy(&decoder);
+
+    var result = Result{ .hw_enabled = decoder.hw_enabled != 0 };
+    _ = c.video_decoder_get_threading(&decoder, &result.threading);
+
+    const cpu_start = DemuxIoBench.cpuTimes();
+    var timer = try std.time.Timer.start();
+
+    for (packets) |packet| {
+        while (c.video_decoder_send_packet(&decoder, packet) == c.AVERROR(c.EAGAIN)) {
+            drainFrames(&decoder, &result);
+        }
+        drainFrames(&decoder, &result);
+    }
+    _ = c.video_decoder_send_packet(&decoder, null);
+    drainFrames(&decoder, &result);
+
+    result.wall_ns = timer.read();
+    const cpu_end = DemuxIoBench.cpuTimes();
+    result.cpu_user_us = cpu_end.user_us - cpu_start.user_us;
+    result.cpu_system_us = cpu_end.system_us - cpu_start.system_us;
+    return result;
+}
+
+fn printResult(variant: Variant, iteration: usize, result: Result) void {
+    const seconds = @as(f64, @floatFromInt(result.wall_ns)) / std.time.ns_per_s;
+    const fps = if (seconds > 0.0) @as(f64, @floatFromInt(result.frames)) / seconds else 0.0;
+    const cpu_seconds = @as(f64, @floatFromInt(result.cpu_user_us + result.cpu_system_us)) / std.time.us_per_s;
+    const cores_busy = if (seconds > 0.0) cpu_seconds / seconds else 0.0;
+
+    std.debug.print(
+        "{s:<12} run={d} threads={s} x{d} frames={d} wall={d:.2}ms ({d:.1} fps) user={d}us sys={d}us cores={d:.2}{s}\n",
+        .{
+            variant.name,
+            iteration,
+            modeLabel(result.threading.mode),
+            result.threading.thread_count,
+            result.frames,
+            seconds * 1000.0,
+            fps,
+            result.cpu_user_us,
+            result.cpu_system_us,
+            cores_busy,
+            if (result.hw_enabled) " (hardware decode; set ZC_HW_DECODE=off)" else "",
+        },
+    );
+}
+
+pub fn run(allocator: std.mem.Allocator, args: []const []const u8) !void {
+    if (args.len < 1) {
+        std.debug.print("usage: zc-bench decode-threads <media> [packets] [iterations] [policy...]\n", .{});
+        return error.MissingMediaPath;
+    }
+
+    const path = try allocator.dupeZ(u8, args[0]);
+    defer allocator.free(path);
+
+    const max_packets: usize = if (args.len > 1) try std.fmt.parseInt(usize, args[1], 10) else 600;
+    const iterations: usize = if (args.len > 2) try std.fmt.parseInt(usize, args[2], 10) else 2;
+
+    const topology = DecodeThreading.detectTopology();
+    var variants: std.ArrayListUnmanaged(Variant) = .empty;
+    defer variants.deinit(allocator);
+    try variants.appendSlice(allocator, &.{
+        .{ .name = "off", .policy = .{ .mode = .off } },
+        .{ .name = "slice", .policy = .{ .mode = .slice } },
+        .{ .name = "frame", .policy = .{ .mode = .frame } },
+        .{ .name = "auto", .policy = .{ .mode = .auto } },
+        .{ .name = "frame:smt", .policy = .{ .mode = .frame, .thread_count = @min(topology.logical, 64) } },
+    });
+    for (args[@min(args.len, 3)..]) |spec| {
+        const policy = DecodeThreading.parsePolicy(spec) orelse {
+            std.debug.print("ignoring invalid policy '{s}'\n", .{spec});
+            continue;
+        };
+        try variants.append(allocator, .{ .name = spec, .policy = policy });
+    }
+
+    var demuxer = std.mem.zeroes(c.Demuxer);
+    const options = c.DemuxerOpenOptions{
+        .io_backend = c.DEMUXER_IO_BACKEND_DEFAULT,
+        .probe_mode = c.DEMUXER_PROBE_FULL,
+        .memory_data = null,
+        .memory_size = 0,
+        .live = 0,
+    };
+    if (c.demuxer_open_with_options(&demuxer, path.ptr, &options) != 0) {
+        return error.OpenFailed;
+    }
+    defer c.demuxer_close(&demuxer);
+
+    var packets = try readPackets(allocator, &demuxer, max_packets);
+    defer freePackets(allocator, &packets);
+
+    const par = demuxer.video_stream.*.codecpar.*;
+    const descriptor = c.avcodec_descriptor_get(par.codec_id);
+    if (descriptor != null and (descriptor.*.props & c.AV_CODEC_PROP_INTRA_ONLY) != 0) {
+        try variants.append(allocator, .{
+            .name = "instances",
+            .policy = .{ .mode = .off },
+            .intra_instances = @intCast(@min(topology.physical, 32)),
+        });
+    }
+    std.debug.print("{s} {d}x{d}, {d} packets, cpus: {d} logical / {d} physical\n", .{
+        std.mem.span(c.avcodec_get_name(par.codec_id)),
+        par.width,
+        par.height,
+        packets.items.len,
+        topology.logical,
+        topology.physical,
+    });
+
+    var iteration: usize = 0;
+    while (iteration < iterations) : (iteration += 1) {
+        for (variants.items) |variant| {
+            const threading = c.VideoDecodeThreading{
+                .mode = modeTag(variant.policy.mode),
+                .thread_count = @intCast(variant.policy.thread_count),
+            };
+            const result = try decodeOnce(demuxer.video_stream, packets.items, .{
+                .decoder_name = null,
+                .threading = &threading,
+                .intra_instances = variant.intra_instances,
+            });
+            printResult(variant, iteration, result);
+        }
+    }
+}
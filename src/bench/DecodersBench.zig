@@ -0,0 +1,149 @@
+const std = @import("std");
+const c = @import("../ffi/cplayer.zig").c;
+const DecoderPreference = @import("../video/DecoderPreference.zig");
+const DecodeThreadsBench = @import("DecodeThreadsBench.zig");
+
+// Decodes the same run of video packets with every decoder FFmpeg has for the
+// stream's codec and ranks them by throughput. With `--record` the ranking is
+// saved for the codec and resolution class, and later decoder opens try the
+// fastest decoder first.
+
+const Candidate = struct {
+    name: [:0]const u8,
+    best_fps: f64 = 0.0,
+    failed: bool = false,
+};
+
+fn fpsOf(result: DecodeThreadsBench.Result) f64 {
+    const seconds = @as(f64, @floatFromInt(result.wall_ns)) / std.time.ns_per_s;
+    return if (seconds > 0.0) @as(f64, @floatFromInt(result.frames)) / seconds else 0.0;
+}
+
+fn fasterFirst(_: void, a: Candidate, b: Candidate) bool {
+    return a.best_fps > b.best_fps;
+}
+
+// Hardware wrapper decoders (`h264_cuvid`, `hevc_v4l2m2m`) hand back frames
+// the pipeline cannot upload; hardware decode goes through `ZC_HW_DECODE`.
+fn listDecoders(allocator: std.mem.Allocator, codec_id: c.AVCodecID) !std.ArrayListUnmanaged(Candidate) {
+    var candidates: std.ArrayListUnmanaged(Candidate) = .empty;
+    errdefer candidates.deinit(allocator);
+
+    var opaque_state: ?*anyopaque = null;
+    while (true) {
+        const codec = c.av_codec_iterate(&opaque_state);
+        if (codec == null) {
+            break;
+        }
+        if (codec.*.id != codec_id or c.av_codec_is_decoder(codec) == 0 or (codec.*.capabilities & c.AV_CODEC_CAP_HARDWARE) != 0) {
+            continue;
+        }
+        try candidates.append(allocator, .{ .name = std.mem.span(codec.*.name) });
+    }
+    return candidates;
+}
+
+pub fn run(allocator: std.mem.Allocator, args: []const []const u8) !void {
+    var record = false;
+    var positional: [3][]const u8 = undefined;
+    var positional_count: usize = 0;
+    for (args) |arg| {
+        if (std.mem.eql(u8, arg, "--record")) {
+            record = true;
+        } else if (positional_count < positional.len) {
+            positional[positional_count] = arg;
+            positional_count += 1;
+        }
+    }
+    if (positional_count < 1) {
+        std.debug.print("usage: zc-bench decoders <media> [packets] [iterations] [--record]\n", .{});
+        return error.MissingMediaPath;
+    }
+
+    const path = try allocator.dupeZ(u8, positional[0]);
+    defer allocator.free(path);
+
+    const max_packets: usize = if (positional_count > 1) try std.fmt.parseInt(usize, positional[1], 10) else 600;
+    const iterations: usize = if (positional_count > 2) try std.fmt.parseInt(usize, positional[2], 10) else 2;
+
+    var demuxer = std.mem.zeroes(c.Demuxer);
+    const options = c.DemuxerOpenOptions{
+        .io_backend = c.DEMUXER_IO_BACKEND_DEFAULT,
+        .probe_mode = c.DEMUXER_PROBE_FULL,
+        .memory_data = null,
+        .memory_size = 0,
+        .live = 0,
+    };
+    if (c.demuxer_open_with_options(&demuxer, path.ptr, &options) != 0) {
+        return error.OpenFailed;
+    }
+    defer c.demuxer_close(&demuxer);
+
+    var packets = try DecodeThreadsBench.readPackets(allocator, &demuxer, max_packets);
+    defer DecodeThreadsBench.freePackets(allocator, &packets);
+
+    const par = demuxer.video_stream.*.codecpar.*;
+    const codec_name = std.mem.span(c.avcodec_get_name(par.codec_id));
+    const class = DecoderPreference.classify(par.width, par.height);
+
+    var candidates = try listDecoders(allocator, par.codec_id);
+    defer candidates.deinit(allocator);
+
+    std.debug.print("{s} {d}x{d} ({s}), {d} packets, {d} decoders\n", .{
+        codec_name,
+        par.width,
+        par.height,
+        @tagName(class),
+        packets.items.len,
+        candidates.items.len,
+    });
+
+    var iteration: usize = 0;
+    while (iteration < iterations) : (iteration += 1) {
+        for (candidates.items) |*candidate| {
+            if (candidate.failed) {
+                continue;
+            }
+            const result = DecodeThreadsBench.decodeOnce(demuxer.video_stream, packets.items, .{
+                .decoder_name = candidate.name.ptr,
+                .threading = null,
+                .intra_instances = 0,
+            }) catch |err| {
+                std.debug.print("{s:<16} failed to open: {s}\n", .{ candidate.name, @errorName(err) });
+                candidate.failed = true;
+                continue;
+            };
+            const fps = fpsOf(result);
+            candidate.best_fps = @max(candidate.best_fps, fps);
+            std.debug.print("{s:<16} run={d} frames={d} wall={d:.2}ms ({d:.1} fps) user={d}us sys={d}us{s}\n", .{
+                candidate.name,
+                iteration,
+                result.frames,
+                @as(f64, @floatFromInt(result.wall_ns)) / std.time.ns_per_ms,
+                fps,
+                result.cpu_user_us,
+                result.cpu_system_us,
+                if (result.hw_enabled) " (hardware decode)" else "",
+            });
+        }
+    }
+
+    std.mem.sort(Candidate, candidates.items, {}, fasterFirst);
+    var ranked: std.ArrayListUnmanaged([]const u8) = .empty;
+    defer ranked.deinit(allocator);
+    for (candidates.items) |candidate| {
+        if (!candidate.failed and candidate.best_fps > 0.0) {
+            try ranked.append(allocator, candidate.name);
+        }
+    }
+    if (ranked.items.len == 0) {
+        return error.NoDecoder;
+    }
+    std.debug.print("fastest for {s}@{s}: {s}\n", .{ codec_name, @tagName(class), ranked.items[0] });
+
+    if (record) {
+        const rankings = try DecoderPreference.recordRanking(allocator, codec_name, class, ranked.items);
+        defer allocator.free(rankings);
+        std.debug.print("recorded in {s}\n", .{rankings});
+    }
+}
@@ -0,0 +1,150 @@
+const std = @import("std");
+const builtin = @import("builtin");
+const c = @import("../ffi/cplayer.zig").c;
+
+// Demuxes a whole file once per I/O backend and reports wall time, process CPU
+// time and the custom backend's read statistics. Runs are back to back, so
+// every backend after the first reads from a warm page cache.
+
+const Backend = struct {
+    name: []const u8,
+    id: c_int,
+};
+
+const backends = [_]Backend{
+    .{ .name = "default", .id = c.DEMUXER_IO_BACKEND_DEFAULT },
+    .{ .name = "mmap", .id = c.DEMUXER_IO_BACKEND_MMAP },
+    .{ .name = "prefetch", .id = c.DEMUXER_IO_BACKEND_PREFETCH },
+};
+
+const Result = struct {
+    packets: u64 = 0,
+    payload_bytes: u64 = 0,
+    wall_ns: u64 = 0,
+    cpu_user_us: i64 = 0,
+    cpu_system_us: i64 = 0,
+    io_backend: c_int = c.DEMUXER_IO_BACKEND_DEFAULT,
+    io_stats: c.DemuxerIoStats = std.mem.zeroes(c.DemuxerIoStats),
+};
+
+pub const CpuTimes = struct {
+    user_us: i64 = 0,
+    system_us: i64 = 0,
+};
+
+pub fn cpuTimes() CpuTimes {
+    if (comptime builtin.os.tag == .windows) {
+        return .{};
+    } else {
+        const usage = std.posix.getrusage(std.posix.rusage.SELF);
+        return .{
+            .user_us = @as(i64, usage.utime.sec) * std.time.us_per_s + usage.utime.usec,
+            .system_us = @as(i64, usage.stime.sec) * std.time.us_per_s + usage.stime.usec,
+        };
+    }
+}
+
+fn demuxOnce(path: [:0]const u8, backend: c_int) !Result {
+    var demuxer = std.mem.zeroes(c.Demuxer);
+    const options = c.DemuxerOpenOptions{
+        .io_backend = backend,
+        .probe_mode = c.demuxer_probe_mode_from_environment(),
+        .memory_data = null,
+        .memory_size = 0,
+        .live = 0,
+    };
+    if (c.demuxer_open_with_options(&demuxer, path.ptr, &options) != 0) {
+        return error.OpenFailed;
+    }
+    defer c.demuxer_close(&demuxer);
+
+    const packet = c.av_packet_alloc();
+    if (packet == null) {
+        return error.OutOfMemory;
+    }
+    defer {
+        var p = packet;
+        c.av_packet_free(&p);
+    }
+
+    var result = Result{ .io_backend = demuxer.io.backend };
+    const cpu_start = cpuTimes();
+    var timer = try std.time.Timer.start();
+
+    while (c.av_read_frame(demuxer.fmt_ctx, packet) >= 0) {
+        result.packets += 1;
+        result.payload_bytes += @intCast(packet.*.size);
+        c.av_packet_unref(packet);
+    }
+
+    result.wall_ns = timer.read();
+    const cpu_end = cpuTimes();
+    result.cpu_user_us = cpu_end.user_us - cpu_start.user_us;
+    result.cpu_system_us = cpu_end.system_us - cpu_start.system_us;
+    _ = c.demuxer_io_get_stats(&demuxer.io, &result.io_stats);
+    return result;
+}
+
+fn printResult(backend: Backend, iteration: usize, result: Result) void {
+    const wall_ms = @as(f64, @floatFromInt(result.wall_ns)) / std.time.ns_per_ms;
+    const seconds = @as(f64, @floatFromInt(result.wall_ns)) / std.time.ns_per_s;
+    const mib = @as(f64, @floatFromInt(result.payload_bytes)) / (1024.0 * 1024.0);
+    const throughput = if (seconds > 0.0) mib / seconds else 0.0;
+    const fell_back = result.io_backend != backend.id;
+
+    std.debug.print(
+        "{s:<8} run={d} packets={d} payload={d:.1}MiB wall={d:.2}ms ({d:.1}MiB/s) user={d}us sys={d}us reads={d} seeks={d} advise={d}{s}\n",
+        .{
+            backend.name,
+            iteration,
+            result.packets,
+            mib,
+            wall_ms,
+            throughput,
+            result.cpu_user_us,
+            result.cpu_system_us,
+            result.io_stats.read_calls,
+            result.io_stats.seek_calls,
+            result.io_stats.advise_calls,
+            if (fell_back) " (fell back to default)" else "",
+        },
+    );
+
+    const stats = result.io_stats;
+    if (stats.prefetch_hits + stats.prefetch_stalls == 0) {
+        return;
+    }
+
+    std.debug.print("         hits={d} stalls={d} stall={d}us failed={d} read latency:", .{
+        stats.prefetch_hits,
+        stats.prefetch_stalls,
+        stats.prefetch_stall_us,
+        stats.prefetch_failed_reads,
+    });
+    for (stats.latency_us_histogram, 0..) |count, bucket| {
+        if (count > 0) {
+            std.debug.print(" <{d}us:{d}", .{ @as(u64, 2) << @intCast(bucket), count });
+        }
+    }
+    std.debug.print("\n", .{});
+}
+
+pub fn run(allocator: std.mem.Allocator, args: []const []const u8) !void {
+    if (args.len < 1) {
+        std.debug.print("usage: zc-bench demux-io <media> [iterations]\n", .{});
+        return error.MissingMediaPath;
+    }
+
+    const path = try allocator.dupeZ(u8, args[0]);
+    defer allocator.free(path);
+
+    const iterations: usize = if (args.len > 1) try std.fmt.parseInt(usize, args[1], 10) else 3;
+
+    var iteration: usize = 0;
+    while (iteration < iterations) : (iteration += 1) {
+        for (backends) |backend| {
+            const result = try demuxOnce(path, backend.id);
+            printResult(backend, iteration, result);
+        }
+    }
+}
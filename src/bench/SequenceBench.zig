@@ -0,0 +1,95 @@
+const std = @import("std");
+const c = @import("../ffi/cplayer.zig").c;
+const DecodeThreadsBench = @import("DecodeThreadsBench.zig");
+const DemuxIoBench = @import("DemuxIoBench.zig");
+
+// Plays an image sequence as fast as it decodes: demux thread, read-ahead and
+// video decoder as the player runs them, without conversion or rendering.
+// Reports throughput against the sequence's frame rate. Runs with
+// `ZC_SEQUENCE_READAHEAD=off` or `ZC_INTRA_DECODERS=off` give the baselines.
+
+pub fn run(allocator: std.mem.Allocator, args: []const []const u8) !void {
+    if (args.len < 1) {
+        std.debug.print("usage: zc-bench sequence <pattern[@fps]> [frames]\n", .{});
+        return error.MissingMediaPath;
+    }
+
+    const path = try allocator.dupeZ(u8, args[0]);
+    defer allocator.free(path);
+    const max_frames: u64 = if (args.len > 1) try std.fmt.parseInt(u64, args[1], 10) else 240;
+
+    var demuxer = std.mem.zeroes(c.Demuxer);
+    const options = c.DemuxerOpenOptions{
+        .io_backend = c.DEMUXER_IO_BACKEND_DEFAULT,
+        .probe_mode = c.DEMUXER_PROBE_FULL,
+        .memory_data = null,
+        .memory_size = 0,
+        .live = 0,
+    };
+    if (c.demuxer_open_with_options(&demuxer, path.ptr, &options) != 0) {
+        return error.OpenFailed;
+    }
+    defer c.demuxer_close(&demuxer);
+    if (demuxer.source_kind != c.DEMUXER_SOURCE_SEQUENCE) {
+        std.debug.print("{s} is not an image sequence pattern\n", .{args[0]});
+        return error.NotASequence;
+    }
+
+    var decoder = std.mem.zeroes(c.VideoDecoder);
+    if (c.video_decoder_init(&decoder, demuxer.video_stream) != 0) {
+        return error.DecoderInitFailed;
+    }
+    defer c.video_decoder_destroy(&decoder);
+
+    var threading = c.VideoDecodeThreading{ .mode = c.VIDEO_DECODE_THREADS_OFF, .thread_count = 1 };
+    _ = c.video_decoder_get_threading(&decoder, &threading);
+    const par = demuxer.video_stream.*.codecpar.*;
+    const rate = c.av_q2d(demuxer.video_stream.*.avg_frame_rate);
+    std.debug.print("{s} {d}x{d} at {d:.3} fps, decode threads={s} x{d}\n", .{
+        std.mem.span(c.avcodec_get_name(par.codec_id)),
+        par.width,
+        par.height,
+        rate,
+        DecodeThreadsBench.modeLabel(threading.mode),
+        threading.thread_count,
+    });
+
+    if (c.demuxer_start(&demuxer) != 0) {
+        return error.DemuxerStartFailed;
+    }
+
+    const cpu_start = DemuxIoBench.cpuTimes();
+    var timer = try std.time.Timer.start();
+    var frames: u64 = 0;
+    while (frames < max_frames and c.video_decoder_decode_frame(&decoder, &demuxer) == 0) {
+        frames += 1;
+    }
+    const seconds = @as(f64, @floatFromInt(timer.read())) / std.time.ns_per_s;
+    const cpu_end = DemuxIoBench.cpuTimes();
+    if (frames == 0) {
+        return error.NoFramesDecoded;
+    }
+
+    const fps = @as(f64, @floatFromInt(frames)) / seconds;
+    const cpu_seconds = @as(f64, @floatFromInt((cpu_end.user_us - cpu_start.user_us) + (cpu_end.system_us - cpu_start.system_us))) / std.time.us_per_s;
+    std.debug.print("frames={d} wall={d:.2}ms ({d:.1} fps, {d:.2}x real time) cores={d:.2}\n", .{
+        frames,
+        seconds * 1000.0,
+        fps,
+        if (rate > 0.0) fps / rate else 0.0,
+        cpu_seconds / seconds,
+    });
+
+    var stats: c.DemuxerSequenceStats = undefined;
+    if (c.demuxer_get_sequence_stats(&demuxer, &stats) == 0) {
+        std.debug.print("read-ahead={d} hits={d} misses={d} read={d:.1}MiB failed={d}\n", .{
+            stats.read_ahead,
+            stats.prefetch_hits,
+            stats.misses,
+            @as(f64, @floatFromInt(stats.bytes_read)) / (1024.0 * 1024.0),
+            stats.failed_reads,
+        });
+    } else {
+        std.debug.print("read-ahead off\n", .{});
+    }
+}
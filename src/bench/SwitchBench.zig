@@ -0,0 +1,95 @@
+const std = @import("std");
+const c = @import("../ffi/cplayer.zig").c;
+
+// Alternates one player between two media files and times each switch: the
+// open plus decoding the new file's first video frame. Runs once keeping
+// compatible decoders open and once rebuilding them, as `ZC_MEDIA_REUSE=off`
+// does. Audio output and rendering are left out; the debug panel's "Switch"
+// line times those too.
+
+const first_frame_timeout_ns: u64 = 5 * std.time.ns_per_s;
+
+const Stats = struct {
+    min_ns: u64 = std.math.maxInt(u64),
+    max_ns: u64 = 0,
+    total_ns: u64 = 0,
+    count: u64 = 0,
+    video_reused: u64 = 0,
+    audio_reused: u64 = 0,
+
+    fn add(self: *Stats, elapsed_ns: u64) void {
+        self.min_ns = @min(self.min_ns, elapsed_ns);
+        self.max_ns = @max(self.max_ns, elapsed_ns);
+        self.total_ns += elapsed_ns;
+        self.count += 1;
+    }
+};
+
+fn ms(ns: u64) f64 {
+    return @as(f64, @floatFromInt(ns)) / std.time.ns_per_ms;
+}
+
+fn openToFirstFrame(player: *c.Player, path: [:0]const u8) !u64 {
+    var timer = try std.time.Timer.start();
+    if (c.player_open(player, path.ptr) != 0) {
+        return error.OpenFailed;
+    }
+    c.player_play(player);
+    while (c.player_decode_frame(player) != 0) {
+        if (timer.read() > first_frame_timeout_ns) {
+            return error.FirstFrameTimeout;
+        }
+        std.Thread.sleep(100 * std.time.ns_per_us);
+    }
+    return timer.read();
+}
+
+fn runMode(paths: [2][:0]const u8, switches: usize, reuse: bool) !Stats {
+    var player = std.mem.zeroes(c.Player);
+    if (c.player_init(&player) != 0) {
+        return error.PlayerInitFailed;
+    }
+    defer c.player_destroy(&player);
+    player.decoder_reuse = if (reuse) 1 else 0;
+
+    _ = try openToFirstFrame(&player, paths[0]);
+
+    var stats = Stats{};
+    for (0..switches) |i| {
+        c.player_stop_demuxer(&player);
+        stats.add(try openToFirstFrame(&player, paths[(i + 1) % 2]));
+        stats.video_reused += @intCast(player.video_decoder_reused);
+        stats.audio_reused += @intCast(player.audio_decoder_reused);
+    }
+    return stats;
+}
+
+pub fn run(allocator: std.mem.Allocator, args: []const []const u8) !void {
+    if (args.len < 2) {
+        std.debug.print("usage: zc-bench switch <media> <media> [switches]\n", .{});
+        return error.MissingMediaPath;
+    }
+
+    const first = try allocator.dupeZ(u8, args[0]);
+    defer allocator.free(first);
+    const second = try allocator.dupeZ(u8, args[1]);
+    defer allocator.free(second);
+
+    const switches: usize = if (args.len > 2) try std.fmt.parseInt(usize, args[2], 10) else 10;
+    if (switches == 0) {
+        return error.InvalidSwitchCount;
+    }
+
+    for ([_]bool{ true, false }) |reuse| {
+        const stats = try runMode(.{ first, second }, switches, reuse);
+        std.debug.print("{s:<8} switches={d} first frame min={d:.2}ms avg={d:.2}ms max={d:.2}ms reused video={d} audio={d}\n", .{
+            if (reuse) "reuse" else "rebuild",
+            stats.count,
+            ms(stats.min_ns),
+            ms(stats.total_ns / stats.count),
+            ms(stats.max_ns),
+            stats.video_reused,
+            stats.audio_reused,
+        });
+    }
+}
@@ -10,6 +10,7 @@ pub const CommandKind = enum {
     seek_abs,
     set_volume,
     set_speed,
+    select_track,
     shutdown,
 };
 
@@ -97,6 +97,10 @@ pub const PlaybackEngine = struct {
         try self.enqueue(Command.scalar(.set_speed, speed));
     }
 
+    pub fn sendSelectTrack(self: *Self, stream_index: i32) !void {
+        try self.enqueue(Command.scalar(.select_track, @floatFromInt(stream_index)));
+    }
+
     pub fn requestShutdown(self: *Self) !void {
         try self.enqueue(Command.simple(.shutdown));
     }
@@ -241,6 +245,9 @@ pub const PlaybackEngine = struct {
             .set_speed => {
                 self.session.setSpeed(command.value);
             },
+            .select_track => {
+                self.session.selectTrack(@intFromFloat(command.value));
+            },
             .shutdown => {
                 self.running.store(false, .release);
             },
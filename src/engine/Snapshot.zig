@@ -35,6 +35,27 @@ pub const VideoHwPolicy = enum {
     videotoolbox,
 };
 
+pub const VideoDecodeSkip = enum {
+    none,
+    loop_filter,
+    nonref,
+    idct,
+};
+
+pub const TrackKind = enum {
+    video,
+    audio,
+};
+
+pub const max_tracks: usize = 16;
+
+pub const TrackSummary = struct {
+    stream_index: i32 = -1,
+    kind: TrackKind = .video,
+    selected: bool = false,
+    label: [64]u8 = [_]u8{0} ** 64,
+};
+
 pub const Snapshot = struct {
     state: PlaybackState = .stopped,
     current_time: f64 = 0.0,
@@ -51,12 +72,44 @@ pub const Snapshot = struct {
     media_bitrate_kbps: i32 = 0,
     video_codec: [32]u8 = [_]u8{0} ** 32,
     video_bitrate_kbps: i32 = 0,
+    video_decode_threads: [32]u8 = [_]u8{0} ** 32,
+    video_decode_skip: VideoDecodeSkip = .none,
+    video_catch_ups: i32 = 0,
+    video_convert_ms: f64 = 0.0,
+    video_scale_threads: i32 = 0,
     video_fps_num: i32 = 0,
     video_fps_den: i32 = 0,
     audio_codec: [32]u8 = [_]u8{0} ** 32,
     audio_bitrate_kbps: i32 = 0,
     audio_sample_rate: i32 = 0,
     audio_channels: i32 = 0,
+    demux_video_buffered_kb: i32 = 0,
+    demux_video_buffered_ms: i32 = 0,
+    demux_video_fill_percent: i32 = 0,
+    demux_audio_buffered_kb: i32 = 0,
+    demux_audio_buffered_ms: i32 = 0,
+    demux_audio_fill_percent: i32 = 0,
+    demux_starvation_overflows: i32 = 0,
+    net_cache_hits: i32 = 0,
+    net_cache_misses: i32 = 0,
+    net_downloaded_kb: i32 = 0,
+    rebuffers: i32 = 0,
+    abr_variant_count: i32 = 0,
+    abr_variant_kbps: i32 = 0,
+    abr_bandwidth_kbps: i32 = 0,
+    abr_switches: i32 = 0,
+    abr_switch_latency_ms: i32 = 0,
+    live: bool = false,
+    live_latency_ms: i32 = 0,
+    live_target_ms: i32 = 0,
+    live_catching_up: bool = false,
+    live_trims: i32 = 0,
+    open_probe: [32]u8 = [_]u8{0} ** 32,
+    open_to_first_frame_ms: i32 = 0,
+    switch_ms: i32 = 0,
+    switch_reused: [32]u8 = [_]u8{0} ** 32,
+    track_count: i32 = 0,
+    tracks: [max_tracks]TrackSummary = [_]TrackSummary{.{}} ** max_tracks,
 };
 
 pub fn stateLabel(state: PlaybackState) []const u8 {
@@ -1,6 +1,8 @@
 comptime {
     _ = @import("../media/demuxer_exports.zig");
+    _ = @import("../media/demuxer_io_exports.zig");
     _ = @import("../media/player_exports.zig");
+    _ = @import("../media/stream_info_cache_exports.zig");
     _ = @import("../video/video_pipeline_exports.zig");
     _ = @import("../audio/audio_output_exports.zig");
     _ = @import("../video/video_decoder_exports.zig");
@@ -0,0 +1,143 @@
+const std = @import("std");
+
+// Throughput estimate from segment downloads and a buffer-aware variant
+// choice. The estimate picks the highest variant the network sustains with a
+// safety margin; a nearly empty buffer forces the lowest variant, a thin one
+// blocks upswitches, and switches are spaced out so one noisy segment does
+// not flip the stream back and forth.
+
+// Downloads this small (playlists, tiny segments) are dominated by request
+// latency and would drag the estimate down.
+const min_sample_bytes: usize = 16 * 1024;
+
+const Ewma = struct {
+    half_life_s: f64,
+    value: f64 = 0.0,
+    total_weight_s: f64 = 0.0,
+
+    fn add(self: *Ewma, weight_s: f64, sample: f64) void {
+        const alpha = std.math.pow(f64, 0.5, weight_s / self.half_life_s);
+        self.value = sample * (1.0 - alpha) + alpha * self.value;
+        self.total_weight_s += weight_s;
+    }
+
+    // Corrects the bias towards the zero the average starts from.
+    fn estimate(self: *const Ewma) f64 {
+        const zero_factor = 1.0 - std.math.pow(f64, 0.5, self.total_weight_s / self.half_life_s);
+        return self.value / zero_factor;
+    }
+};
+
+pub const BandwidthEstimator = struct {
+    fast: Ewma = .{ .half_life_s = 2.0 },
+    slow: Ewma = .{ .half_life_s = 8.0 },
+    samples: usize = 0,
+
+    pub fn addSample(self: *BandwidthEstimator, bytes: usize, seconds: f64) void {
+        if (bytes < min_sample_bytes or !(seconds > 0.0)) {
+            return;
+        }
+        const bits_per_second = @as(f64, @floatFromInt(bytes)) * 8.0 / seconds;
+        self.fast.add(seconds, bits_per_second);
+        self.slow.add(seconds, bits_per_second);
+        self.samples += 1;
+    }
+
+    /// The lower of a fast and a slow average: drops are followed at once,
+    /// recoveries only once they last.
+    pub fn estimateBps(self: *const BandwidthEstimator) ?f64 {
+        if (self.samples == 0) {
+            return null;
+        }
+        return @min(self.fast.estimate(), self.slow.estimate());
+    }
+};
+
+pub const Config = struct {
+    safety_factor: f64 = 0.8,
+    panic_buffer_s: f64 = 1.0,
+    upswitch_buffer_s: f64 = 3.0,
+    min_switch_interval_s: f64 = 4.0,
+};
+
+pub const Input = struct {
+    /// Ascending bitrates, one per variant.
+    bitrates_bps: []const i64,
+    current: usize,
+    estimate_bps: ?f64,
+    buffer_s: f64,
+    since_last_switch_s: f64,
+};
+
+pub fn selectVariant(config: Config, input: Input) usize {
+    if (input.bitrates_bps.len <= 1) {
+        return input.current;
+    }
+    if (input.buffer_s < config.panic_buffer_s and input.current > 0 and input.since_last_switch_s >= config.min_switch_interval_s) {
+        return 0;
+    }
+    const estimate = input.estimate_bps orelse return input.current;
+    if (input.since_last_switch_s < config.min_switch_interval_s) {
+        return input.current;
+    }
+
+    const budget = estimate * config.safety_factor;
+    var sustainable: usize = 0;
+    for (input.bitrates_bps, 0..) |bitrate, i| {
+        if (@as(f64, @floatFromInt(bitrate)) <= budget) {
+            sustainable = i;
+        }
+    }
+
+    if (sustainable > input.current and input.buffer_s < config.upswitch_buffer_s) {
+        return input.current;
+    }
+    return sustainable;
+}
+
+test "bandwidth estimate follows drops quickly and recoveries slowly" {
+    var estimator = BandwidthEstimator{};
+    try std.testing.expect(estimator.estimateBps() == null);
+
+    estimator.addSample(1024, 0.01);
+    try std.testing.expect(estimator.estimateBps() == null);
+
+    // 8 Mbit/s for a while.
+    for (0..8) |_| {
+        estimator.addSample(1_000_000, 1.0);
+    }
+    try std.testing.expectApproxEqRel(@as(f64, 8_000_000), estimator.estimateBps().?, 0.01);
+
+    estimator.addSample(250_000, 1.0);
+    const after_drop = estimator.estimateBps().?;
+    try std.testing.expect(after_drop < 7_000_000);
+
+    estimator.addSample(1_000_000, 1.0);
+    try std.testing.expect(estimator.estimateBps().? < 7_500_000);
+}
+
+test "selectVariant picks the highest sustainable variant with buffer guards" {
+    const ladder = [_]i64{ 500_000, 1_500_000, 4_000_000 };
+    const config = Config{};
+    var input = Input{ .bitrates_bps = &ladder, .current = 1, .estimate_bps = 6_000_000, .buffer_s = 12.0, .since_last_switch_s = 10.0 };
+
+    try std.testing.expectEqual(@as(usize, 2), selectVariant(config, input));
+
+    input.buffer_s = 2.0;
+    try std.testing.expectEqual(@as(usize, 1), selectVariant(config, input));
+
+    input.estimate_bps = 1_000_000;
+    try std.testing.expectEqual(@as(usize, 0), selectVariant(config, input));
+
+    input.estimate_bps = 6_000_000;
+    input.buffer_s = 0.5;
+    try std.testing.expectEqual(@as(usize, 0), selectVariant(config, input));
+
+    input.buffer_s = 12.0;
+    input.since_last_switch_s = 1.0;
+    try std.testing.expectEqual(@as(usize, 1), selectVariant(config, input));
+
+    input.since_last_switch_s = 10.0;
+    input.estimate_bps = null;
+    try std.testing.expectEqual(@as(usize, 1), selectVariant(config, input));
+}
@@ -0,0 +1,79 @@
+const std = @import("std");
+
+// Identifies a media file by canonical path, size and modification time, so
+// per-file caches are invalidated when the file is replaced or rewritten.
+
+pub const FileIdentity = struct {
+    size: u64,
+    mtime_ns: i64,
+    path_hash: u64,
+
+    pub fn fromPath(path: []const u8) !FileIdentity {
+        const file = try std.fs.cwd().openFile(path, .{});
+        defer file.close();
+        const stat = try file.stat();
+
+        var path_buf: [std.fs.max_path_bytes]u8 = undefined;
+        const canonical = std.fs.cwd().realpath(path, &path_buf) catch path;
+
+        return .{
+            .size = stat.size,
+            .mtime_ns = @truncate(stat.mtime),
+            .path_hash = std.hash.Wyhash.hash(0, canonical),
+        };
+    }
+
+    pub fn eql(self: FileIdentity, other: FileIdentity) bool {
+        return self.size == other.size and self.mtime_ns == other.mtime_ns and self.path_hash == other.path_hash;
+    }
+
+    pub fn cacheKey(self: FileIdentity) u64 {
+        var hasher = std.hash.Wyhash.init(self.path_hash);
+        hasher.update(std.mem.asBytes(&self.size));
+        hasher.update(std.mem.asBytes(&self.mtime_ns));
+        return hasher.final();
+    }
+
+    /// Returns `<cache dir>/<category>/<key><extension>`, creating the
+    /// category directory when needed.
+    pub fn cacheFilePath(self: FileIdentity, allocator: std.mem.Allocator, category: []const u8, extension: []const u8) ![]u8 {
+        const dir = try cacheDir(allocator, category);
+        defer allocator.free(dir);
+
+        var name_buf: [32]u8 = undefined;
+        const name = try std.fmt.bufPrint(&name_buf, "{x:0>16}{s}", .{ self.cacheKey(), extension });
+        return std.fs.path.join(allocator, &.{ dir, name });
+    }
+};
+
+/// `ZC_CACHE_DIR` overrides the per-user application data directory.
+pub fn cacheDir(allocator: std.mem.Allocator, category: []const u8) ![]u8 {
+    const root = std.process.getEnvVarOwned(allocator, "ZC_CACHE_DIR") catch blk: {
+        const app_dir = try std.fs.getAppDataDir(allocator, "zc-player");
+        defer allocator.free(app_dir);
+        break :blk try std.fs.path.join(allocator, &.{ app_dir, "cache" });
+    };
+    defer allocator.free(root);
+
+    const dir = try std.fs.path.join(allocator, &.{ root, category });
+    errdefer allocator.free(dir);
+    try std.fs.cwd().makePath(dir);
+    return dir;
+}
+
+test "FileIdentity changes when the file is rewritten" {
+    var tmp = std.testing.tmpDir(.{});
+    defer tmp.cleanup();
+
+    try tmp.dir.writeFile(.{ .sub_path = "media.ts", .data = "first" });
+    const path = try tmp.dir.realpathAlloc(std.testing.allocator, "media.ts");
+    defer std.testing.allocator.free(path);
+
+    const first = try FileIdentity.fromPath(path);
+    try std.testing.expect(first.eql(try FileIdentity.fromPath(path)));
+
+    try tmp.dir.writeFile(.{ .sub_path = "media.ts", .data = "second version" });
+    const second = try FileIdentity.fromPath(path);
+    try std.testing.expect(!first.eql(second));
+    try std.testing.expect(first.cacheKey() != second.cacheKey());
+}
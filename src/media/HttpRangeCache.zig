@@ -0,0 +1,678 @@
+const std = @import("std");
+const cacheDir = @import("FileIdentity.zig").cacheDir;
+const test_server = @import("TestHttpServer.zig");
+const c = @cImport({
+    @cInclude("libavformat/avformat.h");
+    @cInclude("libavutil/dict.h");
+});
+
+// Serves reads of a remote HTTP(S) resource from a sparse on-disk file of
+// fixed-size chunks. Missing chunks are fetched with ranged requests by a few
+// worker threads, on demand for the reader and speculatively ahead of it. The
+// chunk map is saved next to the data, so a later open of the same URL only
+// downloads what earlier sessions never read.
+
+pub const Options = struct {
+    chunk_size: usize = 1024 * 1024,
+    worker_count: usize = 4,
+    read_ahead_chunks: usize = 8,
+    /// Defaults to `<cache dir>/http`.
+    cache_dir: ?[]const u8 = null,
+    /// Chunks kept on disk across all URLs; defaults to `ZC_HTTP_CACHE_MAX_MB`.
+    max_cache_bytes: ?u64 = null,
+};
+
+pub const Stats = struct {
+    hit_chunks: i64 = 0,
+    miss_chunks: i64 = 0,
+    bytes_downloaded: i64 = 0,
+    failed_fetches: i64 = 0,
+};
+
+const ChunkState = enum(u8) {
+    absent,
+    present,
+    queued,
+    fetching,
+    failed,
+};
+
+const map_magic = "ZCHC";
+const map_version: u32 = 2;
+const map_header_len = 40;
+const max_workers = 8;
+const default_max_cache_bytes: u64 = 4096 * 1024 * 1024;
+const max_map_bytes: usize = 64 * 1024 * 1024;
+
+/// Megabytes; unset or invalid values keep the 4 GiB default.
+pub fn maxCacheBytesFromEnvironment() u64 {
+    const value = std.process.getEnvVarOwned(std.heap.page_allocator, "ZC_HTTP_CACHE_MAX_MB") catch return default_max_cache_bytes;
+    defer std.heap.page_allocator.free(value);
+    return parseMaxCacheBytes(value);
+}
+
+fn parseMaxCacheBytes(value: []const u8) u64 {
+    const megabytes = std.fmt.parseInt(u64, std.mem.trim(u8, value, " "), 10) catch return default_max_cache_bytes;
+    return std.math.mul(u64, megabytes, 1024 * 1024) catch default_max_cache_bytes;
+}
+
+pub const HttpRangeCache = struct {
+    allocator: std.mem.Allocator,
+    url: [:0]u8,
+    url_hash: u64,
+    validator_hash: u64,
+    total_size: u64,
+    chunk_size: usize,
+    read_ahead_chunks: usize,
+    data_file: std.fs.File,
+    map_path: []u8,
+    max_cache_bytes: u64,
+    states: []ChunkState,
+    map_dirty: bool = false,
+
+    mutex: std.Thread.Mutex = .{},
+    work_cond: std.Thread.Condition = .{},
+    ready_cond: std.Thread.Condition = .{},
+    pending: std.ArrayListUnmanaged(usize) = .{},
+    workers: [max_workers]?std.Thread = [_]?std.Thread{null} ** max_workers,
+    stopping: std.atomic.Value(bool) = std.atomic.Value(bool).init(false),
+    cancelled: bool = false,
+    last_chunk: ?usize = null,
+    stats: Stats = .{},
+
+    pub fn create(allocator: std.mem.Allocator, url: []const u8, options: Options) !*HttpRangeCache {
+        _ = c.avformat_network_init();
+        errdefer _ = c.avformat_network_deinit();
+
+        const url_z = try allocator.dupeZ(u8, url);
+        errdefer allocator.free(url_z);
+
+        const total_size = try remoteSize(url_z);
+        const validator_hash = remoteValidatorHash(allocator, url);
+        const chunk_size = @max(options.chunk_size, 64 * 1024);
+        const chunk_count: usize = @intCast((total_size + chunk_size - 1) / chunk_size);
+        const url_hash = std.hash.Wyhash.hash(0, url);
+
+        const dir = if (options.cache_dir) |d| try allocator.dupe(u8, d) else try cacheDir(allocator, "http");
+        defer allocator.free(dir);
+        try std.fs.cwd().makePath(dir);
+
+        var name_buf: [32]u8 = undefined;
+        const data_name = try std.fmt.bufPrint(&name_buf, "{x:0>16}.zchd", .{url_hash});
+        const data_path = try std.fs.path.join(allocator, &.{ dir, data_name });
+        defer allocator.free(data_path);
+        const map_name = try std.fmt.bufPrint(&name_buf, "{x:0>16}.zchm", .{url_hash});
+        const map_path = try std.fs.path.join(allocator, &.{ dir, map_name });
+        errdefer allocator.free(map_path);
+
+        const data_file = try std.fs.cwd().createFile(data_path, .{ .read = true, .truncate = false });
+        errdefer data_file.close();
+
+        const states = try allocator.alloc(ChunkState, chunk_count);
+        errdefer allocator.free(states);
+        @memset(states, .absent);
+
+        const self = try allocator.create(HttpRangeCache);
+        errdefer allocator.destroy(self);
+        self.* = .{
+            .allocator = allocator,
+            .url = url_z,
+            .url_hash = url_hash,
+            .validator_hash = validator_hash,
+            .total_size = total_size,
+            .chunk_size = chunk_size,
+            .read_ahead_chunks = options.read_ahead_chunks,
+            .data_file = data_file,
+            .map_path = map_path,
+            .max_cache_bytes = options.max_cache_bytes orelse maxCacheBytesFromEnvironment(),
+            .states = states,
+        };
+
+        // A map for a different size, chunk layout, ETag or Last-Modified
+        // means the remote file changed; its data is dropped. So is a map
+        // whose data file was evicted from under it.
+        const data_size = (try data_file.stat()).size;
+        const map_loaded = if (data_size == total_size) (if (self.loadMap()) |_| true else |_| false) else false;
+        if (!map_loaded) {
+            @memset(states, .absent);
+            try data_file.setEndPos(0);
+        }
+        try data_file.setEndPos(total_size);
+        // The data file's mtime orders entries for eviction.
+        const now = std.time.nanoTimestamp();
+        data_file.updateTimes(now, now) catch {};
+
+        errdefer self.stopWorkers();
+        const worker_count = std.math.clamp(options.worker_count, 1, max_workers);
+        for (0..worker_count) |i| {
+            self.workers[i] = try std.Thread.spawn(.{}, workerMain, .{self});
+        }
+        return self;
+    }
+
+    pub fn destroy(self: *HttpRangeCache) void {
+        self.stopWorkers();
+        if (self.map_dirty) {
+            self.saveMap() catch {};
+        }
+
+        self.pending.deinit(self.allocator);
+        self.data_file.close();
+        if (std.fs.path.dirname(self.map_path)) |dir| {
+            evict(self.allocator, dir, self.max_cache_bytes) catch {};
+        }
+        self.allocator.free(self.states);
+        self.allocator.free(self.map_path);
+        self.allocator.free(self.url);
+        self.allocator.destroy(self);
+        _ = c.avformat_network_deinit();
+    }
+
+    pub fn size(self: *const HttpRangeCache) u64 {
+        return self.total_size;
+    }
+
+    /// Reads at most up to the end of the chunk holding `position`, waiting
+    /// for it to be fetched when it is not cached. Returns 0 at the end.
+    pub fn read(self: *HttpRangeCache, position: u64, out: []u8) !usize {
+        if (position >= self.total_size or out.len == 0) {
+            return 0;
+        }
+
+        const chunk: usize = @intCast(position / self.chunk_size);
+        {
+            self.mutex.lock();
+            defer self.mutex.unlock();
+
+            if (self.last_chunk != chunk) {
+                if (self.states[chunk] == .present) {
+                    self.stats.hit_chunks += 1;
+                } else {
+                    self.stats.miss_chunks += 1;
+                }
+                self.last_chunk = chunk;
+                try self.scheduleAround(chunk);
+            }
+
+            if (self.states[chunk] == .failed) {
+                // Give a failed chunk another attempt once the reader needs it.
+                self.states[chunk] = .absent;
+            }
+            if (self.states[chunk] == .absent) {
+                try self.scheduleAround(chunk);
+            }
+            while (self.states[chunk] != .present and self.states[chunk] != .failed and !self.cancelled) {
+                self.ready_cond.wait(&self.mutex);
+            }
+            if (self.cancelled) {
+                return error.Cancelled;
+            }
+            if (self.states[chunk] == .failed) {
+                return error.FetchFailed;
+            }
+        }
+
+        const chunk_end = @min(self.total_size, (@as(u64, chunk) + 1) * self.chunk_size);
+        const n: usize = @intCast(@min(@as(u64, out.len), chunk_end - position));
+        return self.data_file.preadAll(out[0..n], position);
+    }
+
+    /// Fails pending and later reads until `rearm`.
+    pub fn cancel(self: *HttpRangeCache) void {
+        self.mutex.lock();
+        self.cancelled = true;
+        self.ready_cond.broadcast();
+        self.mutex.unlock();
+    }
+
+    pub fn rearm(self: *HttpRangeCache) void {
+        self.mutex.lock();
+        defer self.mutex.unlock();
+        if (!self.stopping.load(.acquire)) {
+            self.cancelled = false;
+        }
+    }
+
+    // Puts `chunk` at the head of the queue and the read-ahead window behind
+    // it. Queued chunks outside the window belong to a position the reader
+    // has left and are dropped. Fails only when `chunk` itself could not be
+    // queued, since nothing would ever fetch it for the waiting reader.
+    fn scheduleAround(self: *HttpRangeCache, chunk: usize) !void {
+        const window_end = @min(self.states.len, chunk + 1 + self.read_ahead_chunks);
+        var i: usize = 0;
+        while (i < self.pending.items.len) {
+            const queued = self.pending.items[i];
+            if (queued < chunk or queued >= window_end) {
+                self.states[queued] = .absent;
+                _ = self.pending.orderedRemove(i);
+            } else {
+                i += 1;
+            }
+        }
+
+        if (self.states[chunk] == .absent) {
+            try self.pending.insert(self.allocator, 0, chunk);
+            self.states[chunk] = .queued;
+        } else if (self.states[chunk] == .queued) {
+            const at = std.mem.indexOfScalar(usize, self.pending.items, chunk).?;
+            _ = self.pending.orderedRemove(at);
+            self.pending.insertAssumeCapacity(0, chunk);
+        }
+
+        var ahead = chunk + 1;
+        while (ahead < window_end) : (ahead += 1) {
+            if (self.states[ahead] == .absent) {
+                self.pending.append(self.allocator, ahead) catch break;
+                self.states[ahead] = .queued;
+            }
+        }
+        self.work_cond.broadcast();
+    }
+
+    fn stopWorkers(self: *HttpRangeCache) void {
+        self.mutex.lock();
+        self.stopping.store(true, .release);
+        self.cancelled = true;
+        self.work_cond.broadcast();
+        self.ready_cond.broadcast();
+        self.mutex.unlock();
+
+        for (&self.workers) |*worker| {
+            if (worker.*) |thread| {
+                thread.join();
+                worker.* = null;
+            }
+        }
+    }
+
+    fn workerMain(self: *HttpRangeCache) void {
+        const buffer = self.allocator.alloc(u8, self.chunk_size) catch return;
+        defer self.allocator.free(buffer);
+
+        while (true) {
+            self.mutex.lock();
+            while (self.pending.items.len == 0 and !self.stopping.load(.acquire)) {
+                self.work_cond.wait(&self.mutex);
+            }
+            if (self.stopping.load(.acquire)) {
+                self.mutex.unlock();
+                return;
+            }
+            const chunk = self.pending.orderedRemove(0);
+            self.states[chunk] = .fetching;
+            self.mutex.unlock();
+
+            const start = @as(u64, chunk) * self.chunk_size;
+            const len: usize = @intCast(@min(self.total_size - start, self.chunk_size));
+            const fetched = self.fetchRange(start, buffer[0..len]);
+            const stored = if (fetched) |_| self.data_file.pwriteAll(buffer[0..len], start) else |err| err;
+
+            self.mutex.lock();
+            if (stored) |_| {
+                self.states[chunk] = .present;
+                self.stats.bytes_downloaded += @intCast(len);
+                self.map_dirty = true;
+            } else |_| {
+                self.states[chunk] = .failed;
+                self.stats.failed_fetches += 1;
+            }
+            self.ready_cond.broadcast();
+            self.mutex.unlock();
+        }
+    }
+
+    fn fetchRange(self: *HttpRangeCache, start: u64, out: []u8) !void {
+        var options: ?*c.AVDictionary = null;
+        defer c.av_dict_free(&options);
+
+        var offset_buf: [24]u8 = undefined;
+        var end_buf: [24]u8 = undefined;
+        const offset_text = try std.fmt.bufPrintZ(&offset_buf, "{d}", .{start});
+        const end_text = try std.fmt.bufPrintZ(&end_buf, "{d}", .{start + out.len});
+        _ = c.av_dict_set(&options, "offset", offset_text.ptr, 0);
+        _ = c.av_dict_set(&options, "end_offset", end_text.ptr, 0);
+
+        const interrupt = c.AVIOInterruptCB{ .callback = interruptFetch, .@"opaque" = self };
+        var ctx: [*c]c.AVIOContext = null;
+        if (c.avio_open2(&ctx, self.url.ptr, c.AVIO_FLAG_READ, &interrupt, &options) < 0) {
+            return error.OpenFailed;
+        }
+        defer _ = c.avio_closep(&ctx);
+
+        var got: usize = 0;
+        while (got < out.len) {
+            const n = c.avio_read(ctx, out[got..].ptr, @intCast(out.len - got));
+            if (n <= 0) {
+                return error.ShortRead;
+            }
+            got += @intCast(n);
+        }
+    }
+
+    fn interruptFetch(opaque_ptr: ?*anyopaque) callconv(.c) c_int {
+        const self: *HttpRangeCache = @ptrCast(@alignCast(opaque_ptr orelse return 1));
+        return @intFromBool(self.stopping.load(.acquire));
+    }
+
+    fn loadMap(self: *HttpRangeCache) !void {
+        const bytes = try std.fs.cwd().readFileAlloc(self.allocator, self.map_path, map_header_len + self.states.len);
+        defer self.allocator.free(bytes);
+
+        if (bytes.len != map_header_len + self.states.len or !std.mem.eql(u8, bytes[0..4], map_magic)) {
+            return error.InvalidMap;
+        }
+        if (std.mem.readInt(u32, bytes[4..8], .little) != map_version or
+            std.mem.readInt(u64, bytes[8..16], .little) != self.total_size or
+            std.mem.readInt(u64, bytes[16..24], .little) != self.chunk_size or
+            std.mem.readInt(u64, bytes[24..32], .little) != self.url_hash or
+            std.mem.readInt(u64, bytes[32..40], .little) != self.validator_hash)
+        {
+            return error.InvalidMap;
+        }
+
+        for (self.states, bytes[map_header_len..]) |*state, byte| {
+            state.* = if (byte == 1) .present else .absent;
+        }
+    }
+
+    // Written through a temporary file and a rename, like the keyframe index
+    // sidecars, so a crash never marks unfetched chunks as present.
+    fn saveMap(self: *HttpRangeCache) !void {
+        const bytes = try self.allocator.alloc(u8, map_header_len + self.states.len);
+        defer self.allocator.free(bytes);
+
+        @memcpy(bytes[0..4], map_magic);
+        std.mem.writeInt(u32, bytes[4..8], map_version, .little);
+        std.mem.writeInt(u64, bytes[8..16], self.total_size, .little);
+        std.mem.writeInt(u64, bytes[16..24], self.chunk_size, .little);
+        std.mem.writeInt(u64, bytes[24..32], self.url_hash, .little);
+        std.mem.writeInt(u64, bytes[32..40], self.validator_hash, .little);
+        for (self.states, bytes[map_header_len..]) |state, *byte| {
+            byte.* = @intFromBool(state == .present);
+        }
+
+        try self.data_file.sync();
+        const tmp_path = try std.fmt.allocPrint(self.allocator, "{s}.tmp", .{self.map_path});
+        defer self.allocator.free(tmp_path);
+        try std.fs.cwd().writeFile(.{ .sub_path = tmp_path, .data = bytes });
+        try std.fs.cwd().rename(tmp_path, self.map_path);
+        self.map_dirty = false;
+    }
+};
+
+const CacheEntry = struct {
+    stem: [16]u8,
+    bytes: u64,
+    last_used: i128,
+
+    fn lessRecentlyUsed(_: void, a: CacheEntry, b: CacheEntry) bool {
+        return a.last_used < b.last_used;
+    }
+};
+
+// Present chunks per the map; the data file is sparse, so its length says
+// nothing. Without a readable map the whole length counts.
+fn cachedBytes(allocator: std.mem.Allocator, dir: std.fs.Dir, stem: []const u8, data_size: u64) u64 {
+    var name_buf: [32]u8 = undefined;
+    const map_name = std.fmt.bufPrint(&name_buf, "{s}.zchm", .{stem}) catch return data_size;
+    const bytes = dir.readFileAlloc(allocator, map_name, max_map_bytes) catch return data_size;
+    defer allocator.free(bytes);
+    if (bytes.len < map_header_len or !std.mem.eql(u8, bytes[0..4], map_magic)) {
+        return data_size;
+    }
+
+    const chunk_size = std.mem.readInt(u64, bytes[16..24], .little);
+    const present = std.mem.count(u8, bytes[map_header_len..], &[_]u8{1});
+    return @min(data_size, std.math.mul(u64, present, chunk_size) catch data_size);
+}
+
+// Deletes least recently used entries until the cached chunks fit in
+// `max_bytes`. The map goes first, so an interrupted eviction leaves data
+// without a map, which the next open discards.
+fn evict(allocator: std.mem.Allocator, dir_path: []const u8, max_bytes: u64) !void {
+    var dir = try std.fs.cwd().openDir(dir_path, .{ .iterate = true });
+    defer dir.close();
+
+    var entries: std.ArrayListUnmanaged(CacheEntry) = .{};
+    defer entries.deinit(allocator);
+    var total: u64 = 0;
+
+    var it = dir.iterate();
+    while (try it.next()) |entry| {
+        if (entry.kind != .file or entry.name.len != 16 + ".zchd".len or !std.mem.endsWith(u8, entry.name, ".zchd")) {
+            continue;
+        }
+        const stat = dir.statFile(entry.name) catch continue;
+        var cached = CacheEntry{ .stem = undefined, .bytes = 0, .last_used = stat.mtime };
+        @memcpy(&cached.stem, entry.name[0..16]);
+        cached.bytes = cachedBytes(allocator, dir, &cached.stem, stat.size);
+        total += cached.bytes;
+        try entries.append(allocator, cached);
+    }
+    if (total <= max_bytes) {
+        return;
+    }
+
+    std.mem.sort(CacheEntry, entries.items, {}, CacheEntry.lessRecentlyUsed);
+    var name_buf: [32]u8 = undefined;
+    for (entries.items) |entry| {
+        if (total <= max_bytes) {
+            break;
+        }
+        dir.deleteFile(try std.fmt.bufPrint(&name_buf, "{s}.zchm", .{entry.stem})) catch {};
+        dir.deleteFile(try std.fmt.bufPrint(&name_buf, "{s}.zchd", .{entry.stem})) catch {};
+        total -|= entry.bytes;
+    }
+}
+
+fn remoteSize(url: [:0]const u8) !u64 {
+    var ctx: [*c]c.AVIOContext = null;
+    if (c.avio_open2(&ctx, url.ptr, c.AVIO_FLAG_READ, null, null) < 0) {
+        return error.OpenFailed;
+    }
+    defer _ = c.avio_closep(&ctx);
+
+    const total = c.avio_size(ctx);
+    // Live or chunked responses without a length cannot be cached by range.
+    if (total <= 0) {
+        return error.UnknownSize;
+    }
+    return @intCast(total);
+}
+
+// libavformat's HTTP protocol does not expose response headers, so the ETag
+// and Last-Modified come from a HEAD request of our own. A server that sends
+// neither, or refuses HEAD, hashes like one without validators; the size
+// check is all that guards its map then.
+fn remoteValidatorHash(allocator: std.mem.Allocator, url: []const u8) u64 {
+    var etag: u64 = 0;
+    var last_modified: u64 = 0;
+    fetch: {
+        var client: std.http.Client = .{ .allocator = allocator };
+        defer client.deinit();
+
+        const uri = std.Uri.parse(url) catch break :fetch;
+        var request = client.request(.HEAD, uri, .{}) catch break :fetch;
+        defer request.deinit();
+        request.sendBodiless() catch break :fetch;
+
+        var redirect_buf: [4096]u8 = undefined;
+        const response = request.receiveHead(&redirect_buf) catch break :fetch;
+        var headers = response.head.iterateHeaders();
+        while (headers.next()) |header| {
+            if (std.ascii.eqlIgnoreCase(header.name, "etag")) {
+                etag = std.hash.Wyhash.hash(1, header.value);
+            } else if (std.ascii.eqlIgnoreCase(header.name, "last-modified")) {
+                last_modified = std.hash.Wyhash.hash(2, header.value);
+            }
+        }
+    }
+    return std.hash.Wyhash.hash(etag, std.mem.asBytes(&last_modified));
+}
+
+pub fn isHttpUrl(path: []const u8) bool {
+    return std.ascii.startsWithIgnoreCase(path, "http://") or std.ascii.startsWithIgnoreCase(path, "https://");
+}
+
+test "range cache downloads each chunk once and serves later opens from disk" {
+    if (comptime !test_server.supported) {
+        return error.SkipZigTest;
+    }
+
+    const chunk_size = 64 * 1024;
+    const body = try std.testing.allocator.alloc(u8, 3 * chunk_size + 1234);
+    defer std.testing.allocator.free(body);
+    for (body, 0..) |*byte, i| {
+        byte.* = @truncate(i * 31 + i / 7);
+    }
+
+    var routes = [_]test_server.Route{.{ .path = "/media.bin", .body = body, .etag = "\"v1\"" }};
+    const server = try test_server.TestHttpServer.start(std.testing.allocator, &routes);
+    defer server.stop();
+    var url_buf: [64]u8 = undefined;
+    const url = try server.url(&url_buf, "/media.bin");
+
+    var tmp = std.testing.tmpDir(.{});
+    defer tmp.cleanup();
+    const dir = try tmp.dir.realpathAlloc(std.testing.allocator, ".");
+    defer std.testing.allocator.free(dir);
+    const options = Options{ .chunk_size = chunk_size, .worker_count = 2, .read_ahead_chunks = 2, .cache_dir = dir };
+
+    const out = try std.testing.allocator.alloc(u8, body.len);
+    defer std.testing.allocator.free(out);
+
+    {
+        const cache = try HttpRangeCache.create(std.testing.allocator, url, options);
+        defer cache.destroy();
+        try std.testing.expectEqual(@as(u64, body.len), cache.size());
+
+        // Start in the middle, as a seek would, then read from the start.
+        var probe: [100]u8 = undefined;
+        const n = try cache.read(2 * chunk_size + 10, &probe);
+        try std.testing.expectEqualSlices(u8, body[2 * chunk_size + 10 ..][0..n], probe[0..n]);
+
+        var position: usize = 0;
+        while (position < body.len) {
+            position += try cache.read(position, out[position..]);
+        }
+        try std.testing.expectEqualSlices(u8, body, out);
+        try std.testing.expect(cache.stats.miss_chunks > 0);
+        try std.testing.expectEqual(@as(i64, body.len), cache.stats.bytes_downloaded);
+
+        // A stopped and restarted demuxer reads on.
+        cache.cancel();
+        try std.testing.expectError(error.Cancelled, cache.read(0, &probe));
+        cache.rearm();
+        try std.testing.expect(try cache.read(0, &probe) > 0);
+    }
+
+    const requests_after_first_open = server.requestCount("/media.bin");
+    {
+        const cache = try HttpRangeCache.create(std.testing.allocator, url, options);
+        defer cache.destroy();
+
+        @memset(out, 0);
+        var position: usize = 0;
+        while (position < body.len) {
+            position += try cache.read(position, out[position..]);
+        }
+        try std.testing.expectEqualSlices(u8, body, out);
+        try std.testing.expectEqual(@as(i64, 4), cache.stats.hit_chunks);
+        try std.testing.expectEqual(@as(i64, 0), cache.stats.miss_chunks);
+        try std.testing.expectEqual(@as(i64, 0), cache.stats.bytes_downloaded);
+    }
+    // Only the size probe and the validator check reached the server the
+    // second time.
+    try std.testing.expectEqual(requests_after_first_open + 2, server.requestCount("/media.bin"));
+
+    // Same URL and size, new ETag: the server replaced the file.
+    routes[0].etag = "\"v2\"";
+    {
+        const cache = try HttpRangeCache.create(std.testing.allocator, url, options);
+        defer cache.destroy();
+
+        var position: usize = 0;
+        while (position < body.len) {
+            position += try cache.read(position, out[position..]);
+        }
+        try std.testing.expectEqual(@as(i64, 0), cache.stats.hit_chunks);
+        try std.testing.expectEqual(@as(i64, body.len), cache.stats.bytes_downloaded);
+    }
+}
+
+test "the disk budget evicts the least recently used URL" {
+    if (comptime !test_server.supported) {
+        return error.SkipZigTest;
+    }
+
+    const chunk_size = 64 * 1024;
+    const body = try std.testing.allocator.alloc(u8, 3 * chunk_size);
+    defer std.testing.allocator.free(body);
+    @memset(body, 0x5a);
+
+    const routes = [_]test_server.Route{
+        .{ .path = "/old.bin", .body = body },
+        .{ .path = "/new.bin", .body = body },
+    };
+    const server = try test_server.TestHttpServer.start(std.testing.allocator, &routes);
+    defer server.stop();
+
+    var tmp = std.testing.tmpDir(.{});
+    defer tmp.cleanup();
+    const dir = try tmp.dir.realpathAlloc(std.testing.allocator, ".");
+    defer std.testing.allocator.free(dir);
+    // Room for one URL's chunks, not two.
+    const options = Options{ .chunk_size = chunk_size, .worker_count = 2, .read_ahead_chunks = 2, .cache_dir = dir, .max_cache_bytes = 4 * chunk_size };
+
+    var stems: [2][16]u8 = undefined;
+    const out = try std.testing.allocator.alloc(u8, body.len);
+    defer std.testing.allocator.free(out);
+    for ([_][]const u8{ "/old.bin", "/new.bin" }, 0..) |path, i| {
+        var url_buf: [64]u8 = undefined;
+        const url = try server.url(&url_buf, path);
+        _ = try std.fmt.bufPrint(&stems[i], "{x:0>16}", .{std.hash.Wyhash.hash(0, url)});
+
+        const cache = try HttpRangeCache.create(std.testing.allocator, url, options);
+        defer cache.destroy();
+        var position: usize = 0;
+        while (position < body.len) {
+            position += try cache.read(position, out[position..]);
+        }
+    }
+
+    var name_buf: [32]u8 = undefined;
+    for ([_][]const u8{ ".zchd", ".zchm" }) |extension| {
+        try std.testing.expectError(error.FileNotFound, tmp.dir.access(try std.fmt.bufPrint(&name_buf, "{s}{s}", .{ &stems[0], extension }), .{}));
+        try tmp.dir.access(try std.fmt.bufPrint(&name_buf, "{s}{s}", .{ &stems[1], extension }), .{});
+    }
+}
+
+test "parseMaxCacheBytes reads megabytes" {
+    try std.testing.expectEqual(@as(u64, 512 * 1024 * 1024), parseMaxCacheBytes("512"));
+    try std.testing.expectEqual(default_max_cache_bytes, parseMaxCacheBytes("lots"));
+}
+
+test "a read fails instead of waiting when its chunk cannot be queued" {
+    var failing = std.testing.FailingAllocator.init(std.testing.allocator, .{ .fail_index = 0 });
+    var states = [_]ChunkState{.absent} ** 4;
+    var cache = HttpRangeCache{
+        .allocator = failing.allocator(),
+        .url = undefined,
+        .url_hash = 0,
+        .validator_hash = 0,
+        .total_size = 4 * 1024,
+        .chunk_size = 1024,
+        .read_ahead_chunks = 2,
+        .data_file = undefined,
+        .map_path = undefined,
+        .max_cache_bytes = 0,
+        .states = &states,
+    };
+    defer cache.pending.deinit(cache.allocator);
+
+    var out: [16]u8 = undefined;
+    try std.testing.expectError(error.OutOfMemory, cache.read(0, &out));
+    try std.testing.expectEqual(ChunkState.absent, states[0]);
+    // The next read of the same chunk schedules it again.
+    try std.testing.expectError(error.OutOfMemory, cache.read(0, &out));
+}
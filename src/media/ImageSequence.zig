@@ -0,0 +1,726 @@
+const std = @import("std");
+const c = @cImport({
+    @cInclude("libavformat/avformat.h");
+    @cInclude("libavutil/dict.h");
+    @cInclude("libavutil/mem.h");
+});
+
+// Numbered image sequences (DPX, EXR, PNG, TIFF, ...) open through
+// libavformat's image2 demuxer from a pattern path: `shot.%04d.exr`,
+// `shot.####.exr` (one `#` per digit) or `shot.%d.png`. A trailing `@rate`
+// (`shot.####.dpx@23.976`) sets the frame rate, otherwise `ZC_SEQUENCE_FPS`
+// does (default 24). The sequence starts at the lowest frame number on disk.
+//
+// image2 opens one file per frame through the format context's `io_open`
+// hook. The reader sits there and keeps the next `ZC_SEQUENCE_READAHEAD`
+// frames (default 8, `off` to read on demand) loaded on a small pool of
+// reader threads, so file I/O overlaps decode and several reads are in
+// flight at once. Frame `n` lives in slot `n % slots.len`.
+
+pub const default_rate = Rate{ .num = 24, .den = 1 };
+const default_read_ahead: usize = 8;
+const max_read_ahead: usize = 128;
+const max_frame_bytes: usize = 1024 * 1024 * 1024;
+const served_buffer_size: c_int = 256 * 1024;
+
+pub const Rate = struct {
+    num: c_int,
+    den: c_int,
+};
+
+/// "24", "24000/1001", or a decimal; the NTSC rates (23.976, 29.97, 59.94)
+/// map to their exact /1001 forms.
+pub fn parseRate(text: []const u8) ?Rate {
+    const trimmed = std.mem.trim(u8, text, " ");
+    if (std.mem.indexOfScalar(u8, trimmed, '/')) |slash| {
+        const num = std.fmt.parseInt(c_int, trimmed[0..slash], 10) catch return null;
+        const den = std.fmt.parseInt(c_int, trimmed[slash + 1 ..], 10) catch return null;
+        return if (num > 0 and den > 0) .{ .num = num, .den = den } else null;
+    }
+    const value = std.fmt.parseFloat(f64, trimmed) catch return null;
+    if (!(value > 0.0 and value <= 1000.0)) {
+        return null;
+    }
+    if (value == @round(value)) {
+        return .{ .num = @intFromFloat(value), .den = 1 };
+    }
+    const ntsc = @round(value * 1.001);
+    if (@abs(value * 1.001 - ntsc) < 0.005) {
+        return .{ .num = @as(c_int, @intFromFloat(ntsc)) * 1000, .den = 1001 };
+    }
+    return .{ .num = @intFromFloat(@round(value * 1000.0)), .den = 1000 };
+}
+
+pub fn rateFromEnvironment() Rate {
+    const value = std.process.getEnvVarOwned(std.heap.page_allocator, "ZC_SEQUENCE_FPS") catch return default_rate;
+    defer std.heap.page_allocator.free(value);
+    return parseRate(value) orelse default_rate;
+}
+
+/// Frames kept loaded ahead of the demuxer; 0 reads each frame on demand.
+pub fn parseReadAhead(value: []const u8) usize {
+    const trimmed = std.mem.trim(u8, value, " ");
+    if (std.ascii.eqlIgnoreCase(trimmed, "off")) {
+        return 0;
+    }
+    const frames = std.fmt.parseInt(usize, trimmed, 10) catch return default_read_ahead;
+    return @min(frames, max_read_ahead);
+}
+
+pub fn readAheadFromEnvironment() usize {
+    const value = std.process.getEnvVarOwned(std.heap.page_allocator, "ZC_SEQUENCE_READAHEAD") catch return default_read_ahead;
+    defer std.heap.page_allocator.free(value);
+    return parseReadAhead(value);
+}
+
+pub const Pattern = struct {
+    prefix: []const u8,
+    // Zero-padded width; 0 is unpadded.
+    digits: usize,
+    suffix: []const u8,
+
+    /// The frame number placeholder must be in the file name, not the
+    /// directory, and there must be only one.
+    pub fn parse(path: []const u8) ?Pattern {
+        const name_start = if (std.mem.lastIndexOfAny(u8, path, "/\\")) |i| i + 1 else 0;
+        const name = path[name_start..];
+        const found = findPlaceholder(name) orelse return null;
+        const suffix = name[found.end..];
+        if (findPlaceholder(suffix) != null) {
+            return null;
+        }
+        return .{
+            .prefix = path[0 .. name_start + found.start],
+            .digits = found.digits,
+            .suffix = suffix,
+        };
+    }
+
+    pub fn formatFrame(self: Pattern, buf: []u8, frame: u64) ![]u8 {
+        var digits_buf: [24]u8 = undefined;
+        const digits = try std.fmt.bufPrint(&digits_buf, "{d}", .{frame});
+        const padding = self.digits -| digits.len;
+        if (self.prefix.len + padding + digits.len + self.suffix.len > buf.len) {
+            return error.NoSpaceLeft;
+        }
+        var writer = std.Io.Writer.fixed(buf);
+        writer.writeAll(self.prefix) catch unreachable;
+        writer.splatByteAll('0', padding) catch unreachable;
+        writer.writeAll(digits) catch unreachable;
+        writer.writeAll(self.suffix) catch unreachable;
+        return writer.buffered();
+    }
+
+    /// The printf-style pattern image2 expects, with literal `%` escaped.
+    pub fn formatImage2(self: Pattern, buf: []u8) ![:0]u8 {
+        var writer = std.Io.Writer.fixed(buf);
+        try writeEscaped(&writer, self.prefix);
+        if (self.digits > 0) {
+            try writer.print("%0{d}d", .{self.digits});
+        } else {
+            try writer.writeAll("%d");
+        }
+        try writeEscaped(&writer, self.suffix);
+        try writer.writeByte(0);
+        const written = writer.buffered();
+        return written[0 .. written.len - 1 :0];
+    }
+
+    /// Frame number of a path this pattern produced.
+    pub fn frameNumber(self: Pattern, path: []const u8) ?u64 {
+        if (path.len <= self.prefix.len + self.suffix.len or !std.mem.startsWith(u8, path, self.prefix) or !std.mem.endsWith(u8, path, self.suffix)) {
+            return null;
+        }
+        const digits = path[self.prefix.len .. path.len - self.suffix.len];
+        if (digits.len < self.digits or (self.digits == 0 and digits.len > 1 and digits[0] == '0')) {
+            return null;
+        }
+        for (digits) |ch| {
+            if (!std.ascii.isDigit(ch)) {
+                return null;
+            }
+        }
+        return std.fmt.parseInt(u64, digits, 10) catch null;
+    }
+};
+
+const Placeholder = struct {
+    start: usize,
+    end: usize,
+    digits: usize,
+};
+
+fn findPlaceholder(name: []const u8) ?Placeholder {
+    var i: usize = 0;
+    while (i < name.len) : (i += 1) {
+        if (name[i] == '#') {
+            var end = i;
+            while (end < name.len and name[end] == '#') {
+                end += 1;
+            }
+            return .{ .start = i, .end = end, .digits = end - i };
+        }
+        if (name[i] != '%' or i + 1 >= name.len) {
+            continue;
+        }
+        if (name[i + 1] == '%') {
+            i += 1;
+            continue;
+        }
+        var end = i + 1;
+        while (end < name.len and std.ascii.isDigit(name[end])) {
+            end += 1;
+        }
+        if (end < name.len and name[end] == 'd') {
+            const width = std.fmt.parseInt(usize, name[i + 1 .. end], 10) catch 0;
+            return .{ .start = i, .end = end + 1, .digits = width };
+        }
+    }
+    return null;
+}
+
+fn writeEscaped(writer: *std.Io.Writer, text: []const u8) !void {
+    for (text) |ch| {
+        if (ch == '%') {
+            try writer.writeAll("%%");
+        } else {
+            try writer.writeByte(ch);
+        }
+    }
+}
+
+pub const Source = struct {
+    pattern: Pattern,
+    // Null when the path carries no `@rate`.
+    rate: ?Rate,
+};
+
+/// Null for anything that is not a local sequence pattern.
+pub fn parseSource(path: []const u8) ?Source {
+    if (std.mem.indexOf(u8, path, "://") != null) {
+        return null;
+    }
+    if (std.mem.lastIndexOfScalar(u8, path, '@')) |at| {
+        if (parseRate(path[at + 1 ..])) |rate| {
+            if (Pattern.parse(path[0..at])) |pattern| {
+                return .{ .pattern = pattern, .rate = rate };
+            }
+        }
+    }
+    const pattern = Pattern.parse(path) orelse return null;
+    return .{ .pattern = pattern, .rate = null };
+}
+
+pub const Range = struct {
+    first: u64,
+    last: u64,
+};
+
+/// Lowest and highest frame numbers on disk, or null when no file matches.
+pub fn scanRange(pattern: Pattern) !?Range {
+    const name_start = if (std.mem.lastIndexOfAny(u8, pattern.prefix, "/\\")) |i| i + 1 else 0;
+    const dir_path = if (name_start == 0) "." else pattern.prefix[0..name_start];
+    var dir = try std.fs.cwd().openDir(dir_path, .{ .iterate = true });
+    defer dir.close();
+
+    const name_pattern = Pattern{ .prefix = pattern.prefix[name_start..], .digits = pattern.digits, .suffix = pattern.suffix };
+    var range: ?Range = null;
+    var it = dir.iterate();
+    while (try it.next()) |entry| {
+        if (entry.kind == .directory) {
+            continue;
+        }
+        const frame = name_pattern.frameNumber(entry.name) orelse continue;
+        if (range) |*r| {
+            r.first = @min(r.first, frame);
+            r.last = @max(r.last, frame);
+        } else {
+            range = .{ .first = frame, .last = frame };
+        }
+    }
+    return range;
+}
+
+pub const Sequence = struct {
+    source: Source,
+    range: Range,
+};
+
+/// A sequence to open for `path`: it parses as a pattern, no file exists under
+/// that literal name (`Take #2.mov`, `100%5d.mp4`), and at least one frame
+/// matches on disk. Null sends the path down the normal open.
+pub fn detect(path: []const u8) ?Sequence {
+    const source = parseSource(path) orelse return null;
+    if (std.fs.cwd().access(path, .{})) |_| {
+        return null;
+    } else |_| {}
+    const range = (scanRange(source.pattern) catch return null) orelse return null;
+    return .{ .source = source, .range = range };
+}
+
+pub const Options = struct {
+    read_ahead: usize = default_read_ahead,
+    reader_count: usize = 4,
+};
+
+pub const Stats = struct {
+    prefetch_hits: i64 = 0,
+    misses: i64 = 0,
+    bytes_read: i64 = 0,
+    failed_reads: i64 = 0,
+};
+
+const SlotState = enum {
+    empty,
+    queued,
+    reading,
+    ready,
+    failed,
+};
+
+const Slot = struct {
+    frame: u64 = 0,
+    state: SlotState = .empty,
+    data: []u8 = &.{},
+};
+
+const Served = struct {
+    data: []u8,
+    position: usize = 0,
+};
+
+pub const SequenceReader = struct {
+    allocator: std.mem.Allocator,
+    pattern_storage: []u8,
+    pattern: Pattern,
+    range: Range,
+    slots: []Slot,
+    readers: []std.Thread,
+    mutex: std.Thread.Mutex = .{},
+    work_cond: std.Thread.Condition = .{},
+    ready_cond: std.Thread.Condition = .{},
+    stats: Stats = .{},
+    stopping: bool = false,
+    cancelled: std.atomic.Value(bool) = std.atomic.Value(bool).init(false),
+
+    pub fn create(allocator: std.mem.Allocator, pattern: Pattern, range: Range, options: Options) !*SequenceReader {
+        const self = try allocator.create(SequenceReader);
+        errdefer allocator.destroy(self);
+
+        const storage = try std.mem.concat(allocator, u8, &.{ pattern.prefix, pattern.suffix });
+        errdefer allocator.free(storage);
+
+        const slots = try allocator.alloc(Slot, options.read_ahead + 1);
+        errdefer allocator.free(slots);
+        @memset(slots, .{});
+
+        const reader_count = if (options.read_ahead == 0) 0 else std.math.clamp(options.reader_count, 1, options.read_ahead);
+        const readers = try allocator.alloc(std.Thread, reader_count);
+        errdefer allocator.free(readers);
+
+        self.* = .{
+            .allocator = allocator,
+            .pattern_storage = storage,
+            .pattern = .{
+                .prefix = storage[0..pattern.prefix.len],
+                .digits = pattern.digits,
+                .suffix = storage[pattern.prefix.len..],
+            },
+            .range = range,
+            .slots = slots,
+            .readers = readers,
+        };
+
+        var started: usize = 0;
+        errdefer self.stopReaders(started);
+        while (started < readers.len) : (started += 1) {
+            readers[started] = try std.Thread.spawn(.{}, readerMain, .{self});
+        }
+        return self;
+    }
+
+    /// The format context must already be closed: its open frame contexts
+    /// are released through this reader.
+    pub fn destroy(self: *SequenceReader) void {
+        self.stopReaders(self.readers.len);
+        for (self.slots) |slot| {
+            self.allocator.free(slot.data);
+        }
+        self.allocator.free(self.slots);
+        self.allocator.free(self.readers);
+        self.allocator.free(self.pattern_storage);
+        self.allocator.destroy(self);
+    }
+
+    /// Installs the hooks on a context from `avformat_alloc_context`, before
+    /// `avformat_open_input`.
+    pub fn attach(self: *SequenceReader, format_context: *anyopaque) void {
+        const ctx: *c.AVFormatContext = @ptrCast(@alignCast(format_context));
+        ctx.@"opaque" = self;
+        ctx.io_open = ioOpen;
+        ctx.io_close2 = ioClose2;
+    }
+
+    /// Fails pending and later opens until `rearm`.
+    pub fn cancel(self: *SequenceReader) void {
+        self.mutex.lock();
+        self.cancelled.store(true, .release);
+        self.ready_cond.broadcast();
+        self.mutex.unlock();
+    }
+
+    pub fn rearm(self: *SequenceReader) void {
+        self.mutex.lock();
+        defer self.mutex.unlock();
+        if (!self.stopping) {
+            self.cancelled.store(false, .release);
+        }
+    }
+
+    pub fn readAhead(self: *const SequenceReader) usize {
+        return self.slots.len - 1;
+    }
+
+    pub fn snapshotStats(self: *SequenceReader) Stats {
+        self.mutex.lock();
+        defer self.mutex.unlock();
+        return self.stats;
+    }
+
+    fn stopReaders(self: *SequenceReader, started: usize) void {
+        self.mutex.lock();
+        self.stopping = true;
+        self.cancelled.store(true, .release);
+        self.work_cond.broadcast();
+        self.ready_cond.broadcast();
+        self.mutex.unlock();
+        for (self.readers[0..started]) |thread| {
+            thread.join();
+        }
+    }
+
+    // Returns the contents of `frame`, owned by the caller.
+    fn take(self: *SequenceReader, frame: u64) ![]u8 {
+        self.mutex.lock();
+        if (self.cancelled.load(.acquire)) {
+            self.mutex.unlock();
+            return error.Cancelled;
+        }
+        const slot = &self.slots[frame % self.slots.len];
+        if (slot.frame == frame and slot.state != .empty) {
+            while (slot.state == .reading and !self.cancelled.load(.acquire)) {
+                self.ready_cond.wait(&self.mutex);
+            }
+            if (self.cancelled.load(.acquire)) {
+                self.mutex.unlock();
+                return error.Cancelled;
+            }
+            if (slot.state == .ready) {
+                const data = slot.data;
+                slot.* = .{};
+                self.stats.prefetch_hits += 1;
+                self.scheduleAfter(frame);
+                self.mutex.unlock();
+                return data;
+            }
+            // Queued but not started, or failed: read it here.
+            slot.* = .{};
+        }
+        self.stats.misses += 1;
+        self.scheduleAfter(frame);
+        self.mutex.unlock();
+        return self.readFrame(frame);
+    }
+
+    // Queues the frames after `frame` that are not loaded yet. Slots still
+    // being read finish first and are picked up by a later call.
+    fn scheduleAfter(self: *SequenceReader, frame: u64) void {
+        if (self.readers.len == 0) {
+            return;
+        }
+        const last = @min(frame + self.readAhead(), self.range.last);
+        var next = frame + 1;
+        while (next <= last) : (next += 1) {
+            const slot = &self.slots[next % self.slots.len];
+            if ((slot.frame == next and slot.state != .empty) or slot.state == .reading) {
+                continue;
+            }
+            self.allocator.free(slot.data);
+            slot.* = .{ .frame = next, .state = .queued };
+        }
+        self.work_cond.broadcast();
+    }
+
+    fn readFrame(self: *SequenceReader, frame: u64) ![]u8 {
+        var path_buf: [std.fs.max_path_bytes]u8 = undefined;
+        const path = try self.pattern.formatFrame(&path_buf, frame);
+        const data = std.fs.cwd().readFileAlloc(self.allocator, path, max_frame_bytes) catch |err| {
+            self.mutex.lock();
+            self.stats.failed_reads += 1;
+            self.mutex.unlock();
+            return err;
+        };
+        self.mutex.lock();
+        self.stats.bytes_read += @intCast(data.len);
+        self.mutex.unlock();
+        return data;
+    }
+
+    fn readerMain(self: *SequenceReader) void {
+        self.mutex.lock();
+        defer self.mutex.unlock();
+        while (true) {
+            const slot = while (!self.stopping) {
+                if (self.nextQueued()) |next| {
+                    break next;
+                }
+                self.work_cond.wait(&self.mutex);
+            } else return;
+
+            slot.state = .reading;
+            const frame = slot.frame;
+            self.mutex.unlock();
+            const result = self.readFrame(frame);
+            self.mutex.lock();
+
+            // Reading slots are never rescheduled, so `slot` still holds `frame`.
+            if (result) |data| {
+                slot.data = data;
+                slot.state = .ready;
+            } else |_| {
+                slot.state = .failed;
+            }
+            self.ready_cond.broadcast();
+        }
+    }
+
+    // The queued frame the demuxer will reach first.
+    fn nextQueued(self: *SequenceReader) ?*Slot {
+        var best: ?*Slot = null;
+        for (self.slots) |*slot| {
+            if (slot.state == .queued and (best == null or slot.frame < best.?.frame)) {
+                best = slot;
+            }
+        }
+        return best;
+    }
+
+    fn serve(self: *SequenceReader, pb: [*c][*c]c.AVIOContext, data: []u8) c_int {
+        const served = self.allocator.create(Served) catch {
+            self.allocator.free(data);
+            return c.AVERROR(c.ENOMEM);
+        };
+        served.* = .{ .data = data };
+
+        const buffer: [*c]u8 = @ptrCast(c.av_malloc(@intCast(served_buffer_size)));
+        if (buffer != null) {
+            pb.* = c.avio_alloc_context(buffer, served_buffer_size, 0, served, servedRead, null, servedSeek);
+            if (pb.* != null) {
+                return 0;
+            }
+            c.av_free(buffer);
+        }
+        self.allocator.free(data);
+        self.allocator.destroy(served);
+        return c.AVERROR(c.ENOMEM);
+    }
+
+    fn fromContext(s: [*c]c.AVFormatContext) ?*SequenceReader {
+        if (s == null) {
+            return null;
+        }
+        return @ptrCast(@alignCast(s.*.@"opaque" orelse return null));
+    }
+
+    fn ioOpen(s: [*c]c.AVFormatContext, pb: [*c][*c]c.AVIOContext, url: [*c]const u8, flags: c_int, options: [*c]?*c.AVDictionary) callconv(.c) c_int {
+        const self = fromContext(s) orelse return c.AVERROR(c.EINVAL);
+        const frame = self.pattern.frameNumber(std.mem.span(url));
+        if (frame == null or (flags & c.AVIO_FLAG_WRITE) != 0) {
+            return c.avio_open2(pb, url, flags, &s.*.interrupt_callback, options);
+        }
+
+        const data = self.take(frame.?) catch |err| return switch (err) {
+            error.Cancelled => c.AVERROR_EXIT,
+            error.OutOfMemory => c.AVERROR(c.ENOMEM),
+            error.FileNotFound => c.AVERROR(c.ENOENT),
+            else => c.AVERROR(c.EIO),
+        };
+        return self.serve(pb, data);
+    }
+
+    fn ioClose2(s: [*c]c.AVFormatContext, pb: [*c]c.AVIOContext) callconv(.c) c_int {
+        if (pb == null) {
+            return 0;
+        }
+        const served_here = if (pb.*.read_packet) |read_fn| read_fn == &servedRead else false;
+        if (!served_here) {
+            return c.avio_close(pb);
+        }
+
+        const self = fromContext(s) orelse return c.AVERROR(c.EINVAL);
+        const served: *Served = @ptrCast(@alignCast(pb.*.@"opaque"));
+        self.allocator.free(served.data);
+        self.allocator.destroy(served);
+        var ctx = pb;
+        c.av_freep(@ptrCast(&ctx.*.buffer));
+        c.avio_context_free(&ctx);
+        return 0;
+    }
+};
+
+fn servedRead(opaque_ptr: ?*anyopaque, buf: [*c]u8, buf_size: c_int) callconv(.c) c_int {
+    const served: *Served = @ptrCast(@alignCast(opaque_ptr orelse return c.AVERROR(c.EINVAL)));
+    if (buf == null or buf_size <= 0) {
+        return c.AVERROR(c.EINVAL);
+    }
+    if (served.position >= served.data.len) {
+        return c.AVERROR_EOF;
+    }
+
+    const count = @min(@as(usize, @intCast(buf_size)), served.data.len - served.position);
+    @memcpy(buf[0..count], served.data[served.position .. served.position + count]);
+    served.position += count;
+    return @intCast(count);
+}
+
+fn servedSeek(opaque_ptr: ?*anyopaque, offset: i64, whence: c_int) callconv(.c) i64 {
+    const served: *Served = @ptrCast(@alignCast(opaque_ptr orelse return c.AVERROR(c.EINVAL)));
+    const size: i64 = @intCast(served.data.len);
+    if ((whence & c.AVSEEK_SIZE) != 0) {
+        return size;
+    }
+
+    const base: i64 = switch (whence & ~@as(c_int, c.AVSEEK_FORCE)) {
+        c.SEEK_SET => 0,
+        c.SEEK_CUR => @intCast(served.position),
+        c.SEEK_END => size,
+        else => return c.AVERROR(c.EINVAL),
+    };
+    const target = base + offset;
+    if (target < 0) {
+        return c.AVERROR(c.EINVAL);
+    }
+    served.position = @intCast(@min(target, size));
+    return @intCast(served.position);
+}
+
+test "parseSource reads printf and hash patterns with an optional rate" {
+    const printf = parseSource("/shots/a%b/plate.%04d.exr").?;
+    try std.testing.expectEqualStrings("/shots/a%b/plate.", printf.pattern.prefix);
+    try std.testing.expectEqual(@as(usize, 4), printf.pattern.digits);
+    try std.testing.expectEqualStrings(".exr", printf.pattern.suffix);
+    try std.testing.expectEqual(@as(?Rate, null), printf.rate);
+
+    const hashes = parseSource("plate.######.dpx@23.976").?;
+    try std.testing.expectEqualStrings("plate.", hashes.pattern.prefix);
+    try std.testing.expectEqual(@as(usize, 6), hashes.pattern.digits);
+    try std.testing.expectEqual(Rate{ .num = 24000, .den = 1001 }, hashes.rate.?);
+
+    try std.testing.expectEqual(@as(usize, 0), parseSource("frame_%d.png").?.pattern.digits);
+    try std.testing.expectEqual(@as(?Source, null), parseSource("movie.mov"));
+    try std.testing.expectEqual(@as(?Source, null), parseSource("https://host/a%20d.mp4"));
+    try std.testing.expectEqual(@as(?Source, null), parseSource("100%%.png"));
+    try std.testing.expectEqual(@as(?Source, null), parseSource("a.%04d.%04d.exr"));
+}
+
+test "detect leaves real files with pattern characters to the normal open" {
+    const allocator = std.testing.allocator;
+    var tmp = std.testing.tmpDir(.{});
+    defer tmp.cleanup();
+    try tmp.dir.writeFile(.{ .sub_path = "a #1.mp4", .data = "not a frame" });
+    try tmp.dir.writeFile(.{ .sub_path = "100%5d.mp4", .data = "" });
+    try tmp.dir.writeFile(.{ .sub_path = "plate.0007.png", .data = "" });
+
+    const dir_path = try tmp.dir.realpathAlloc(allocator, ".");
+    defer allocator.free(dir_path);
+    var path_buf: [std.fs.max_path_bytes]u8 = undefined;
+
+    for ([_][]const u8{ "a #1.mp4", "100%5d.mp4", "Track #3.mp3" }) |name| {
+        const path = try std.fmt.bufPrint(&path_buf, "{s}/{s}", .{ dir_path, name });
+        try std.testing.expect(parseSource(path) != null);
+        try std.testing.expectEqual(@as(?Sequence, null), detect(path));
+    }
+
+    const pattern = try std.fmt.bufPrint(&path_buf, "{s}/plate.####.png@25", .{dir_path});
+    const sequence = detect(pattern).?;
+    try std.testing.expectEqual(Range{ .first = 7, .last = 7 }, sequence.range);
+    try std.testing.expectEqual(Rate{ .num = 25, .den = 1 }, sequence.source.rate.?);
+}
+
+test "parseRate accepts integers, fractions and NTSC decimals" {
+    try std.testing.expectEqual(Rate{ .num = 25, .den = 1 }, parseRate("25").?);
+    try std.testing.expectEqual(Rate{ .num = 30000, .den = 1001 }, parseRate("29.97").?);
+    try std.testing.expectEqual(Rate{ .num = 48000, .den = 1001 }, parseRate("48000/1001").?);
+    try std.testing.expectEqual(Rate{ .num = 12500, .den = 1000 }, parseRate("12.5").?);
+    try std.testing.expectEqual(@as(?Rate, null), parseRate("0"));
+    try std.testing.expectEqual(@as(?Rate, null), parseRate("fast"));
+}
+
+test "pattern formats frames and image2 patterns and reads them back" {
+    const pattern = Pattern.parse("a%b/plate.####.exr").?;
+    var buf: [64]u8 = undefined;
+    const path = try pattern.formatFrame(&buf, 1001);
+    try std.testing.expectEqualStrings("a%b/plate.1001.exr", path);
+    try std.testing.expectEqual(@as(?u64, 1001), pattern.frameNumber(path));
+    try std.testing.expectEqualStrings("a%b/plate.12345.exr", try pattern.formatFrame(&buf, 12345));
+    try std.testing.expectEqual(@as(?u64, null), pattern.frameNumber("a%b/plate.101.exr"));
+    try std.testing.expectEqual(@as(?u64, null), pattern.frameNumber("a%b/plate.10x1.exr"));
+
+    var image2_buf: [64]u8 = undefined;
+    try std.testing.expectEqualStrings("a%%b/plate.%04d.exr", try pattern.formatImage2(&image2_buf));
+    try std.testing.expectEqualStrings("f%d.png", try Pattern.parse("f%d.png").?.formatImage2(&image2_buf));
+}
+
+test "reader serves frames in order and loads ahead" {
+    const allocator = std.testing.allocator;
+    var tmp = std.testing.tmpDir(.{});
+    defer tmp.cleanup();
+
+    const first: u64 = 1001;
+    const count: u64 = 12;
+    var name_buf: [32]u8 = undefined;
+    for (first..first + count) |frame| {
+        const name = try std.fmt.bufPrint(&name_buf, "plate.{d:0>4}.dpx", .{frame});
+        var contents: [16]u8 = undefined;
+        try tmp.dir.writeFile(.{ .sub_path = name, .data = try std.fmt.bufPrint(&contents, "frame {d}", .{frame}) });
+    }
+    try tmp.dir.writeFile(.{ .sub_path = "plate.notes.txt", .data = "" });
+
+    const dir_path = try tmp.dir.realpathAlloc(allocator, ".");
+    defer allocator.free(dir_path);
+    const pattern_path = try std.fmt.allocPrint(allocator, "{s}/plate.####.dpx", .{dir_path});
+    defer allocator.free(pattern_path);
+
+    const pattern = Pattern.parse(pattern_path).?;
+    const range = (try scanRange(pattern)).?;
+    try std.testing.expectEqual(Range{ .first = first, .last = first + count - 1 }, range);
+
+    const reader = try SequenceReader.create(allocator, pattern, range, .{ .read_ahead = 4, .reader_count = 2 });
+    defer reader.destroy();
+
+    var expected: [16]u8 = undefined;
+    for (first..first + count) |frame| {
+        const data = try reader.take(frame);
+        defer allocator.free(data);
+        try std.testing.expectEqualStrings(try std.fmt.bufPrint(&expected, "frame {d}", .{frame}), data);
+    }
+
+    // Only the first frame is guaranteed to miss; the readers may lose a
+    // race for a few others but never read past the last frame.
+    const stats = reader.snapshotStats();
+    try std.testing.expectEqual(@as(i64, count), stats.prefetch_hits + stats.misses);
+    try std.testing.expect(stats.misses >= 1);
+    try std.testing.expectEqual(@as(i64, 0), stats.failed_reads);
+
+    // A jump back misses once and reloads from there.
+    const again = try reader.take(first);
+    allocator.free(again);
+    try std.testing.expectEqual(stats.misses + 1, reader.snapshotStats().misses);
+
+    // A stopped demuxer fails opens until it starts again.
+    reader.cancel();
+    try std.testing.expectError(error.Cancelled, reader.take(first + 1));
+    reader.rearm();
+    const resumed = try reader.take(first + 1);
+    allocator.free(resumed);
+}
@@ -0,0 +1,344 @@
+const std = @import("std");
+const FileIdentity = @import("FileIdentity.zig").FileIdentity;
+
+// Video keyframe positions (presentation time in AV_TIME_BASE units to byte
+// offset) for one media file. Entries arrive from the demux thread during
+// playback and from an optional background scan; both run concurrently with
+// seeks, so every access goes through `mutex`.
+//
+// The sidecar is a little-endian dump of the entries behind a header that
+// repeats the file identity and the indexed stream.
+
+const sidecar_magic = "ZCKF";
+const sidecar_version: u32 = 1;
+const header_len = 4 + 4 + 8 + 8 + 8 + 4 + 4 + 4;
+const entry_len = 16;
+const max_sidecar_entries: usize = 1 << 22;
+
+/// Two neighbouring entries further apart than this are assumed to come from
+/// disjoint indexed ranges, so a target between them is not served. Tighter
+/// still is twice the typical spacing seen so far: a wider gap in a stream
+/// that keys every second means keyframes between them were never indexed.
+pub const max_keyframe_gap_us: i64 = 10 * std.time.us_per_s;
+const gap_samples: usize = 63;
+
+pub const Entry = struct {
+    pts_us: i64,
+    pos: i64,
+};
+
+pub const KeyframeIndex = struct {
+    allocator: std.mem.Allocator,
+    mutex: std.Thread.Mutex = .{},
+    entries: std.ArrayListUnmanaged(Entry) = .{},
+    identity: FileIdentity,
+    stream_index: u32,
+    media_path: []u8,
+    complete: bool = false,
+    dirty: bool = false,
+
+    pub fn create(allocator: std.mem.Allocator, media_path: []const u8, stream_index: u32) !*KeyframeIndex {
+        const self = try allocator.create(KeyframeIndex);
+        errdefer allocator.destroy(self);
+
+        const path_copy = try allocator.dupe(u8, media_path);
+        errdefer allocator.free(path_copy);
+
+        self.* = .{
+            .allocator = allocator,
+            .identity = try FileIdentity.fromPath(media_path),
+            .stream_index = stream_index,
+            .media_path = path_copy,
+        };
+        return self;
+    }
+
+    pub fn destroy(self: *KeyframeIndex) void {
+        self.entries.deinit(self.allocator);
+        self.allocator.free(self.media_path);
+        self.allocator.destroy(self);
+    }
+
+    pub fn sidecarPath(self: *const KeyframeIndex, allocator: std.mem.Allocator) ![]u8 {
+        return self.identity.cacheFilePath(allocator, "keyframes", ".zckf");
+    }
+
+    pub fn insert(self: *KeyframeIndex, pts_us: i64, pos: i64) void {
+        if (pos < 0) {
+            return;
+        }
+
+        self.mutex.lock();
+        defer self.mutex.unlock();
+
+        const idx = self.lowerBound(pts_us);
+        if (idx < self.entries.items.len and self.entries.items[idx].pts_us == pts_us) {
+            return;
+        }
+        self.entries.insert(self.allocator, idx, .{ .pts_us = pts_us, .pos = pos }) catch return;
+        self.dirty = true;
+    }
+
+    pub fn markComplete(self: *KeyframeIndex) void {
+        self.mutex.lock();
+        defer self.mutex.unlock();
+        if (!self.complete) {
+            self.complete = true;
+            self.dirty = true;
+        }
+    }
+
+    pub fn isComplete(self: *KeyframeIndex) bool {
+        self.mutex.lock();
+        defer self.mutex.unlock();
+        return self.complete;
+    }
+
+    pub fn count(self: *KeyframeIndex) usize {
+        self.mutex.lock();
+        defer self.mutex.unlock();
+        return self.entries.items.len;
+    }
+
+    /// Byte offset of the last keyframe at or before `target_us`, when the
+    /// index is known to cover the target.
+    pub fn seekOffset(self: *KeyframeIndex, target_us: i64) ?i64 {
+        self.mutex.lock();
+        defer self.mutex.unlock();
+
+        const items = self.entries.items;
+        const upper = self.lowerBound(target_us +| 1);
+        if (upper == 0) {
+            return null;
+        }
+
+        const entry = items[upper - 1];
+        const max_gap = self.maxGap();
+        if (upper < items.len) {
+            if (items[upper].pts_us - entry.pts_us > max_gap) {
+                return null;
+            }
+        } else if (!self.complete or target_us - entry.pts_us > max_gap) {
+            return null;
+        }
+        return entry.pos;
+    }
+
+    // Twice the median of up to `gap_samples` neighbour gaps spread across
+    // the index, capped at `max_keyframe_gap_us`. The median keeps a few
+    // unindexed stretches from widening the bound.
+    fn maxGap(self: *const KeyframeIndex) i64 {
+        const items = self.entries.items;
+        if (items.len < 2) {
+            return max_keyframe_gap_us;
+        }
+
+        var gaps: [gap_samples]i64 = undefined;
+        const gap_count = @min(items.len - 1, gap_samples);
+        for (0..gap_count) |i| {
+            const at = i * (items.len - 1) / gap_count;
+            gaps[i] = items[at + 1].pts_us - items[at].pts_us;
+        }
+        std.mem.sort(i64, gaps[0..gap_count], {}, std.sort.asc(i64));
+        return @min(gaps[gap_count / 2] *| 2, max_keyframe_gap_us);
+    }
+
+    pub fn loadFrom(self: *KeyframeIndex, path: []const u8) !void {
+        const bytes = try std.fs.cwd().readFileAlloc(self.allocator, path, header_len + max_sidecar_entries * entry_len);
+        defer self.allocator.free(bytes);
+
+        if (bytes.len < header_len or !std.mem.eql(u8, bytes[0..4], sidecar_magic)) {
+            return error.InvalidSidecar;
+        }
+        if (std.mem.readInt(u32, bytes[4..8], .little) != sidecar_version) {
+            return error.InvalidSidecar;
+        }
+
+        const identity = FileIdentity{
+            .size = std.mem.readInt(u64, bytes[8..16], .little),
+            .mtime_ns = std.mem.readInt(i64, bytes[16..24], .little),
+            .path_hash = std.mem.readInt(u64, bytes[24..32], .little),
+        };
+        const stream_index = std.mem.readInt(u32, bytes[32..36], .little);
+        const complete = std.mem.readInt(u32, bytes[36..40], .little) != 0;
+        const entry_count = std.mem.readInt(u32, bytes[40..44], .little);
+
+        if (!identity.eql(self.identity) or stream_index != self.stream_index) {
+            return error.StaleSidecar;
+        }
+        if (bytes.len != header_len + @as(usize, entry_count) * entry_len) {
+            return error.InvalidSidecar;
+        }
+
+        var loaded: std.ArrayListUnmanaged(Entry) = .{};
+        errdefer loaded.deinit(self.allocator);
+        try loaded.ensureTotalCapacity(self.allocator, entry_count);
+
+        var offset: usize = header_len;
+        var last_pts: i64 = std.math.minInt(i64);
+        for (0..entry_count) |_| {
+            const entry = Entry{
+                .pts_us = std.mem.readInt(i64, bytes[offset..][0..8], .little),
+                .pos = std.mem.readInt(i64, bytes[offset + 8 ..][0..8], .little),
+            };
+            if (entry.pts_us <= last_pts or entry.pos < 0) {
+                return error.InvalidSidecar;
+            }
+            last_pts = entry.pts_us;
+            loaded.appendAssumeCapacity(entry);
+            offset += entry_len;
+        }
+
+        self.mutex.lock();
+        defer self.mutex.unlock();
+        self.entries.deinit(self.allocator);
+        self.entries = loaded;
+        self.complete = complete;
+        self.dirty = false;
+    }
+
+    /// Writes the sidecar through a temporary file and a rename, so a crash
+    /// never leaves a truncated index behind.
+    pub fn saveTo(self: *KeyframeIndex, path: []const u8) !void {
+        var bytes: std.ArrayListUnmanaged(u8) = .{};
+        defer bytes.deinit(self.allocator);
+
+        {
+            self.mutex.lock();
+            defer self.mutex.unlock();
+
+            const items = self.entries.items;
+            try bytes.resize(self.allocator, header_len + items.len * entry_len);
+            const out = bytes.items;
+            @memcpy(out[0..4], sidecar_magic);
+            std.mem.writeInt(u32, out[4..8], sidecar_version, .little);
+            std.mem.writeInt(u64, out[8..16], self.identity.size, .little);
+            std.mem.writeInt(i64, out[16..24], self.identity.mtime_ns, .little);
+            std.mem.writeInt(u64, out[24..32], self.identity.path_hash, .little);
+            std.mem.writeInt(u32, out[32..36], self.stream_index, .little);
+            std.mem.writeInt(u32, out[36..40], @intFromBool(self.complete), .little);
+            std.mem.writeInt(u32, out[40..44], @intCast(items.len), .little);
+
+            var offset: usize = header_len;
+            for (items) |entry| {
+                std.mem.writeInt(i64, out[offset..][0..8], entry.pts_us, .little);
+                std.mem.writeInt(i64, out[offset + 8 ..][0..8], entry.pos, .little);
+                offset += entry_len;
+            }
+            self.dirty = false;
+        }
+
+        const tmp_path = try std.fmt.allocPrint(self.allocator, "{s}.tmp", .{path});
+        defer self.allocator.free(tmp_path);
+
+        try std.fs.cwd().writeFile(.{ .sub_path = tmp_path, .data = bytes.items });
+        try std.fs.cwd().rename(tmp_path, path);
+    }
+
+    pub fn isDirty(self: *KeyframeIndex) bool {
+        self.mutex.lock();
+        defer self.mutex.unlock();
+        return self.dirty;
+    }
+
+    fn lowerBound(self: *const KeyframeIndex, pts_us: i64) usize {
+        var lo: usize = 0;
+        var hi: usize = self.entries.items.len;
+        while (lo < hi) {
+            const mid = lo + (hi - lo) / 2;
+            if (self.entries.items[mid].pts_us < pts_us) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        return lo;
+    }
+};
+
+fn createTestIndex(tmp: *std.testing.TmpDir) !*KeyframeIndex {
+    tmp.dir.access("media.ts", .{}) catch {
+        try tmp.dir.writeFile(.{ .sub_path = "media.ts", .data = "payload" });
+    };
+    const path = try tmp.dir.realpathAlloc(std.testing.allocator, "media.ts");
+    defer std.testing.allocator.free(path);
+    return KeyframeIndex.create(std.testing.allocator, path, 0);
+}
+
+test "seekOffset serves targets bracketed by nearby keyframes" {
+    var tmp = std.testing.tmpDir(.{});
+    defer tmp.cleanup();
+    const index = try createTestIndex(&tmp);
+    defer index.destroy();
+
+    index.insert(2_000_000, 4000);
+    index.insert(0, 0);
+    index.insert(1_000_000, 2000);
+    index.insert(1_000_000, 9999);
+    index.insert(60_000_000, 90000);
+    try std.testing.expectEqual(@as(usize, 4), index.count());
+
+    try std.testing.expectEqual(@as(?i64, 0), index.seekOffset(0));
+    try std.testing.expectEqual(@as(?i64, 2000), index.seekOffset(1_500_000));
+    try std.testing.expectEqual(@as(?i64, 2000), index.seekOffset(1_000_000));
+    try std.testing.expectEqual(@as(?i64, null), index.seekOffset(-1));
+    // The gap between 2 s and 60 s was never observed.
+    try std.testing.expectEqual(@as(?i64, null), index.seekOffset(30_000_000));
+    try std.testing.expectEqual(@as(?i64, null), index.seekOffset(61_000_000));
+
+    index.markComplete();
+    try std.testing.expectEqual(@as(?i64, 90000), index.seekOffset(61_000_000));
+}
+
+test "seekOffset bounds gaps by the typical keyframe spacing" {
+    var tmp = std.testing.tmpDir(.{});
+    defer tmp.cleanup();
+    const index = try createTestIndex(&tmp);
+    defer index.destroy();
+
+    // Keyframes every 2 s, except that 8 s and 10 s were never indexed.
+    var pts_us: i64 = 0;
+    while (pts_us <= 20_000_000) : (pts_us += 2_000_000) {
+        if (pts_us != 8_000_000 and pts_us != 10_000_000) {
+            index.insert(pts_us, @divExact(pts_us, 1000));
+        }
+    }
+
+    try std.testing.expectEqual(@as(?i64, 4000), index.seekOffset(5_000_000));
+    try std.testing.expectEqual(@as(?i64, 12000), index.seekOffset(13_000_000));
+    // 6 s apart is within max_keyframe_gap_us but three times the spacing.
+    try std.testing.expectEqual(@as(?i64, null), index.seekOffset(9_000_000));
+
+    index.markComplete();
+    try std.testing.expectEqual(@as(?i64, 20000), index.seekOffset(23_000_000));
+    try std.testing.expectEqual(@as(?i64, null), index.seekOffset(25_000_000));
+}
+
+test "sidecar round-trips and rejects other files" {
+    var tmp = std.testing.tmpDir(.{});
+    defer tmp.cleanup();
+    const index = try createTestIndex(&tmp);
+    defer index.destroy();
+
+    index.insert(0, 0);
+    index.insert(1_000_000, 188 * 40);
+    index.markComplete();
+
+    const dir_path = try tmp.dir.realpathAlloc(std.testing.allocator, ".");
+    defer std.testing.allocator.free(dir_path);
+    const sidecar = try std.fs.path.join(std.testing.allocator, &.{ dir_path, "media.zckf" });
+    defer std.testing.allocator.free(sidecar);
+
+    try index.saveTo(sidecar);
+    try std.testing.expect(!index.isDirty());
+
+    const reloaded = try createTestIndex(&tmp);
+    defer reloaded.destroy();
+    try reloaded.loadFrom(sidecar);
+    try std.testing.expectEqual(@as(usize, 2), reloaded.count());
+    try std.testing.expect(reloaded.isComplete());
+    try std.testing.expectEqual(@as(?i64, 188 * 40), reloaded.seekOffset(1_200_000));
+
+    reloaded.stream_index = 1;
+    try std.testing.expectError(error.StaleSidecar, reloaded.loadFrom(sidecar));
+}
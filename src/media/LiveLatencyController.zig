@@ -0,0 +1,134 @@
+const std = @import("std");
+
+// Holds live playback a target distance behind the live edge. A small
+// overshoot is worked off by playing slightly fast, which goes unnoticed; a
+// large one (a stall, a pause, a burst of late data) is trimmed by jumping
+// towards the edge, since a few percent of extra speed would take minutes to
+// close it.
+
+pub const default_target_s: f64 = 0.5;
+
+pub const Config = struct {
+    target_s: f64 = default_target_s,
+    /// Catch-up starts this far above the target and runs until it is met.
+    tolerance_s: f64 = 0.15,
+    catch_up_rate: f64 = 1.05,
+    /// Latency this far above the target is trimmed instead.
+    trim_threshold_s: f64 = 2.0,
+    /// After a trim the stream resumes at the next keyframe; latency is not
+    /// judged again until that has had time to happen.
+    trim_cooldown_s: f64 = 3.0,
+    /// Smoothing window, so network jitter and the gaps between packet
+    /// arrivals do not toggle catch-up.
+    smoothing_s: f64 = 1.0,
+};
+
+pub const Action = union(enum) {
+    /// Clock rate factor; 1.0 on target.
+    rate: f64,
+    /// Jump to this distance behind the live edge.
+    trim: f64,
+};
+
+/// Receive-to-present latency: how far the playhead trails the newest pts
+/// received, plus how long ago that pts arrived.
+pub fn latencySeconds(edge_pts: f64, edge_age_s: f64, playhead: f64) f64 {
+    return @max(edge_pts - playhead + edge_age_s, 0.0);
+}
+
+pub fn parseTargetMs(value: []const u8) ?f64 {
+    const ms = std.fmt.parseFloat(f64, std.mem.trim(u8, value, " ")) catch return null;
+    if (!(ms >= 50.0 and ms <= 30_000.0)) {
+        return null;
+    }
+    return ms / 1000.0;
+}
+
+pub fn configFromEnvironment() Config {
+    const value = std.process.getEnvVarOwned(std.heap.page_allocator, "ZC_LIVE_LATENCY_MS") catch return .{};
+    defer std.heap.page_allocator.free(value);
+    return .{ .target_s = parseTargetMs(value) orelse default_target_s };
+}
+
+pub const LiveLatencyController = struct {
+    config: Config = .{},
+    smoothed_s: ?f64 = null,
+    catching_up: bool = false,
+    since_trim_s: f64 = std.math.inf(f64),
+    trims: u32 = 0,
+
+    pub fn update(self: *LiveLatencyController, latency_s: f64, dt_s: f64) Action {
+        self.since_trim_s += dt_s;
+        if (self.since_trim_s < self.config.trim_cooldown_s) {
+            return .{ .rate = 1.0 };
+        }
+
+        if (latency_s > self.config.target_s + self.config.trim_threshold_s) {
+            self.smoothed_s = null;
+            self.catching_up = false;
+            self.since_trim_s = 0.0;
+            self.trims += 1;
+            return .{ .trim = self.config.target_s };
+        }
+
+        const previous = self.smoothed_s orelse latency_s;
+        const alpha = std.math.clamp(dt_s / self.config.smoothing_s, 0.0, 1.0);
+        const smoothed = previous + (latency_s - previous) * alpha;
+        self.smoothed_s = smoothed;
+
+        if (self.catching_up) {
+            self.catching_up = smoothed > self.config.target_s;
+        } else {
+            self.catching_up = smoothed > self.config.target_s + self.config.tolerance_s;
+        }
+        return .{ .rate = if (self.catching_up) self.config.catch_up_rate else 1.0 };
+    }
+};
+
+test "catch-up runs from above the tolerance down to the target" {
+    var controller = LiveLatencyController{};
+    const dt = 0.1;
+
+    try std.testing.expectEqual(Action{ .rate = 1.0 }, controller.update(0.55, dt));
+
+    // A single late sample is smoothed away.
+    try std.testing.expectEqual(Action{ .rate = 1.0 }, controller.update(1.2, dt));
+
+    var action = Action{ .rate = 1.0 };
+    for (0..20) |_| {
+        action = controller.update(1.0, dt);
+    }
+    try std.testing.expectEqual(Action{ .rate = 1.05 }, action);
+
+    // Still above the target inside the tolerance band: keep catching up.
+    for (0..20) |_| {
+        action = controller.update(0.6, dt);
+    }
+    try std.testing.expectEqual(Action{ .rate = 1.05 }, action);
+
+    for (0..30) |_| {
+        action = controller.update(0.45, dt);
+    }
+    try std.testing.expectEqual(Action{ .rate = 1.0 }, action);
+}
+
+test "far behind trims once, then waits out the cooldown" {
+    var controller = LiveLatencyController{ .config = .{ .target_s = 0.3 } };
+
+    try std.testing.expectEqual(Action{ .trim = 0.3 }, controller.update(4.0, 0.1));
+    try std.testing.expectEqual(@as(u32, 1), controller.trims);
+
+    // Resuming at the next keyframe takes a moment; no second trim meanwhile.
+    try std.testing.expectEqual(Action{ .rate = 1.0 }, controller.update(4.5, 1.0));
+    try std.testing.expectEqual(Action{ .trim = 0.3 }, controller.update(4.5, 2.5));
+    try std.testing.expectEqual(@as(u32, 2), controller.trims);
+}
+
+test "latency and target parsing" {
+    try std.testing.expectApproxEqAbs(@as(f64, 0.75), latencySeconds(10.5, 0.05, 9.8), 1e-9);
+    try std.testing.expectEqual(@as(f64, 0.0), latencySeconds(10.0, 0.0, 10.2));
+
+    try std.testing.expectApproxEqAbs(@as(f64, 0.25), parseTargetMs(" 250 ").?, 1e-9);
+    try std.testing.expect(parseTargetMs("10") == null);
+    try std.testing.expect(parseTargetMs("soon") == null);
+}
@@ -0,0 +1,56 @@
+const std = @import("std");
+
+// Opening the next file keeps whatever the previous one already paid for when
+// the new streams are compatible: the open decoders (codec context, hardware
+// device, scaler, resampler) when the codec parameters match, the audio device
+// and ring when the output format matches, and the video and audio decode
+// threads, which park while the player swaps media underneath them.
+//
+// `ZC_MEDIA_REUSE=off` tears everything down on every switch, for comparison.
+
+pub fn enabledFromEnvironment() bool {
+    const value = std.process.getEnvVarOwned(std.heap.page_allocator, "ZC_MEDIA_REUSE") catch return true;
+    defer std.heap.page_allocator.free(value);
+    return !(std.ascii.eqlIgnoreCase(value, "off") or std.mem.eql(u8, value, "0"));
+}
+
+pub const Reused = struct {
+    video_decoder: bool = false,
+    audio_decoder: bool = false,
+    audio_device: bool = false,
+    threads: bool = false,
+};
+
+/// What the last switch kept, as "video, audio, device, threads" (decoders,
+/// audio device, decode threads) or "none". Fits a 32-byte snapshot field.
+pub fn label(reused: Reused, buf: []u8) []const u8 {
+    const parts = [_]struct { on: bool, name: []const u8 }{
+        .{ .on = reused.video_decoder, .name = "video" },
+        .{ .on = reused.audio_decoder, .name = "audio" },
+        .{ .on = reused.audio_device, .name = "device" },
+        .{ .on = reused.threads, .name = "threads" },
+    };
+    var len: usize = 0;
+    for (parts) |part| {
+        if (!part.on) {
+            continue;
+        }
+        const sep: []const u8 = if (len > 0) ", " else "";
+        const written = std.fmt.bufPrint(buf[len..], "{s}{s}", .{ sep, part.name }) catch break;
+        len += written.len;
+    }
+    if (len == 0) {
+        const none = "none";
+        const n = @min(none.len, buf.len);
+        @memcpy(buf[0..n], none[0..n]);
+        return buf[0..n];
+    }
+    return buf[0..len];
+}
+
+test "label lists reused parts in order" {
+    var buf: [48]u8 = undefined;
+    try std.testing.expectEqualStrings("none", label(.{}, &buf));
+    try std.testing.expectEqualStrings("video, device, threads", label(.{ .video_decoder = true, .audio_device = true, .threads = true }, &buf));
+    try std.testing.expectEqualStrings("audio", label(.{ .audio_decoder = true }, &buf));
+}
@@ -0,0 +1,255 @@
+const std = @import("std");
+const builtin = @import("builtin");
+
+// Drains a non-seekable byte stream (a pipe or stdin) on its own thread into a
+// bounded ring, so a slow writer stalls the reader thread instead of the
+// demuxer, and a stalled demuxer applies back-pressure to the writer once the
+// ring is full instead of growing without bound. The descriptor is borrowed
+// and never closed.
+
+pub const supported = builtin.os.tag != .windows and builtin.os.tag != .wasi;
+
+const poll_interval_ms: i32 = 100;
+
+pub const Stats = struct {
+    reader_stalls: i64 = 0,
+    writer_stalls: i64 = 0,
+    peak_buffered: usize = 0,
+};
+
+pub const PipeReader = struct {
+    allocator: std.mem.Allocator,
+    fd: std.posix.fd_t,
+    ring: []u8,
+    head: usize = 0,
+    count: usize = 0,
+    eof: bool = false,
+    failed: bool = false,
+    cancelled: bool = false,
+    stopping: bool = false,
+    mutex: std.Thread.Mutex = .{},
+    data_cond: std.Thread.Condition = .{},
+    space_cond: std.Thread.Condition = .{},
+    thread: ?std.Thread = null,
+    stats: Stats = .{},
+
+    pub fn create(allocator: std.mem.Allocator, fd: std.posix.fd_t, capacity: usize) !*PipeReader {
+        if (comptime !supported) {
+            return error.Unsupported;
+        }
+
+        const self = try allocator.create(PipeReader);
+        errdefer allocator.destroy(self);
+
+        const ring = try allocator.alloc(u8, @max(capacity, 64 * 1024));
+        errdefer allocator.free(ring);
+
+        self.* = .{ .allocator = allocator, .fd = fd, .ring = ring };
+        self.thread = try std.Thread.spawn(.{}, fillMain, .{self});
+        return self;
+    }
+
+    pub fn destroy(self: *PipeReader) void {
+        self.mutex.lock();
+        self.stopping = true;
+        self.space_cond.broadcast();
+        self.data_cond.broadcast();
+        self.mutex.unlock();
+
+        if (self.thread) |thread| {
+            thread.join();
+        }
+        self.allocator.free(self.ring);
+        self.allocator.destroy(self);
+    }
+
+    /// Blocks until at least one byte is buffered. Returns 0 at end of stream.
+    pub fn read(self: *PipeReader, out: []u8) !usize {
+        self.mutex.lock();
+        defer self.mutex.unlock();
+
+        if (self.count == 0 and !self.eof and !self.failed and !self.cancelled) {
+            self.stats.reader_stalls += 1;
+            while (self.count == 0 and !self.eof and !self.failed and !self.cancelled) {
+                self.data_cond.wait(&self.mutex);
+            }
+        }
+
+        if (self.cancelled) {
+            return error.Cancelled;
+        }
+        if (self.count == 0) {
+            return if (self.failed) error.ReadFailed else 0;
+        }
+
+        const n = @min(out.len, self.count);
+        const first = @min(n, self.ring.len - self.head);
+        @memcpy(out[0..first], self.ring[self.head .. self.head + first]);
+        @memcpy(out[first..n], self.ring[0 .. n - first]);
+        self.head = (self.head + n) % self.ring.len;
+        self.count -= n;
+        self.space_cond.signal();
+        return n;
+    }
+
+    /// Fails pending and later reads until `rearm`; used to unblock a reader
+    /// waiting on an idle writer.
+    pub fn cancel(self: *PipeReader) void {
+        self.mutex.lock();
+        self.cancelled = true;
+        self.data_cond.broadcast();
+        self.mutex.unlock();
+    }
+
+    /// Reads resume where the cancelled one stopped; buffered bytes are kept.
+    pub fn rearm(self: *PipeReader) void {
+        self.mutex.lock();
+        defer self.mutex.unlock();
+        if (!self.stopping) {
+            self.cancelled = false;
+        }
+    }
+
+    fn fillMain(self: *PipeReader) void {
+        while (true) {
+            self.mutex.lock();
+            if (self.count == self.ring.len and !self.stopping) {
+                self.stats.writer_stalls += 1;
+                while (self.count == self.ring.len and !self.stopping) {
+                    self.space_cond.wait(&self.mutex);
+                }
+            }
+            if (self.stopping) {
+                self.mutex.unlock();
+                return;
+            }
+            // Only the fill thread moves the tail, so the free span stays
+            // valid after the lock is released.
+            const tail = (self.head + self.count) % self.ring.len;
+            const span = if (tail >= self.head) self.ring.len - tail else self.head - tail;
+            self.mutex.unlock();
+
+            if (!self.waitReadable()) {
+                return;
+            }
+
+            const n = std.posix.read(self.fd, self.ring[tail .. tail + span]) catch |err| switch (err) {
+                error.WouldBlock => continue,
+                else => {
+                    self.finish(true);
+                    return;
+                },
+            };
+            if (n == 0) {
+                self.finish(false);
+                return;
+            }
+
+            self.mutex.lock();
+            self.count += n;
+            self.stats.peak_buffered = @max(self.stats.peak_buffered, self.count);
+            self.data_cond.signal();
+            self.mutex.unlock();
+        }
+    }
+
+    // Polls with a timeout so `destroy` never waits on an idle writer.
+    fn waitReadable(self: *PipeReader) bool {
+        var fds = [_]std.posix.pollfd{.{ .fd = self.fd, .events = std.posix.POLL.IN, .revents = 0 }};
+        while (true) {
+            self.mutex.lock();
+            const stopping = self.stopping;
+            self.mutex.unlock();
+            if (stopping) {
+                return false;
+            }
+
+            const ready = std.posix.poll(&fds, poll_interval_ms) catch {
+                self.finish(true);
+                return false;
+            };
+            if (ready > 0) {
+                return true;
+            }
+        }
+    }
+
+    fn finish(self: *PipeReader, failed: bool) void {
+        self.mutex.lock();
+        self.eof = true;
+        self.failed = failed;
+        self.data_cond.broadcast();
+        self.mutex.unlock();
+    }
+};
+
+test "pipe reader delivers a stream larger than its ring in order" {
+    if (comptime !supported) {
+        return error.SkipZigTest;
+    }
+
+    const fds = try std.posix.pipe();
+    defer std.posix.close(fds[0]);
+
+    var contents: [300 * 1024 + 11]u8 = undefined;
+    for (&contents, 0..) |*byte, i| {
+        byte.* = @truncate(i * 13);
+    }
+
+    const writer = try std.Thread.spawn(.{}, struct {
+        fn run(fd: std.posix.fd_t, data: []const u8) void {
+            defer std.posix.close(fd);
+            var offset: usize = 0;
+            while (offset < data.len) {
+                offset += std.posix.write(fd, data[offset..@min(offset + 7000, data.len)]) catch return;
+            }
+        }
+    }.run, .{ fds[1], @as([]const u8, &contents) });
+
+    const reader = try PipeReader.create(std.testing.allocator, fds[0], 64 * 1024);
+    defer reader.destroy();
+
+    var out: [contents.len]u8 = undefined;
+    var position: usize = 0;
+    while (true) {
+        const n = try reader.read(out[position..@min(position + 5000, out.len)]);
+        if (n == 0) {
+            break;
+        }
+        position += n;
+    }
+    writer.join();
+
+    try std.testing.expectEqual(contents.len, position);
+    try std.testing.expectEqualSlices(u8, &contents, &out);
+    try std.testing.expect(reader.stats.peak_buffered <= 64 * 1024);
+}
+
+test "a rearmed pipe reader resumes after a cancel" {
+    if (comptime !supported) {
+        return error.SkipZigTest;
+    }
+
+    const fds = try std.posix.pipe();
+    defer std.posix.close(fds[0]);
+    _ = try std.posix.write(fds[1], "abc");
+    std.posix.close(fds[1]);
+
+    const reader = try PipeReader.create(std.testing.allocator, fds[0], 64 * 1024);
+    defer reader.destroy();
+
+    reader.cancel();
+    var out: [8]u8 = undefined;
+    try std.testing.expectError(error.Cancelled, reader.read(&out));
+
+    reader.rearm();
+    var position: usize = 0;
+    while (true) {
+        const n = try reader.read(out[position..]);
+        if (n == 0) {
+            break;
+        }
+        position += n;
+    }
+    try std.testing.expectEqualStrings("abc", out[0..position]);
+}
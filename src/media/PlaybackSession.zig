@@ -5,9 +5,15 @@ const VideoBackendStatus = @import("../engine/Snapshot.zig").VideoBackendStatus;
 const VideoFallbackReason = @import("../engine/Snapshot.zig").VideoFallbackReason;
 const VideoHwBackend = @import("../engine/Snapshot.zig").VideoHwBackend;
 const VideoHwPolicy = @import("../engine/Snapshot.zig").VideoHwPolicy;
+const VideoDecodeSkip = @import("../engine/Snapshot.zig").VideoDecodeSkip;
+const TrackSummary = @import("../engine/Snapshot.zig").TrackSummary;
+const max_tracks = @import("../engine/Snapshot.zig").max_tracks;
 const Player = @import("Player.zig").Player;
 const AudioOutput = @import("../audio/AudioOutput.zig").AudioOutput;
 const VideoPipeline = @import("../video/VideoPipeline.zig").VideoPipeline;
+const LiveLatency = @import("LiveLatencyController.zig");
+const MediaReuse = @import("MediaReuse.zig");
+const LiveLatencyController = LiveLatency.LiveLatencyController;
 const RenderFrame = VideoPipeline.RenderFrame;
 
 fn clearTextField(field: *[32]u8) void {
@@ -33,6 +39,79 @@ fn setTextFieldFromC(field: *[32]u8, c_text: [*c]const u8) void {
     setTextField(field, std.mem.span(c_text));
 }
 
+const DemuxQueueLevel = struct {
+    buffered_kb: i32 = 0,
+    buffered_ms: i32 = 0,
+    fill_percent: i32 = 0,
+};
+
+fn demuxQueueLevel(stats: c.DemuxerQueueStats) DemuxQueueLevel {
+    const fill_percent = std.math.clamp(stats.fill * 100.0, 0.0, 1000.0);
+    const buffered_ms = std.math.clamp(stats.duration * 1000.0, 0.0, @as(f64, std.math.maxInt(i32)));
+    return .{
+        .buffered_kb = std.math.cast(i32, @divTrunc(@max(stats.bytes, 0), 1024)) orelse std.math.maxInt(i32),
+        .buffered_ms = @intFromFloat(buffered_ms),
+        .fill_percent = @intFromFloat(fill_percent),
+    };
+}
+
+fn probeSourceLabel(source: c_int) []const u8 {
+    return switch (source) {
+        c.DEMUXER_PROBE_SOURCE_CACHE => "cache",
+        c.DEMUXER_PROBE_SOURCE_BOUNDED => "fast",
+        c.DEMUXER_PROBE_SOURCE_LIVE => "live",
+        else => "full",
+    };
+}
+
+fn decodeThreadsLabel(field: *[32]u8, threading: c.VideoDecodeThreading) void {
+    const mode = switch (threading.mode) {
+        c.VIDEO_DECODE_THREADS_FRAME => "frame",
+        c.VIDEO_DECODE_THREADS_SLICE => "slice",
+        c.VIDEO_DECODE_THREADS_INSTANCES => "instances",
+        else => {
+            setTextField(field, "single");
+            return;
+        },
+    };
+    var buf: [32]u8 = undefined;
+    setTextField(field, std.fmt.bufPrint(&buf, "{s} x{d}", .{ mode, threading.thread_count }) catch mode);
+}
+
+fn trackSummary(info: c.DemuxerTrackInfo) TrackSummary {
+    var summary = TrackSummary{
+        .stream_index = info.stream_index,
+        .kind = if (info.media_type == c.AVMEDIA_TYPE_AUDIO) .audio else .video,
+        .selected = info.selected != 0,
+    };
+
+    const language = std.mem.sliceTo(&info.language, 0);
+    const title = std.mem.sliceTo(&info.title, 0);
+    const codec = std.mem.span(c.avcodec_get_name(@intCast(info.codec_id)));
+    var buf: [128]u8 = undefined;
+    const text = switch (summary.kind) {
+        .audio => std.fmt.bufPrint(&buf, "#{d} {s} {s} {d}ch {s}", .{
+            info.stream_index,
+            if (language.len > 0) language else "und",
+            codec,
+            info.channels,
+            title,
+        }),
+        .video => std.fmt.bufPrint(&buf, "#{d} {s} {d}x{d} {s}", .{
+            info.stream_index,
+            codec,
+            info.width,
+            info.height,
+            title,
+        }),
+    } catch buf[0..0];
+
+    const trimmed = std.mem.trim(u8, text, " ");
+    const n = @min(trimmed.len, summary.label.len - 1);
+    @memcpy(summary.label[0..n], trimmed[0..n]);
+    return summary;
+}
+
 fn bitrateKbps(value: i64) i32 {
     if (value <= 0) {
         return 0;
@@ -47,6 +126,14 @@ pub const PlaybackSession = struct {
     player: Player = .{},
     audio_output: AudioOutput = .{},
     video_pipeline: VideoPipeline = .{},
+    open_timer: ?std.time.Timer = null,
+    open_to_first_frame_ms: i32 = 0,
+    switch_timer: ?std.time.Timer = null,
+    switch_ms: i32 = 0,
+    switch_reused: MediaReuse.Reused = .{},
+    live_controller: LiveLatencyController = .{},
+    live_latency_ms: i32 = 0,
+    live_last_update_ns: i128 = 0,
 
     pub fn init(allocator: std.mem.Allocator) PlaybackSession {
         return PlaybackSession{
@@ -63,35 +150,72 @@ pub const PlaybackSession = struct {
         self.player.deinit();
     }
 
+    /// Replacing open media keeps the decoders, audio device and decode
+    /// threads that fit the new file (see MediaReuse.zig); `switch_ms` times
+    /// the whole switch, from here to the new file's first frame.
     pub fn openMedia(self: *PlaybackSession, path: []const u8) void {
-        self.destroyOutputs();
-
-        self.player.open(path) catch return;
-
-        self.video_pipeline.init(&self.player) catch return;
-
-        self.audio_output.init(&self.player) catch {
+        self.switch_timer = if (self.player.hasMedia()) std.time.Timer.start() catch null else null;
+        self.switch_ms = 0;
+        self.switch_reused = .{};
+        const warm = self.parkOutputs();
+        self.open_timer = std.time.Timer.start() catch null;
+        self.open_to_first_frame_ms = 0;
+        self.live_controller = .{ .config = LiveLatency.configFromEnvironment() };
+        self.live_latency_ms = 0;
+        self.live_last_update_ns = 0;
+
+        self.player.open(path) catch {
             self.destroyOutputs();
             return;
         };
 
+        const raw = self.player.raw();
+        var reused = MediaReuse.Reused{
+            .video_decoder = raw.video_decoder_reused != 0,
+            .audio_decoder = raw.audio_decoder_reused != 0,
+            .threads = warm,
+        };
+
+        if (warm) {
+            reused.audio_device = self.audio_output.reuse(&self.player);
+            if (!reused.audio_device) {
+                self.audio_output.destroy();
+            }
+        } else {
+            self.video_pipeline.init(&self.player) catch return;
+        }
+
+        if (!reused.audio_device) {
+            self.audio_output.init(&self.player) catch {
+                self.destroyOutputs();
+                return;
+            };
+        }
+
         if (!self.player.play()) {
             self.destroyOutputs();
             return;
         }
 
-        self.audio_output.start() catch {
-            self.destroyOutputs();
-            return;
-        };
+        if (!reused.audio_device) {
+            self.audio_output.start() catch {
+                self.destroyOutputs();
+                return;
+            };
+        }
 
         self.audio_output.setVolume(self.player.volume());
-        self.audio_output.setSpeed(self.player.playbackSpeed());
-
-        self.video_pipeline.start() catch {
-            self.destroyOutputs();
-            return;
-        };
+        self.audio_output.setSpeed(self.player.clockSpeed());
+
+        if (warm) {
+            self.video_pipeline.unpark();
+        } else {
+            self.video_pipeline.start() catch {
+                self.destroyOutputs();
+                return;
+            };
+        }
+        self.switch_reused = reused;
     }
 
     pub fn play(self: *PlaybackSession) void {
@@ -118,6 +242,39 @@ pub const PlaybackSession = struct {
         self.player.setSpeed(speed);
     }
 
+    /// Switches the active video or audio track at the playhead. The output
+    /// that consumes the switched track is rebuilt, since the new track may
+    /// differ in sample format, channel count or frame size.
+    pub fn selectTrack(self: *PlaybackSession, stream_index: i32) void {
+        var info: c.DemuxerTrackInfo = undefined;
+        if (c.demuxer_get_track_info(&self.player.raw().demuxer, stream_index, &info) != 0 or info.selected != 0) {
+            return;
+        }
+
+        if (info.media_type == c.AVMEDIA_TYPE_AUDIO) {
+            self.audio_output.destroy();
+            _ = self.player.selectTrack(stream_index);
+            self.video_pipeline.reset();
+
+            self.audio_output.init(&self.player) catch return;
+            self.audio_output.setVolume(self.player.volume());
+            self.audio_output.setSpeed(self.player.clockSpeed());
+            self.audio_output.setPaused(self.player.state() != .playing);
+            self.audio_output.start() catch {
+                self.audio_output.destroy();
+            };
+        } else if (info.media_type == c.AVMEDIA_TYPE_VIDEO) {
+            self.video_pipeline.destroy();
+            _ = self.player.selectTrack(stream_index);
+            self.audio_output.reset();
+
+            self.video_pipeline.init(&self.player) catch return;
+            self.video_pipeline.start() catch {
+                self.video_pipeline.destroy();
+            };
+        }
+    }
+
     pub fn tick(self: *PlaybackSession) void {
         var state = self.player.state();
 
@@ -132,19 +289,50 @@ pub const PlaybackSession = struct {
             }
         }
 
+        if (self.player.seekFailed()) {
+            self.audio_output.reset();
+            self.video_pipeline.reset();
+        }
+
         if (state == .playing and self.video_pipeline.initialized) {
             if (self.audio_output.masterClock()) |master_clock| {
                 self.player.setCurrentTime(master_clock);
             } else if (!self.player.hasAudio()) {
                 self.player.setCurrentTime(self.player.videoPts());
             }
+            self.updateLiveLatency();
         }
 
         self.audio_output.setVolume(self.player.volume());
-        self.audio_output.setSpeed(self.player.playbackSpeed());
+        self.audio_output.setSpeed(self.player.clockSpeed());
         self.player.clampCurrentTimeToDuration();
     }
 
+    // Runs after the playhead update. A trim lands `target_s` behind the
+    // newest pts received; the demuxer resumes at the next keyframe past it,
+    // or at the next audio packet past it when the stream has no video.
+    fn updateLiveLatency(self: *PlaybackSession) void {
+        var edge_pts: f64 = 0.0;
+        var edge_age: f64 = 0.0;
+        if (!self.player.isLive() or c.demuxer_get_live_edge(&self.player.raw().demuxer, &edge_pts, &edge_age) != 0) {
+            return;
+        }
+
+        const now = std.time.nanoTimestamp();
+        const dt_s = if (self.live_last_update_ns == 0) 0.0 else @as(f64, @floatFromInt(now - self.live_last_update_ns)) / std.time.ns_per_s;
+        self.live_last_update_ns = now;
+
+        const latency = LiveLatency.latencySeconds(edge_pts, edge_age, self.player.currentTime());
+        self.live_latency_ms = @intFromFloat(@min(latency * 1000.0, @as(f64, std.math.maxInt(i32))));
+        switch (self.live_controller.update(latency, dt_s)) {
+            .rate => |rate| self.player.setRateAdjust(rate),
+            .trim => |behind_edge_s| {
+                self.player.setRateAdjust(1.0);
+                self.player.seek(edge_pts - behind_edge_s);
+            },
+        }
+    }
+
     pub fn snapshot(self: *PlaybackSession) Snapshot {
         const interop_status: VideoBackendStatus = switch (self.video_pipeline.interopStatus()) {
             .software => .software,
@@ -176,9 +364,23 @@ pub const PlaybackSession = struct {
             else => .auto,
         };
 
+        const decode_skip: VideoDecodeSkip = switch (self.video_pipeline.decodeSkipLevel()) {
+            c.VIDEO_DECODE_SKIP_LOOP_FILTER => .loop_filter,
+            c.VIDEO_DECODE_SKIP_NONREF => .nonref,
+            c.VIDEO_DECODE_SKIP_IDCT => .idct,
+            else => .none,
+        };
+
         var media_format: [32]u8 = [_]u8{0} ** 32;
+        var open_probe: [32]u8 = [_]u8{0} ** 32;
         var video_codec: [32]u8 = [_]u8{0} ** 32;
+        var video_decode_threads: [32]u8 = [_]u8{0} ** 32;
         var audio_codec: [32]u8 = [_]u8{0} ** 32;
+        var switch_reused: [32]u8 = [_]u8{0} ** 32;
+        if (self.switch_ms > 0) {
+            var label_buf: [32]u8 = undefined;
+            setTextField(&switch_reused, MediaReuse.label(self.switch_reused, &label_buf));
+        }
 
         var media_bitrate_kbps: i32 = 0;
         var video_bitrate_kbps: i32 = 0;
@@ -195,6 +397,7 @@ pub const PlaybackSession = struct {
                 setTextFieldFromC(&media_format, fmt_ctx.*.iformat.*.name);
             }
             media_bitrate_kbps = bitrateKbps(fmt_ctx.*.bit_rate);
+            setTextField(&open_probe, probeSourceLabel(raw.demuxer.probe_source));
         }
 
         if (raw.decoder.codec_ctx != null) {
@@ -203,6 +406,11 @@ pub const PlaybackSession = struct {
                 setTextFieldFromC(&video_codec, codec_ctx.*.codec.*.name);
             }
             video_bitrate_kbps = bitrateKbps(codec_ctx.*.bit_rate);
+
+            var threading: c.VideoDecodeThreading = undefined;
+            if (raw.decoder.hw_enabled == 0 and c.video_decoder_get_threading(&raw.decoder, &threading) == 0) {
+                decodeThreadsLabel(&video_decode_threads, threading);
+            }
         }
 
         if (raw.demuxer.video_stream != null) {
@@ -211,6 +419,46 @@ pub const PlaybackSession = struct {
             video_fps_den = rate.den;
         }
 
+        var demux_video = DemuxQueueLevel{};
+        var demux_audio = DemuxQueueLevel{};
+        var demux_starvation_overflows: i32 = 0;
+        var video_queue_stats = std.mem.zeroes(c.DemuxerQueueStats);
+        var audio_queue_stats = std.mem.zeroes(c.DemuxerQueueStats);
+        if (c.demuxer_get_queue_stats(&raw.demuxer, &video_queue_stats, &audio_queue_stats) == 0) {
+            demux_video = demuxQueueLevel(video_queue_stats);
+            demux_audio = demuxQueueLevel(audio_queue_stats);
+            demux_starvation_overflows = video_queue_stats.starvation_overflows +| audio_queue_stats.starvation_overflows;
+        }
+
+        var net_cache_hits: i32 = 0;
+        var net_cache_misses: i32 = 0;
+        var net_downloaded_kb: i32 = 0;
+        var io_stats = std.mem.zeroes(c.DemuxerIoStats);
+        if (raw.demuxer.io.backend == c.DEMUXER_IO_BACKEND_HTTP and c.demuxer_io_get_stats(&raw.demuxer.io, &io_stats) == 0) {
+            net_cache_hits = std.math.cast(i32, io_stats.http_cache_hits) orelse std.math.maxInt(i32);
+            net_cache_misses = std.math.cast(i32, io_stats.http_cache_misses) orelse std.math.maxInt(i32);
+            net_downloaded_kb = std.math.cast(i32, @divTrunc(io_stats.http_bytes_downloaded, 1024)) orelse std.math.maxInt(i32);
+        }
+
+        var abr_stats = std.mem.zeroes(c.DemuxerAbrStats);
+        _ = c.demuxer_get_abr_stats(&raw.demuxer, &abr_stats);
+
+        var tracks = [_]TrackSummary{.{}} ** max_tracks;
+        var track_count: usize = 0;
+        const stream_count = c.demuxer_get_track_count(&raw.demuxer);
+        var stream_index: c_int = 0;
+        while (stream_index < stream_count and track_count < max_tracks) : (stream_index += 1) {
+            var info: c.DemuxerTrackInfo = undefined;
+            if (c.demuxer_get_track_info(&raw.demuxer, stream_index, &info) != 0) {
+                continue;
+            }
+            if (info.media_type != c.AVMEDIA_TYPE_VIDEO and info.media_type != c.AVMEDIA_TYPE_AUDIO) {
+                continue;
+            }
+            tracks[track_count] = trackSummary(info);
+            track_count += 1;
+        }
+
         if (raw.has_audio != 0 and raw.audio_decoder.codec_ctx != null) {
             const ac = raw.audio_decoder.codec_ctx;
             if (ac.*.codec != null and ac.*.codec.*.name != null) {
@@ -237,17 +485,62 @@ pub const PlaybackSession = struct {
             .media_bitrate_kbps = media_bitrate_kbps,
             .video_codec = video_codec,
             .video_bitrate_kbps = video_bitrate_kbps,
+            .video_decode_threads = video_decode_threads,
+            .video_decode_skip = decode_skip,
+            .video_catch_ups = self.video_pipeline.catchUpCount(),
+            .video_convert_ms = if (raw.decoder.sws_ctx != null) raw.decoder.convert_ms else 0.0,
+            .video_scale_threads = if (raw.decoder.sws_ctx != null) raw.decoder.scale_threads else 0,
             .video_fps_num = video_fps_num,
             .video_fps_den = video_fps_den,
             .audio_codec = audio_codec,
             .audio_bitrate_kbps = audio_bitrate_kbps,
             .audio_sample_rate = audio_sample_rate,
             .audio_channels = audio_channels,
+            .demux_video_buffered_kb = demux_video.buffered_kb,
+            .demux_video_buffered_ms = demux_video.buffered_ms,
+            .demux_video_fill_percent = demux_video.fill_percent,
+            .demux_audio_buffered_kb = demux_audio.buffered_kb,
+            .demux_audio_buffered_ms = demux_audio.buffered_ms,
+            .demux_audio_fill_percent = demux_audio.fill_percent,
+            .demux_starvation_overflows = demux_starvation_overflows,
+            .net_cache_hits = net_cache_hits,
+            .net_cache_misses = net_cache_misses,
+            .net_downloaded_kb = net_downloaded_kb,
+            .rebuffers = abr_stats.rebuffers,
+            .abr_variant_count = abr_stats.variant_count,
+            .abr_variant_kbps = bitrateKbps(abr_stats.variant_bitrate),
+            .abr_bandwidth_kbps = bitrateKbps(abr_stats.bandwidth_estimate),
+            .abr_switches = abr_stats.switches,
+            .abr_switch_latency_ms = @intFromFloat(@min(abr_stats.last_switch_latency_ms, @as(f64, std.math.maxInt(i32)))),
+            .live = self.player.isLive(),
+            .live_latency_ms = self.live_latency_ms,
+            .live_target_ms = @intFromFloat(self.live_controller.config.target_s * 1000.0),
+            .live_catching_up = self.live_controller.catching_up,
+            .live_trims = std.math.cast(i32, self.live_controller.trims) orelse std.math.maxInt(i32),
+            .open_probe = open_probe,
+            .open_to_first_frame_ms = self.open_to_first_frame_ms,
+            .switch_ms = self.switch_ms,
+            .switch_reused = switch_reused,
+            .track_count = @intCast(track_count),
+            .tracks = tracks,
         };
     }
 
     pub fn getFrameForRender(self: *PlaybackSession, master_clock: f64) ?RenderFrame {
-        return self.video_pipeline.getFrameForRender(master_clock);
+        const frame = self.video_pipeline.getFrameForRender(master_clock);
+        if (frame != null) {
+            if (self.open_timer) |*timer| {
+                const elapsed_ms = timer.read() / std.time.ns_per_ms;
+                self.open_to_first_frame_ms = std.math.cast(i32, elapsed_ms) orelse std.math.maxInt(i32);
+                self.open_timer = null;
+            }
+            if (self.switch_timer) |*timer| {
+                const elapsed_ms = timer.read() / std.time.ns_per_ms;
+                self.switch_ms = std.math.cast(i32, elapsed_ms) orelse std.math.maxInt(i32);
+                self.switch_timer = null;
+            }
+        }
+        return frame;
     }
 
     pub fn reportTrueZeroCopySubmitResult(self: *PlaybackSession, success: bool) void {
@@ -258,6 +551,19 @@ pub const PlaybackSession = struct {
         self.video_pipeline.setTrueZeroCopyActive(active);
     }
 
+    // Holds the running outputs off the player while it swaps media; false
+    // when reuse is off or nothing was running, with the outputs torn down.
+    fn parkOutputs(self: *PlaybackSession) bool {
+        if (self.player.raw().decoder_reuse == 0 or !self.video_pipeline.initialized) {
+            self.destroyOutputs();
+            return false;
+        }
+        self.video_pipeline.park();
+        self.audio_output.park();
+        self.player.stopDemuxer();
+        return true;
+    }
+
     fn destroyOutputs(self: *PlaybackSession) void {
         self.player.stopDemuxer();
         self.video_pipeline.destroy();
@@ -63,6 +63,10 @@ pub const Player = struct {
         c.player_seek(&self.handle, time);
     }
 
+    pub fn selectTrack(self: *Player, stream_index: i32) bool {
+        return c.player_select_track(&self.handle, stream_index) == 0;
+    }
+
     pub fn setVolume(self: *Player, volume_value: f64) void {
         c.player_set_volume(&self.handle, volume_value);
     }
@@ -71,6 +75,10 @@ pub const Player = struct {
         c.player_set_playback_speed(&self.handle, speed);
     }
 
+    pub fn setRateAdjust(self: *Player, factor: f64) void {
+        c.player_set_rate_adjust(&self.handle, factor);
+    }
+
     pub fn state(self: *Player) PlaybackState {
         return mapState(c.player_get_state(&self.handle));
     }
@@ -87,6 +95,14 @@ pub const Player = struct {
         return c.player_get_playback_speed(&self.handle);
     }
 
+    pub fn clockSpeed(self: *Player) f64 {
+        return c.player_get_clock_speed(&self.handle);
+    }
+
+    pub fn isLive(self: *Player) bool {
+        return c.player_is_live(&self.handle) != 0;
+    }
+
     pub fn currentTime(self: *Player) f64 {
         return self.handle.current_time;
     }
@@ -107,6 +123,12 @@ pub const Player = struct {
         return c.player_apply_seek(&self.handle) == 0;
     }
 
+    /// True once, when the demuxer reports that the last seek failed and the
+    /// clock moved to where it went on reading.
+    pub fn seekFailed(self: *Player) bool {
+        return c.player_poll_seek(&self.handle) < 0;
+    }
+
     pub fn stopDemuxer(self: *Player) void {
         c.player_stop_demuxer(&self.handle);
     }
@@ -0,0 +1,511 @@
+const std = @import("std");
+const builtin = @import("builtin");
+
+// Keeps a window of fixed-size file blocks in flight ahead of the reader. Block
+// `n` always lives in slot `n % blocks.len`, so moving the read position
+// forward recycles the slots behind it. All block state is owned by the
+// reading thread; the I/O engine only fills buffers of pending blocks and
+// hands back completions, which the reader applies in `reap`.
+
+const uring_supported = builtin.os.tag == .linux;
+
+pub const latency_bucket_count = 20;
+
+pub const Options = struct {
+    window_bytes: usize = 16 * 1024 * 1024,
+    block_size: usize = 1024 * 1024,
+    worker_count: usize = 2,
+    use_io_uring: bool = true,
+};
+
+pub const Stats = struct {
+    hits: i64 = 0,
+    stalls: i64 = 0,
+    stall_ns: u64 = 0,
+    completed_reads: i64 = 0,
+    failed_reads: i64 = 0,
+    // Bucket i counts block reads that completed in [2^i, 2^(i+1)) microseconds;
+    // the last bucket is open-ended.
+    latency_histogram: [latency_bucket_count]i64 = [_]i64{0} ** latency_bucket_count,
+};
+
+pub const Engine = enum {
+    io_uring,
+    thread_pool,
+};
+
+const BlockState = enum {
+    empty,
+    pending,
+    ready,
+    failed,
+};
+
+const Block = struct {
+    offset: u64 = 0,
+    requested: usize = 0,
+    len: usize = 0,
+    state: BlockState = .empty,
+    submitted_ns: u64 = 0,
+};
+
+const Completion = struct {
+    slot: usize,
+    result: i64,
+    completed_ns: u64,
+};
+
+const max_workers = 8;
+
+pub const ReadAheadPrefetcher = struct {
+    allocator: std.mem.Allocator,
+    file: std.fs.File,
+    file_size: u64,
+    block_size: usize,
+    buffer: []u8,
+    blocks: []Block,
+    pending_count: usize = 0,
+    epoch: std.time.Instant,
+    engine: Engine,
+    stats: Stats = .{},
+
+    ring: if (uring_supported) std.os.linux.IoUring else void = undefined,
+
+    pool_mutex: std.Thread.Mutex = .{},
+    work_cond: std.Thread.Condition = .{},
+    done_cond: std.Thread.Condition = .{},
+    requests: []usize = &.{},
+    request_head: usize = 0,
+    request_count: usize = 0,
+    completions: []Completion = &.{},
+    completion_count: usize = 0,
+    workers: [max_workers]?std.Thread = [_]?std.Thread{null} ** max_workers,
+    stopping: bool = false,
+
+    pub fn create(allocator: std.mem.Allocator, path: []const u8, options: Options) !*ReadAheadPrefetcher {
+        const file = try std.fs.cwd().openFile(path, .{});
+        errdefer file.close();
+
+        const file_size = (try file.stat()).size;
+        const block_size = @max(options.block_size, 64 * 1024);
+        const block_count = std.math.clamp(options.window_bytes / block_size, 2, 256);
+
+        const self = try allocator.create(ReadAheadPrefetcher);
+        errdefer allocator.destroy(self);
+
+        const buffer = try allocator.alloc(u8, block_count * block_size);
+        errdefer allocator.free(buffer);
+
+        const blocks = try allocator.alloc(Block, block_count);
+        errdefer allocator.free(blocks);
+        @memset(blocks, .{});
+
+        self.* = .{
+            .allocator = allocator,
+            .file = file,
+            .file_size = file_size,
+            .block_size = block_size,
+            .buffer = buffer,
+            .blocks = blocks,
+            .epoch = try std.time.Instant.now(),
+            .engine = .thread_pool,
+        };
+
+        if (comptime uring_supported) {
+            if (options.use_io_uring) {
+                const entries = std.math.ceilPowerOfTwo(u16, @intCast(block_count)) catch 256;
+                if (std.os.linux.IoUring.init(entries, 0)) |ring| {
+                    self.ring = ring;
+                    self.engine = .io_uring;
+                    return self;
+                } else |_| {}
+            }
+        }
+
+        try self.startWorkers(@max(@min(options.worker_count, max_workers), 1));
+        return self;
+    }
+
+    pub fn destroy(self: *ReadAheadPrefetcher) void {
+        switch (self.engine) {
+            .io_uring => {
+                if (comptime uring_supported) {
+                    // Buffers of in-flight reads must outlive the kernel's use of them.
+                    while (self.pending_count > 0) {
+                        self.reap(true) catch break;
+                    }
+                    self.ring.deinit();
+                }
+            },
+            .thread_pool => self.stopWorkers(),
+        }
+
+        if (self.requests.len > 0) {
+            self.allocator.free(self.requests);
+        }
+        if (self.completions.len > 0) {
+            self.allocator.free(self.completions);
+        }
+        self.allocator.free(self.blocks);
+        self.allocator.free(self.buffer);
+        self.file.close();
+        self.allocator.destroy(self);
+    }
+
+    pub fn size(self: *const ReadAheadPrefetcher) u64 {
+        return self.file_size;
+    }
+
+    pub fn windowBytes(self: *const ReadAheadPrefetcher) usize {
+        return self.buffer.len;
+    }
+
+    /// Copies bytes at `position` into `dst`, returning 0 at end of file. May
+    /// return fewer bytes than requested when `dst` crosses a block boundary.
+    pub fn read(self: *ReadAheadPrefetcher, position: u64, dst: []u8) !usize {
+        if (position >= self.file_size or dst.len == 0) {
+            return 0;
+        }
+
+        try self.reap(false);
+        try self.schedule(position);
+
+        const block = try self.ensureReady(position);
+        const in_block: usize = @intCast(position - block.offset);
+        if (in_block >= block.len) {
+            return 0;
+        }
+
+        const count = @min(dst.len, block.len - in_block);
+        const src = self.blockBuffer(self.slotFor(position))[in_block .. in_block + count];
+        @memcpy(dst[0..count], src);
+        return count;
+    }
+
+    fn nowNs(self: *const ReadAheadPrefetcher) u64 {
+        const now = std.time.Instant.now() catch return 0;
+        return now.since(self.epoch);
+    }
+
+    fn slotFor(self: *const ReadAheadPrefetcher, position: u64) usize {
+        return @intCast((position / self.block_size) % self.blocks.len);
+    }
+
+    fn blockBuffer(self: *const ReadAheadPrefetcher, slot: usize) []u8 {
+        return self.buffer[slot * self.block_size .. (slot + 1) * self.block_size];
+    }
+
+    fn requestedLen(self: *const ReadAheadPrefetcher, offset: u64) usize {
+        return @intCast(@min(@as(u64, self.block_size), self.file_size - offset));
+    }
+
+    fn schedule(self: *ReadAheadPrefetcher, position: u64) !void {
+        const first_block = position / self.block_size;
+        var submitted = false;
+
+        for (0..self.blocks.len) |k| {
+            const offset = (first_block + k) * self.block_size;
+            if (offset >= self.file_size) {
+                break;
+            }
+
+            const slot = self.slotFor(offset);
+            const block = &self.blocks[slot];
+            if (block.state == .pending) {
+                continue;
+            }
+            if (block.offset == offset and block.state != .empty) {
+                continue;
+            }
+
+            try self.submit(slot, offset);
+            submitted = true;
+        }
+
+        if (submitted) {
+            try self.flush();
+        }
+    }
+
+    fn ensureReady(self: *ReadAheadPrefetcher, position: u64) !*Block {
+        const offset = (position / self.block_size) * self.block_size;
+        const slot = self.slotFor(position);
+        const block = &self.blocks[slot];
+        var wait_start_ns: ?u64 = null;
+
+        while (true) {
+            if (block.offset == offset and block.state == .ready) {
+                break;
+            }
+
+            if (block.offset == offset and block.state == .failed) {
+                try self.readSync(slot);
+                continue;
+            }
+
+            if (block.state != .pending) {
+                try self.submit(slot, offset);
+                try self.flush();
+            }
+
+            if (wait_start_ns == null) {
+                wait_start_ns = self.nowNs();
+            }
+            try self.reap(true);
+        }
+
+        if (wait_start_ns) |start_ns| {
+            self.stats.stalls += 1;
+            self.stats.stall_ns += self.nowNs() -| start_ns;
+        } else {
+            self.stats.hits += 1;
+        }
+        return block;
+    }
+
+    fn readSync(self: *ReadAheadPrefetcher, slot: usize) !void {
+        const block = &self.blocks[slot];
+        const want = self.requestedLen(block.offset);
+        block.len = try self.file.preadAll(self.blockBuffer(slot)[0..want], block.offset);
+        block.state = .ready;
+    }
+
+    fn submit(self: *ReadAheadPrefetcher, slot: usize, offset: u64) !void {
+        const block = &self.blocks[slot];
+        block.* = .{
+            .offset = offset,
+            .requested = self.requestedLen(offset),
+            .state = .pending,
+            .submitted_ns = self.nowNs(),
+        };
+        self.pending_count += 1;
+
+        switch (self.engine) {
+            .io_uring => {
+                if (comptime uring_supported) {
+                    const buffer = self.blockBuffer(slot)[0..block.requested];
+                    _ = self.ring.read(slot, self.file.handle, .{ .buffer = buffer }, offset) catch |err| {
+                        block.state = .failed;
+                        self.pending_count -= 1;
+                        return err;
+                    };
+                }
+            },
+            .thread_pool => {
+                self.pool_mutex.lock();
+                defer self.pool_mutex.unlock();
+                self.requests[(self.request_head + self.request_count) % self.requests.len] = slot;
+                self.request_count += 1;
+                self.work_cond.signal();
+            },
+        }
+    }
+
+    fn flush(self: *ReadAheadPrefetcher) !void {
+        if (self.engine == .io_uring) {
+            if (comptime uring_supported) {
+                _ = try self.ring.submit();
+            }
+        }
+    }
+
+    fn reap(self: *ReadAheadPrefetcher, wait: bool) !void {
+        if (self.pending_count == 0) {
+            return;
+        }
+
+        switch (self.engine) {
+            .io_uring => {
+                if (comptime uring_supported) {
+                    var cqes: [32]std.os.linux.io_uring_cqe = undefined;
+                    const count = try self.ring.copy_cqes(&cqes, if (wait) 1 else 0);
+                    const completed_ns = self.nowNs();
+                    for (cqes[0..count]) |cqe| {
+                        self.complete(.{ .slot = @intCast(cqe.user_data), .result = cqe.res, .completed_ns = completed_ns });
+                    }
+                }
+            },
+            .thread_pool => {
+                var drained: [256]Completion = undefined;
+                var count: usize = 0;
+                {
+                    self.pool_mutex.lock();
+                    defer self.pool_mutex.unlock();
+                    while (wait and self.completion_count == 0) {
+                        self.done_cond.wait(&self.pool_mutex);
+                    }
+                    count = self.completion_count;
+                    @memcpy(drained[0..count], self.completions[0..count]);
+                    self.completion_count = 0;
+                }
+                for (drained[0..count]) |completion| {
+                    self.complete(completion);
+                }
+            },
+        }
+    }
+
+    fn complete(self: *ReadAheadPrefetcher, completion: Completion) void {
+        const block = &self.blocks[completion.slot];
+        self.pending_count -= 1;
+
+        recordLatency(&self.stats, completion.completed_ns -| block.submitted_ns);
+        self.stats.completed_reads += 1;
+
+        // Short reads are retried synchronously when the block is needed.
+        if (completion.result >= 0 and @as(usize, @intCast(completion.result)) == block.requested) {
+            block.len = block.requested;
+            block.state = .ready;
+        } else {
+            self.stats.failed_reads += 1;
+            block.state = .failed;
+        }
+    }
+
+    fn startWorkers(self: *ReadAheadPrefetcher, count: usize) !void {
+        self.requests = try self.allocator.alloc(usize, self.blocks.len);
+        errdefer {
+            self.allocator.free(self.requests);
+            self.requests = &.{};
+        }
+        self.completions = try self.allocator.alloc(Completion, self.blocks.len);
+        errdefer {
+            self.allocator.free(self.completions);
+            self.completions = &.{};
+        }
+        errdefer self.stopWorkers();
+
+        for (0..count) |i| {
+            self.workers[i] = try std.Thread.spawn(.{}, workerMain, .{self});
+        }
+    }
+
+    fn stopWorkers(self: *ReadAheadPrefetcher) void {
+        {
+            self.pool_mutex.lock();
+            defer self.pool_mutex.unlock();
+            self.stopping = true;
+            self.work_cond.broadcast();
+        }
+
+        for (&self.workers) |*worker| {
+            if (worker.*) |thread| {
+                thread.join();
+                worker.* = null;
+            }
+        }
+    }
+
+    fn workerMain(self: *ReadAheadPrefetcher) void {
+        while (true) {
+            var slot: usize = 0;
+            {
+                self.pool_mutex.lock();
+                defer self.pool_mutex.unlock();
+                while (self.request_count == 0 and !self.stopping) {
+                    self.work_cond.wait(&self.pool_mutex);
+                }
+                if (self.stopping) {
+                    return;
+                }
+                slot = self.requests[self.request_head];
+                self.request_head = (self.request_head + 1) % self.requests.len;
+                self.request_count -= 1;
+            }
+
+            // The block is pending, so the reader leaves it alone until the
+            // completion below is applied.
+            const block = &self.blocks[slot];
+            const buffer = self.blockBuffer(slot)[0..block.requested];
+            const result: i64 = if (self.file.preadAll(buffer, block.offset)) |n| @intCast(n) else |_| -1;
+            const completed_ns = self.nowNs();
+
+            self.pool_mutex.lock();
+            defer self.pool_mutex.unlock();
+            self.completions[self.completion_count] = .{ .slot = slot, .result = result, .completed_ns = completed_ns };
+            self.completion_count += 1;
+            self.done_cond.signal();
+        }
+    }
+};
+
+fn latencyBucket(latency_ns: u64) usize {
+    const micros = latency_ns / std.time.ns_per_us;
+    if (micros == 0) {
+        return 0;
+    }
+    return @min(@as(usize, std.math.log2_int(u64, micros)), latency_bucket_count - 1);
+}
+
+fn recordLatency(stats: *Stats, latency_ns: u64) void {
+    stats.latency_histogram[latencyBucket(latency_ns)] += 1;
+}
+
+fn expectPrefetchedReads(engine_options: Options) !void {
+    var tmp = std.testing.tmpDir(.{});
+    defer tmp.cleanup();
+
+    const contents = try std.testing.allocator.alloc(u8, 5 * 64 * 1024 + 123);
+    defer std.testing.allocator.free(contents);
+    for (contents, 0..) |*byte, i| {
+        byte.* = @truncate(i *% 31 + 7);
+    }
+    try tmp.dir.writeFile(.{ .sub_path = "input.bin", .data = contents });
+
+    const path = try tmp.dir.realpathAlloc(std.testing.allocator, "input.bin");
+    defer std.testing.allocator.free(path);
+
+    const prefetcher = try ReadAheadPrefetcher.create(std.testing.allocator, path, engine_options);
+    defer prefetcher.destroy();
+    try std.testing.expectEqual(@as(u64, contents.len), prefetcher.size());
+
+    const out = try std.testing.allocator.alloc(u8, contents.len);
+    defer std.testing.allocator.free(out);
+
+    var position: usize = 0;
+    while (true) {
+        const n = try prefetcher.read(position, out[position..@min(position + 10_000, out.len)]);
+        if (n == 0) {
+            break;
+        }
+        position += n;
+    }
+    try std.testing.expectEqual(contents.len, position);
+    try std.testing.expectEqualSlices(u8, contents, out);
+
+    // Jump backwards past the recycled slots, then read across the last block.
+    var probe: [300]u8 = undefined;
+    const n = try prefetcher.read(100, &probe);
+    try std.testing.expectEqualSlices(u8, contents[100 .. 100 + n], probe[0..n]);
+    const tail = try prefetcher.read(contents.len - 50, &probe);
+    try std.testing.expectEqual(@as(usize, 50), tail);
+    try std.testing.expectEqualSlices(u8, contents[contents.len - 50 ..], probe[0..50]);
+
+    try std.testing.expect(prefetcher.stats.completed_reads > 0);
+    var histogram_total: i64 = 0;
+    for (prefetcher.stats.latency_histogram) |count| {
+        histogram_total += count;
+    }
+    try std.testing.expectEqual(prefetcher.stats.completed_reads, histogram_total);
+}
+
+test "thread pool prefetcher serves sequential and backward reads" {
+    try expectPrefetchedReads(.{ .window_bytes = 2 * 64 * 1024, .block_size = 64 * 1024, .use_io_uring = false });
+}
+
+test "io_uring prefetcher serves sequential and backward reads" {
+    if (comptime !uring_supported) {
+        return error.SkipZigTest;
+    }
+    // Falls back to the thread pool when io_uring is unavailable; the reads
+    // must be identical either way.
+    try expectPrefetchedReads(.{ .window_bytes = 3 * 64 * 1024, .block_size = 64 * 1024 });
+}
+
+test "latencyBucket uses log2 microsecond buckets" {
+    try std.testing.expectEqual(@as(usize, 0), latencyBucket(500));
+    try std.testing.expectEqual(@as(usize, 0), latencyBucket(1500));
+    try std.testing.expectEqual(@as(usize, 1), latencyBucket(2 * std.time.ns_per_us));
+    try std.testing.expectEqual(@as(usize, 10), latencyBucket(1500 * std.time.ns_per_us));
+    try std.testing.expectEqual(@as(usize, latency_bucket_count - 1), latencyBucket(std.time.ns_per_s * 100));
+}
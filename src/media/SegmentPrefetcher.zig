@@ -0,0 +1,737 @@
+const std = @import("std");
+const BandwidthEstimator = @import("BitrateSelector.zig").BandwidthEstimator;
+const test_server = @import("TestHttpServer.zig");
+const c = @cImport({
+    @cInclude("libavformat/avformat.h");
+    @cInclude("libavutil/dict.h");
+    @cInclude("libavutil/mem.h");
+});
+
+// Sits under libavformat's HLS and DASH demuxers as their `io_open` /
+// `io_close2` hooks. Every playlist and segment they open is downloaded whole
+// and served from memory, which times each download for the bandwidth
+// estimate. When an HLS segment is opened, the next few segments of the same
+// media playlist are fetched on a worker thread, so the demuxer finds them
+// already downloaded instead of waiting on the network at each boundary.
+//
+// Byte-range opens and the top-level manifest go straight to avio, because
+// `avformat_close_input` closes the latter with `avio_close`.
+
+pub const Options = struct {
+    lookahead_segments: usize = 3,
+    max_buffered_segments: usize = 8,
+};
+
+pub const Stats = struct {
+    prefetch_hits: i64 = 0,
+    misses: i64 = 0,
+    bytes_downloaded: i64 = 0,
+    failed_fetches: i64 = 0,
+};
+
+const served_buffer_size: c_int = 64 * 1024;
+const read_chunk_size: usize = 64 * 1024;
+
+const SegmentState = enum {
+    queued,
+    fetching,
+    ready,
+    failed,
+};
+
+const Segment = struct {
+    url: []u8,
+    playlist_hash: u64,
+    duration_s: f64,
+    state: SegmentState = .queued,
+    data: []u8 = &.{},
+};
+
+const PlaylistEntry = struct {
+    url: []u8,
+    duration_s: f64,
+};
+
+const Playlist = struct {
+    hash: u64,
+    entries: []PlaylistEntry,
+};
+
+const Served = struct {
+    data: []u8,
+    position: usize = 0,
+};
+
+pub const SegmentPrefetcher = struct {
+    allocator: std.mem.Allocator,
+    options: Options,
+    mutex: std.Thread.Mutex = .{},
+    work_cond: std.Thread.Condition = .{},
+    ready_cond: std.Thread.Condition = .{},
+    // Oldest first; consumed segments are removed.
+    segments: std.ArrayListUnmanaged(*Segment) = .{},
+    playlists: std.ArrayListUnmanaged(Playlist) = .{},
+    current_playlist_hash: u64 = 0,
+    // What the demuxer last passed to `io_open` (headers, cookies, user agent,
+    // proxy), so prefetched segments are requested the way it would.
+    open_options: ?*c.AVDictionary = null,
+    estimator: BandwidthEstimator = .{},
+    stats: Stats = .{},
+    worker: ?std.Thread = null,
+    stopping: bool = false,
+    cancelled: std.atomic.Value(bool) = std.atomic.Value(bool).init(false),
+
+    pub fn create(allocator: std.mem.Allocator, options: Options) !*SegmentPrefetcher {
+        _ = c.avformat_network_init();
+        errdefer _ = c.avformat_network_deinit();
+
+        const self = try allocator.create(SegmentPrefetcher);
+        errdefer allocator.destroy(self);
+        self.* = .{ .allocator = allocator, .options = options };
+        self.worker = try std.Thread.spawn(.{}, workerMain, .{self});
+        return self;
+    }
+
+    /// The format context must already be closed: its remaining segment
+    /// contexts are released through this prefetcher.
+    pub fn destroy(self: *SegmentPrefetcher) void {
+        self.mutex.lock();
+        self.stopping = true;
+        self.cancelled.store(true, .release);
+        self.work_cond.broadcast();
+        self.ready_cond.broadcast();
+        self.mutex.unlock();
+        if (self.worker) |thread| {
+            thread.join();
+        }
+
+        for (self.segments.items) |segment| {
+            self.freeSegment(segment);
+        }
+        self.segments.deinit(self.allocator);
+        for (self.playlists.items) |playlist| {
+            self.freeEntries(playlist.entries);
+        }
+        self.playlists.deinit(self.allocator);
+        c.av_dict_free(&self.open_options);
+        self.allocator.destroy(self);
+        _ = c.avformat_network_deinit();
+    }
+
+    /// Installs the hooks on a context from `avformat_alloc_context`, before
+    /// `avformat_open_input`.
+    pub fn attach(self: *SegmentPrefetcher, format_context: *anyopaque) void {
+        const ctx: *c.AVFormatContext = @ptrCast(@alignCast(format_context));
+        ctx.@"opaque" = self;
+        ctx.io_open = ioOpen;
+        ctx.io_close2 = ioClose2;
+    }
+
+    /// Fails pending and later opens until `rearm`.
+    pub fn cancel(self: *SegmentPrefetcher) void {
+        self.mutex.lock();
+        self.cancelled.store(true, .release);
+        self.ready_cond.broadcast();
+        self.mutex.unlock();
+    }
+
+    pub fn rearm(self: *SegmentPrefetcher) void {
+        self.mutex.lock();
+        defer self.mutex.unlock();
+        if (!self.stopping) {
+            self.cancelled.store(false, .release);
+        }
+    }
+
+    pub fn estimateBps(self: *SegmentPrefetcher) ?f64 {
+        self.mutex.lock();
+        defer self.mutex.unlock();
+        return self.estimator.estimateBps();
+    }
+
+    /// Media time downloaded ahead of the demuxer on the playlist it reads.
+    pub fn bufferedSeconds(self: *SegmentPrefetcher) f64 {
+        self.mutex.lock();
+        defer self.mutex.unlock();
+        var total: f64 = 0.0;
+        for (self.segments.items) |segment| {
+            if (segment.state == .ready and segment.playlist_hash == self.current_playlist_hash) {
+                total += segment.duration_s;
+            }
+        }
+        return total;
+    }
+
+    pub fn snapshotStats(self: *SegmentPrefetcher) Stats {
+        self.mutex.lock();
+        defer self.mutex.unlock();
+        return self.stats;
+    }
+
+    fn rememberOptions(self: *SegmentPrefetcher, options: ?*const c.AVDictionary) void {
+        self.mutex.lock();
+        defer self.mutex.unlock();
+        c.av_dict_free(&self.open_options);
+        _ = c.av_dict_copy(&self.open_options, options, 0);
+    }
+
+    // Returns the whole body of `url`, owned by the caller.
+    fn fetch(self: *SegmentPrefetcher, url: []const u8) ![]u8 {
+        self.mutex.lock();
+        if (self.findSegment(url)) |index| {
+            const segment = self.segments.items[index];
+            // The worker fetches in playlist order, so a queued segment is at
+            // most one download behind the one in flight.
+            while ((segment.state == .queued or segment.state == .fetching) and !self.cancelled.load(.acquire)) {
+                self.ready_cond.wait(&self.mutex);
+            }
+            if (self.cancelled.load(.acquire)) {
+                self.mutex.unlock();
+                return error.Cancelled;
+            }
+            _ = self.segments.orderedRemove(std.mem.indexOfScalar(*Segment, self.segments.items, segment).?);
+            if (segment.state == .ready) {
+                const data = segment.data;
+                segment.data = &.{};
+                self.stats.prefetch_hits += 1;
+                self.current_playlist_hash = segment.playlist_hash;
+                self.scheduleAfter(url);
+                self.mutex.unlock();
+                self.freeSegment(segment);
+                return data;
+            }
+            self.freeSegment(segment);
+        }
+        self.mutex.unlock();
+
+        const data = try self.download(url);
+        errdefer self.allocator.free(data);
+        const entries = try parseMediaPlaylist(self.allocator, url, data);
+
+        self.mutex.lock();
+        defer self.mutex.unlock();
+        if (entries) |list| {
+            self.storePlaylist(std.hash.Wyhash.hash(0, url), list);
+        } else {
+            self.stats.misses += 1;
+            self.scheduleAfter(url);
+        }
+        return data;
+    }
+
+    fn download(self: *SegmentPrefetcher, url: []const u8) ![]u8 {
+        const url_z = try self.allocator.dupeZ(u8, url);
+        defer self.allocator.free(url_z);
+
+        var body: std.ArrayListUnmanaged(u8) = .{};
+        errdefer body.deinit(self.allocator);
+
+        var options: ?*c.AVDictionary = null;
+        defer c.av_dict_free(&options);
+        self.mutex.lock();
+        _ = c.av_dict_copy(&options, self.open_options, 0);
+        self.mutex.unlock();
+
+        const started = std.time.nanoTimestamp();
+        const interrupt = c.AVIOInterruptCB{ .callback = interruptDownload, .@"opaque" = self };
+        var ctx: [*c]c.AVIOContext = null;
+        if (c.avio_open2(&ctx, url_z.ptr, c.AVIO_FLAG_READ, &interrupt, &options) < 0) {
+            self.noteFailure();
+            return if (self.cancelled.load(.acquire)) error.Cancelled else error.OpenFailed;
+        }
+        defer _ = c.avio_closep(&ctx);
+
+        while (true) {
+            try body.ensureUnusedCapacity(self.allocator, read_chunk_size);
+            const n = c.avio_read(ctx, body.unusedCapacitySlice().ptr, @intCast(read_chunk_size));
+            if (n == 0 or n == c.AVERROR_EOF) {
+                break;
+            }
+            if (n < 0) {
+                self.noteFailure();
+                return if (self.cancelled.load(.acquire)) error.Cancelled else error.ReadFailed;
+            }
+            body.items.len += @intCast(n);
+        }
+
+        const elapsed_s = @as(f64, @floatFromInt(std.time.nanoTimestamp() - started)) / std.time.ns_per_s;
+        self.mutex.lock();
+        self.estimator.addSample(body.items.len, elapsed_s);
+        self.stats.bytes_downloaded += @intCast(body.items.len);
+        self.mutex.unlock();
+        return body.toOwnedSlice(self.allocator);
+    }
+
+    fn noteFailure(self: *SegmentPrefetcher) void {
+        self.mutex.lock();
+        self.stats.failed_fetches += 1;
+        self.mutex.unlock();
+    }
+
+    fn interruptDownload(opaque_ptr: ?*anyopaque) callconv(.c) c_int {
+        const self: *SegmentPrefetcher = @ptrCast(@alignCast(opaque_ptr orelse return 1));
+        return @intFromBool(self.cancelled.load(.acquire));
+    }
+
+    fn findSegment(self: *SegmentPrefetcher, url: []const u8) ?usize {
+        for (self.segments.items, 0..) |segment, i| {
+            if (std.mem.eql(u8, segment.url, url)) {
+                return i;
+            }
+        }
+        return null;
+    }
+
+    // Live playlists are reloaded while playing; the newest copy wins.
+    fn storePlaylist(self: *SegmentPrefetcher, hash: u64, entries: []PlaylistEntry) void {
+        for (self.playlists.items) |*playlist| {
+            if (playlist.hash == hash) {
+                self.freeEntries(playlist.entries);
+                playlist.entries = entries;
+                return;
+            }
+        }
+        self.playlists.append(self.allocator, .{ .hash = hash, .entries = entries }) catch self.freeEntries(entries);
+    }
+
+    // Queues the segments that follow `url` in its playlist. Queued segments
+    // outside that window belong to a variant or position the demuxer has
+    // left and are dropped; the oldest downloaded ones are evicted beyond the
+    // buffer budget.
+    fn scheduleAfter(self: *SegmentPrefetcher, url: []const u8) void {
+        const located = self.locate(url) orelse return;
+        const playlist = self.playlists.items[located.playlist];
+        const window_start = located.entry + 1;
+        const window = playlist.entries[@min(window_start, playlist.entries.len)..@min(window_start + self.options.lookahead_segments, playlist.entries.len)];
+        self.current_playlist_hash = playlist.hash;
+
+        var i: usize = 0;
+        while (i < self.segments.items.len) {
+            const segment = self.segments.items[i];
+            if (segment.state == .queued and !containsUrl(window, segment.url)) {
+                _ = self.segments.orderedRemove(i);
+                self.freeSegment(segment);
+            } else {
+                i += 1;
+            }
+        }
+
+        for (window) |entry| {
+            if (self.findSegment(entry.url) != null) {
+                continue;
+            }
+            const segment = self.allocator.create(Segment) catch break;
+            const segment_url = self.allocator.dupe(u8, entry.url) catch {
+                self.allocator.destroy(segment);
+                break;
+            };
+            segment.* = .{ .url = segment_url, .playlist_hash = playlist.hash, .duration_s = entry.duration_s };
+            self.segments.append(self.allocator, segment) catch {
+                self.freeSegment(segment);
+                break;
+            };
+        }
+
+        i = 0;
+        while (self.segments.items.len > self.options.max_buffered_segments and i < self.segments.items.len) {
+            const segment = self.segments.items[i];
+            if (segment.state == .ready or segment.state == .failed) {
+                _ = self.segments.orderedRemove(i);
+                self.freeSegment(segment);
+            } else {
+                i += 1;
+            }
+        }
+        self.work_cond.broadcast();
+    }
+
+    const Location = struct {
+        playlist: usize,
+        entry: usize,
+    };
+
+    fn locate(self: *SegmentPrefetcher, url: []const u8) ?Location {
+        for (self.playlists.items, 0..) |playlist, p| {
+            for (playlist.entries, 0..) |entry, e| {
+                if (std.mem.eql(u8, entry.url, url)) {
+                    return .{ .playlist = p, .entry = e };
+                }
+            }
+        }
+        return null;
+    }
+
+    fn workerMain(self: *SegmentPrefetcher) void {
+        self.mutex.lock();
+        defer self.mutex.unlock();
+        while (true) {
+            const next = while (!self.stopping) {
+                if (self.nextQueued()) |segment| {
+                    break segment;
+                }
+                self.work_cond.wait(&self.mutex);
+            } else return;
+
+            next.state = .fetching;
+            const url = next.url;
+            self.mutex.unlock();
+            const result = self.download(url);
+            self.mutex.lock();
+
+            // Fetching segments are never removed, so `next` is still live.
+            if (result) |data| {
+                next.data = data;
+                next.state = .ready;
+            } else |_| {
+                next.state = .failed;
+            }
+            self.ready_cond.broadcast();
+        }
+    }
+
+    fn nextQueued(self: *SegmentPrefetcher) ?*Segment {
+        for (self.segments.items) |segment| {
+            if (segment.state == .queued) {
+                return segment;
+            }
+        }
+        return null;
+    }
+
+    fn freeSegment(self: *SegmentPrefetcher, segment: *Segment) void {
+        self.allocator.free(segment.data);
+        self.allocator.free(segment.url);
+        self.allocator.destroy(segment);
+    }
+
+    fn freeEntries(self: *SegmentPrefetcher, entries: []PlaylistEntry) void {
+        for (entries) |entry| {
+            self.allocator.free(entry.url);
+        }
+        self.allocator.free(entries);
+    }
+
+    fn serve(self: *SegmentPrefetcher, pb: [*c][*c]c.AVIOContext, data: []u8) c_int {
+        const served = self.allocator.create(Served) catch {
+            self.allocator.free(data);
+            return c.AVERROR(c.ENOMEM);
+        };
+        served.* = .{ .data = data };
+
+        const buffer: [*c]u8 = @ptrCast(c.av_malloc(@intCast(served_buffer_size)));
+        if (buffer != null) {
+            pb.* = c.avio_alloc_context(buffer, served_buffer_size, 0, served, servedRead, null, servedSeek);
+            if (pb.* != null) {
+                return 0;
+            }
+            c.av_free(buffer);
+        }
+        self.allocator.free(data);
+        self.allocator.destroy(served);
+        return c.AVERROR(c.ENOMEM);
+    }
+
+    fn fromContext(s: [*c]c.AVFormatContext) ?*SegmentPrefetcher {
+        if (s == null) {
+            return null;
+        }
+        return @ptrCast(@alignCast(s.*.@"opaque" orelse return null));
+    }
+
+    fn ioOpen(s: [*c]c.AVFormatContext, pb: [*c][*c]c.AVIOContext, url: [*c]const u8, flags: c_int, options: [*c]?*c.AVDictionary) callconv(.c) c_int {
+        const self = fromContext(s) orelse return c.AVERROR(c.EINVAL);
+        const path = std.mem.span(url);
+        const ranged = options != null and c.av_dict_get(options.*, "offset", null, 0) != null;
+        const top_level = @intFromPtr(pb) == @intFromPtr(&s.*.pb);
+        if (top_level or ranged or (flags & c.AVIO_FLAG_WRITE) != 0 or !isHttp(path)) {
+            return c.avio_open2(pb, url, flags, &s.*.interrupt_callback, options);
+        }
+
+        self.rememberOptions(if (options != null) options.* else null);
+        const data = self.fetch(path) catch |err| return switch (err) {
+            error.Cancelled => c.AVERROR_EXIT,
+            error.OutOfMemory => c.AVERROR(c.ENOMEM),
+            else => c.AVERROR(c.EIO),
+        };
+        return self.serve(pb, data);
+    }
+
+    fn ioClose2(s: [*c]c.AVFormatContext, pb: [*c]c.AVIOContext) callconv(.c) c_int {
+        if (pb == null) {
+            return 0;
+        }
+        const served_here = if (pb.*.read_packet) |read_fn| read_fn == &servedRead else false;
+        if (!served_here) {
+            return c.avio_close(pb);
+        }
+
+        const self = fromContext(s) orelse return c.AVERROR(c.EINVAL);
+        const served: *Served = @ptrCast(@alignCast(pb.*.@"opaque"));
+        self.allocator.free(served.data);
+        self.allocator.destroy(served);
+        var ctx = pb;
+        c.av_freep(@ptrCast(&ctx.*.buffer));
+        c.avio_context_free(&ctx);
+        return 0;
+    }
+};
+
+fn servedRead(opaque_ptr: ?*anyopaque, buf: [*c]u8, buf_size: c_int) callconv(.c) c_int {
+    const served: *Served = @ptrCast(@alignCast(opaque_ptr orelse return c.AVERROR(c.EINVAL)));
+    if (buf == null or buf_size <= 0) {
+        return c.AVERROR(c.EINVAL);
+    }
+    if (served.position >= served.data.len) {
+        return c.AVERROR_EOF;
+    }
+
+    const count = @min(@as(usize, @intCast(buf_size)), served.data.len - served.position);
+    @memcpy(buf[0..count], served.data[served.position .. served.position + count]);
+    served.position += count;
+    return @intCast(count);
+}
+
+fn servedSeek(opaque_ptr: ?*anyopaque, offset: i64, whence: c_int) callconv(.c) i64 {
+    const served: *Served = @ptrCast(@alignCast(opaque_ptr orelse return c.AVERROR(c.EINVAL)));
+    const size: i64 = @intCast(served.data.len);
+    if ((whence & c.AVSEEK_SIZE) != 0) {
+        return size;
+    }
+
+    const base: i64 = switch (whence & ~@as(c_int, c.AVSEEK_FORCE)) {
+        c.SEEK_SET => 0,
+        c.SEEK_CUR => @intCast(served.position),
+        c.SEEK_END => size,
+        else => return c.AVERROR(c.EINVAL),
+    };
+    const target = base + offset;
+    if (target < 0) {
+        return c.AVERROR(c.EINVAL);
+    }
+    served.position = @intCast(@min(target, size));
+    return @intCast(served.position);
+}
+
+fn isHttp(url: []const u8) bool {
+    return std.ascii.startsWithIgnoreCase(url, "http://") or std.ascii.startsWithIgnoreCase(url, "https://");
+}
+
+/// HLS and DASH manifests over HTTP(S) are read in segment mode.
+pub fn isSegmentManifestUrl(url: []const u8) bool {
+    if (!isHttp(url)) {
+        return false;
+    }
+    const path = url[0 .. std.mem.indexOfAny(u8, url, "?#") orelse url.len];
+    return std.ascii.endsWithIgnoreCase(path, ".m3u8") or std.ascii.endsWithIgnoreCase(path, ".mpd");
+}
+
+fn containsUrl(entries: []const PlaylistEntry, url: []const u8) bool {
+    for (entries) |entry| {
+        if (std.mem.eql(u8, entry.url, url)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+fn resolveUri(allocator: std.mem.Allocator, base: []const u8, reference: []const u8) ![]u8 {
+    if (std.mem.indexOf(u8, reference, "://") != null) {
+        return allocator.dupe(u8, reference);
+    }
+    const authority_end = if (std.mem.indexOf(u8, base, "://")) |i|
+        std.mem.indexOfAnyPos(u8, base, i + 3, "/?#") orelse base.len
+    else
+        0;
+    if (reference.len > 0 and reference[0] == '/') {
+        return std.mem.concat(allocator, u8, &.{ base[0..authority_end], reference });
+    }
+
+    const path_end = std.mem.indexOfAnyPos(u8, base, authority_end, "?#") orelse base.len;
+    const dir_end = if (std.mem.lastIndexOfScalar(u8, base[authority_end..path_end], '/')) |i| authority_end + i + 1 else {
+        return std.mem.concat(allocator, u8, &.{ base[0..authority_end], "/", reference });
+    };
+    return std.mem.concat(allocator, u8, &.{ base[0..dir_end], reference });
+}
+
+// Returns the segments of an HLS media playlist, or null for anything else
+// (master playlists, DASH manifests, segments). Byte-range playlists are
+// skipped because their segments are opened as ranges of one resource.
+fn parseMediaPlaylist(allocator: std.mem.Allocator, url: []const u8, body: []const u8) !?[]PlaylistEntry {
+    if (!std.mem.startsWith(u8, body, "#EXTM3U") or
+        std.mem.indexOf(u8, body, "#EXTINF") == null or
+        std.mem.indexOf(u8, body, "#EXT-X-BYTERANGE") != null)
+    {
+        return null;
+    }
+
+    var entries: std.ArrayListUnmanaged(PlaylistEntry) = .{};
+    errdefer {
+        for (entries.items) |entry| {
+            allocator.free(entry.url);
+        }
+        entries.deinit(allocator);
+    }
+
+    var duration_s: f64 = 0.0;
+    var lines = std.mem.splitScalar(u8, body, '\n');
+    while (lines.next()) |raw| {
+        const line = std.mem.trim(u8, raw, " \t\r");
+        if (line.len == 0) {
+            continue;
+        }
+        if (std.mem.startsWith(u8, line, "#EXTINF:")) {
+            const value = line["#EXTINF:".len..];
+            duration_s = std.fmt.parseFloat(f64, value[0 .. std.mem.indexOfScalar(u8, value, ',') orelse value.len]) catch 0.0;
+            continue;
+        }
+        if (line[0] == '#') {
+            continue;
+        }
+        const resolved = try resolveUri(allocator, url, line);
+        errdefer allocator.free(resolved);
+        try entries.append(allocator, .{ .url = resolved, .duration_s = duration_s });
+        duration_s = 0.0;
+    }
+    return try entries.toOwnedSlice(allocator);
+}
+
+test "resolveUri handles absolute, root-relative and relative references" {
+    const allocator = std.testing.allocator;
+    const cases = [_][3][]const u8{
+        .{ "http://h:1/a/b/list.m3u8?t=1", "seg0.ts", "http://h:1/a/b/seg0.ts" },
+        .{ "http://h:1/a/b/list.m3u8", "/x/seg0.ts", "http://h:1/x/seg0.ts" },
+        .{ "http://h:1/a/list.m3u8", "https://cdn/seg0.ts", "https://cdn/seg0.ts" },
+        .{ "http://h:1", "seg0.ts", "http://h:1/seg0.ts" },
+    };
+    for (cases) |case| {
+        const resolved = try resolveUri(allocator, case[0], case[1]);
+        defer allocator.free(resolved);
+        try std.testing.expectEqualStrings(case[2], resolved);
+    }
+
+    try std.testing.expect(isSegmentManifestUrl("https://h/live/master.m3u8?token=x"));
+    try std.testing.expect(isSegmentManifestUrl("http://h/manifest.mpd"));
+    try std.testing.expect(!isSegmentManifestUrl("http://h/movie.mp4"));
+    try std.testing.expect(!isSegmentManifestUrl("/tmp/master.m3u8"));
+}
+
+test "prefetcher serves following segments from memory and follows variant switches" {
+    if (comptime !test_server.supported) {
+        return error.SkipZigTest;
+    }
+    const allocator = std.testing.allocator;
+
+    // Two variants of six 40 KB segments; segment bodies encode their name.
+    const segment_count = 6;
+    const segment_len = 40 * 1024;
+    var bodies: [2][segment_count][]u8 = undefined;
+    var paths: [2][segment_count][16]u8 = undefined;
+    var path_lens: [2][segment_count]usize = undefined;
+    var playlists: [2][]u8 = undefined;
+    var routes: [2 + 2 * segment_count]test_server.Route = undefined;
+
+    for (0..2) |v| {
+        var playlist: std.ArrayListUnmanaged(u8) = .{};
+        defer playlist.deinit(allocator);
+        try playlist.appendSlice(allocator, "#EXTM3U\n#EXT-X-TARGETDURATION:2\n");
+        for (0..segment_count) |s| {
+            bodies[v][s] = try allocator.alloc(u8, segment_len);
+            @memset(bodies[v][s], @intCast(v * 16 + s));
+            const path = try std.fmt.bufPrint(&paths[v][s], "/v{d}/seg{d}.ts", .{ v, s });
+            path_lens[v][s] = path.len;
+            try playlist.print(allocator, "#EXTINF:2.0,\nseg{d}.ts\n", .{s});
+            routes[2 + v * segment_count + s] = .{ .path = paths[v][s][0..path.len], .body = bodies[v][s] };
+        }
+        try playlist.appendSlice(allocator, "#EXT-X-ENDLIST\n");
+        playlists[v] = try playlist.toOwnedSlice(allocator);
+    }
+    defer {
+        for (0..2) |v| {
+            allocator.free(playlists[v]);
+            for (bodies[v]) |body| {
+                allocator.free(body);
+            }
+        }
+    }
+    routes[0] = .{ .path = "/v0/index.m3u8", .body = playlists[0] };
+    routes[1] = .{ .path = "/v1/index.m3u8", .body = playlists[1] };
+
+    const server = try test_server.TestHttpServer.start(allocator, &routes);
+    defer server.stop();
+
+    const prefetcher = try SegmentPrefetcher.create(allocator, .{ .lookahead_segments = 2, .max_buffered_segments = 4 });
+    defer prefetcher.destroy();
+
+    var url_buf: [96]u8 = undefined;
+    const fetchPath = struct {
+        fn run(p: *SegmentPrefetcher, srv: *test_server.TestHttpServer, buf: []u8, path: []const u8) ![]u8 {
+            return p.fetch(try srv.url(buf, path));
+        }
+    }.run;
+
+    const variant0 = try fetchPath(prefetcher, server, &url_buf, "/v0/index.m3u8");
+    allocator.free(variant0);
+
+    for (0..3) |s| {
+        const data = try fetchPath(prefetcher, server, &url_buf, paths[0][s][0..path_lens[0][s]]);
+        defer allocator.free(data);
+        try std.testing.expectEqualSlices(u8, bodies[0][s], data);
+    }
+
+    // Switch to the other variant mid-stream.
+    const variant1 = try fetchPath(prefetcher, server, &url_buf, "/v1/index.m3u8");
+    allocator.free(variant1);
+    for (3..segment_count) |s| {
+        const data = try fetchPath(prefetcher, server, &url_buf, paths[1][s][0..path_lens[1][s]]);
+        defer allocator.free(data);
+        try std.testing.expectEqualSlices(u8, bodies[1][s], data);
+    }
+
+    const stats = prefetcher.snapshotStats();
+    try std.testing.expectEqual(@as(i64, 2), stats.misses);
+    try std.testing.expectEqual(@as(i64, 4), stats.prefetch_hits);
+    try std.testing.expectEqual(@as(i64, 0), stats.failed_fetches);
+    try std.testing.expect(prefetcher.estimateBps() != null);
+
+    // Every segment that was played was downloaded exactly once.
+    for (0..3) |s| {
+        try std.testing.expectEqual(@as(usize, 1), server.requestCount(paths[0][s][0..path_lens[0][s]]));
+    }
+    for (3..segment_count) |s| {
+        try std.testing.expectEqual(@as(usize, 1), server.requestCount(paths[1][s][0..path_lens[1][s]]));
+    }
+    // Nothing before the switch point of the new variant was fetched.
+    try std.testing.expectEqual(@as(usize, 0), server.requestCount(paths[1][0][0..path_lens[1][0]]));
+}
+
+test "downloads carry the options the demuxer opened with" {
+    if (comptime !test_server.supported) {
+        return error.SkipZigTest;
+    }
+
+    const allocator = std.testing.allocator;
+    const routes = [_]test_server.Route{.{ .path = "/seg0.ts", .body = "segment", .required_header = "X-Token: abc" }};
+    const server = try test_server.TestHttpServer.start(allocator, &routes);
+    defer server.stop();
+
+    const prefetcher = try SegmentPrefetcher.create(allocator, .{});
+    defer prefetcher.destroy();
+
+    var url_buf: [64]u8 = undefined;
+    const url = try server.url(&url_buf, "/seg0.ts");
+    try std.testing.expectError(error.OpenFailed, prefetcher.fetch(url));
+
+    // A stopped and restarted demuxer opens segments again.
+    prefetcher.cancel();
+    try std.testing.expectError(error.Cancelled, prefetcher.fetch(url));
+    prefetcher.rearm();
+
+    var options: ?*c.AVDictionary = null;
+    defer c.av_dict_free(&options);
+    _ = c.av_dict_set(&options, "headers", "X-Token: abc\r\n", 0);
+    prefetcher.rememberOptions(options);
+
+    const data = try prefetcher.fetch(url);
+    defer allocator.free(data);
+    try std.testing.expectEqualStrings("segment", data);
+}
@@ -0,0 +1,156 @@
+const std = @import("std");
+const builtin = @import("builtin");
+
+// Minimal HTTP/1.1 origin standing in for remote media in tests: fixed
+// routes, one request per connection, HEAD, `Range: bytes=a-` and `bytes=a-b`.
+
+pub const supported = builtin.os.tag != .windows and builtin.os.tag != .wasi;
+
+pub const Route = struct {
+    path: []const u8,
+    body: []const u8,
+    /// Sent as the ETag header when not empty.
+    etag: []const u8 = "",
+    /// Requests without this exact header line get a 403 when not empty.
+    required_header: []const u8 = "",
+};
+
+const max_routes = 32;
+
+pub const TestHttpServer = struct {
+    allocator: std.mem.Allocator,
+    server: std.net.Server,
+    routes: []const Route,
+    counts: [max_routes]std.atomic.Value(usize) = [_]std.atomic.Value(usize){std.atomic.Value(usize).init(0)} ** max_routes,
+    stopping: std.atomic.Value(bool) = std.atomic.Value(bool).init(false),
+    thread: ?std.Thread = null,
+
+    pub fn start(allocator: std.mem.Allocator, routes: []const Route) !*TestHttpServer {
+        std.debug.assert(routes.len <= max_routes);
+        const self = try allocator.create(TestHttpServer);
+        errdefer allocator.destroy(self);
+
+        const address = try std.net.Address.parseIp("127.0.0.1", 0);
+        self.* = .{ .allocator = allocator, .server = try address.listen(.{ .reuse_address = true }), .routes = routes };
+        errdefer self.server.deinit();
+        self.thread = try std.Thread.spawn(.{}, serve, .{self});
+        return self;
+    }
+
+    pub fn stop(self: *TestHttpServer) void {
+        self.stopping.store(true, .release);
+        // Wake the blocking accept.
+        if (std.net.tcpConnectToAddress(self.server.listen_address)) |stream| {
+            stream.close();
+        } else |_| {}
+        if (self.thread) |thread| {
+            thread.join();
+        }
+        self.server.deinit();
+        self.allocator.destroy(self);
+    }
+
+    pub fn url(self: *TestHttpServer, buf: []u8, path: []const u8) ![:0]u8 {
+        return std.fmt.bufPrintZ(buf, "http://127.0.0.1:{d}{s}", .{ self.server.listen_address.getPort(), path });
+    }
+
+    pub fn requestCount(self: *TestHttpServer, path: []const u8) usize {
+        for (self.routes, 0..) |route, i| {
+            if (std.mem.eql(u8, route.path, path)) {
+                return self.counts[i].load(.monotonic);
+            }
+        }
+        return 0;
+    }
+
+    fn serve(self: *TestHttpServer) void {
+        while (!self.stopping.load(.acquire)) {
+            const connection = self.server.accept() catch return;
+            defer connection.stream.close();
+            if (self.stopping.load(.acquire)) {
+                return;
+            }
+            self.respond(connection.stream.handle) catch {};
+        }
+    }
+
+    fn respond(self: *TestHttpServer, fd: std.posix.socket_t) !void {
+        var request: [4096]u8 = undefined;
+        var len: usize = 0;
+        while (std.mem.indexOf(u8, request[0..len], "\r\n\r\n") == null) {
+            if (len == request.len) {
+                return error.RequestTooLarge;
+            }
+            const n = try std.posix.read(fd, request[len..]);
+            if (n == 0) {
+                return error.ConnectionClosed;
+            }
+            len += n;
+        }
+
+        var lines = std.mem.splitSequence(u8, request[0..len], "\r\n");
+        var request_line = std.mem.splitScalar(u8, lines.first(), ' ');
+        const method = request_line.first();
+        const target = request_line.next() orelse return error.BadRequest;
+        const path = target[0 .. std.mem.indexOfScalar(u8, target, '?') orelse target.len];
+
+        const route_index = for (self.routes, 0..) |route, i| {
+            if (std.mem.eql(u8, route.path, path)) {
+                break i;
+            }
+        } else {
+            try writeAll(fd, "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+            return;
+        };
+        _ = self.counts[route_index].fetchAdd(1, .monotonic);
+        const route = self.routes[route_index];
+        const body = route.body;
+
+        var first: usize = 0;
+        var last: usize = body.len -| 1;
+        var ranged = false;
+        var authorized = route.required_header.len == 0;
+        while (lines.next()) |line| {
+            if (!authorized and std.ascii.eqlIgnoreCase(line, route.required_header)) {
+                authorized = true;
+            }
+            const prefix = "range: bytes=";
+            if (line.len <= prefix.len or !std.ascii.startsWithIgnoreCase(line, prefix)) {
+                continue;
+            }
+            var bounds = std.mem.splitScalar(u8, line[prefix.len..], '-');
+            first = try std.fmt.parseInt(usize, bounds.first(), 10);
+            if (bounds.next()) |end_text| {
+                if (end_text.len > 0) {
+                    last = @min(last, try std.fmt.parseInt(usize, end_text, 10));
+                }
+            }
+            ranged = true;
+        }
+
+        if (!authorized) {
+            try writeAll(fd, "HTTP/1.1 403 Forbidden\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+            return;
+        }
+
+        var etag_buf: [128]u8 = undefined;
+        const etag = if (route.etag.len > 0) try std.fmt.bufPrint(&etag_buf, "ETag: {s}\r\n", .{route.etag}) else "";
+
+        var header_buf: [512]u8 = undefined;
+        const header = if (ranged)
+            try std.fmt.bufPrint(&header_buf, "HTTP/1.1 206 Partial Content\r\nContent-Length: {d}\r\nContent-Range: bytes {d}-{d}/{d}\r\nAccept-Ranges: bytes\r\n{s}Connection: close\r\n\r\n", .{ last + 1 - first, first, last, body.len, etag })
+        else
+            try std.fmt.bufPrint(&header_buf, "HTTP/1.1 200 OK\r\nContent-Length: {d}\r\nAccept-Ranges: bytes\r\n{s}Connection: close\r\n\r\n", .{ body.len, etag });
+        try writeAll(fd, header);
+        if (body.len > 0 and !std.mem.eql(u8, method, "HEAD")) {
+            try writeAll(fd, body[first .. last + 1]);
+        }
+    }
+
+    fn writeAll(fd: std.posix.socket_t, bytes: []const u8) !void {
+        var offset: usize = 0;
+        while (offset < bytes.len) {
+            offset += try std.posix.write(fd, bytes[offset..]);
+        }
+    }
+};
@@ -0,0 +1,163 @@
+const std = @import("std");
+const builtin = @import("builtin");
+const c = @cImport({
+    @cInclude("libavformat/avformat.h");
+    @cInclude("libavcodec/avcodec.h");
+});
+
+// Live source standing in for a camera or encoder in tests: encodes a small
+// gray MPEG-1 picture stream in real time and sends it as MPEG-TS over UDP to
+// 127.0.0.1.
+
+pub const supported = builtin.os.tag != .wasi;
+
+const width = 64;
+const height = 64;
+const fps = 25;
+// Gives up on its own if the test never stops it.
+const max_frames = 60 * fps;
+
+pub const TestLiveSender = struct {
+    allocator: std.mem.Allocator,
+    port: u16,
+    encoder: [*c]c.AVCodecContext = null,
+    frame: [*c]c.AVFrame = null,
+    packet: [*c]c.AVPacket = null,
+    output: [*c]c.AVFormatContext = null,
+    stream: [*c]c.AVStream = null,
+    stopping: std.atomic.Value(bool) = std.atomic.Value(bool).init(false),
+    thread: ?std.Thread = null,
+
+    /// Sets up the encoder and the UDP muxer before returning, so a missing
+    /// encoder fails here instead of leaving the receiver waiting forever.
+    pub fn start(allocator: std.mem.Allocator) !*TestLiveSender {
+        const port = try freePort();
+        const self = try allocator.create(TestLiveSender);
+        self.* = .{ .allocator = allocator, .port = port };
+        errdefer self.release();
+        try self.open();
+        self.thread = try std.Thread.spawn(.{}, run, .{self});
+        return self;
+    }
+
+    pub fn stop(self: *TestLiveSender) void {
+        self.stopping.store(true, .release);
+        if (self.thread) |thread| {
+            thread.join();
+        }
+        if (self.output != null and self.output.*.pb != null) {
+            _ = c.av_write_trailer(self.output);
+        }
+        self.release();
+    }
+
+    pub fn url(self: *TestLiveSender, buf: []u8) ![:0]u8 {
+        return std.fmt.bufPrintZ(buf, "udp://127.0.0.1:{d}", .{self.port});
+    }
+
+    // A port that was free a moment ago; nothing else binds loopback UDP
+    // ports in the test run.
+    fn freePort() !u16 {
+        var address = try std.net.Address.parseIp("127.0.0.1", 0);
+        const fd = try std.posix.socket(std.posix.AF.INET, std.posix.SOCK.DGRAM, 0);
+        defer std.posix.close(fd);
+        try std.posix.bind(fd, &address.any, address.getOsSockLen());
+        var len: std.posix.socklen_t = address.getOsSockLen();
+        try std.posix.getsockname(fd, &address.any, &len);
+        return address.getPort();
+    }
+
+    fn open(self: *TestLiveSender) !void {
+        const codec = c.avcodec_find_encoder(c.AV_CODEC_ID_MPEG1VIDEO);
+        if (codec == null) {
+            return error.EncoderUnavailable;
+        }
+        self.encoder = c.avcodec_alloc_context3(codec);
+        self.frame = c.av_frame_alloc();
+        self.packet = c.av_packet_alloc();
+        if (self.encoder == null or self.frame == null or self.packet == null) {
+            return error.OutOfMemory;
+        }
+
+        const e = self.encoder;
+        e.*.width = width;
+        e.*.height = height;
+        e.*.pix_fmt = c.AV_PIX_FMT_YUV420P;
+        e.*.time_base = .{ .num = 1, .den = fps };
+        e.*.framerate = .{ .num = fps, .den = 1 };
+        e.*.gop_size = 5;
+        e.*.max_b_frames = 0;
+        if (c.avcodec_open2(e, codec, null) < 0) {
+            return error.EncoderUnavailable;
+        }
+
+        const f = self.frame;
+        f.*.format = c.AV_PIX_FMT_YUV420P;
+        f.*.width = width;
+        f.*.height = height;
+        if (c.av_frame_get_buffer(f, 0) < 0) {
+            return error.OutOfMemory;
+        }
+        for (0..3) |plane| {
+            const rows: usize = if (plane == 0) height else height / 2;
+            const bytes = @as(usize, @intCast(f.*.linesize[plane])) * rows;
+            @memset(f.*.data[plane][0..bytes], 128);
+        }
+
+        var url_buf: [64]u8 = undefined;
+        const target = try std.fmt.bufPrintZ(&url_buf, "udp://127.0.0.1:{d}?pkt_size=1316", .{self.port});
+        if (c.avformat_alloc_output_context2(&self.output, null, "mpegts", target.ptr) < 0 or self.output == null) {
+            return error.MuxerUnavailable;
+        }
+        self.stream = c.avformat_new_stream(self.output, null);
+        if (self.stream == null or c.avcodec_parameters_from_context(self.stream.*.codecpar, e) < 0) {
+            return error.OutOfMemory;
+        }
+        self.stream.*.time_base = e.*.time_base;
+        if (c.avio_open2(&self.output.*.pb, target.ptr, c.AVIO_FLAG_WRITE, null, null) < 0) {
+            return error.ConnectFailed;
+        }
+        self.output.*.flags |= c.AVFMT_FLAG_FLUSH_PACKETS;
+        if (c.avformat_write_header(self.output, null) < 0) {
+            return error.MuxerUnavailable;
+        }
+    }
+
+    fn release(self: *TestLiveSender) void {
+        if (self.output != null) {
+            if (self.output.*.pb != null) {
+                _ = c.avio_closep(&self.output.*.pb);
+            }
+            c.avformat_free_context(self.output);
+        }
+        c.av_packet_free(&self.packet);
+        c.av_frame_free(&self.frame);
+        c.avcodec_free_context(&self.encoder);
+        self.allocator.destroy(self);
+    }
+
+    fn run(self: *TestLiveSender) void {
+        const frame_ns: i128 = std.time.ns_per_s / fps;
+        const started = std.time.nanoTimestamp();
+        var index: i64 = 0;
+        while (index < max_frames and !self.stopping.load(.acquire)) : (index += 1) {
+            self.frame.*.pts = index;
+            if (c.avcodec_send_frame(self.encoder, self.frame) < 0) {
+                return;
+            }
+            while (c.avcodec_receive_packet(self.encoder, self.packet) == 0) {
+                c.av_packet_rescale_ts(self.packet, self.encoder.*.time_base, self.stream.*.time_base);
+                self.packet.*.stream_index = self.stream.*.index;
+                if (c.av_interleaved_write_frame(self.output, self.packet) < 0) {
+                    return;
+                }
+            }
+
+            const due = started + @as(i128, index + 1) * frame_ns;
+            const now = std.time.nanoTimestamp();
+            if (due > now) {
+                std.Thread.sleep(@intCast(due - now));
+            }
+        }
+    }
+};
@@ -1,72 +1,1431 @@
 const std = @import("std");
+const KeyframeIndex = @import("KeyframeIndex.zig").KeyframeIndex;
+const SegmentPrefetcherMod = @import("SegmentPrefetcher.zig");
+const SegmentPrefetcher = SegmentPrefetcherMod.SegmentPrefetcher;
+const BitrateSelector = @import("BitrateSelector.zig");
+const ImageSequence = @import("ImageSequence.zig");
+const SequenceReader = ImageSequence.SequenceReader;
+const test_sender = @import("TestLiveSender.zig");
 const c = @cImport({
     @cInclude("player/demuxer.h");
 });
 
+// Each packet queue is a single-producer/single-consumer ring: the demux thread
+// is the only writer of `tail`, the owning decode thread the only writer of
+// `head`. The demuxer mutex is only taken by a side that has to sleep (empty
+// or full ring) and by the opposite side when it sees the sleeper's flag.
+//
+// The demux thread lives for the whole session. Seeks are posted to it under
+// the mutex (`seek_target`, `seek_pending`) and bump `seek_generation`; every
+// queued packet carries the generation the demux thread was on when it read
+// it, and consumers drop packets from older generations. `eof` holds the
+// generation it was reached on plus one, so a stale EOF never ends playback
+// after a seek.
+//
+// Track selection has two views. `video_stream*`/`audio_stream*` are what the
+// decoders consume and change under the mutex; `routed_*` are the demux
+// thread's copies, refreshed together with `AVStream.discard` whenever it
+// applies a seek, since only the thread reading `fmt_ctx` may touch them.
+// A track switch is therefore a seek that carries a new selection.
+//
+// HLS and DASH renditions of the same content appear as parallel streams.
+// Adaptive bitrate switches between them on the demux thread without a seek:
+// the target rendition is un-discarded, read alongside the current one, and
+// routed from its first keyframe past the last routed video packet.
+//
+// Live sources are read for latency rather than smoothness: a minimal probe,
+// no demuxer-side buffering, short rings, and no rewinding. The demux thread
+// stamps the newest routed pts with its arrival time (`live_edge_*`, under the
+// mutex) so the player can tell how far behind the live edge it presents.
+
+const default_video_limits = c.DemuxerQueueLimits{
+    .max_bytes = 64 * 1024 * 1024,
+    .max_duration = 4.0,
+    .low_watermark = 0.75,
+};
+
+const default_audio_limits = c.DemuxerQueueLimits{
+    .max_bytes = 4 * 1024 * 1024,
+    .max_duration = 4.0,
+    .low_watermark = 0.75,
+};
+
+// Byte and duration counters live in SDL_AtomicInt, so budgets stay well below
+// the 32-bit range.
+const max_limit_bytes: i64 = 1024 * 1024 * 1024;
+const max_limit_seconds: f64 = 600.0;
+const max_packet_duration_us: i64 = 10 * std.time.us_per_s;
+
+// A full ring may grow to this multiple of its budgets while the other stream's
+// decoder is starved, which is what badly interleaved files need to reach the
+// starving stream's next packets. The ceilings keep the counters in range.
+const starvation_overflow_factor = 4;
+const max_overflow_bytes: i64 = std.math.maxInt(i32) / 2;
+const max_overflow_seconds: f64 = 1800.0;
+
 fn capacity() c_int {
     return c.DEMUXER_PACKET_QUEUE_CAPACITY;
 }
 
-fn queueClear(queue: *c.DemuxerPacketQueue) void {
-    while (queue.count > 0) {
-        const head_idx: usize = @intCast(queue.head);
-        const packet = queue.packets[head_idx];
-        queue.packets[head_idx] = null;
-        queue.head = @mod(queue.head + 1, capacity());
-        queue.count -= 1;
+fn sanitizeQueueLimits(limits: c.DemuxerQueueLimits, fallback: c.DemuxerQueueLimits) c.DemuxerQueueLimits {
+    var out = limits;
+    if (out.max_bytes <= 0) {
+        out.max_bytes = fallback.max_bytes;
+    }
+    out.max_bytes = @min(out.max_bytes, max_limit_bytes);
+
+    if (!(out.max_duration > 0.0)) {
+        out.max_duration = fallback.max_duration;
+    }
+    out.max_duration = @min(out.max_duration, max_limit_seconds);
+
+    if (!(out.low_watermark > 0.0 and out.low_watermark <= 1.0)) {
+        out.low_watermark = fallback.low_watermark;
+    }
+    out.low_watermark = @max(out.low_watermark, 0.1);
+    return out;
+}
+
+fn parseQueueLimits(value: []const u8, fallback: c.DemuxerQueueLimits) c.DemuxerQueueLimits {
+    var limits = fallback;
+    var parts = std.mem.splitScalar(u8, value, ',');
+
+    if (parts.next()) |megabytes_text| {
+        const megabytes = std.fmt.parseFloat(f64, std.mem.trim(u8, megabytes_text, " ")) catch 0.0;
+        if (megabytes > 0.0) {
+            const bytes = @min(megabytes * 1024.0 * 1024.0, @as(f64, @floatFromInt(max_limit_bytes)));
+            limits.max_bytes = @intFromFloat(bytes);
+        }
+    }
+
+    if (parts.next()) |seconds_text| {
+        const seconds = std.fmt.parseFloat(f64, std.mem.trim(u8, seconds_text, " ")) catch 0.0;
+        if (seconds > 0.0) {
+            limits.max_duration = seconds;
+        }
+    }
+
+    if (parts.next()) |watermark_text| {
+        const watermark = std.fmt.parseFloat(f64, std.mem.trim(u8, watermark_text, " ")) catch 0.0;
+        if (watermark > 0.0 and watermark <= 1.0) {
+            limits.low_watermark = watermark;
+        }
+    }
+
+    return sanitizeQueueLimits(limits, fallback);
+}
+
+fn queueLimitsFromEnvironment(name: []const u8, fallback: c.DemuxerQueueLimits) c.DemuxerQueueLimits {
+    const value = std.process.getEnvVarOwned(std.heap.page_allocator, name) catch return fallback;
+    defer std.heap.page_allocator.free(value);
+    return parseQueueLimits(value, fallback);
+}
+
+fn packetDurationUs(stream: ?*c.AVStream, packet: *const c.AVPacket) c_int {
+    const s = stream orelse return 0;
+
+    var duration_us: i64 = 0;
+    if (packet.duration > 0) {
+        duration_us = c.av_rescale_q(packet.duration, s.*.time_base, c.AVRational{ .num = 1, .den = c.AV_TIME_BASE });
+    } else if (s.*.avg_frame_rate.num > 0 and s.*.avg_frame_rate.den > 0) {
+        duration_us = @divTrunc(@as(i64, s.*.avg_frame_rate.den) * c.AV_TIME_BASE, s.*.avg_frame_rate.num);
+    }
+
+    return @intCast(std.math.clamp(duration_us, 0, max_packet_duration_us));
+}
+
+fn slotIndex(position: c_int) usize {
+    const wrapped: u32 = @bitCast(position);
+    return @as(usize, wrapped) % @as(usize, @intCast(capacity()));
+}
+
+fn queueCount(queue: *c.DemuxerPacketQueue) c_int {
+    const tail = c.SDL_GetAtomicInt(&queue.tail);
+    const head = c.SDL_GetAtomicInt(&queue.head);
+    return tail -% head;
+}
+
+fn queueBytes(queue: *c.DemuxerPacketQueue) i64 {
+    return @max(c.SDL_GetAtomicInt(&queue.bytes), 0);
+}
+
+fn queueDuration(queue: *c.DemuxerPacketQueue) f64 {
+    const duration_us = @max(c.SDL_GetAtomicInt(&queue.duration_us), 0);
+    return @as(f64, @floatFromInt(duration_us)) / @as(f64, @floatFromInt(std.time.us_per_s));
+}
+
+fn queueFill(queue: *c.DemuxerPacketQueue) f64 {
+    const limits = queue.limits;
+    var fill = @as(f64, @floatFromInt(queueCount(queue))) / @as(f64, @floatFromInt(capacity()));
+    if (limits.max_bytes > 0) {
+        fill = @max(fill, @as(f64, @floatFromInt(queueBytes(queue))) / @as(f64, @floatFromInt(limits.max_bytes)));
+    }
+    if (limits.max_duration > 0.0) {
+        fill = @max(fill, queueDuration(queue) / limits.max_duration);
+    }
+    return fill;
+}
+
+// The producer stops at the high watermark (any budget reached) and resumes
+// only once every budget has drained below `low_watermark` of its limit, so a
+// saturated ring does not bounce the demux thread awake on every pop.
+fn queueAboveHighWatermark(queue: *c.DemuxerPacketQueue) bool {
+    const count = queueCount(queue);
+    if (count >= capacity()) {
+        return true;
+    }
+    if (count == 0) {
+        return false;
+    }
+
+    const limits = queue.limits;
+    if (limits.max_bytes > 0 and queueBytes(queue) >= limits.max_bytes) {
+        return true;
+    }
+    return limits.max_duration > 0.0 and queueDuration(queue) >= limits.max_duration;
+}
+
+fn queueBelowLowWatermark(queue: *c.DemuxerPacketQueue) bool {
+    const count = queueCount(queue);
+    if (count == 0) {
+        return true;
+    }
+    if (count >= capacity()) {
+        return false;
+    }
+
+    const limits = queue.limits;
+    if (limits.max_bytes > 0 and @as(f64, @floatFromInt(queueBytes(queue))) >= @as(f64, @floatFromInt(limits.max_bytes)) * limits.low_watermark) {
+        return false;
+    }
+    return !(limits.max_duration > 0.0 and queueDuration(queue) >= limits.max_duration * limits.low_watermark);
+}
+
+fn queueBelowOverflowCeiling(queue: *c.DemuxerPacketQueue) bool {
+    if (queueCount(queue) >= capacity()) {
+        return false;
+    }
+
+    const limits = queue.limits;
+    if (limits.max_bytes > 0 and queueBytes(queue) >= @min(limits.max_bytes * starvation_overflow_factor, max_overflow_bytes)) {
+        return false;
+    }
+    return !(limits.max_duration > 0.0 and queueDuration(queue) >= @min(limits.max_duration * starvation_overflow_factor, max_overflow_seconds));
+}
+
+fn queueReset(queue: *c.DemuxerPacketQueue) void {
+    _ = c.SDL_SetAtomicInt(&queue.head, 0);
+    _ = c.SDL_SetAtomicInt(&queue.tail, 0);
+    _ = c.SDL_SetAtomicInt(&queue.bytes, 0);
+    _ = c.SDL_SetAtomicInt(&queue.duration_us, 0);
+    _ = c.SDL_SetAtomicInt(&queue.consumer_waiting, 0);
+    _ = c.SDL_SetAtomicInt(&queue.producer_waiting, 0);
+    queue.overflowing = 0;
+}
+
+// Ring slots own their AVPacket shells for the lifetime of the demuxer: the
+// consumer moves the payload out and leaves the blank shell in place, and the
+// producer moves the next payload into it once `head` has released the slot.
+// Steady-state demuxing therefore allocates no packet structs or buffer refs.
+fn queueClear(queue: *c.DemuxerPacketQueue) void {
+    var head = c.SDL_GetAtomicInt(&queue.head);
+    const tail = c.SDL_GetAtomicInt(&queue.tail);
+    while (head != tail) : (head +%= 1) {
+        const packet = queue.packets[slotIndex(head)];
+        if (packet != null) {
+            c.av_packet_unref(packet);
+        }
+    }
+
+    queueReset(queue);
+}
+
+fn queueRelease(queue: *c.DemuxerPacketQueue) void {
+    queueClear(queue);
+
+    for (&queue.packets) |*slot| {
+        if (slot.* != null) {
+            c.av_packet_free(slot);
+        }
+    }
+    queue.packet_shells = 0;
+}
+
+fn queuePush(queue: *c.DemuxerPacketQueue, src_packet: *c.AVPacket, duration_us: c_int, generation: c_int) c_int {
+    const tail = c.SDL_GetAtomicInt(&queue.tail);
+    const head = c.SDL_GetAtomicInt(&queue.head);
+    if (tail -% head >= capacity()) {
+        return -1;
+    }
+
+    const idx = slotIndex(tail);
+    if (queue.packets[idx] == null) {
+        queue.packets[idx] = c.av_packet_alloc();
+        if (queue.packets[idx] == null) {
+            return -1;
+        }
+        queue.packet_shells += 1;
+    }
+
+    if (c.av_packet_make_refcounted(src_packet) < 0) {
+        return -1;
+    }
+
+    const packet = queue.packets[idx];
+    c.av_packet_move_ref(packet, src_packet);
+    queue.durations_us[idx] = duration_us;
+    queue.generations[idx] = generation;
+    _ = c.SDL_AddAtomicInt(&queue.bytes, packet.*.size);
+    _ = c.SDL_AddAtomicInt(&queue.duration_us, duration_us);
+    _ = c.SDL_SetAtomicInt(&queue.tail, tail +% 1);
+    return 0;
+}
+
+fn queuePop(queue: *c.DemuxerPacketQueue, dst_packet: *c.AVPacket) c_int {
+    const head = c.SDL_GetAtomicInt(&queue.head);
+    const tail = c.SDL_GetAtomicInt(&queue.tail);
+    if (head == tail) {
+        return -1;
+    }
+
+    const idx = slotIndex(head);
+    const packet = queue.packets[idx];
+    const duration_us = queue.durations_us[idx];
+
+    if (packet == null) {
+        _ = c.SDL_SetAtomicInt(&queue.head, head +% 1);
+        return -1;
+    }
+
+    const size = packet.*.size;
+    c.av_packet_move_ref(dst_packet, packet);
+    _ = c.SDL_SetAtomicInt(&queue.head, head +% 1);
+
+    _ = c.SDL_AddAtomicInt(&queue.bytes, -size);
+    _ = c.SDL_AddAtomicInt(&queue.duration_us, -duration_us);
+    return 0;
+}
+
+fn queueHeadGeneration(queue: *c.DemuxerPacketQueue) c_int {
+    return queue.generations[slotIndex(c.SDL_GetAtomicInt(&queue.head))];
+}
+
+fn markEof(demuxer: *c.Demuxer) void {
+    _ = c.SDL_SetAtomicInt(&demuxer.eof, c.SDL_GetAtomicInt(&demuxer.demux_generation) +% 1);
+}
+
+fn reachedEof(demuxer: *c.Demuxer, generation: c_int) bool {
+    return c.SDL_GetAtomicInt(&demuxer.eof) == generation +% 1;
+}
+
+fn wakeAll(demuxer: *c.Demuxer) void {
+    if (demuxer.mutex == null) {
+        return;
+    }
+
+    _ = c.SDL_LockMutex(demuxer.mutex);
+    if (demuxer.can_read_video != null) {
+        _ = c.SDL_BroadcastCondition(demuxer.can_read_video);
+    }
+    if (demuxer.can_read_audio != null) {
+        _ = c.SDL_BroadcastCondition(demuxer.can_read_audio);
+    }
+    if (demuxer.can_write != null) {
+        _ = c.SDL_BroadcastCondition(demuxer.can_write);
+    }
+    _ = c.SDL_UnlockMutex(demuxer.mutex);
+}
+
+fn wakeConsumer(demuxer: *c.Demuxer, queue: *c.DemuxerPacketQueue, can_read: ?*c.SDL_Condition) void {
+    if (c.SDL_GetAtomicInt(&queue.consumer_waiting) == 0 or can_read == null) {
+        return;
+    }
+
+    _ = c.SDL_LockMutex(demuxer.mutex);
+    _ = c.SDL_SignalCondition(can_read);
+    _ = c.SDL_UnlockMutex(demuxer.mutex);
+}
+
+fn wakeProducer(demuxer: *c.Demuxer, queue: *c.DemuxerPacketQueue) void {
+    if (c.SDL_GetAtomicInt(&queue.producer_waiting) == 0 or demuxer.can_write == null) {
+        return;
+    }
+
+    if (!queueBelowLowWatermark(queue)) {
+        return;
+    }
+
+    _ = c.SDL_LockMutex(demuxer.mutex);
+    _ = c.SDL_SignalCondition(demuxer.can_write);
+    _ = c.SDL_UnlockMutex(demuxer.mutex);
+}
+
+const WaitResult = enum {
+    ready,
+    stop,
+    seek,
+};
+
+fn producerInterrupted(demuxer: *c.Demuxer) ?WaitResult {
+    if (c.SDL_GetAtomicInt(&demuxer.stop_requested) != 0) {
+        return .stop;
+    }
+    if (c.SDL_GetAtomicInt(&demuxer.seek_pending) != 0) {
+        return .seek;
+    }
+    return null;
+}
+
+fn otherQueue(demuxer: *c.Demuxer, queue: *c.DemuxerPacketQueue) ?*c.DemuxerPacketQueue {
+    if (queue == &demuxer.video_queue) {
+        return if (demuxer.routed_audio_stream_index >= 0) &demuxer.audio_queue else null;
+    }
+    return if (demuxer.routed_video_stream_index >= 0) &demuxer.video_queue else null;
+}
+
+// A decoder is starving when it sleeps on an empty ring. Blocking on the full
+// ring then deadlocks playback until the other decoder drains it, which on a
+// poorly interleaved file it cannot do without the starved stream's packets.
+fn starvationOverflowAllowed(demuxer: *c.Demuxer, queue: *c.DemuxerPacketQueue) bool {
+    const other = otherQueue(demuxer, queue) orelse return false;
+    if (queueCount(other) != 0 or c.SDL_GetAtomicInt(&other.consumer_waiting) == 0) {
+        return false;
+    }
+    return queueBelowOverflowCeiling(queue);
+}
+
+fn noteStarvationOverflow(queue: *c.DemuxerPacketQueue) void {
+    if (queue.overflowing == 0) {
+        queue.overflowing = 1;
+        queue.starvation_overflows += 1;
+    }
+}
+
+fn waitForSpace(demuxer: *c.Demuxer, queue: *c.DemuxerPacketQueue) WaitResult {
+    if (!queueAboveHighWatermark(queue)) {
+        queue.overflowing = 0;
+        return producerInterrupted(demuxer) orelse .ready;
+    }
+
+    if (starvationOverflowAllowed(demuxer, queue)) {
+        noteStarvationOverflow(queue);
+        return producerInterrupted(demuxer) orelse .ready;
+    }
+
+    _ = c.SDL_LockMutex(demuxer.mutex);
+    _ = c.SDL_SetAtomicInt(&queue.producer_waiting, 1);
+    while (producerInterrupted(demuxer) == null and
+        !queueBelowLowWatermark(queue) and
+        !starvationOverflowAllowed(demuxer, queue))
+    {
+        _ = c.SDL_WaitCondition(demuxer.can_write, demuxer.mutex);
+    }
+    _ = c.SDL_SetAtomicInt(&queue.producer_waiting, 0);
+    const starved = !queueBelowLowWatermark(queue);
+    _ = c.SDL_UnlockMutex(demuxer.mutex);
+
+    if (producerInterrupted(demuxer)) |result| {
+        return result;
+    }
+    if (starved) {
+        noteStarvationOverflow(queue);
+    } else {
+        queue.overflowing = 0;
+    }
+    return .ready;
+}
+
+// Parks the demux thread after EOF until a seek or stop arrives. Both are
+// posted under the mutex together with a `can_write` broadcast.
+fn waitForSeekOrStop(demuxer: *c.Demuxer) void {
+    _ = c.SDL_LockMutex(demuxer.mutex);
+    while (producerInterrupted(demuxer) == null) {
+        _ = c.SDL_WaitCondition(demuxer.can_write, demuxer.mutex);
+    }
+    _ = c.SDL_UnlockMutex(demuxer.mutex);
+}
+
+fn routedStream(demuxer: *c.Demuxer, stream_index: c_int) ?*c.AVStream {
+    if (demuxer.fmt_ctx == null or stream_index < 0 or stream_index >= demuxer.fmt_ctx.*.nb_streams) {
+        return null;
+    }
+    return demuxer.fmt_ctx.*.streams[@intCast(stream_index)];
+}
+
+// Only the thread reading from `fmt_ctx` may call this: the demux thread, or
+// the caller while no demux thread runs. Unselected streams are discarded
+// inside libavformat, so their packets are never read into memory.
+fn applyTrackRouting(demuxer: *c.Demuxer, video_index: c_int, audio_index: c_int) void {
+    demuxer.routed_video_stream_index = video_index;
+    demuxer.routed_audio_stream_index = audio_index;
+    if (demuxer.fmt_ctx == null) {
+        return;
+    }
+
+    var i: c_uint = 0;
+    while (i < demuxer.fmt_ctx.*.nb_streams) : (i += 1) {
+        const stream = demuxer.fmt_ctx.*.streams[i];
+        if (stream == null) {
+            continue;
+        }
+        const index: c_int = @intCast(i);
+        stream.*.discard = if (index == video_index or index == audio_index) c.AVDISCARD_DEFAULT else c.AVDISCARD_ALL;
+    }
+}
+
+fn seekFormatContext(d: *c.Demuxer, target_seconds: f64) c_int {
+    const target_ts: i64 = @intFromFloat(target_seconds * @as(f64, @floatFromInt(c.AV_TIME_BASE)));
+    var seek_ret: c_int = -1;
+    if (keyframeIndexFrom(d)) |index| {
+        // Indexed offsets only hold while the indexed video track is read.
+        if (@as(c_int, @intCast(index.stream_index)) == d.routed_video_stream_index) {
+            if (index.seekOffset(target_ts)) |pos| {
+                seek_ret = c.av_seek_frame(d.fmt_ctx, -1, pos, c.AVSEEK_FLAG_BYTE);
+            }
+        }
+    }
+    if (seek_ret < 0) {
+        seek_ret = c.avformat_seek_file(d.fmt_ctx, -1, std.math.minInt(i64), target_ts, std.math.maxInt(i64), c.AVSEEK_FLAG_BACKWARD);
+    }
+    if (seek_ret < 0) {
+        seek_ret = c.av_seek_frame(d.fmt_ctx, -1, target_ts, c.AVSEEK_FLAG_BACKWARD);
+    }
+    if (seek_ret >= 0) {
+        _ = c.avformat_flush(d.fmt_ctx);
+    }
+    return seek_ret;
+}
+
+fn sourceSeekable(d: *c.Demuxer) bool {
+    if (d.live != 0) {
+        return false;
+    }
+    const pb = d.fmt_ctx.*.pb;
+    return pb == null or (pb.*.seekable & c.AVIO_SEEKABLE_NORMAL) != 0;
+}
+
+// A pipe cannot jump, so it keeps reading and drops packets until the first
+// video keyframe at or after the target, or the first audio packet there when
+// no video is routed. A target behind the read position resumes at the next
+// keyframe.
+fn seekSource(d: *c.Demuxer, target_seconds: f64) c_int {
+    d.skip_forward = 0;
+    if (sourceSeekable(d)) {
+        return seekFormatContext(d, target_seconds);
+    }
+    d.skip_target_us = @intFromFloat(target_seconds * @as(f64, @floatFromInt(c.AV_TIME_BASE)));
+    d.skip_forward = 1;
+    return 0;
+}
+
+fn reachedSkipTarget(demuxer: *c.Demuxer, video: bool, stream: ?*c.AVStream, packet: *const c.AVPacket) bool {
+    if (video and (packet.flags & c.AV_PKT_FLAG_KEY) == 0) {
+        return false;
+    }
+    if (!video and demuxer.routed_video_stream_index >= 0) {
+        return false;
+    }
+    const s = stream orelse return false;
+    const pts_us = packetTimestampUs(s, packet) orelse return false;
+    if (pts_us < demuxer.skip_target_us) {
+        return false;
+    }
+    demuxer.skip_forward = 0;
+    return true;
+}
+
+// Consumer-side counterpart of `skip_forward` for a video decoder that has
+// fallen hopelessly behind: queued packets are dropped as they are popped, up
+// to the first keyframe at or after the target. A seek ends the catch-up.
+fn skipForCatchUp(demuxer: *c.Demuxer, generation: c_int, packet: *const c.AVPacket) bool {
+    if (demuxer.video_catch_up == 0) {
+        return false;
+    }
+    if (generation != demuxer.video_catch_up_generation) {
+        demuxer.video_catch_up = 0;
+        return false;
+    }
+    if ((packet.flags & c.AV_PKT_FLAG_KEY) != 0) {
+        const stream = demuxer.video_stream orelse return false;
+        const pts_us = packetTimestampUs(stream, packet) orelse return true;
+        if (pts_us >= demuxer.video_catch_up_us) {
+            demuxer.video_catch_up = 0;
+            return false;
+        }
+    }
+    return true;
+}
+
+// Serves the seek from the packet cache when the selection is unchanged and
+// the target lies inside the cached range; otherwise drops the cache, applies
+// the selection and leaves the file seek to the caller.
+fn seekFromPacketCache(demuxer: *c.Demuxer, target_seconds: f64, video_index: c_int, audio_index: c_int) bool {
+    const routing_changed = video_index != demuxer.routed_video_stream_index or audio_index != demuxer.routed_audio_stream_index;
+    applyTrackRouting(demuxer, video_index, audio_index);
+    demuxer.skip_forward = 0;
+
+    const cache = packetCacheFrom(demuxer) orelse return false;
+    const target_us: i64 = @intFromFloat(target_seconds * @as(f64, @floatFromInt(c.AV_TIME_BASE)));
+    if (!routing_changed and cache.beginReplay(target_us)) {
+        return true;
+    }
+    cache.clear();
+    return false;
+}
+
+// Under the mutex, so a reader never pairs one seek's generation with
+// another's result. A failed seek also records where reading goes on: just
+// past the newest packet queued before it.
+fn noteSeekResult(demuxer: *c.Demuxer, generation: c_int, result: c_int) void {
+    _ = c.SDL_LockMutex(demuxer.mutex);
+    demuxer.seek_result_generation = generation;
+    demuxer.seek_result = if (result < 0) -1 else 0;
+    if (result < 0) {
+        demuxer.seek_resume_time = @as(f64, @floatFromInt(demuxer.read_position_us)) / @as(f64, @floatFromInt(c.AV_TIME_BASE));
+    }
+    _ = c.SDL_UnlockMutex(demuxer.mutex);
+}
+
+// Runs on the demux thread. Requests that arrive while the seek is in
+// progress leave `seek_pending` set, so rapid scrubbing collapses into one
+// seek per loop iteration to the latest target.
+fn applyPendingSeek(demuxer: *c.Demuxer) void {
+    _ = c.SDL_LockMutex(demuxer.mutex);
+    const target_seconds = demuxer.seek_target;
+    const generation = c.SDL_GetAtomicInt(&demuxer.seek_generation);
+    const video_index = demuxer.video_stream_index;
+    const audio_index = demuxer.audio_stream_index;
+    _ = c.SDL_SetAtomicInt(&demuxer.seek_pending, 0);
+    _ = c.SDL_UnlockMutex(demuxer.mutex);
+
+    resetAbrForSeek(demuxer);
+    const target_us: i64 = @intFromFloat(target_seconds * @as(f64, @floatFromInt(c.AV_TIME_BASE)));
+    if (seekFromPacketCache(demuxer, target_seconds, video_index, audio_index)) {
+        demuxer.read_position_us = target_us;
+        noteSeekResult(demuxer, generation, 0);
+        _ = c.SDL_SetAtomicInt(&demuxer.demux_generation, generation);
+        return;
+    }
+
+    // A failed seek keeps reading from the current position, which still
+    // beats stalling both decoders; the player learns of it through
+    // `demuxer_get_seek_result`.
+    const result = seekSource(demuxer, target_seconds);
+    if (result >= 0) {
+        demuxer.read_position_us = target_us;
+    }
+    noteSeekResult(demuxer, generation, result);
+    _ = c.SDL_SetAtomicInt(&demuxer.demux_generation, generation);
+}
+
+// Consumer-side drop of queued packets older than `generation`; only valid
+// while the caller holds the consumer role for the ring. The demux thread may
+// already be pushing the new generation behind them, which is kept.
+fn queueDiscardStale(demuxer: *c.Demuxer, queue: *c.DemuxerPacketQueue, generation: c_int) void {
+    var packet = std.mem.zeroes(c.AVPacket);
+    while (queueCount(queue) > 0 and queueHeadGeneration(queue) != generation) {
+        if (queuePop(queue, &packet) != 0) {
+            break;
+        }
+        c.av_packet_unref(&packet);
+    }
+    wakeProducer(demuxer, queue);
+}
+
+const KeyframeIndexMode = enum {
+    off,
+    lazy,
+    scan,
+};
+
+fn parseKeyframeIndexMode(value: []const u8) KeyframeIndexMode {
+    const trimmed = std.mem.trim(u8, value, " ");
+    if (std.ascii.eqlIgnoreCase(trimmed, "off") or std.mem.eql(u8, trimmed, "0")) {
+        return .off;
+    }
+    if (std.ascii.eqlIgnoreCase(trimmed, "scan")) {
+        return .scan;
+    }
+    return .lazy;
+}
+
+fn keyframeIndexModeFromEnvironment() KeyframeIndexMode {
+    const value = std.process.getEnvVarOwned(std.heap.page_allocator, "ZC_KEYFRAME_INDEX") catch return .lazy;
+    defer std.heap.page_allocator.free(value);
+    return parseKeyframeIndexMode(value);
+}
+
+fn keyframeIndexFrom(demuxer: *c.Demuxer) ?*KeyframeIndex {
+    const ptr = demuxer.keyframe_index orelse return null;
+    return @ptrCast(@alignCast(ptr));
+}
+
+// Byte-offset seeks only help containers that have no index of their own:
+// MPEG-TS and the raw elementary streams libavformat indexes generically.
+// The entry count is no signal, since MP4 and Matroska load theirs lazily
+// from the end of the file.
+fn keyframeIndexFormat(iformat: *const c.AVInputFormat) bool {
+    if ((iformat.flags & c.AVFMT_NO_BYTE_SEEK) != 0) {
+        return false;
+    }
+    return (iformat.flags & c.AVFMT_GENERIC_INDEX) != 0 or std.mem.eql(u8, std.mem.span(iformat.name), "mpegts");
+}
+
+fn keyframeIndexEligible(demuxer: *c.Demuxer) bool {
+    if (demuxer.fmt_ctx == null or demuxer.video_stream == null) {
+        return false;
+    }
+
+    const iformat = demuxer.fmt_ctx.*.iformat;
+    return iformat != null and keyframeIndexFormat(iformat);
+}
+
+fn packetTimestampUs(stream: *const c.AVStream, packet: *const c.AVPacket) ?i64 {
+    const ts = if (packet.pts != c.AV_NOPTS_VALUE) packet.pts else packet.dts;
+    if (ts == c.AV_NOPTS_VALUE) {
+        return null;
+    }
+    return c.av_rescale_q(ts, stream.time_base, c.AVRational{ .num = 1, .den = c.AV_TIME_BASE });
+}
+
+fn keyframeTimestampUs(stream: *const c.AVStream, packet: *const c.AVPacket) ?i64 {
+    if ((packet.flags & c.AV_PKT_FLAG_KEY) == 0 or packet.pos < 0) {
+        return null;
+    }
+    return packetTimestampUs(stream, packet);
+}
+
+fn recordKeyframe(demuxer: *c.Demuxer, stream: *const c.AVStream, packet: *const c.AVPacket) void {
+    const index = keyframeIndexFrom(demuxer) orelse return;
+    if (packet.stream_index != @as(c_int, @intCast(index.stream_index))) {
+        return;
+    }
+    if (keyframeTimestampUs(stream, packet)) |pts_us| {
+        index.insert(pts_us, packet.pos);
+    }
+}
+
+fn keyframeScanThreadMain(userdata: ?*anyopaque) callconv(.c) c_int {
+    if (userdata == null) {
+        return -1;
+    }
+
+    const demuxer: *c.Demuxer = @ptrCast(@alignCast(userdata.?));
+    const index = keyframeIndexFrom(demuxer) orelse return -1;
+    _ = c.SDL_SetCurrentThreadPriority(c.SDL_THREAD_PRIORITY_LOW);
+
+    const path = std.heap.page_allocator.dupeZ(u8, index.media_path) catch return -1;
+    defer std.heap.page_allocator.free(path);
+
+    var fmt_ctx: [*c]c.AVFormatContext = null;
+    if (c.avformat_open_input(&fmt_ctx, path.ptr, null, null) != 0) {
+        return -1;
+    }
+    defer c.avformat_close_input(&fmt_ctx);
+
+    if (c.avformat_find_stream_info(fmt_ctx, null) < 0 or index.stream_index >= fmt_ctx.*.nb_streams) {
+        return -1;
+    }
+
+    const stream = fmt_ctx.*.streams[index.stream_index];
+    if (stream == null or stream.*.codecpar == null or stream.*.codecpar.*.codec_type != c.AVMEDIA_TYPE_VIDEO) {
+        return -1;
+    }
+
+    var i: c_uint = 0;
+    while (i < fmt_ctx.*.nb_streams) : (i += 1) {
+        if (i != index.stream_index) {
+            fmt_ctx.*.streams[i].*.discard = c.AVDISCARD_ALL;
+        }
+    }
+
+    var packet = c.av_packet_alloc();
+    if (packet == null) {
+        return -1;
+    }
+    defer c.av_packet_free(&packet);
+
+    while (c.SDL_GetAtomicInt(&demuxer.index_scan_stop) == 0) {
+        const ret = c.av_read_frame(fmt_ctx, packet);
+        if (ret == c.AVERROR_EOF) {
+            index.markComplete();
+            break;
+        }
+        if (ret < 0) {
+            break;
+        }
+
+        if (packet.*.stream_index == @as(c_int, @intCast(index.stream_index))) {
+            if (keyframeTimestampUs(stream, packet)) |pts_us| {
+                index.insert(pts_us, packet.*.pos);
+            }
+        }
+        c.av_packet_unref(packet);
+    }
+
+    return 0;
+}
+
+fn openKeyframeIndex(demuxer: *c.Demuxer, filepath: [*c]const u8) void {
+    const mode = keyframeIndexModeFromEnvironment();
+    if (mode == .off or demuxer.source_kind != c.DEMUXER_SOURCE_FILE or !keyframeIndexEligible(demuxer)) {
+        return;
+    }
+
+    const path: [*:0]const u8 = @ptrCast(filepath);
+    const index = KeyframeIndex.create(std.heap.page_allocator, std.mem.span(path), @intCast(demuxer.video_stream_index)) catch return;
+    if (index.sidecarPath(std.heap.page_allocator)) |sidecar| {
+        defer std.heap.page_allocator.free(sidecar);
+        index.loadFrom(sidecar) catch {};
+    } else |_| {}
+    demuxer.keyframe_index = index;
+
+    if (mode == .scan and !index.isComplete()) {
+        _ = c.SDL_SetAtomicInt(&demuxer.index_scan_stop, 0);
+        demuxer.index_thread = c.SDL_CreateThread(keyframeScanThreadMain, "keyframe_scan", demuxer);
+    }
+}
+
+fn closeKeyframeIndex(demuxer: *c.Demuxer) void {
+    if (demuxer.index_thread != null) {
+        _ = c.SDL_SetAtomicInt(&demuxer.index_scan_stop, 1);
+        c.SDL_WaitThread(demuxer.index_thread, null);
+        demuxer.index_thread = null;
+    }
+
+    const index = keyframeIndexFrom(demuxer) orelse return;
+    if (index.isDirty()) {
+        if (index.sidecarPath(std.heap.page_allocator)) |sidecar| {
+            defer std.heap.page_allocator.free(sidecar);
+            index.saveTo(sidecar) catch {};
+        } else |_| {}
+    }
+    index.destroy();
+    demuxer.keyframe_index = null;
+}
+
+// Packets the demux thread already read, kept (by reference) so that seeks
+// into the recent past replay them instead of seeking the file. The cache is
+// owned by the demux thread, always starts at a video keyframe and is
+// contiguous in read order: after replaying it to the end, the next
+// av_read_frame() continues exactly where the cache stops.
+const CachedPacket = struct {
+    packet: [*c]c.AVPacket,
+    keyframe: bool,
+    pts_us: i64,
+};
+
+const PacketCache = struct {
+    allocator: std.mem.Allocator,
+    entries: std.ArrayListUnmanaged(CachedPacket) = .{},
+    start: usize = 0,
+    bytes: i64 = 0,
+    newest_video_us: i64 = std.math.minInt(i64),
+    replay_cursor: ?usize = null,
+    window_us: i64,
+    max_bytes: i64,
+
+    fn create(allocator: std.mem.Allocator, window_us: i64, max_bytes: i64) !*PacketCache {
+        const self = try allocator.create(PacketCache);
+        self.* = .{ .allocator = allocator, .window_us = window_us, .max_bytes = max_bytes };
+        return self;
+    }
+
+    fn destroy(self: *PacketCache) void {
+        self.clear();
+        self.entries.deinit(self.allocator);
+        self.allocator.destroy(self);
+    }
+
+    fn live(self: *PacketCache) []CachedPacket {
+        return self.entries.items[self.start..];
+    }
+
+    fn clear(self: *PacketCache) void {
+        for (self.live()) |*entry| {
+            c.av_packet_free(&entry.packet);
+        }
+        self.entries.clearRetainingCapacity();
+        self.start = 0;
+        self.bytes = 0;
+        self.newest_video_us = std.math.minInt(i64);
+        self.replay_cursor = null;
+    }
+
+    /// Any packet that cannot be kept breaks contiguity, so the whole cache
+    /// is dropped rather than leaving a hole.
+    fn append(self: *PacketCache, packet: *const c.AVPacket, video: bool, pts_us: ?i64) void {
+        const keyframe = video and pts_us != null and (packet.flags & c.AV_PKT_FLAG_KEY) != 0;
+        if (self.live().len == 0 and !keyframe) {
+            return;
+        }
+
+        var copy = c.av_packet_alloc();
+        if (copy == null or c.av_packet_ref(copy, packet) < 0) {
+            c.av_packet_free(&copy);
+            self.clear();
+            return;
+        }
+
+        const ts = pts_us orelse self.newest_video_us;
+        self.entries.append(self.allocator, .{ .packet = copy, .keyframe = keyframe, .pts_us = ts }) catch {
+            c.av_packet_free(&copy);
+            self.clear();
+            return;
+        };
+        self.bytes += packet.size;
+        if (video and pts_us != null) {
+            self.newest_video_us = @max(self.newest_video_us, ts);
+        }
+        self.trim();
+    }
+
+    // Drops whole GOPs from the front while the rest still covers the window,
+    // or unconditionally while over the byte budget. A single GOP over the
+    // budget (long GOPs, intra refresh) drops everything; caching resumes at
+    // the next keyframe.
+    fn trim(self: *PacketCache) void {
+        while (true) {
+            const items = self.live();
+            var next_key: usize = 1;
+            while (next_key < items.len and !items[next_key].keyframe) : (next_key += 1) {}
+            if (next_key >= items.len) {
+                if (self.bytes > self.max_bytes) {
+                    self.clear();
+                }
+                break;
+            }
+
+            const covered_without = self.newest_video_us -| items[next_key].pts_us;
+            if (covered_without < self.window_us and self.bytes <= self.max_bytes) {
+                break;
+            }
+
+            for (items[0..next_key]) |*entry| {
+                self.bytes -= entry.packet.*.size;
+                c.av_packet_free(&entry.packet);
+            }
+            self.start += next_key;
+        }
+
+        if (self.start > 256 and self.start * 2 > self.entries.items.len) {
+            const remaining = self.entries.items.len - self.start;
+            std.mem.copyForwards(CachedPacket, self.entries.items[0..remaining], self.entries.items[self.start..]);
+            self.entries.shrinkRetainingCapacity(remaining);
+            self.start = 0;
+        }
+    }
+
+    /// Positions the replay cursor on the last keyframe at or before
+    /// `target_us`, when the cache covers the target.
+    fn beginReplay(self: *PacketCache, target_us: i64) bool {
+        const items = self.live();
+        if (items.len == 0 or target_us > self.newest_video_us or target_us < items[0].pts_us) {
+            return false;
+        }
+
+        var i = items.len;
+        while (i > 0) {
+            i -= 1;
+            if (items[i].keyframe and items[i].pts_us <= target_us) {
+                self.replay_cursor = i;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    fn takeReplay(self: *PacketCache, out: *c.AVPacket) bool {
+        const cursor = self.replay_cursor orelse return false;
+        const items = self.live();
+        if (cursor >= items.len or c.av_packet_ref(out, items[cursor].packet) < 0) {
+            self.replay_cursor = null;
+            return false;
+        }
+        self.replay_cursor = cursor + 1;
+        return true;
+    }
+};
+
+const default_back_cache_seconds: f64 = 10.0;
+const default_back_cache_bytes: i64 = 128 * 1024 * 1024;
+
+const BackCacheConfig = struct {
+    seconds: f64 = default_back_cache_seconds,
+    max_bytes: i64 = default_back_cache_bytes,
+};
+
+/// `ZC_DEMUX_BACK_CACHE=<seconds>[,<megabytes>]`; `0` or `off` disables it.
+fn parseBackCacheConfig(value: []const u8) ?BackCacheConfig {
+    const trimmed = std.mem.trim(u8, value, " ");
+    if (std.ascii.eqlIgnoreCase(trimmed, "off")) {
+        return null;
+    }
+
+    var config = BackCacheConfig{};
+    var parts = std.mem.splitScalar(u8, trimmed, ',');
+    if (parts.next()) |seconds_text| {
+        const seconds = std.fmt.parseFloat(f64, std.mem.trim(u8, seconds_text, " ")) catch default_back_cache_seconds;
+        if (!(seconds > 0.0)) {
+            return null;
+        }
+        config.seconds = @min(seconds, max_limit_seconds);
+    }
+    if (parts.next()) |megabytes_text| {
+        const megabytes = std.fmt.parseFloat(f64, std.mem.trim(u8, megabytes_text, " ")) catch 0.0;
+        if (megabytes > 0.0) {
+            config.max_bytes = @intFromFloat(@min(megabytes * 1024.0 * 1024.0, @as(f64, @floatFromInt(max_limit_bytes))));
+        }
+    }
+    return config;
+}
+
+fn backCacheConfigFromEnvironment() ?BackCacheConfig {
+    const value = std.process.getEnvVarOwned(std.heap.page_allocator, "ZC_DEMUX_BACK_CACHE") catch return BackCacheConfig{};
+    defer std.heap.page_allocator.free(value);
+    return parseBackCacheConfig(value);
+}
 
-        if (packet != null) {
-            var packet_copy = packet;
-            c.av_packet_free(&packet_copy);
+fn packetCacheFrom(demuxer: *c.Demuxer) ?*PacketCache {
+    const ptr = demuxer.packet_cache orelse return null;
+    return @ptrCast(@alignCast(ptr));
+}
+
+// The window is measured behind the playhead, which trails the demux thread's
+// read position by up to the video ring's duration budget.
+fn openPacketCache(demuxer: *c.Demuxer) void {
+    const config = backCacheConfigFromEnvironment() orelse return;
+    const window_seconds = config.seconds + demuxer.video_queue.limits.max_duration;
+    const window_us: i64 = @intFromFloat(window_seconds * @as(f64, @floatFromInt(std.time.us_per_s)));
+    const cache = PacketCache.create(std.heap.page_allocator, window_us, config.max_bytes) catch return;
+    demuxer.packet_cache = cache;
+}
+
+fn closePacketCache(demuxer: *c.Demuxer) void {
+    const cache = packetCacheFrom(demuxer) orelse return;
+    cache.destroy();
+    demuxer.packet_cache = null;
+}
+
+// Renditions are video streams that differ only in bitrate: same codec and
+// time base, so the running decoder continues across a switch.
+const max_abr_variants = 16;
+const abr_tick_ns: i128 = 500 * std.time.ns_per_ms;
+const abr_switch_timeout_ns: i128 = 10 * std.time.ns_per_s;
+const rebuffer_threshold_ns: i128 = 100 * std.time.ns_per_ms;
+
+const AbrVariant = struct {
+    video_index: c_int,
+    audio_index: c_int,
+    bitrate_bps: i64,
+};
+
+const PendingSwitch = struct {
+    target: usize,
+    started_ns: i128,
+};
+
+const AbrController = struct {
+    variants: [max_abr_variants]AbrVariant = undefined,
+    bitrates: [max_abr_variants]i64 = undefined,
+    count: usize = 0,
+    current: usize = 0,
+    pending: ?PendingSwitch = null,
+    last_switch_ns: ?i128 = null,
+    last_tick_ns: i128 = 0,
+    last_video_pts_us: ?i64 = null,
+    last_audio_pts_us: ?i64 = null,
+    // Audio of the new rendition up to here duplicates what was routed.
+    audio_floor_us: ?i64 = null,
+    // Set by a manual video track selection, which ends adaptation.
+    pinned: std.atomic.Value(bool) = std.atomic.Value(bool).init(false),
+
+    stats_mutex: std.Thread.Mutex = .{},
+    published_current: usize = 0,
+    switches: c_int = 0,
+    last_switch_latency_ms: f64 = 0.0,
+};
+
+fn abrEnabledFromEnvironment() bool {
+    const value = std.process.getEnvVarOwned(std.heap.page_allocator, "ZC_ABR") catch return true;
+    defer std.heap.page_allocator.free(value);
+    const trimmed = std.mem.trim(u8, value, " ");
+    return !(std.ascii.eqlIgnoreCase(trimmed, "off") or std.mem.eql(u8, trimmed, "0"));
+}
+
+fn segmentPrefetcherFrom(demuxer: *c.Demuxer) ?*SegmentPrefetcher {
+    const ptr = demuxer.segment_prefetcher orelse return null;
+    return @ptrCast(@alignCast(ptr));
+}
+
+fn sequenceReaderFrom(demuxer: *c.Demuxer) ?*SequenceReader {
+    const ptr = demuxer.sequence_reader orelse return null;
+    return @ptrCast(@alignCast(ptr));
+}
+
+fn abrFrom(demuxer: *c.Demuxer) ?*AbrController {
+    const ptr = demuxer.abr orelse return null;
+    return @ptrCast(@alignCast(ptr));
+}
+
+fn variantBitrate(stream: *const c.AVStream) i64 {
+    const entry = c.av_dict_get(stream.metadata, "variant_bitrate", null, 0);
+    if (entry != null and entry.*.value != null) {
+        if (std.fmt.parseInt(i64, std.mem.span(entry.*.value), 10)) |bitrate| {
+            return bitrate;
+        } else |_| {}
+    }
+    return stream.codecpar.*.bit_rate;
+}
+
+fn audioCompatible(a: *const c.AVStream, b: *const c.AVStream) bool {
+    const pa = a.codecpar.*;
+    const pb = b.codecpar.*;
+    return pa.codec_id == pb.codec_id and
+        pa.sample_rate == pb.sample_rate and
+        pa.ch_layout.nb_channels == pb.ch_layout.nb_channels and
+        c.av_cmp_q(a.time_base, b.time_base) == 0;
+}
+
+// Each rendition keeps its own audio when that is interchangeable with the
+// current one (muxed HLS variants); otherwise audio stays on its track.
+fn buildAbrLadder(demuxer: *c.Demuxer, abr: *AbrController) void {
+    if (demuxer.video_stream == null) {
+        return;
+    }
+    const reference = demuxer.video_stream;
+    var i: c_uint = 0;
+    while (i < demuxer.fmt_ctx.*.nb_streams and abr.count < max_abr_variants) : (i += 1) {
+        const stream = demuxer.fmt_ctx.*.streams[i];
+        if (stream == null or stream.*.codecpar == null) {
+            continue;
+        }
+        const par = stream.*.codecpar.*;
+        if (par.codec_type != c.AVMEDIA_TYPE_VIDEO or
+            par.codec_id != reference.*.codecpar.*.codec_id or
+            (stream.*.disposition & c.AV_DISPOSITION_ATTACHED_PIC) != 0 or
+            c.av_cmp_q(stream.*.time_base, reference.*.time_base) != 0)
+        {
+            continue;
+        }
+        const bitrate = variantBitrate(stream);
+        if (bitrate <= 0) {
+            continue;
+        }
+
+        const video_index: c_int = @intCast(i);
+        var audio_index = demuxer.audio_stream_index;
+        const related = c.av_find_best_stream(demuxer.fmt_ctx, c.AVMEDIA_TYPE_AUDIO, -1, video_index, null, 0);
+        if (demuxer.audio_stream != null and related >= 0) {
+            if (routedStream(demuxer, related)) |candidate| {
+                if (audioCompatible(candidate, demuxer.audio_stream)) {
+                    audio_index = related;
+                }
+            }
+        }
+
+        // Insertion keeps the ladder sorted by bitrate.
+        var at = abr.count;
+        while (at > 0 and abr.variants[at - 1].bitrate_bps > bitrate) : (at -= 1) {
+            abr.variants[at] = abr.variants[at - 1];
         }
+        abr.variants[at] = .{ .video_index = video_index, .audio_index = audio_index, .bitrate_bps = bitrate };
+        abr.count += 1;
+    }
+    for (abr.variants[0..abr.count], 0..) |variant, v| {
+        abr.bitrates[v] = variant.bitrate_bps;
+    }
+}
+
+// Playback starts on the lowest rendition, before any throughput is known.
+fn openAbr(demuxer: *c.Demuxer) void {
+    if (segmentPrefetcherFrom(demuxer) == null or !abrEnabledFromEnvironment()) {
+        return;
     }
+    const abr = std.heap.page_allocator.create(AbrController) catch return;
+    abr.* = .{};
+    buildAbrLadder(demuxer, abr);
+    if (abr.count < 2) {
+        std.heap.page_allocator.destroy(abr);
+        return;
+    }
+
+    const start = abr.variants[0];
+    if (routedStream(demuxer, start.video_index)) |stream| {
+        demuxer.video_stream_index = start.video_index;
+        demuxer.video_stream = stream;
+    }
+    if (routedStream(demuxer, start.audio_index)) |stream| {
+        demuxer.audio_stream_index = start.audio_index;
+        demuxer.audio_stream = stream;
+    }
+    abr.current = 0;
+    abr.published_current = 0;
+    demuxer.abr = abr;
+}
 
-    queue.head = 0;
-    queue.tail = 0;
+fn closeAbr(demuxer: *c.Demuxer) void {
+    const abr = abrFrom(demuxer) orelse return;
+    std.heap.page_allocator.destroy(abr);
+    demuxer.abr = null;
 }
 
-fn queuePush(queue: *c.DemuxerPacketQueue, src_packet: *const c.AVPacket) c_int {
-    if (queue.count >= capacity()) {
-        return -1;
+fn beginAbrSwitch(demuxer: *c.Demuxer, abr: *AbrController, target: usize, now_ns: i128) void {
+    const variant = abr.variants[target];
+    // The demuxer resumes a re-enabled rendition near the current read
+    // position, so both are read side by side until the switch commits.
+    if (routedStream(demuxer, variant.video_index)) |stream| {
+        stream.discard = c.AVDISCARD_DEFAULT;
+    }
+    if (routedStream(demuxer, variant.audio_index)) |stream| {
+        stream.discard = c.AVDISCARD_DEFAULT;
     }
+    abr.pending = .{ .target = target, .started_ns = now_ns };
+}
 
-    const packet = c.av_packet_alloc();
-    if (packet == null) {
-        return -1;
+fn abortAbrSwitch(demuxer: *c.Demuxer, abr: *AbrController) void {
+    if (abr.pending == null) {
+        return;
     }
+    abr.pending = null;
+    abr.last_switch_ns = std.time.nanoTimestamp();
+    applyTrackRouting(demuxer, demuxer.routed_video_stream_index, demuxer.routed_audio_stream_index);
+}
 
-    if (c.av_packet_ref(packet, src_packet) < 0) {
-        var packet_copy = packet;
-        c.av_packet_free(&packet_copy);
-        return -1;
+// Runs on the demux thread between reads.
+fn tickAbr(demuxer: *c.Demuxer, abr: *AbrController) void {
+    const now = std.time.nanoTimestamp();
+    if (now - abr.last_tick_ns < abr_tick_ns) {
+        return;
     }
+    abr.last_tick_ns = now;
 
-    const tail_idx: usize = @intCast(queue.tail);
-    queue.packets[tail_idx] = packet;
-    queue.tail = @mod(queue.tail + 1, capacity());
-    queue.count += 1;
-    return 0;
+    if (abr.pinned.load(.acquire)) {
+        abortAbrSwitch(demuxer, abr);
+        return;
+    }
+    if (abr.pending) |pending| {
+        if (now - pending.started_ns > abr_switch_timeout_ns) {
+            abortAbrSwitch(demuxer, abr);
+        }
+        return;
+    }
+
+    const prefetcher = segmentPrefetcherFrom(demuxer) orelse return;
+    const since_last_switch_s = if (abr.last_switch_ns) |at|
+        @as(f64, @floatFromInt(now - at)) / std.time.ns_per_s
+    else
+        std.math.inf(f64);
+    const target = BitrateSelector.selectVariant(.{}, .{
+        .bitrates_bps = abr.bitrates[0..abr.count],
+        .current = abr.current,
+        .estimate_bps = prefetcher.estimateBps(),
+        .buffer_s = queueDuration(&demuxer.video_queue) + prefetcher.bufferedSeconds(),
+        .since_last_switch_s = since_last_switch_s,
+    });
+    if (target != abr.current) {
+        beginAbrSwitch(demuxer, abr, target, now);
+    }
 }
 
-fn queuePop(queue: *c.DemuxerPacketQueue, dst_packet: *c.AVPacket) c_int {
-    if (queue.count <= 0) {
-        return -1;
+fn attachNewExtradata(stream: *const c.AVStream, packet: *c.AVPacket) void {
+    const par = stream.codecpar;
+    if (par == null or par.*.extradata == null or par.*.extradata_size <= 0) {
+        return;
+    }
+    const size: usize = @intCast(par.*.extradata_size);
+    const side = c.av_packet_new_side_data(packet, c.AV_PKT_DATA_NEW_EXTRADATA, size);
+    if (side != null) {
+        @memcpy(side[0..size], par.*.extradata[0..size]);
     }
+}
 
-    const head_idx: usize = @intCast(queue.head);
-    const packet = queue.packets[head_idx];
-    queue.packets[head_idx] = null;
-    queue.head = @mod(queue.head + 1, capacity());
-    queue.count -= 1;
+// Makes the pending rendition the selection for both views. Returns false
+// when a seek or manual selection posted meanwhile takes precedence.
+fn commitAbrSwitch(demuxer: *c.Demuxer, abr: *AbrController, pending: PendingSwitch, packet: *c.AVPacket) bool {
+    const variant = abr.variants[pending.target];
+    const video_stream = routedStream(demuxer, variant.video_index) orelse return false;
+    const audio_index = if (demuxer.routed_audio_stream_index >= 0) variant.audio_index else -1;
 
-    if (packet == null) {
-        return -1;
+    _ = c.SDL_LockMutex(demuxer.mutex);
+    if (abr.pinned.load(.acquire) or c.SDL_GetAtomicInt(&demuxer.seek_pending) != 0) {
+        _ = c.SDL_UnlockMutex(demuxer.mutex);
+        abortAbrSwitch(demuxer, abr);
+        return false;
+    }
+    demuxer.video_stream_index = variant.video_index;
+    demuxer.video_stream = video_stream;
+    if (routedStream(demuxer, audio_index)) |audio_stream| {
+        demuxer.audio_stream_index = audio_index;
+        demuxer.audio_stream = audio_stream;
     }
+    _ = c.SDL_UnlockMutex(demuxer.mutex);
 
-    c.av_packet_move_ref(dst_packet, packet);
-    var packet_copy = packet;
-    c.av_packet_free(&packet_copy);
-    return 0;
+    if (audio_index >= 0 and audio_index != demuxer.routed_audio_stream_index) {
+        abr.audio_floor_us = abr.last_audio_pts_us;
+    }
+    applyTrackRouting(demuxer, variant.video_index, if (audio_index >= 0) audio_index else demuxer.routed_audio_stream_index);
+    attachNewExtradata(video_stream, packet);
+    // Cached packets belong to the old rendition's streams.
+    if (packetCacheFrom(demuxer)) |cache| {
+        cache.clear();
+    }
+
+    const now = std.time.nanoTimestamp();
+    abr.pending = null;
+    abr.current = pending.target;
+    abr.last_switch_ns = now;
+    abr.last_video_pts_us = null;
+
+    abr.stats_mutex.lock();
+    abr.published_current = pending.target;
+    abr.switches += 1;
+    abr.last_switch_latency_ms = @as(f64, @floatFromInt(now - pending.started_ns)) / std.time.ns_per_ms;
+    abr.stats_mutex.unlock();
+    return true;
+}
+
+// Decides whether a freshly read packet continues to routing. Packets of a
+// pending rendition are dropped until its first keyframe past everything
+// already routed, which commits the switch.
+fn filterAbrPacket(demuxer: *c.Demuxer, abr: *AbrController, packet: *c.AVPacket) bool {
+    const index = packet.stream_index;
+    if (abr.pending) |pending| {
+        const variant = abr.variants[pending.target];
+        if (index == variant.video_index) {
+            const stream = routedStream(demuxer, index) orelse return false;
+            if ((packet.flags & c.AV_PKT_FLAG_KEY) == 0) {
+                return false;
+            }
+            const pts_us = packetTimestampUs(stream, packet) orelse return false;
+            if (abr.last_video_pts_us) |last| {
+                if (pts_us <= last) {
+                    return false;
+                }
+            }
+            return commitAbrSwitch(demuxer, abr, pending, packet);
+        }
+        if (index == variant.audio_index and index != demuxer.routed_audio_stream_index) {
+            return false;
+        }
+    }
+
+    if (index == demuxer.routed_video_stream_index) {
+        const stream = routedStream(demuxer, index) orelse return true;
+        if (packetTimestampUs(stream, packet)) |pts_us| {
+            abr.last_video_pts_us = if (abr.last_video_pts_us) |last| @max(last, pts_us) else pts_us;
+        }
+    } else if (index == demuxer.routed_audio_stream_index) {
+        const stream = routedStream(demuxer, index) orelse return true;
+        const pts_us = packetTimestampUs(stream, packet) orelse return true;
+        if (abr.audio_floor_us) |floor| {
+            if (pts_us <= floor) {
+                return false;
+            }
+            abr.audio_floor_us = null;
+        }
+        abr.last_audio_pts_us = pts_us;
+    }
+    return true;
+}
+
+// A seek re-reads from the new position with the consumer-side selection,
+// which already reflects every committed switch.
+fn resetAbrForSeek(demuxer: *c.Demuxer) void {
+    const abr = abrFrom(demuxer) orelse return;
+    abr.pending = null;
+    abr.last_video_pts_us = null;
+    abr.last_audio_pts_us = null;
+    abr.audio_floor_us = null;
+}
+
+// Counts video ring underruns during playback: waits long enough to be seen,
+// after the current seek generation has delivered, that ended with data.
+fn noteVideoWait(demuxer: *c.Demuxer, queue: *c.DemuxerPacketQueue, started_ns: i128) void {
+    if (queue != &demuxer.video_queue or queueCount(queue) == 0) {
+        return;
+    }
+    if (demuxer.video_delivered_generation != c.SDL_GetAtomicInt(&demuxer.seek_generation) +% 1) {
+        return;
+    }
+    if (std.time.nanoTimestamp() - started_ns >= rebuffer_threshold_ns) {
+        _ = c.SDL_AddAtomicInt(&demuxer.rebuffers, 1);
+    }
+}
+
+const live_video_limits = c.DemuxerQueueLimits{
+    .max_bytes = 16 * 1024 * 1024,
+    .max_duration = 2.0,
+    .low_watermark = 0.75,
+};
+
+const live_audio_limits = c.DemuxerQueueLimits{
+    .max_bytes = 1024 * 1024,
+    .max_duration = 2.0,
+    .low_watermark = 0.75,
+};
+
+// Enough for an MPEG-TS PAT/PMT and the first keyframe's parameters; the
+// player reopens with a full probe when the decoders need more.
+const live_probe_bytes: i64 = 32 * 1024;
+const live_analyze_duration_us: i64 = 100 * std.time.us_per_ms;
+
+// A pts this far behind the edge is a timestamp reset (sender restart,
+// MPEG-TS wrap), not reordering.
+const live_discontinuity_s: f64 = 5.0;
+
+const live_schemes = [_][]const u8{ "udp", "rtp", "srt", "rtsp", "rtsps", "rtmp", "rtmps", "tcp" };
+
+fn isLiveUrl(url: []const u8) bool {
+    const end = std.mem.indexOf(u8, url, "://") orelse return false;
+    for (live_schemes) |scheme| {
+        if (std.ascii.eqlIgnoreCase(url[0..end], scheme)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+fn parseLiveMode(value: []const u8, url: []const u8) bool {
+    const trimmed = std.mem.trim(u8, value, " ");
+    if (std.ascii.eqlIgnoreCase(trimmed, "on") or std.mem.eql(u8, trimmed, "1")) {
+        return true;
+    }
+    if (std.ascii.eqlIgnoreCase(trimmed, "off") or std.mem.eql(u8, trimmed, "0")) {
+        return false;
+    }
+    return isLiveUrl(url);
+}
+
+pub export fn demuxer_live_mode_from_environment(filepath: [*c]const u8) c_int {
+    if (filepath == null) {
+        return 0;
+    }
+    const url = std.mem.span(filepath);
+    const value = std.process.getEnvVarOwned(std.heap.page_allocator, "ZC_LIVE") catch return @intFromBool(isLiveUrl(url));
+    defer std.heap.page_allocator.free(value);
+    return @intFromBool(parseLiveMode(value, url));
+}
+
+// Blocking protocol reads (a silent UDP sender, a stalled RTSP server) give
+// up once the demuxer is stopped.
+fn liveInterrupted(userdata: ?*anyopaque) callconv(.c) c_int {
+    const demuxer: *c.Demuxer = @ptrCast(@alignCast(userdata orelse return 0));
+    return c.SDL_GetAtomicInt(&demuxer.stop_requested);
+}
+
+// B-frames arrive out of pts order, so the edge only moves forward unless the
+// timestamps jump back by more than reordering explains.
+fn noteLiveEdge(demuxer: *c.Demuxer, stream: *const c.AVStream, packet: *const c.AVPacket) void {
+    const pts_us = packetTimestampUs(stream, packet) orelse return;
+    const pts = @as(f64, @floatFromInt(pts_us)) / @as(f64, @floatFromInt(c.AV_TIME_BASE));
+
+    _ = c.SDL_LockMutex(demuxer.mutex);
+    defer _ = c.SDL_UnlockMutex(demuxer.mutex);
+    if (demuxer.live_edge_received_ns == 0 or pts > demuxer.live_edge_pts or pts < demuxer.live_edge_pts - live_discontinuity_s) {
+        demuxer.live_edge_pts = pts;
+        demuxer.live_edge_received_ns = c.SDL_GetTicksNS();
+    }
 }
 
 fn demuxThreadMain(userdata: ?*anyopaque) callconv(.c) c_int {
@@ -78,155 +1437,331 @@ fn demuxThreadMain(userdata: ?*anyopaque) callconv(.c) c_int {
 
     const packet = c.av_packet_alloc();
     if (packet == null) {
-        if (demuxer.mutex != null) {
-            _ = c.SDL_LockMutex(demuxer.mutex);
-            demuxer.eof = 1;
-            demuxer.thread_running = 0;
-            if (demuxer.can_read_video != null) {
-                _ = c.SDL_BroadcastCondition(demuxer.can_read_video);
-            }
-            if (demuxer.can_read_audio != null) {
-                _ = c.SDL_BroadcastCondition(demuxer.can_read_audio);
-            }
-            if (demuxer.can_write != null) {
-                _ = c.SDL_BroadcastCondition(demuxer.can_write);
-            }
-            _ = c.SDL_UnlockMutex(demuxer.mutex);
-        }
+        markEof(demuxer);
+        _ = c.SDL_SetAtomicInt(&demuxer.thread_running, 0);
+        wakeAll(demuxer);
         return -1;
     }
 
-    while (true) {
-        _ = c.SDL_LockMutex(demuxer.mutex);
-        const stop_requested = demuxer.stop_requested;
-        _ = c.SDL_UnlockMutex(demuxer.mutex);
-        if (stop_requested != 0) {
-            break;
+    while (c.SDL_GetAtomicInt(&demuxer.stop_requested) == 0) {
+        if (c.SDL_GetAtomicInt(&demuxer.seek_pending) != 0) {
+            applyPendingSeek(demuxer);
+            continue;
         }
 
-        const ret = c.av_read_frame(demuxer.fmt_ctx, packet);
-        if (ret < 0) {
-            _ = c.SDL_LockMutex(demuxer.mutex);
-            demuxer.eof = 1;
-            if (demuxer.can_read_video != null) {
-                _ = c.SDL_BroadcastCondition(demuxer.can_read_video);
-            }
-            if (demuxer.can_read_audio != null) {
-                _ = c.SDL_BroadcastCondition(demuxer.can_read_audio);
-            }
-            if (demuxer.can_write != null) {
-                _ = c.SDL_BroadcastCondition(demuxer.can_write);
-            }
-            _ = c.SDL_UnlockMutex(demuxer.mutex);
-            break;
+        const generation = c.SDL_GetAtomicInt(&demuxer.demux_generation);
+        if (reachedEof(demuxer, generation)) {
+            waitForSeekOrStop(demuxer);
+            continue;
+        }
+
+        const abr = abrFrom(demuxer);
+        if (abr) |controller| {
+            tickAbr(demuxer, controller);
         }
 
-        _ = c.SDL_LockMutex(demuxer.mutex);
+        const cache = packetCacheFrom(demuxer);
+        const replayed = if (cache) |pc| pc.takeReplay(packet) else false;
+        if (!replayed and c.av_read_frame(demuxer.fmt_ctx, packet) < 0) {
+            markEof(demuxer);
+            wakeAll(demuxer);
+            continue;
+        }
+        if (!replayed and abr != null and !filterAbrPacket(demuxer, abr.?, packet)) {
+            c.av_packet_unref(packet);
+            continue;
+        }
 
         var queue: ?*c.DemuxerPacketQueue = null;
         var can_read: ?*c.SDL_Condition = null;
+        var stream: ?*c.AVStream = null;
 
-        if (packet.*.stream_index == demuxer.video_stream_index) {
+        if (packet.*.stream_index == demuxer.routed_video_stream_index) {
             queue = &demuxer.video_queue;
             can_read = demuxer.can_read_video;
-        } else if (packet.*.stream_index == demuxer.audio_stream_index) {
+            stream = routedStream(demuxer, demuxer.routed_video_stream_index);
+        } else if (packet.*.stream_index == demuxer.routed_audio_stream_index) {
             queue = &demuxer.audio_queue;
             can_read = demuxer.can_read_audio;
+            stream = routedStream(demuxer, demuxer.routed_audio_stream_index);
         }
 
-        while (queue != null and demuxer.stop_requested == 0 and queue.?.count >= capacity()) {
-            _ = c.SDL_WaitCondition(demuxer.can_write, demuxer.mutex);
-        }
-
-        if (queue != null and demuxer.stop_requested == 0) {
-            if (queuePush(queue.?, packet) != 0) {
-                demuxer.stop_requested = 1;
-                demuxer.eof = 1;
-                if (demuxer.can_read_video != null) {
-                    _ = c.SDL_BroadcastCondition(demuxer.can_read_video);
-                }
-                if (demuxer.can_read_audio != null) {
-                    _ = c.SDL_BroadcastCondition(demuxer.can_read_audio);
+        if (queue) |q| {
+            if (!replayed) {
+                if (stream) |s| {
+                    if (q == &demuxer.video_queue) {
+                        recordKeyframe(demuxer, s, packet);
+                    }
+                    if (cache) |pc| {
+                        pc.append(packet, q == &demuxer.video_queue, packetTimestampUs(s, packet));
+                    }
+                } else if (cache) |pc| {
+                    pc.clear();
                 }
-                if (demuxer.can_write != null) {
-                    _ = c.SDL_BroadcastCondition(demuxer.can_write);
+                if (demuxer.live != 0) {
+                    if (stream) |s| {
+                        noteLiveEdge(demuxer, s, packet);
+                    }
                 }
-            } else if (can_read != null) {
-                _ = c.SDL_SignalCondition(can_read);
             }
-        }
 
-        const should_stop = demuxer.stop_requested;
-        _ = c.SDL_UnlockMutex(demuxer.mutex);
+            if (demuxer.skip_forward != 0 and !reachedSkipTarget(demuxer, q == &demuxer.video_queue, stream, packet)) {
+                c.av_packet_unref(packet);
+                continue;
+            }
 
-        c.av_packet_unref(packet);
+            switch (waitForSpace(demuxer, q)) {
+                .ready => {},
+                .stop => {
+                    c.av_packet_unref(packet);
+                    break;
+                },
+                .seek => {
+                    c.av_packet_unref(packet);
+                    continue;
+                },
+            }
 
-        if (should_stop != 0) {
-            break;
+            if (queuePush(q, packet, packetDurationUs(stream, packet), generation) != 0) {
+                _ = c.SDL_SetAtomicInt(&demuxer.stop_requested, 1);
+                markEof(demuxer);
+                wakeAll(demuxer);
+                c.av_packet_unref(packet);
+                break;
+            }
+
+            if (stream) |s| {
+                if (packetTimestampUs(s, packet)) |pts_us| {
+                    demuxer.read_position_us = pts_us;
+                }
+            }
+            wakeConsumer(demuxer, q, can_read);
         }
+
+        c.av_packet_unref(packet);
     }
 
     var packet_copy = packet;
     c.av_packet_free(&packet_copy);
 
-    _ = c.SDL_LockMutex(demuxer.mutex);
-    demuxer.thread_running = 0;
-    if (demuxer.can_read_video != null) {
-        _ = c.SDL_BroadcastCondition(demuxer.can_read_video);
+    _ = c.SDL_SetAtomicInt(&demuxer.thread_running, 0);
+    wakeAll(demuxer);
+
+    return 0;
+}
+
+// Fast probing of network and memory sources stops after a few hundred
+// milliseconds of the stream instead of libavformat's 5 MB / 5 s defaults;
+// the player reopens with a full probe when the decoders reject what it found.
+// Local files are probed in full once and then served from the cache.
+const fast_probe_bytes: i64 = 1024 * 1024;
+const fast_analyze_duration_us: i64 = 500 * std.time.us_per_ms;
+
+fn parseProbeMode(value: []const u8) c_int {
+    const trimmed = std.mem.trim(u8, value, " ");
+    if (std.ascii.eqlIgnoreCase(trimmed, "full")) {
+        return c.DEMUXER_PROBE_FULL;
     }
-    if (demuxer.can_read_audio != null) {
-        _ = c.SDL_BroadcastCondition(demuxer.can_read_audio);
+    return c.DEMUXER_PROBE_FAST;
+}
+
+pub export fn demuxer_probe_mode_from_environment() c_int {
+    const value = std.process.getEnvVarOwned(std.heap.page_allocator, "ZC_DEMUX_PROBE") catch return c.DEMUXER_PROBE_FAST;
+    defer std.heap.page_allocator.free(value);
+    return parseProbeMode(value);
+}
+
+fn probeStreams(d: *c.Demuxer, filepath: [*c]const u8, probe_mode: c_int) c_int {
+    if (probe_mode == c.DEMUXER_PROBE_FAST and d.live != 0) {
+        d.fmt_ctx.*.probesize = live_probe_bytes;
+        d.fmt_ctx.*.max_analyze_duration = live_analyze_duration_us;
+        d.probe_source = c.DEMUXER_PROBE_SOURCE_LIVE;
+    } else if (probe_mode == c.DEMUXER_PROBE_FAST and d.source_kind == c.DEMUXER_SOURCE_FILE) {
+        if (c.stream_info_cache_load(d.fmt_ctx, filepath) == 0) {
+            d.probe_source = c.DEMUXER_PROBE_SOURCE_CACHE;
+            return 0;
+        }
+        // A local file without a cache entry pays for one full probe, which
+        // the player stores so later opens skip probing altogether.
+        d.probe_source = c.DEMUXER_PROBE_SOURCE_FULL;
+    } else if (probe_mode == c.DEMUXER_PROBE_FAST) {
+        d.fmt_ctx.*.probesize = fast_probe_bytes;
+        d.fmt_ctx.*.max_analyze_duration = fast_analyze_duration_us;
+        d.probe_source = c.DEMUXER_PROBE_SOURCE_BOUNDED;
+    } else {
+        d.probe_source = c.DEMUXER_PROBE_SOURCE_FULL;
     }
-    if (demuxer.can_write != null) {
-        _ = c.SDL_BroadcastCondition(demuxer.can_write);
+
+    return if (c.avformat_find_stream_info(d.fmt_ctx, null) < 0) -1 else 0;
+}
+
+fn openInputContext(d: *c.Demuxer, filepath: [*c]const u8, options: ?*const c.DemuxerOpenOptions) c_int {
+    const io_backend = if (options) |opts| opts.io_backend else c.demuxer_io_backend_from_environment();
+    const pipe_fd = c.demuxer_io_pipe_fd(filepath);
+
+    if (options != null and options.?.memory_data != null) {
+        d.source_kind = c.DEMUXER_SOURCE_MEMORY;
+        if (c.demuxer_io_open_memory(&d.io, options.?.memory_data, options.?.memory_size) != 0) {
+            return -1;
+        }
+    } else if (pipe_fd >= 0) {
+        // Without the pipe backend (Windows) libavformat's own `pipe:`
+        // protocol reads the descriptor unbuffered.
+        d.source_kind = c.DEMUXER_SOURCE_PIPE;
+        if (c.demuxer_io_open_pipe(&d.io, pipe_fd) != 0) {
+            var url_buf: [32]u8 = undefined;
+            const url = std.fmt.bufPrintZ(&url_buf, "pipe:{d}", .{pipe_fd}) catch return -1;
+            return c.avformat_open_input(&d.fmt_ctx, url.ptr, null, null);
+        }
+    } else if (SegmentPrefetcherMod.isSegmentManifestUrl(std.mem.span(filepath))) {
+        d.source_kind = c.DEMUXER_SOURCE_NETWORK;
+        return openSegmentInput(d, filepath);
+    } else if (ImageSequence.detect(std.mem.span(filepath))) |sequence| {
+        d.source_kind = c.DEMUXER_SOURCE_SEQUENCE;
+        return openSequenceInput(d, sequence);
+    } else if (d.live != 0) {
+        // A live stream has no byte ranges to cache and nothing to rewind.
+        d.source_kind = c.DEMUXER_SOURCE_NETWORK;
+    } else if (c.demuxer_io_is_http_url(filepath) != 0) {
+        // Without the range cache libavformat streams the URL directly.
+        d.source_kind = c.DEMUXER_SOURCE_NETWORK;
+        _ = c.demuxer_io_open_http(&d.io, filepath);
+    } else if (io_backend != c.DEMUXER_IO_BACKEND_DEFAULT and c.demuxer_io_open(&d.io, filepath, io_backend) != 0) {
+        // A backend that cannot serve this path (non-local input, unsupported
+        // platform) falls back to libavformat's own protocol handling.
+        _ = c.demuxer_io_open(&d.io, filepath, c.DEMUXER_IO_BACKEND_DEFAULT);
     }
-    _ = c.SDL_UnlockMutex(demuxer.mutex);
 
-    return 0;
+    if (d.io.avio != null) {
+        d.fmt_ctx = c.avformat_alloc_context();
+        if (d.fmt_ctx == null) {
+            return -1;
+        }
+        d.fmt_ctx.*.pb = d.io.avio;
+        d.fmt_ctx.*.flags |= c.AVFMT_FLAG_CUSTOM_IO;
+    }
+    if (d.live == 0) {
+        return c.avformat_open_input(&d.fmt_ctx, filepath, null, null);
+    }
+
+    if (d.fmt_ctx == null) {
+        d.fmt_ctx = c.avformat_alloc_context();
+        if (d.fmt_ctx == null) {
+            return -1;
+        }
+    }
+    d.fmt_ctx.*.flags |= c.AVFMT_FLAG_NOBUFFER;
+    d.fmt_ctx.*.interrupt_callback = .{ .callback = liveInterrupted, .@"opaque" = d };
+
+    // UDP keeps reading through receive-buffer overruns instead of failing.
+    var open_options: ?*c.AVDictionary = null;
+    defer c.av_dict_free(&open_options);
+    _ = c.av_dict_set(&open_options, "overrun_nonfatal", "1", 0);
+    return c.avformat_open_input(&d.fmt_ctx, filepath, null, &open_options);
 }
 
-pub export fn demuxer_open(demuxer: ?*c.Demuxer, filepath: [*c]const u8) c_int {
-    if (demuxer == null or filepath == null) {
+// HLS and DASH open their playlists and segments through the prefetcher's
+// hooks. libavformat only reuses HTTP connections on contexts it opened
+// itself, so persistent connections are turned off.
+fn openSegmentInput(d: *c.Demuxer, filepath: [*c]const u8) c_int {
+    const prefetcher = SegmentPrefetcher.create(std.heap.page_allocator, .{}) catch return -1;
+    d.segment_prefetcher = prefetcher;
+
+    d.fmt_ctx = c.avformat_alloc_context();
+    if (d.fmt_ctx == null) {
         return -1;
     }
+    prefetcher.attach(@ptrCast(d.fmt_ctx));
 
-    const d = demuxer.?;
-    d.* = std.mem.zeroes(c.Demuxer);
-    d.video_stream_index = -1;
-    d.audio_stream_index = -1;
+    var options: ?*c.AVDictionary = null;
+    defer c.av_dict_free(&options);
+    _ = c.av_dict_set(&options, "http_persistent", "0", 0);
+    _ = c.av_dict_set(&options, "http_multiple", "0", 0);
+    return c.avformat_open_input(&d.fmt_ctx, filepath, null, &options);
+}
 
-    if (c.avformat_open_input(&d.fmt_ctx, filepath, null, null) != 0) {
-        demuxer_close(demuxer);
+// Image sequences go through image2, starting at the first frame on disk, with
+// the reader's hooks loading frames ahead (see ImageSequence.zig).
+fn openSequenceInput(d: *c.Demuxer, sequence: ImageSequence.Sequence) c_int {
+    const source = sequence.source;
+    const range = sequence.range;
+    const rate = source.rate orelse ImageSequence.rateFromEnvironment();
+
+    var pattern_buf: [std.fs.max_path_bytes]u8 = undefined;
+    const pattern = source.pattern.formatImage2(&pattern_buf) catch return -1;
+    var start_buf: [24]u8 = undefined;
+    const start_number = std.fmt.bufPrintZ(&start_buf, "{d}", .{range.first}) catch return -1;
+    var rate_buf: [32]u8 = undefined;
+    const framerate = std.fmt.bufPrintZ(&rate_buf, "{d}/{d}", .{ rate.num, rate.den }) catch return -1;
+
+    d.fmt_ctx = c.avformat_alloc_context();
+    if (d.fmt_ctx == null) {
         return -1;
     }
+    const read_ahead = ImageSequence.readAheadFromEnvironment();
+    if (read_ahead > 0) {
+        const reader = SequenceReader.create(std.heap.page_allocator, source.pattern, range, .{ .read_ahead = read_ahead }) catch return -1;
+        d.sequence_reader = reader;
+        reader.attach(@ptrCast(d.fmt_ctx));
+    }
 
-    if (c.avformat_find_stream_info(d.fmt_ctx, null) < 0) {
-        demuxer_close(demuxer);
+    var options: ?*c.AVDictionary = null;
+    defer c.av_dict_free(&options);
+    _ = c.av_dict_set(&options, "pattern_type", "sequence", 0);
+    _ = c.av_dict_set(&options, "start_number", start_number.ptr, 0);
+    _ = c.av_dict_set(&options, "framerate", framerate.ptr, 0);
+    return c.avformat_open_input(&d.fmt_ctx, pattern.ptr, c.av_find_input_format("image2"), &options);
+}
+
+pub export fn demuxer_open(demuxer: ?*c.Demuxer, filepath: [*c]const u8) c_int {
+    return demuxer_open_with_options(demuxer, filepath, null);
+}
+
+pub export fn demuxer_open_with_options(demuxer: ?*c.Demuxer, filepath: [*c]const u8, options: ?*const c.DemuxerOpenOptions) c_int {
+    if (demuxer == null or filepath == null) {
         return -1;
     }
 
-    var i: c_uint = 0;
-    while (i < d.fmt_ctx.*.nb_streams) : (i += 1) {
-        const stream = d.fmt_ctx.*.streams[i];
-        if (stream == null) {
-            continue;
-        }
-
-        if (stream.*.codecpar != null and stream.*.codecpar.*.codec_type == c.AVMEDIA_TYPE_VIDEO and d.video_stream_index < 0) {
-            d.video_stream_index = @intCast(i);
-            d.video_stream = stream;
-        }
+    const d = demuxer.?;
+    d.* = std.mem.zeroes(c.Demuxer);
+    d.video_stream_index = -1;
+    d.audio_stream_index = -1;
+    d.routed_video_stream_index = -1;
+    d.routed_audio_stream_index = -1;
+    d.live = if (options) |opts| opts.live else demuxer_live_mode_from_environment(filepath);
+    const video_fallback = if (d.live != 0) live_video_limits else default_video_limits;
+    const audio_fallback = if (d.live != 0) live_audio_limits else default_audio_limits;
+    d.video_queue.limits = queueLimitsFromEnvironment("ZC_DEMUX_VIDEO_BUFFER", video_fallback);
+    d.audio_queue.limits = queueLimitsFromEnvironment("ZC_DEMUX_AUDIO_BUFFER", audio_fallback);
+
+    if (openInputContext(d, filepath, options) != 0) {
+        demuxer_close(demuxer);
+        return -1;
+    }
 
-        if (stream.*.codecpar != null and stream.*.codecpar.*.codec_type == c.AVMEDIA_TYPE_AUDIO and d.audio_stream_index < 0) {
-            d.audio_stream_index = @intCast(i);
-            d.audio_stream = stream;
-        }
+    const probe_mode = if (options) |opts| opts.probe_mode else demuxer_probe_mode_from_environment();
+    if (probeStreams(d, filepath, probe_mode) != 0) {
+        demuxer_close(demuxer);
+        return -1;
     }
 
-    if (d.video_stream_index < 0 or d.video_stream == null) {
+    // Default-disposition tracks win; audio prefers the track related to the
+    // chosen video stream (same program).
+    const video_index = c.av_find_best_stream(d.fmt_ctx, c.AVMEDIA_TYPE_VIDEO, -1, -1, null, 0);
+    if (video_index < 0) {
         demuxer_close(demuxer);
         return -1;
     }
+    d.video_stream_index = video_index;
+    d.video_stream = d.fmt_ctx.*.streams[@intCast(video_index)];
+
+    const audio_index = c.av_find_best_stream(d.fmt_ctx, c.AVMEDIA_TYPE_AUDIO, -1, video_index, null, 0);
+    if (audio_index >= 0) {
+        d.audio_stream_index = audio_index;
+        d.audio_stream = d.fmt_ctx.*.streams[@intCast(audio_index)];
+    }
+    openAbr(d);
+    applyTrackRouting(d, d.video_stream_index, d.audio_stream_index);
 
     d.mutex = c.SDL_CreateMutex();
     if (d.mutex == null) {
@@ -252,6 +1787,11 @@ pub export fn demuxer_open(demuxer: ?*c.Demuxer, filepath: [*c]const u8) c_int {
         return -1;
     }
 
+    // Neither helps a source that only ever moves forward.
+    if (d.live == 0) {
+        openKeyframeIndex(d, filepath);
+        openPacketCache(d);
+    }
     return 0;
 }
 
@@ -269,17 +1809,25 @@ pub export fn demuxer_start(demuxer: ?*c.Demuxer) c_int {
         return 0;
     }
 
-    _ = c.SDL_LockMutex(d.mutex);
-    d.stop_requested = 0;
-    d.eof = 0;
-    d.thread_running = 1;
-    _ = c.SDL_UnlockMutex(d.mutex);
+    _ = c.SDL_SetAtomicInt(&d.stop_requested, 0);
+    _ = c.SDL_SetAtomicInt(&d.eof, 0);
+    _ = c.SDL_SetAtomicInt(&d.seek_pending, 0);
+    _ = c.SDL_SetAtomicInt(&d.demux_generation, c.SDL_GetAtomicInt(&d.seek_generation));
+    applyTrackRouting(d, d.video_stream_index, d.audio_stream_index);
+    // `demuxer_stop` cancels blocking reads for good; a restart, such as the
+    // inline seek path, reads on.
+    c.demuxer_io_rearm(&d.io);
+    if (segmentPrefetcherFrom(d)) |prefetcher| {
+        prefetcher.rearm();
+    }
+    if (sequenceReaderFrom(d)) |reader| {
+        reader.rearm();
+    }
+    _ = c.SDL_SetAtomicInt(&d.thread_running, 1);
 
     d.thread = c.SDL_CreateThread(demuxThreadMain, "demux", d);
     if (d.thread == null) {
-        _ = c.SDL_LockMutex(d.mutex);
-        d.thread_running = 0;
-        _ = c.SDL_UnlockMutex(d.mutex);
+        _ = c.SDL_SetAtomicInt(&d.thread_running, 0);
         return -1;
     }
 
@@ -293,31 +1841,24 @@ pub export fn demuxer_stop(demuxer: ?*c.Demuxer) void {
 
     const d = demuxer.?;
 
-    if (d.mutex != null) {
-        _ = c.SDL_LockMutex(d.mutex);
-        d.stop_requested = 1;
-        if (d.can_read_video != null) {
-            _ = c.SDL_BroadcastCondition(d.can_read_video);
-        }
-        if (d.can_read_audio != null) {
-            _ = c.SDL_BroadcastCondition(d.can_read_audio);
-        }
-        if (d.can_write != null) {
-            _ = c.SDL_BroadcastCondition(d.can_write);
-        }
-        _ = c.SDL_UnlockMutex(d.mutex);
-    }
+    _ = c.SDL_SetAtomicInt(&d.stop_requested, 1);
+    wakeAll(d);
 
     if (d.thread != null) {
+        // A pipe read can block on an idle writer indefinitely, a network
+        // read on a stalled server.
+        c.demuxer_io_cancel(&d.io);
+        if (segmentPrefetcherFrom(d)) |prefetcher| {
+            prefetcher.cancel();
+        }
+        if (sequenceReaderFrom(d)) |reader| {
+            reader.cancel();
+        }
         c.SDL_WaitThread(d.thread, null);
         d.thread = null;
     }
 
-    if (d.mutex != null) {
-        _ = c.SDL_LockMutex(d.mutex);
-        d.thread_running = 0;
-        _ = c.SDL_UnlockMutex(d.mutex);
-    }
+    _ = c.SDL_SetAtomicInt(&d.thread_running, 0);
 }
 
 pub export fn demuxer_close(demuxer: ?*c.Demuxer) void {
@@ -328,13 +1869,11 @@ pub export fn demuxer_close(demuxer: ?*c.Demuxer) void {
     const d = demuxer.?;
 
     demuxer_stop(demuxer);
+    closeKeyframeIndex(d);
+    closePacketCache(d);
 
-    if (d.mutex != null) {
-        _ = c.SDL_LockMutex(d.mutex);
-        queueClear(&d.video_queue);
-        queueClear(&d.audio_queue);
-        _ = c.SDL_UnlockMutex(d.mutex);
-    }
+    queueRelease(&d.video_queue);
+    queueRelease(&d.audio_queue);
 
     if (d.can_write != null) {
         c.SDL_DestroyCondition(d.can_write);
@@ -359,14 +1898,30 @@ pub export fn demuxer_close(demuxer: ?*c.Demuxer) void {
     if (d.fmt_ctx != null) {
         c.avformat_close_input(&d.fmt_ctx);
     }
+    // Closing the format context releases segment contexts through the
+    // prefetcher's hooks.
+    if (segmentPrefetcherFrom(d)) |prefetcher| {
+        prefetcher.destroy();
+        d.segment_prefetcher = null;
+    }
+    if (sequenceReaderFrom(d)) |reader| {
+        reader.destroy();
+        d.sequence_reader = null;
+    }
+    closeAbr(d);
+    c.demuxer_io_close(&d.io);
 
     d.video_stream_index = -1;
     d.audio_stream_index = -1;
     d.video_stream = null;
     d.audio_stream = null;
-    d.thread_running = 0;
-    d.stop_requested = 0;
-    d.eof = 0;
+    d.routed_video_stream_index = -1;
+    d.routed_audio_stream_index = -1;
+    d.live = 0;
+    d.live_edge_received_ns = 0;
+    _ = c.SDL_SetAtomicInt(&d.thread_running, 0);
+    _ = c.SDL_SetAtomicInt(&d.stop_requested, 0);
+    _ = c.SDL_SetAtomicInt(&d.eof, 0);
 }
 
 pub export fn demuxer_seek(demuxer: ?*c.Demuxer, time_seconds: f64) c_int {
@@ -384,27 +1939,62 @@ pub export fn demuxer_seek(demuxer: ?*c.Demuxer, time_seconds: f64) c_int {
         target_seconds = 0.0;
     }
 
-    demuxer_stop(demuxer);
-
-    const target_ts: i64 = @intFromFloat(target_seconds * @as(f64, @floatFromInt(c.AV_TIME_BASE)));
-    var seek_ret = c.avformat_seek_file(d.fmt_ctx, -1, std.math.minInt(i64), target_ts, std.math.maxInt(i64), c.AVSEEK_FLAG_BACKWARD);
-    if (seek_ret < 0) {
-        seek_ret = c.av_seek_frame(d.fmt_ctx, -1, target_ts, c.AVSEEK_FLAG_BACKWARD);
+    if (d.thread == null or c.SDL_GetAtomicInt(&d.thread_running) == 0) {
+        // No live demux thread to hand the request to (never started, or it
+        // exited on an error): seek inline and start a fresh one.
+        demuxer_stop(demuxer);
+        _ = c.SDL_AddAtomicInt(&d.seek_generation, 1);
+        queueClear(&d.video_queue);
+        queueClear(&d.audio_queue);
+        _ = c.SDL_SetAtomicInt(&d.stop_requested, 0);
+        _ = c.SDL_SetAtomicInt(&d.eof, 0);
+
+        resetAbrForSeek(d);
+        const generation = c.SDL_GetAtomicInt(&d.seek_generation);
+        if (!seekFromPacketCache(d, target_seconds, d.video_stream_index, d.audio_stream_index) and
+            seekSource(d, target_seconds) < 0)
+        {
+            noteSeekResult(d, generation, -1);
+            return -1;
+        }
+        noteSeekResult(d, generation, 0);
+        return demuxer_start(demuxer);
     }
 
     _ = c.SDL_LockMutex(d.mutex);
-    queueClear(&d.video_queue);
-    queueClear(&d.audio_queue);
-    d.stop_requested = 0;
-    d.eof = 0;
+    d.seek_target = target_seconds;
+    const generation = c.SDL_AddAtomicInt(&d.seek_generation, 1) +% 1;
+    _ = c.SDL_SetAtomicInt(&d.seek_pending, 1);
+    _ = c.SDL_BroadcastCondition(d.can_write);
     _ = c.SDL_UnlockMutex(d.mutex);
 
-    if (seek_ret < 0) {
+    // Both decode threads are parked on the player's decode mutexes while a
+    // seek is applied, so the caller holds the consumer role of both rings and
+    // can drop the stale backlog now instead of leaving it for the decoders.
+    queueDiscardStale(d, &d.video_queue, generation);
+    queueDiscardStale(d, &d.audio_queue, generation);
+    return 0;
+}
+
+/// Outcome of the seek that advanced `seek_generation` to `generation`: 1
+/// while the demux thread has not applied it, 0 once the source is positioned,
+/// -1 when the source failed to seek and reading went on from where it was.
+/// A seek superseded by a later one reports the later one's result.
+pub export fn demuxer_get_seek_result(demuxer: ?*c.Demuxer, generation: c_int, resume_seconds: [*c]f64) c_int {
+    const d = demuxer orelse return -1;
+    if (d.mutex == null) {
         return -1;
     }
 
-    _ = c.avformat_flush(d.fmt_ctx);
-    return demuxer_start(demuxer);
+    _ = c.SDL_LockMutex(d.mutex);
+    defer _ = c.SDL_UnlockMutex(d.mutex);
+    if (d.seek_result_generation -% generation < 0) {
+        return 1;
+    }
+    if (d.seek_result < 0 and resume_seconds != null) {
+        resume_seconds.* = d.seek_resume_time;
+    }
+    return d.seek_result;
 }
 
 fn demuxerPopPacket(demuxer: *c.Demuxer, queue: *c.DemuxerPacketQueue, can_read: ?*c.SDL_Condition, out_packet: [*c]c.AVPacket) c_int {
@@ -414,32 +2004,59 @@ fn demuxerPopPacket(demuxer: *c.Demuxer, queue: *c.DemuxerPacketQueue, can_read:
 
     c.av_packet_unref(out_packet);
 
-    _ = c.SDL_LockMutex(demuxer.mutex);
-    while (queue.count == 0 and demuxer.eof == 0 and demuxer.stop_requested == 0 and demuxer.thread_running != 0) {
-        _ = c.SDL_WaitCondition(can_read, demuxer.mutex);
-    }
+    while (true) {
+        if (queueCount(queue) == 0) {
+            const wait_started = std.time.nanoTimestamp();
+            _ = c.SDL_LockMutex(demuxer.mutex);
+            _ = c.SDL_SetAtomicInt(&queue.consumer_waiting, 1);
+            // A producer parked on the other, full ring re-checks for
+            // starvation once this consumer is asleep.
+            if (demuxer.can_write != null and
+                (c.SDL_GetAtomicInt(&demuxer.video_queue.producer_waiting) != 0 or
+                    c.SDL_GetAtomicInt(&demuxer.audio_queue.producer_waiting) != 0))
+            {
+                _ = c.SDL_BroadcastCondition(demuxer.can_write);
+            }
+            while (queueCount(queue) == 0 and
+                !reachedEof(demuxer, c.SDL_GetAtomicInt(&demuxer.seek_generation)) and
+                c.SDL_GetAtomicInt(&demuxer.stop_requested) == 0 and
+                c.SDL_GetAtomicInt(&demuxer.thread_running) != 0)
+            {
+                _ = c.SDL_WaitCondition(can_read, demuxer.mutex);
+            }
+            _ = c.SDL_SetAtomicInt(&queue.consumer_waiting, 0);
+            _ = c.SDL_UnlockMutex(demuxer.mutex);
+            noteVideoWait(demuxer, queue, wait_started);
+        }
+
+        if (queueCount(queue) == 0) {
+            break;
+        }
 
-    if (queue.count > 0) {
+        const packet_generation = queueHeadGeneration(queue);
         if (queuePop(queue, out_packet) != 0) {
-            _ = c.SDL_UnlockMutex(demuxer.mutex);
             return -1;
         }
-        if (demuxer.can_write != null) {
-            _ = c.SDL_SignalCondition(demuxer.can_write);
+        wakeProducer(demuxer, queue);
+
+        if (packet_generation == c.SDL_GetAtomicInt(&demuxer.seek_generation)) {
+            if (queue == &demuxer.video_queue) {
+                if (skipForCatchUp(demuxer, packet_generation, out_packet)) {
+                    c.av_packet_unref(out_packet);
+                    continue;
+                }
+                demuxer.video_delivered_generation = packet_generation +% 1;
+            }
+            return 1;
         }
-        _ = c.SDL_UnlockMutex(demuxer.mutex);
-        return 1;
+        c.av_packet_unref(out_packet);
     }
 
-    const stop_requested = demuxer.stop_requested;
-    const eof = demuxer.eof;
-    _ = c.SDL_UnlockMutex(demuxer.mutex);
-
-    if (stop_requested != 0) {
+    if (c.SDL_GetAtomicInt(&demuxer.stop_requested) != 0) {
         return -1;
     }
 
-    if (eof != 0) {
+    if (reachedEof(demuxer, c.SDL_GetAtomicInt(&demuxer.seek_generation))) {
         return 0;
     }
 
@@ -455,6 +2072,21 @@ pub export fn demuxer_pop_video_packet(demuxer: ?*c.Demuxer, out_packet: [*c]c.A
     return demuxerPopPacket(d, &d.video_queue, d.can_read_video, out_packet);
 }
 
+/// Drops video packets up to the first keyframe at or after `target_seconds`
+/// (stream time) as the video decoder pops them. Called from the video
+/// consumer, which flushes its decoder alongside.
+pub export fn demuxer_skip_video_to_keyframe(demuxer: ?*c.Demuxer, target_seconds: f64) c_int {
+    const d = demuxer orelse return -1;
+    if (d.video_stream == null or d.mutex == null) {
+        return -1;
+    }
+
+    d.video_catch_up_us = @intFromFloat(target_seconds * @as(f64, @floatFromInt(c.AV_TIME_BASE)));
+    d.video_catch_up_generation = c.SDL_GetAtomicInt(&d.seek_generation);
+    d.video_catch_up = 1;
+    return 0;
+}
+
 pub export fn demuxer_pop_audio_packet(demuxer: ?*c.Demuxer, out_packet: [*c]c.AVPacket) c_int {
     if (demuxer == null or out_packet == null) {
         return -1;
@@ -474,8 +2106,793 @@ pub export fn demuxer_is_eof(demuxer: ?*c.Demuxer) c_int {
     }
 
     const d = demuxer.?;
+    return @intFromBool(reachedEof(d, c.SDL_GetAtomicInt(&d.seek_generation)));
+}
+
+pub export fn demuxer_is_seekable(demuxer: ?*c.Demuxer) c_int {
+    const d = demuxer orelse return 0;
+    if (d.fmt_ctx == null) {
+        return 0;
+    }
+    return @intFromBool(sourceSeekable(d));
+}
+
+fn copyMetadata(dst: []u8, metadata: ?*const c.AVDictionary, key: [*:0]const u8) void {
+    @memset(dst, 0);
+    const entry = c.av_dict_get(metadata, key, null, 0);
+    if (entry == null or entry.*.value == null) {
+        return;
+    }
+    const value = std.mem.span(entry.*.value);
+    const n = @min(value.len, dst.len - 1);
+    @memcpy(dst[0..n], value[0..n]);
+}
+
+pub export fn demuxer_get_track_count(demuxer: ?*c.Demuxer) c_int {
+    const d = demuxer orelse return 0;
+    if (d.fmt_ctx == null) {
+        return 0;
+    }
+    return @intCast(d.fmt_ctx.*.nb_streams);
+}
+
+pub export fn demuxer_get_track_info(demuxer: ?*c.Demuxer, stream_index: c_int, info: [*c]c.DemuxerTrackInfo) c_int {
+    const d = demuxer orelse return -1;
+    if (info == null) {
+        return -1;
+    }
+    const stream = routedStream(d, stream_index) orelse return -1;
+    if (stream.codecpar == null) {
+        return -1;
+    }
+
+    const par = stream.codecpar.*;
+    info.* = std.mem.zeroes(c.DemuxerTrackInfo);
+    info.*.stream_index = stream_index;
+    info.*.media_type = par.codec_type;
+    info.*.codec_id = @intCast(par.codec_id);
+    info.*.selected = @intFromBool(stream_index == d.video_stream_index or stream_index == d.audio_stream_index);
+    info.*.is_default = @intFromBool((stream.disposition & c.AV_DISPOSITION_DEFAULT) != 0);
+    info.*.width = par.width;
+    info.*.height = par.height;
+    info.*.sample_rate = par.sample_rate;
+    info.*.channels = par.ch_layout.nb_channels;
+    copyMetadata(&info.*.language, stream.metadata, "language");
+    copyMetadata(&info.*.title, stream.metadata, "title");
+    return 0;
+}
+
+/// Makes `stream_index` the active video or audio track and restarts reading
+/// at `resume_seconds`, because packets of the new track before the demux
+/// thread's read position were discarded. Like `demuxer_seek`, the caller must
+/// hold both decoders off the packet rings.
+pub export fn demuxer_select_track(demuxer: ?*c.Demuxer, stream_index: c_int, resume_seconds: f64) c_int {
+    const d = demuxer orelse return -1;
+    if (d.mutex == null) {
+        return -1;
+    }
+    const stream = routedStream(d, stream_index) orelse return -1;
+    if (stream.codecpar == null) {
+        return -1;
+    }
+
+    const media_type = stream.codecpar.*.codec_type;
+    if (media_type != c.AVMEDIA_TYPE_VIDEO and media_type != c.AVMEDIA_TYPE_AUDIO) {
+        return -1;
+    }
+
+    if (media_type == c.AVMEDIA_TYPE_VIDEO) {
+        if (abrFrom(d)) |abr| {
+            abr.pinned.store(true, .release);
+        }
+    }
+
+    _ = c.SDL_LockMutex(d.mutex);
+    if (media_type == c.AVMEDIA_TYPE_VIDEO) {
+        d.video_stream_index = stream_index;
+        d.video_stream = stream;
+    } else {
+        d.audio_stream_index = stream_index;
+        d.audio_stream = stream;
+    }
+    _ = c.SDL_UnlockMutex(d.mutex);
+
+    return demuxer_seek(demuxer, resume_seconds);
+}
+
+fn fillQueueStats(queue: *c.DemuxerPacketQueue, out: *c.DemuxerQueueStats) void {
+    out.packets = @max(queueCount(queue), 0);
+    out.bytes = queueBytes(queue);
+    out.duration = queueDuration(queue);
+    out.fill = queueFill(queue);
+    out.packet_shells = queue.packet_shells;
+    out.starvation_overflows = queue.starvation_overflows;
+}
+
+pub export fn demuxer_get_queue_stats(
+    demuxer: ?*c.Demuxer,
+    video_stats: [*c]c.DemuxerQueueStats,
+    audio_stats: [*c]c.DemuxerQueueStats,
+) c_int {
+    if (demuxer == null or demuxer.?.mutex == null) {
+        return -1;
+    }
+
+    const d = demuxer.?;
+    if (video_stats != null) {
+        fillQueueStats(&d.video_queue, video_stats);
+    }
+    if (audio_stats != null) {
+        fillQueueStats(&d.audio_queue, audio_stats);
+    }
+    return 0;
+}
+
+pub export fn demuxer_get_abr_stats(demuxer: ?*c.Demuxer, stats: [*c]c.DemuxerAbrStats) c_int {
+    const d = demuxer orelse return -1;
+    if (stats == null) {
+        return -1;
+    }
+
+    stats.* = std.mem.zeroes(c.DemuxerAbrStats);
+    stats.*.rebuffers = c.SDL_GetAtomicInt(&d.rebuffers);
+    if (segmentPrefetcherFrom(d)) |prefetcher| {
+        const prefetch_stats = prefetcher.snapshotStats();
+        stats.*.segment_prefetch_hits = prefetch_stats.prefetch_hits;
+        stats.*.segment_misses = prefetch_stats.misses;
+        if (prefetcher.estimateBps()) |estimate| {
+            stats.*.bandwidth_estimate = @intFromFloat(estimate);
+        }
+    }
+    if (abrFrom(d)) |abr| {
+        abr.stats_mutex.lock();
+        defer abr.stats_mutex.unlock();
+        stats.*.variant_count = @intCast(abr.count);
+        stats.*.current_variant = @intCast(abr.published_current);
+        stats.*.variant_bitrate = abr.bitrates[abr.published_current];
+        stats.*.switches = abr.switches;
+        stats.*.last_switch_latency_ms = abr.last_switch_latency_ms;
+    }
+    return 0;
+}
+
+/// Read-ahead statistics of an image sequence; fails for other sources and
+/// for sequences opened with read-ahead off.
+pub export fn demuxer_get_sequence_stats(demuxer: ?*c.Demuxer, stats: [*c]c.DemuxerSequenceStats) c_int {
+    const d = demuxer orelse return -1;
+    const reader = sequenceReaderFrom(d) orelse return -1;
+    if (stats == null) {
+        return -1;
+    }
+
+    const reader_stats = reader.snapshotStats();
+    stats.* = .{
+        .read_ahead = @intCast(reader.readAhead()),
+        .prefetch_hits = reader_stats.prefetch_hits,
+        .misses = reader_stats.misses,
+        .bytes_read = reader_stats.bytes_read,
+        .failed_reads = reader_stats.failed_reads,
+    };
+    return 0;
+}
+
+/// Reports the newest pts the demux thread has routed and how long ago it
+/// arrived. Fails for non-live sources and before the first packet.
+pub export fn demuxer_get_live_edge(demuxer: ?*c.Demuxer, edge_pts: [*c]f64, edge_age_seconds: [*c]f64) c_int {
+    const d = demuxer orelse return -1;
+    if (d.live == 0 or d.mutex == null or edge_pts == null or edge_age_seconds == null) {
+        return -1;
+    }
+
     _ = c.SDL_LockMutex(d.mutex);
-    const eof = d.eof;
+    const pts = d.live_edge_pts;
+    const received_ns = d.live_edge_received_ns;
     _ = c.SDL_UnlockMutex(d.mutex);
-    return eof;
+    if (received_ns == 0) {
+        return -1;
+    }
+
+    const now_ns = c.SDL_GetTicksNS();
+    edge_pts.* = pts;
+    edge_age_seconds.* = if (now_ns > received_ns) @as(f64, @floatFromInt(now_ns - received_ns)) / std.time.ns_per_s else 0.0;
+    return 0;
+}
+
+test "track routing discards every stream except the selected pair" {
+    var demuxer = std.mem.zeroes(c.Demuxer);
+    demuxer.fmt_ctx = c.avformat_alloc_context();
+    defer c.avformat_free_context(demuxer.fmt_ctx);
+
+    const media_types = [_]c_int{ c.AVMEDIA_TYPE_VIDEO, c.AVMEDIA_TYPE_AUDIO, c.AVMEDIA_TYPE_AUDIO, c.AVMEDIA_TYPE_SUBTITLE };
+    for (media_types) |media_type| {
+        const stream = c.avformat_new_stream(demuxer.fmt_ctx, null);
+        try std.testing.expect(stream != null);
+        stream.*.codecpar.*.codec_type = media_type;
+    }
+    _ = c.av_dict_set(&demuxer.fmt_ctx.*.streams[2].*.metadata, "language", "deu", 0);
+
+    demuxer.video_stream_index = 0;
+    demuxer.audio_stream_index = 2;
+    applyTrackRouting(&demuxer, demuxer.video_stream_index, demuxer.audio_stream_index);
+
+    const expected = [_]c_int{ c.AVDISCARD_DEFAULT, c.AVDISCARD_ALL, c.AVDISCARD_DEFAULT, c.AVDISCARD_ALL };
+    for (expected, 0..) |discard, i| {
+        try std.testing.expectEqual(discard, @as(c_int, demuxer.fmt_ctx.*.streams[i].*.discard));
+    }
+
+    var info: c.DemuxerTrackInfo = undefined;
+    try std.testing.expectEqual(@as(c_int, 4), demuxer_get_track_count(&demuxer));
+    try std.testing.expectEqual(@as(c_int, 0), demuxer_get_track_info(&demuxer, 2, &info));
+    try std.testing.expectEqual(@as(c_int, 1), info.selected);
+    try std.testing.expectEqualStrings("deu", std.mem.sliceTo(&info.language, 0));
+    try std.testing.expectEqual(@as(c_int, -1), demuxer_get_track_info(&demuxer, 4, &info));
+}
+
+test "demuxerPopPacket drops packets from superseded seek generations" {
+    var demuxer = std.mem.zeroes(c.Demuxer);
+    demuxer.mutex = c.SDL_CreateMutex();
+    defer c.SDL_DestroyMutex(demuxer.mutex);
+    demuxer.can_read_video = c.SDL_CreateCondition();
+    defer c.SDL_DestroyCondition(demuxer.can_read_video);
+    defer queueRelease(&demuxer.video_queue);
+    demuxer.video_queue.limits = default_video_limits;
+
+    var payload = [_]u8{ 1, 2, 3, 4 };
+    var src = std.mem.zeroes(c.AVPacket);
+    for ([_]c_int{ 0, 0, 1, 1 }, 0..) |generation, i| {
+        src.data = &payload;
+        src.size = @intCast(i + 1);
+        try std.testing.expectEqual(@as(c_int, 0), queuePush(&demuxer.video_queue, &src, 0, generation));
+    }
+
+    _ = c.SDL_SetAtomicInt(&demuxer.seek_generation, 1);
+    _ = c.SDL_SetAtomicInt(&demuxer.demux_generation, 1);
+    markEof(&demuxer);
+
+    var out = std.mem.zeroes(c.AVPacket);
+    defer c.av_packet_unref(&out);
+    try std.testing.expectEqual(@as(c_int, 1), demuxerPopPacket(&demuxer, &demuxer.video_queue, demuxer.can_read_video, &out));
+    try std.testing.expectEqual(@as(c_int, 3), out.size);
+    try std.testing.expectEqual(@as(c_int, 1), demuxerPopPacket(&demuxer, &demuxer.video_queue, demuxer.can_read_video, &out));
+    try std.testing.expectEqual(@as(c_int, 4), out.size);
+    try std.testing.expectEqual(@as(c_int, 0), demuxerPopPacket(&demuxer, &demuxer.video_queue, demuxer.can_read_video, &out));
+
+    // An EOF reached before the latest seek does not end the new generation.
+    _ = c.SDL_SetAtomicInt(&demuxer.seek_generation, 2);
+    try std.testing.expectEqual(@as(c_int, -1), demuxerPopPacket(&demuxer, &demuxer.video_queue, demuxer.can_read_video, &out));
+}
+
+test "video catch-up drops packets up to the first keyframe past the target" {
+    var demuxer = std.mem.zeroes(c.Demuxer);
+    demuxer.mutex = c.SDL_CreateMutex();
+    defer c.SDL_DestroyMutex(demuxer.mutex);
+    demuxer.can_read_video = c.SDL_CreateCondition();
+    defer c.SDL_DestroyCondition(demuxer.can_read_video);
+    defer queueRelease(&demuxer.video_queue);
+    demuxer.video_queue.limits = default_video_limits;
+    var stream = std.mem.zeroes(c.AVStream);
+    stream.time_base = .{ .num = 1, .den = 1000 };
+    demuxer.video_stream = &stream;
+
+    var payload = [_]u8{ 1, 2, 3, 4 };
+    var src = std.mem.zeroes(c.AVPacket);
+    const packets = [_]struct { pts: i64, key: bool }{
+        .{ .pts = 0, .key = true },
+        .{ .pts = 1000, .key = true },
+        .{ .pts = 1040, .key = false },
+        .{ .pts = 2000, .key = true },
+        .{ .pts = 2040, .key = false },
+    };
+    for (packets) |packet| {
+        src.data = &payload;
+        src.size = 4;
+        src.pts = packet.pts;
+        src.flags = if (packet.key) c.AV_PKT_FLAG_KEY else 0;
+        try std.testing.expectEqual(@as(c_int, 0), queuePush(&demuxer.video_queue, &src, 0, 0));
+    }
+    markEof(&demuxer);
+
+    var out = std.mem.zeroes(c.AVPacket);
+    defer c.av_packet_unref(&out);
+    try std.testing.expectEqual(@as(c_int, 0), demuxer_skip_video_to_keyframe(&demuxer, 1.5));
+    try std.testing.expectEqual(@as(c_int, 1), demuxerPopPacket(&demuxer, &demuxer.video_queue, demuxer.can_read_video, &out));
+    try std.testing.expectEqual(@as(i64, 2000), out.pts);
+    try std.testing.expectEqual(@as(c_int, 1), demuxerPopPacket(&demuxer, &demuxer.video_queue, demuxer.can_read_video, &out));
+    try std.testing.expectEqual(@as(i64, 2040), out.pts);
+    try std.testing.expectEqual(@as(c_int, 0), demuxer.video_catch_up);
+}
+
+test "a seek on an audio-only pipe resumes at the first audio packet past the target" {
+    var demuxer = std.mem.zeroes(c.Demuxer);
+    demuxer.source_kind = c.DEMUXER_SOURCE_PIPE;
+    demuxer.routed_video_stream_index = -1;
+    demuxer.routed_audio_stream_index = 0;
+    demuxer.fmt_ctx = c.avformat_alloc_context();
+    defer c.avformat_free_context(demuxer.fmt_ctx);
+
+    // No seek callback: libavformat treats the context as a pipe.
+    const buffer: [*c]u8 = @ptrCast(c.av_malloc(4096));
+    var pb = c.avio_alloc_context(buffer, 4096, 0, null, null, null, null);
+    defer {
+        c.av_freep(@ptrCast(&pb.*.buffer));
+        c.avio_context_free(&pb);
+    }
+    demuxer.fmt_ctx.*.pb = pb;
+    try std.testing.expect(!sourceSeekable(&demuxer));
+
+    var stream = std.mem.zeroes(c.AVStream);
+    stream.time_base = .{ .num = 1, .den = 1000 };
+    var packet = std.mem.zeroes(c.AVPacket);
+    packet.dts = c.AV_NOPTS_VALUE;
+
+    try std.testing.expectEqual(@as(c_int, 0), seekSource(&demuxer, 2.0));
+    try std.testing.expectEqual(@as(c_int, 1), demuxer.skip_forward);
+    packet.pts = 1500;
+    try std.testing.expect(!reachedSkipTarget(&demuxer, false, &stream, &packet));
+    packet.pts = 2000;
+    try std.testing.expect(reachedSkipTarget(&demuxer, false, &stream, &packet));
+    try std.testing.expectEqual(@as(c_int, 0), demuxer.skip_forward);
+
+    // With video routed, only a video keyframe ends the skip.
+    demuxer.routed_video_stream_index = 1;
+    try std.testing.expectEqual(@as(c_int, 0), seekSource(&demuxer, 2.0));
+    packet.pts = 3000;
+    try std.testing.expect(!reachedSkipTarget(&demuxer, false, &stream, &packet));
+    packet.flags = c.AV_PKT_FLAG_KEY;
+    try std.testing.expect(reachedSkipTarget(&demuxer, true, &stream, &packet));
+}
+
+test "a latency trim on an audio-only live stream keeps the audio after the trim point" {
+    var demuxer = std.mem.zeroes(c.Demuxer);
+    demuxer.live = 1;
+    demuxer.routed_video_stream_index = -1;
+    demuxer.routed_audio_stream_index = 0;
+
+    var stream = std.mem.zeroes(c.AVStream);
+    stream.time_base = .{ .num = 1, .den = 90000 };
+    var packet = std.mem.zeroes(c.AVPacket);
+    packet.dts = c.AV_NOPTS_VALUE;
+
+    // PlaybackSession trims with a seek to a point behind the live edge.
+    try std.testing.expectEqual(@as(c_int, 0), seekSource(&demuxer, 10.0));
+    try std.testing.expectEqual(@as(c_int, 1), demuxer.skip_forward);
+    packet.pts = 90000 * 9;
+    try std.testing.expect(!reachedSkipTarget(&demuxer, false, &stream, &packet));
+    packet.pts = 90000 * 10 + 1800;
+    try std.testing.expect(reachedSkipTarget(&demuxer, false, &stream, &packet));
+
+    // Audio after the trim point is no longer skipped.
+    try std.testing.expectEqual(@as(c_int, 0), demuxer.skip_forward);
+}
+
+test "seek results follow the generation they were applied for" {
+    var demuxer = std.mem.zeroes(c.Demuxer);
+    demuxer.mutex = c.SDL_CreateMutex();
+    defer c.SDL_DestroyMutex(demuxer.mutex);
+
+    try std.testing.expectEqual(@as(c_int, 1), demuxer_get_seek_result(&demuxer, 1, null));
+    noteSeekResult(&demuxer, 1, 0);
+    try std.testing.expectEqual(@as(c_int, 0), demuxer_get_seek_result(&demuxer, 1, null));
+
+    // Generation 2 was superseded by 3 before the demux thread got to it.
+    try std.testing.expectEqual(@as(c_int, 1), demuxer_get_seek_result(&demuxer, 2, null));
+    demuxer.read_position_us = 42_500_000;
+    noteSeekResult(&demuxer, 3, c.AVERROR(c.EIO));
+    var resume_seconds: f64 = 0.0;
+    try std.testing.expectEqual(@as(c_int, -1), demuxer_get_seek_result(&demuxer, 2, &resume_seconds));
+    try std.testing.expectEqual(@as(f64, 42.5), resume_seconds);
+    try std.testing.expectEqual(@as(c_int, -1), demuxer_get_seek_result(&demuxer, 3, null));
+
+    noteSeekResult(&demuxer, std.math.minInt(c_int), 0);
+    try std.testing.expectEqual(@as(c_int, 0), demuxer_get_seek_result(&demuxer, std.math.maxInt(c_int), null));
+}
+
+test "parseProbeMode only opts out of fast probing explicitly" {
+    try std.testing.expectEqual(@as(c_int, c.DEMUXER_PROBE_FULL), parseProbeMode(" FULL "));
+    try std.testing.expectEqual(@as(c_int, c.DEMUXER_PROBE_FAST), parseProbeMode("fast"));
+    try std.testing.expectEqual(@as(c_int, c.DEMUXER_PROBE_FAST), parseProbeMode("bogus"));
+}
+
+test "parseLiveMode detects live schemes unless overridden" {
+    try std.testing.expect(parseLiveMode("", "udp://239.0.0.1:1234"));
+    try std.testing.expect(parseLiveMode("auto", "SRT://host:9000?mode=caller"));
+    try std.testing.expect(!parseLiveMode("auto", "http://host/clip.mp4"));
+    try std.testing.expect(!parseLiveMode("auto", "/media/udp_capture.ts"));
+    try std.testing.expect(parseLiveMode(" ON ", "http://host/stream.ts"));
+    try std.testing.expect(!parseLiveMode("0", "rtsp://camera/stream"));
+}
+
+test "the live edge advances past reordered pts and follows timestamp resets" {
+    var demuxer = std.mem.zeroes(c.Demuxer);
+    demuxer.live = 1;
+    demuxer.mutex = c.SDL_CreateMutex();
+    defer c.SDL_DestroyMutex(demuxer.mutex);
+
+    var stream = std.mem.zeroes(c.AVStream);
+    stream.time_base = .{ .num = 1, .den = 90000 };
+    var packet = std.mem.zeroes(c.AVPacket);
+    packet.dts = c.AV_NOPTS_VALUE;
+
+    var edge: f64 = 0.0;
+    var age: f64 = 0.0;
+    try std.testing.expectEqual(@as(c_int, -1), demuxer_get_live_edge(&demuxer, &edge, &age));
+
+    for ([_]i64{ 90000 * 10, 90000 * 12, 90000 * 11 }) |pts| {
+        packet.pts = pts;
+        noteLiveEdge(&demuxer, &stream, &packet);
+    }
+    try std.testing.expectEqual(@as(c_int, 0), demuxer_get_live_edge(&demuxer, &edge, &age));
+    try std.testing.expectApproxEqAbs(@as(f64, 12.0), edge, 1e-9);
+    try std.testing.expect(age >= 0.0);
+
+    packet.pts = 90000;
+    noteLiveEdge(&demuxer, &stream, &packet);
+    try std.testing.expectEqual(@as(c_int, 0), demuxer_get_live_edge(&demuxer, &edge, &age));
+    try std.testing.expectApproxEqAbs(@as(f64, 1.0), edge, 1e-9);
+}
+
+test "live mode receives a local MPEG-TS/UDP sender at the live edge" {
+    if (!test_sender.supported) {
+        return error.SkipZigTest;
+    }
+    const sender = test_sender.TestLiveSender.start(std.testing.allocator) catch return error.SkipZigTest;
+    defer sender.stop();
+
+    var url_buf: [64]u8 = undefined;
+    const url = try sender.url(&url_buf);
+    const options = c.DemuxerOpenOptions{
+        .io_backend = c.DEMUXER_IO_BACKEND_DEFAULT,
+        .probe_mode = c.DEMUXER_PROBE_FAST,
+        .memory_data = null,
+        .memory_size = 0,
+        .live = 1,
+    };
+    var demuxer: c.Demuxer = undefined;
+    try std.testing.expectEqual(@as(c_int, 0), demuxer_open_with_options(&demuxer, url.ptr, &options));
+    defer demuxer_close(&demuxer);
+    try std.testing.expectEqual(@as(c_int, c.DEMUXER_PROBE_SOURCE_LIVE), demuxer.probe_source);
+    try std.testing.expectEqual(@as(c_int, 0), demuxer_is_seekable(&demuxer));
+    try std.testing.expectEqual(@as(c_int, 0), demuxer_start(&demuxer));
+
+    var packet = std.mem.zeroes(c.AVPacket);
+    defer c.av_packet_unref(&packet);
+    for (0..10) |_| {
+        try std.testing.expectEqual(@as(c_int, 1), demuxer_pop_video_packet(&demuxer, &packet));
+    }
+
+    // Drained as fast as it arrives, the stream stays within a few frames of
+    // the edge.
+    var edge: f64 = 0.0;
+    var age: f64 = 0.0;
+    try std.testing.expectEqual(@as(c_int, 0), demuxer_get_live_edge(&demuxer, &edge, &age));
+    const time_base = demuxer.video_stream.*.time_base;
+    const popped = @as(f64, @floatFromInt(packet.pts)) * @as(f64, @floatFromInt(time_base.num)) / @as(f64, @floatFromInt(time_base.den));
+    try std.testing.expect(edge >= popped);
+    try std.testing.expect(edge - popped + age < 0.5);
+}
+
+test "parseKeyframeIndexMode defaults to lazy indexing" {
+    try std.testing.expectEqual(KeyframeIndexMode.off, parseKeyframeIndexMode("off"));
+    try std.testing.expectEqual(KeyframeIndexMode.off, parseKeyframeIndexMode("0"));
+    try std.testing.expectEqual(KeyframeIndexMode.scan, parseKeyframeIndexMode(" Scan "));
+    try std.testing.expectEqual(KeyframeIndexMode.lazy, parseKeyframeIndexMode("lazy"));
+    try std.testing.expectEqual(KeyframeIndexMode.lazy, parseKeyframeIndexMode(""));
+}
+
+test "keyframe indexing covers MPEG-TS and raw streams but not indexed containers" {
+    for ([_][:0]const u8{ "mpegts", "h264", "hevc" }) |name| {
+        const iformat = c.av_find_input_format(name.ptr);
+        if (iformat == null) return error.SkipZigTest;
+        try std.testing.expect(keyframeIndexFormat(iformat));
+    }
+    for ([_][:0]const u8{ "matroska", "mov" }) |name| {
+        const iformat = c.av_find_input_format(name.ptr);
+        if (iformat == null) return error.SkipZigTest;
+        try std.testing.expect(!keyframeIndexFormat(iformat));
+    }
+}
+
+test "keyframeTimestampUs keeps positioned keyframes only" {
+    var stream = std.mem.zeroes(c.AVStream);
+    stream.time_base = .{ .num = 1, .den = 90000 };
+
+    var packet = std.mem.zeroes(c.AVPacket);
+    packet.pts = 90000 * 3;
+    packet.dts = c.AV_NOPTS_VALUE;
+    packet.pos = 188 * 1000;
+    try std.testing.expectEqual(@as(?i64, null), keyframeTimestampUs(&stream, &packet));
+
+    packet.flags = c.AV_PKT_FLAG_KEY;
+    try std.testing.expectEqual(@as(?i64, 3 * std.time.us_per_s), keyframeTimestampUs(&stream, &packet));
+
+    packet.pts = c.AV_NOPTS_VALUE;
+    packet.dts = 90000;
+    try std.testing.expectEqual(@as(?i64, std.time.us_per_s), keyframeTimestampUs(&stream, &packet));
+
+    packet.pos = -1;
+    try std.testing.expectEqual(@as(?i64, null), keyframeTimestampUs(&stream, &packet));
+}
+
+test "slotIndex wraps ring positions across integer overflow" {
+    try std.testing.expectEqual(@as(usize, 0), slotIndex(0));
+    try std.testing.expectEqual(@as(usize, 1), slotIndex(capacity() + 1));
+    try std.testing.expectEqual(@as(usize, @intCast(capacity() - 1)), slotIndex(-1));
+    try std.testing.expectEqual(@as(usize, 0), slotIndex(std.math.minInt(c_int)));
+}
+
+test "queuePush and queuePop preserve fifo order and capacity" {
+    var queue: c.DemuxerPacketQueue = std.mem.zeroes(c.DemuxerPacketQueue);
+    defer queueRelease(&queue);
+
+    var src = std.mem.zeroes(c.AVPacket);
+    var i: c_int = 0;
+    while (i < capacity()) : (i += 1) {
+        src.pts = i;
+        try std.testing.expectEqual(@as(c_int, 0), queuePush(&queue, &src, 0, 0));
+    }
+    try std.testing.expectEqual(@as(c_int, -1), queuePush(&queue, &src, 0, 0));
+    try std.testing.expectEqual(capacity(), queueCount(&queue));
+
+    const out: *c.AVPacket = c.av_packet_alloc() orelse return error.OutOfMemory;
+    defer {
+        var out_copy: ?*c.AVPacket = out;
+        c.av_packet_free(&out_copy);
+    }
+
+    try std.testing.expectEqual(@as(c_int, 0), queuePop(&queue, out));
+    try std.testing.expectEqual(@as(i64, 0), out.*.pts);
+    c.av_packet_unref(out);
+    try std.testing.expectEqual(@as(c_int, 0), queuePop(&queue, out));
+    try std.testing.expectEqual(@as(i64, 1), out.*.pts);
+    try std.testing.expectEqual(capacity() - 2, queueCount(&queue));
+}
+
+test "queuePop reports empty ring" {
+    var queue: c.DemuxerPacketQueue = std.mem.zeroes(c.DemuxerPacketQueue);
+    var out = std.mem.zeroes(c.AVPacket);
+    try std.testing.expectEqual(@as(c_int, -1), queuePop(&queue, &out));
+}
+
+test "parseQueueLimits reads megabytes, seconds and watermark" {
+    const limits = parseQueueLimits("32,2.5,0.5", default_video_limits);
+    try std.testing.expectEqual(@as(i64, 32 * 1024 * 1024), limits.max_bytes);
+    try std.testing.expectEqual(@as(f64, 2.5), limits.max_duration);
+    try std.testing.expectEqual(@as(f64, 0.5), limits.low_watermark);
+}
+
+test "parseQueueLimits keeps defaults for missing or invalid fields" {
+    const limits = parseQueueLimits(",abc", default_audio_limits);
+    try std.testing.expectEqual(default_audio_limits.max_bytes, limits.max_bytes);
+    try std.testing.expectEqual(default_audio_limits.max_duration, limits.max_duration);
+    try std.testing.expectEqual(default_audio_limits.low_watermark, limits.low_watermark);
+
+    const clamped = parseQueueLimits("100000,100000", default_video_limits);
+    try std.testing.expectEqual(max_limit_bytes, clamped.max_bytes);
+    try std.testing.expectEqual(max_limit_seconds, clamped.max_duration);
+}
+
+test "queue watermarks apply byte and duration budgets with hysteresis" {
+    var queue: c.DemuxerPacketQueue = std.mem.zeroes(c.DemuxerPacketQueue);
+    defer queueRelease(&queue);
+    queue.limits = .{ .max_bytes = 1000, .max_duration = 1.0, .low_watermark = 0.5 };
+
+    try std.testing.expect(!queueAboveHighWatermark(&queue));
+    try std.testing.expect(queueBelowLowWatermark(&queue));
+
+    var payload: [400]u8 = [_]u8{0} ** 400;
+    var src = std.mem.zeroes(c.AVPacket);
+
+    var pushed: usize = 0;
+    while (pushed < 3) : (pushed += 1) {
+        src.data = &payload;
+        src.size = payload.len;
+        try std.testing.expectEqual(@as(c_int, 0), queuePush(&queue, &src, 100_000, 0));
+        if (pushed == 0) {
+            try std.testing.expect(!queueAboveHighWatermark(&queue));
+        }
+    }
+    try std.testing.expect(queueAboveHighWatermark(&queue));
+    try std.testing.expect(!queueBelowLowWatermark(&queue));
+
+    var out = std.mem.zeroes(c.AVPacket);
+    try std.testing.expectEqual(@as(c_int, 0), queuePop(&queue, &out));
+    c.av_packet_unref(&out);
+    try std.testing.expect(!queueAboveHighWatermark(&queue));
+    try std.testing.expect(!queueBelowLowWatermark(&queue));
+
+    try std.testing.expectEqual(@as(c_int, 0), queuePop(&queue, &out));
+    c.av_packet_unref(&out);
+    try std.testing.expect(queueBelowLowWatermark(&queue));
+    try std.testing.expectEqual(@as(i64, 400), queueBytes(&queue));
+}
+
+test "queue duration budget stops sparse streams by time" {
+    var queue: c.DemuxerPacketQueue = std.mem.zeroes(c.DemuxerPacketQueue);
+    defer queueRelease(&queue);
+    queue.limits = .{ .max_bytes = 1024 * 1024, .max_duration = 0.5, .low_watermark = 0.5 };
+
+    var src = std.mem.zeroes(c.AVPacket);
+    var i: usize = 0;
+    while (i < 25) : (i += 1) {
+        try std.testing.expectEqual(@as(c_int, 0), queuePush(&queue, &src, 20_000, 0));
+    }
+
+    try std.testing.expect(queueAboveHighWatermark(&queue));
+    try std.testing.expect(queueFill(&queue) >= 1.0);
+}
+
+test "packet cache keeps whole GOPs behind the newest packet and replays from a keyframe" {
+    const cache = try PacketCache.create(std.testing.allocator, 2 * std.time.us_per_s, 1024 * 1024);
+    defer cache.destroy();
+
+    var packet = c.av_packet_alloc();
+    defer c.av_packet_free(&packet);
+    try std.testing.expect(c.av_new_packet(packet, 64) == 0);
+
+    // One second per GOP; an audio packet between video packets. The leading
+    // audio packet precedes any keyframe and is not cached.
+    cache.append(packet, false, 0);
+    var second: i64 = 0;
+    while (second < 6) : (second += 1) {
+        var frame: i64 = 0;
+        while (frame < 4) : (frame += 1) {
+            packet.*.flags = if (frame == 0) c.AV_PKT_FLAG_KEY else 0;
+            const pts_us = second * std.time.us_per_s + frame * 250_000;
+            cache.append(packet, true, pts_us);
+            cache.append(packet, false, pts_us);
+        }
+    }
+
+    const items = cache.live();
+    try std.testing.expect(items[0].keyframe);
+    try std.testing.expectEqual(@as(i64, 3 * std.time.us_per_s), items[0].pts_us);
+
+    try std.testing.expect(!cache.beginReplay(2 * std.time.us_per_s));
+    try std.testing.expect(!cache.beginReplay(6 * std.time.us_per_s));
+    try std.testing.expect(cache.beginReplay(4 * std.time.us_per_s + 600_000));
+
+    var out = std.mem.zeroes(c.AVPacket);
+    var replayed: usize = 0;
+    while (cache.takeReplay(&out)) : (replayed += 1) {
+        c.av_packet_unref(&out);
+    }
+    // Keyframe at 4 s through the end: two GOPs of four video and four audio packets.
+    try std.testing.expectEqual(@as(usize, 16), replayed);
+    try std.testing.expect(!cache.takeReplay(&out));
+}
+
+test "packet cache drops a single GOP that outgrows the byte budget" {
+    const cache = try PacketCache.create(std.testing.allocator, 10 * std.time.us_per_s, 4 * 1024);
+    defer cache.destroy();
+
+    var packet = c.av_packet_alloc();
+    defer c.av_packet_free(&packet);
+    try std.testing.expect(c.av_new_packet(packet, 1024) == 0);
+
+    // One keyframe, then inter frames only.
+    for (0..12) |i| {
+        packet.*.flags = if (i == 0) c.AV_PKT_FLAG_KEY else 0;
+        cache.append(packet, true, @as(i64, @intCast(i)) * 40_000);
+        try std.testing.expect(cache.bytes <= cache.max_bytes);
+    }
+    try std.testing.expectEqual(@as(usize, 0), cache.live().len);
+
+    // The next keyframe starts a fresh cache.
+    packet.*.flags = c.AV_PKT_FLAG_KEY;
+    cache.append(packet, true, 12 * 40_000);
+    try std.testing.expectEqual(@as(usize, 1), cache.live().len);
+    try std.testing.expect(cache.bytes <= cache.max_bytes);
+}
+
+test "parseBackCacheConfig reads seconds and megabytes or disables the cache" {
+    const config = parseBackCacheConfig("5, 32").?;
+    try std.testing.expectEqual(@as(f64, 5.0), config.seconds);
+    try std.testing.expectEqual(@as(i64, 32 * 1024 * 1024), config.max_bytes);
+    try std.testing.expect(parseBackCacheConfig("0") == null);
+    try std.testing.expect(parseBackCacheConfig("off") == null);
+}
+
+test "full ring overflows its budget only while the other decoder starves" {
+    var demuxer = std.mem.zeroes(c.Demuxer);
+    defer queueRelease(&demuxer.video_queue);
+    demuxer.routed_video_stream_index = 0;
+    demuxer.routed_audio_stream_index = 1;
+    demuxer.video_queue.limits = .{ .max_bytes = 1024 * 1024, .max_duration = 0.5, .low_watermark = 0.5 };
+
+    var src = std.mem.zeroes(c.AVPacket);
+    var i: usize = 0;
+    while (i < 25) : (i += 1) {
+        try std.testing.expectEqual(@as(c_int, 0), queuePush(&demuxer.video_queue, &src, 20_000, 0));
+    }
+    try std.testing.expect(queueAboveHighWatermark(&demuxer.video_queue));
+    try std.testing.expect(!starvationOverflowAllowed(&demuxer, &demuxer.video_queue));
+
+    _ = c.SDL_SetAtomicInt(&demuxer.audio_queue.consumer_waiting, 1);
+    try std.testing.expectEqual(WaitResult.ready, waitForSpace(&demuxer, &demuxer.video_queue));
+    try std.testing.expectEqual(WaitResult.ready, waitForSpace(&demuxer, &demuxer.video_queue));
+    try std.testing.expectEqual(@as(c_int, 1), demuxer.video_queue.starvation_overflows);
+
+    // Four times the duration budget is the hard ceiling.
+    while (i < 100) : (i += 1) {
+        try std.testing.expectEqual(@as(c_int, 0), queuePush(&demuxer.video_queue, &src, 20_000, 0));
+    }
+    try std.testing.expect(!starvationOverflowAllowed(&demuxer, &demuxer.video_queue));
+
+    demuxer.routed_audio_stream_index = -1;
+    try std.testing.expect(otherQueue(&demuxer, &demuxer.video_queue) == null);
+}
+
+test "queue slots recycle packet shells across push and pop" {
+    var queue: c.DemuxerPacketQueue = std.mem.zeroes(c.DemuxerPacketQueue);
+    defer queueRelease(&queue);
+
+    var src = std.mem.zeroes(c.AVPacket);
+    var out = std.mem.zeroes(c.AVPacket);
+
+    var round: c_int = 0;
+    while (round < capacity() * 3) : (round += 1) {
+        src.pts = round;
+        try std.testing.expectEqual(@as(c_int, 0), queuePush(&queue, &src, 0, 0));
+        try std.testing.expectEqual(@as(c_int, 0), queuePop(&queue, &out));
+        try std.testing.expectEqual(@as(i64, round), out.pts);
+        c.av_packet_unref(&out);
+    }
+
+    try std.testing.expectEqual(capacity(), queue.packet_shells);
+
+    queueClear(&queue);
+    try std.testing.expectEqual(capacity(), queue.packet_shells);
+}
+
+test "adaptive switch commits at the first new keyframe past the routed video" {
+    var demuxer = std.mem.zeroes(c.Demuxer);
+    demuxer.mutex = c.SDL_CreateMutex();
+    defer c.SDL_DestroyMutex(demuxer.mutex);
+    demuxer.fmt_ctx = c.avformat_alloc_context();
+    defer c.avformat_free_context(demuxer.fmt_ctx);
+
+    const bitrates = [_][*:0]const u8{ "3000000", "800000" };
+    for (bitrates) |bitrate| {
+        const stream = c.avformat_new_stream(demuxer.fmt_ctx, null);
+        try std.testing.expect(stream != null);
+        stream.*.codecpar.*.codec_type = c.AVMEDIA_TYPE_VIDEO;
+        stream.*.codecpar.*.codec_id = c.AV_CODEC_ID_H264;
+        stream.*.time_base = .{ .num = 1, .den = 90000 };
+        _ = c.av_dict_set(&stream.*.metadata, "variant_bitrate", bitrate, 0);
+    }
+    demuxer.video_stream_index = 0;
+    demuxer.video_stream = demuxer.fmt_ctx.*.streams[0];
+    demuxer.audio_stream_index = -1;
+    applyTrackRouting(&demuxer, 0, -1);
+
+    var abr = AbrController{};
+    buildAbrLadder(&demuxer, &abr);
+    try std.testing.expectEqual(@as(usize, 2), abr.count);
+    try std.testing.expectEqual(@as(c_int, 1), abr.variants[0].video_index);
+    abr.current = 1;
+
+    var packet = std.mem.zeroes(c.AVPacket);
+    packet.stream_index = 0;
+    packet.pts = 4 * 90000;
+    try std.testing.expect(filterAbrPacket(&demuxer, &abr, &packet));
+
+    beginAbrSwitch(&demuxer, &abr, 0, std.time.nanoTimestamp());
+    try std.testing.expectEqual(@as(c_int, c.AVDISCARD_DEFAULT), @as(c_int, demuxer.fmt_ctx.*.streams[1].*.discard));
+
+    packet.stream_index = 1;
+    packet.pts = 5 * 90000;
+    try std.testing.expect(!filterAbrPacket(&demuxer, &abr, &packet));
+    packet.flags = c.AV_PKT_FLAG_KEY;
+    packet.pts = 4 * 90000;
+    try std.testing.expect(!filterAbrPacket(&demuxer, &abr, &packet));
+    try std.testing.expectEqual(@as(c_int, 0), demuxer.video_stream_index);
+
+    packet.pts = 6 * 90000;
+    try std.testing.expect(filterAbrPacket(&demuxer, &abr, &packet));
+    try std.testing.expectEqual(@as(c_int, 1), demuxer.video_stream_index);
+    try std.testing.expectEqual(@as(c_int, 1), demuxer.routed_video_stream_index);
+    try std.testing.expectEqual(@as(c_int, c.AVDISCARD_ALL), @as(c_int, demuxer.fmt_ctx.*.streams[0].*.discard));
+    try std.testing.expectEqual(@as(usize, 0), abr.current);
+    try std.testing.expectEqual(@as(c_int, 1), abr.switches);
+    try std.testing.expect(abr.pending == null);
 }
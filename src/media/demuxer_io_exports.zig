@@ -0,0 +1,670 @@
+const std = @import("std");
+const builtin = @import("builtin");
+const ReadAheadPrefetcher = @import("ReadAheadPrefetcher.zig").ReadAheadPrefetcher;
+const prefetcher_latency_buckets = @import("ReadAheadPrefetcher.zig").latency_bucket_count;
+const PipeReaderMod = @import("PipeReader.zig");
+const PipeReader = PipeReaderMod.PipeReader;
+const HttpRangeCacheMod = @import("HttpRangeCache.zig");
+const HttpRangeCache = HttpRangeCacheMod.HttpRangeCache;
+const c = @cImport({
+    @cInclude("player/demuxer_io.h");
+});
+
+// The mmap backend maps a local file once and serves AVIOContext refills with
+// a memcpy out of the mapping instead of a read(2) per refill. The kernel is
+// told the access pattern is sequential, and the window ahead of the read
+// position is re-advised as playback advances or after a seek.
+//
+// The prefetch backend keeps a window of block reads in flight ahead of the
+// read position (io_uring on Linux, a small thread pool elsewhere), so a slow
+// device stalls the background reads instead of the demux thread.
+//
+// The pipe backend drains a pipe or stdin into a bounded ring on a reader
+// thread and is not seekable. The memory backend serves a caller-owned buffer
+// that must outlive the demuxer.
+//
+// The http backend reads HTTP(S) URLs through a sparse on-disk chunk cache
+// that survives across sessions; see HttpRangeCache.
+
+comptime {
+    std.debug.assert(c.DEMUXER_IO_LATENCY_BUCKETS == prefetcher_latency_buckets);
+}
+
+const mmap_supported = builtin.os.tag != .windows and builtin.os.tag != .wasi;
+
+const avio_buffer_size: c_int = 256 * 1024;
+const default_readahead_bytes: i64 = 8 * 1024 * 1024;
+const default_prefetch_window_bytes: i64 = 16 * 1024 * 1024;
+const max_prefetch_window_bytes: i64 = 256 * 1024 * 1024;
+const default_pipe_buffer_bytes: i64 = 8 * 1024 * 1024;
+
+fn parseIoBackend(value: []const u8) c_int {
+    const trimmed = std.mem.trim(u8, value, " ");
+    if (std.ascii.eqlIgnoreCase(trimmed, "mmap")) {
+        return c.DEMUXER_IO_BACKEND_MMAP;
+    }
+    if (std.ascii.eqlIgnoreCase(trimmed, "prefetch")) {
+        return c.DEMUXER_IO_BACKEND_PREFETCH;
+    }
+    return c.DEMUXER_IO_BACKEND_DEFAULT;
+}
+
+fn parseMegabytes(value: []const u8, default_bytes: i64) i64 {
+    const megabytes = std.fmt.parseFloat(f64, std.mem.trim(u8, value, " ")) catch return default_bytes;
+    if (!(megabytes > 0.0)) {
+        return default_bytes;
+    }
+    const bytes = @min(megabytes * 1024.0 * 1024.0, @as(f64, @floatFromInt(max_prefetch_window_bytes)));
+    return @intFromFloat(bytes);
+}
+
+fn parseWindowBytes(value: []const u8) i64 {
+    return parseMegabytes(value, default_prefetch_window_bytes);
+}
+
+fn megabytesFromEnvironment(name: []const u8, default_bytes: i64) i64 {
+    const value = std.process.getEnvVarOwned(std.heap.page_allocator, name) catch return default_bytes;
+    defer std.heap.page_allocator.free(value);
+    return parseMegabytes(value, default_bytes);
+}
+
+fn prefetchWindowFromEnvironment() i64 {
+    return megabytesFromEnvironment("ZC_DEMUX_IO_WINDOW_MB", default_prefetch_window_bytes);
+}
+
+/// `-` and `pipe:` read stdin; `pipe:<fd>` reads an inherited descriptor.
+fn parsePipeFd(path: []const u8) ?c_int {
+    if (std.mem.eql(u8, path, "-") or std.mem.eql(u8, path, "pipe:")) {
+        return 0;
+    }
+    if (!std.mem.startsWith(u8, path, "pipe:")) {
+        return null;
+    }
+    const fd = std.fmt.parseInt(c_int, path["pipe:".len..], 10) catch return null;
+    return if (fd >= 0) fd else null;
+}
+
+fn httpCacheEnabled() bool {
+    const value = std.process.getEnvVarOwned(std.heap.page_allocator, "ZC_HTTP_CACHE") catch return true;
+    defer std.heap.page_allocator.free(value);
+    const trimmed = std.mem.trim(u8, value, " ");
+    return !(std.mem.eql(u8, trimmed, "0") or std.ascii.eqlIgnoreCase(trimmed, "off"));
+}
+
+fn debugEnabled() bool {
+    const value = std.process.getEnvVarOwned(std.heap.page_allocator, "ZC_DEBUG_DEMUX_IO") catch return false;
+    defer std.heap.page_allocator.free(value);
+    return value.len > 0 and !std.mem.eql(u8, value, "0");
+}
+
+fn ioFromOpaque(opaque_ptr: ?*anyopaque) ?*c.DemuxerIo {
+    const ptr = opaque_ptr orelse return null;
+    return @ptrCast(@alignCast(ptr));
+}
+
+fn prefetcherFrom(io: *const c.DemuxerIo) ?*ReadAheadPrefetcher {
+    const ptr = io.prefetch orelse return null;
+    return @ptrCast(@alignCast(ptr));
+}
+
+fn pipeReaderFrom(io: *const c.DemuxerIo) ?*PipeReader {
+    const ptr = io.pipe orelse return null;
+    return @ptrCast(@alignCast(ptr));
+}
+
+fn httpCacheFrom(io: *const c.DemuxerIo) ?*HttpRangeCache {
+    const ptr = io.http orelse return null;
+    return @ptrCast(@alignCast(ptr));
+}
+
+fn mappedPages(io: *const c.DemuxerIo, start: i64, end: i64) []align(std.heap.page_size_min) u8 {
+    const base: [*]align(std.heap.page_size_min) u8 = @alignCast(@as([*]u8, @ptrCast(io.map_base)));
+    return base[@intCast(start)..@intCast(end)];
+}
+
+fn mapFile(io: *c.DemuxerIo, filepath: [*:0]const u8) !void {
+    if (comptime mmap_supported) {
+        const file = try std.fs.cwd().openFileZ(filepath, .{});
+        defer file.close();
+
+        const size = (try file.stat()).size;
+        if (size == 0 or size > std.math.maxInt(i64)) {
+            return error.UnsupportedFileSize;
+        }
+
+        const mapping = try std.posix.mmap(null, size, std.posix.PROT.READ, .{ .TYPE = .PRIVATE }, file.handle, 0);
+        io.map_base = mapping.ptr;
+        io.size = @intCast(size);
+        std.posix.madvise(mapping.ptr, mapping.len, std.posix.MADV.SEQUENTIAL) catch {};
+    } else {
+        return error.Unsupported;
+    }
+}
+
+fn unmapFile(io: *c.DemuxerIo) void {
+    if (comptime mmap_supported) {
+        if (io.map_base != null and io.size > 0) {
+            std.posix.munmap(mappedPages(io, 0, io.size));
+        }
+    }
+    io.map_base = null;
+    io.size = 0;
+}
+
+fn adviseAhead(io: *c.DemuxerIo) void {
+    if (comptime mmap_supported) {
+        if (io.map_base == null or io.position >= io.size) {
+            return;
+        }
+
+        // Re-advise once half of the current window has been consumed, or when
+        // a seek moved the read position outside of it.
+        const half_window = @divTrunc(io.readahead_bytes, 2);
+        if (io.position >= io.advised_start and io.position + half_window < io.advised_end) {
+            return;
+        }
+
+        const page_size: i64 = @intCast(std.heap.pageSize());
+        const start = io.position - @mod(io.position, page_size);
+        const end = @min(io.size, io.position + io.readahead_bytes);
+        const pages = mappedPages(io, start, end);
+        std.posix.madvise(pages.ptr, pages.len, std.posix.MADV.WILLNEED) catch {};
+
+        io.advised_start = start;
+        io.advised_end = end;
+        io.stats.advise_calls += 1;
+    }
+}
+
+fn mmapReadPacket(opaque_ptr: ?*anyopaque, buf: [*c]u8, buf_size: c_int) callconv(.c) c_int {
+    const io = ioFromOpaque(opaque_ptr) orelse return c.AVERROR(c.EINVAL);
+    if (buf == null or buf_size <= 0) {
+        return c.AVERROR(c.EINVAL);
+    }
+
+    if (io.position >= io.size) {
+        return c.AVERROR_EOF;
+    }
+
+    adviseAhead(io);
+
+    const count: usize = @intCast(@min(@as(i64, buf_size), io.size - io.position));
+    const offset: usize = @intCast(io.position);
+    @memcpy(buf[0..count], io.map_base[offset .. offset + count]);
+
+    io.position += @intCast(count);
+    io.stats.read_calls += 1;
+    io.stats.bytes_read += @intCast(count);
+    return @intCast(count);
+}
+
+fn openPrefetcher(io: *c.DemuxerIo, filepath: [*:0]const u8) !void {
+    const prefetcher = try ReadAheadPrefetcher.create(std.heap.page_allocator, std.mem.span(filepath), .{
+        .window_bytes = @intCast(prefetchWindowFromEnvironment()),
+    });
+    io.prefetch = prefetcher;
+    io.size = @intCast(prefetcher.size());
+    io.readahead_bytes = @intCast(prefetcher.windowBytes());
+}
+
+fn closePrefetcher(io: *c.DemuxerIo) void {
+    if (prefetcherFrom(io)) |prefetcher| {
+        prefetcher.destroy();
+    }
+    io.prefetch = null;
+}
+
+fn prefetchReadPacket(opaque_ptr: ?*anyopaque, buf: [*c]u8, buf_size: c_int) callconv(.c) c_int {
+    const io = ioFromOpaque(opaque_ptr) orelse return c.AVERROR(c.EINVAL);
+    const prefetcher = prefetcherFrom(io) orelse return c.AVERROR(c.EINVAL);
+    if (buf == null or buf_size <= 0) {
+        return c.AVERROR(c.EINVAL);
+    }
+
+    const count = prefetcher.read(@intCast(io.position), buf[0..@intCast(buf_size)]) catch return c.AVERROR(c.EIO);
+    if (count == 0) {
+        return c.AVERROR_EOF;
+    }
+
+    io.position += @intCast(count);
+    io.stats.read_calls += 1;
+    io.stats.bytes_read += @intCast(count);
+    return @intCast(count);
+}
+
+fn pipeReadPacket(opaque_ptr: ?*anyopaque, buf: [*c]u8, buf_size: c_int) callconv(.c) c_int {
+    const io = ioFromOpaque(opaque_ptr) orelse return c.AVERROR(c.EINVAL);
+    const reader = pipeReaderFrom(io) orelse return c.AVERROR(c.EINVAL);
+    if (buf == null or buf_size <= 0) {
+        return c.AVERROR(c.EINVAL);
+    }
+
+    const count = reader.read(buf[0..@intCast(buf_size)]) catch |err| switch (err) {
+        error.Cancelled => return c.AVERROR_EXIT,
+        else => return c.AVERROR(c.EIO),
+    };
+    if (count == 0) {
+        return c.AVERROR_EOF;
+    }
+
+    io.position += @intCast(count);
+    io.stats.read_calls += 1;
+    io.stats.bytes_read += @intCast(count);
+    return @intCast(count);
+}
+
+fn memoryReadPacket(opaque_ptr: ?*anyopaque, buf: [*c]u8, buf_size: c_int) callconv(.c) c_int {
+    const io = ioFromOpaque(opaque_ptr) orelse return c.AVERROR(c.EINVAL);
+    if (buf == null or buf_size <= 0 or io.memory_base == null) {
+        return c.AVERROR(c.EINVAL);
+    }
+
+    if (io.position >= io.size) {
+        return c.AVERROR_EOF;
+    }
+
+    const count: usize = @intCast(@min(@as(i64, buf_size), io.size - io.position));
+    const offset: usize = @intCast(io.position);
+    @memcpy(buf[0..count], io.memory_base[offset .. offset + count]);
+
+    io.position += @intCast(count);
+    io.stats.read_calls += 1;
+    io.stats.bytes_read += @intCast(count);
+    return @intCast(count);
+}
+
+fn httpReadPacket(opaque_ptr: ?*anyopaque, buf: [*c]u8, buf_size: c_int) callconv(.c) c_int {
+    const io = ioFromOpaque(opaque_ptr) orelse return c.AVERROR(c.EINVAL);
+    const cache = httpCacheFrom(io) orelse return c.AVERROR(c.EINVAL);
+    if (buf == null or buf_size <= 0) {
+        return c.AVERROR(c.EINVAL);
+    }
+
+    const count = cache.read(@intCast(io.position), buf[0..@intCast(buf_size)]) catch |err| switch (err) {
+        error.Cancelled => return c.AVERROR_EXIT,
+        error.OutOfMemory => return c.AVERROR(c.ENOMEM),
+        else => return c.AVERROR(c.EIO),
+    };
+    if (count == 0) {
+        return c.AVERROR_EOF;
+    }
+
+    io.position += @intCast(count);
+    io.stats.read_calls += 1;
+    io.stats.bytes_read += @intCast(count);
+    return @intCast(count);
+}
+
+fn ioSeek(opaque_ptr: ?*anyopaque, offset: i64, whence: c_int) callconv(.c) i64 {
+    const io = ioFromOpaque(opaque_ptr) orelse return c.AVERROR(c.EINVAL);
+
+    if ((whence & c.AVSEEK_SIZE) != 0) {
+        return io.size;
+    }
+
+    const base: i64 = switch (whence & ~@as(c_int, c.AVSEEK_FORCE)) {
+        c.SEEK_SET => 0,
+        c.SEEK_CUR => io.position,
+        c.SEEK_END => io.size,
+        else => return c.AVERROR(c.EINVAL),
+    };
+
+    const target = base + offset;
+    if (target < 0) {
+        return c.AVERROR(c.EINVAL);
+    }
+
+    io.position = @min(target, io.size);
+    io.stats.seek_calls += 1;
+    return io.position;
+}
+
+pub export fn demuxer_io_backend_from_environment() c_int {
+    const value = std.process.getEnvVarOwned(std.heap.page_allocator, "ZC_DEMUX_IO") catch return c.DEMUXER_IO_BACKEND_DEFAULT;
+    defer std.heap.page_allocator.free(value);
+    return parseIoBackend(value);
+}
+
+pub export fn demuxer_io_open(io_ptr: ?*c.DemuxerIo, filepath: [*c]const u8, backend: c_int) c_int {
+    const io = io_ptr orelse return -1;
+    io.* = std.mem.zeroes(c.DemuxerIo);
+    io.backend = c.DEMUXER_IO_BACKEND_DEFAULT;
+    if (filepath == null) {
+        return -1;
+    }
+
+    const read_packet: *const fn (?*anyopaque, [*c]u8, c_int) callconv(.c) c_int = switch (backend) {
+        c.DEMUXER_IO_BACKEND_MMAP => mmapReadPacket,
+        c.DEMUXER_IO_BACKEND_PREFETCH => prefetchReadPacket,
+        else => return 0,
+    };
+
+    const path: [*:0]const u8 = @ptrCast(filepath);
+    const opened = if (backend == c.DEMUXER_IO_BACKEND_MMAP) blk: {
+        io.readahead_bytes = default_readahead_bytes;
+        break :blk mapFile(io, path);
+    } else openPrefetcher(io, path);
+    opened catch {
+        demuxer_io_close(io);
+        return -1;
+    };
+
+    return attachContext(io, backend, read_packet, ioSeek);
+}
+
+fn attachContext(
+    io: *c.DemuxerIo,
+    backend: c_int,
+    read_packet: *const fn (?*anyopaque, [*c]u8, c_int) callconv(.c) c_int,
+    seek: ?*const fn (?*anyopaque, i64, c_int) callconv(.c) i64,
+) c_int {
+    const buffer: [*c]u8 = @ptrCast(c.av_malloc(@intCast(avio_buffer_size)));
+    if (buffer == null) {
+        demuxer_io_close(io);
+        return -1;
+    }
+
+    io.avio = c.avio_alloc_context(buffer, avio_buffer_size, 0, io, read_packet, null, seek);
+    if (io.avio == null) {
+        c.av_free(buffer);
+        demuxer_io_close(io);
+        return -1;
+    }
+    if (seek == null) {
+        io.avio.*.seekable = 0;
+    }
+
+    io.backend = backend;
+    return 0;
+}
+
+pub export fn demuxer_io_pipe_fd(filepath: [*c]const u8) c_int {
+    if (filepath == null) {
+        return -1;
+    }
+    const path: [*:0]const u8 = @ptrCast(filepath);
+    return parsePipeFd(std.mem.span(path)) orelse -1;
+}
+
+pub export fn demuxer_io_open_pipe(io_ptr: ?*c.DemuxerIo, fd: c_int) c_int {
+    const io = io_ptr orelse return -1;
+    io.* = std.mem.zeroes(c.DemuxerIo);
+    io.backend = c.DEMUXER_IO_BACKEND_DEFAULT;
+    if (comptime !PipeReaderMod.supported) {
+        return -1;
+    } else {
+        if (fd < 0) {
+            return -1;
+        }
+
+        const buffer_bytes = megabytesFromEnvironment("ZC_DEMUX_PIPE_BUFFER_MB", default_pipe_buffer_bytes);
+        const reader = PipeReader.create(std.heap.page_allocator, fd, @intCast(buffer_bytes)) catch return -1;
+        io.pipe = reader;
+        io.readahead_bytes = @intCast(reader.ring.len);
+        return attachContext(io, c.DEMUXER_IO_BACKEND_PIPE, pipeReadPacket, null);
+    }
+}
+
+pub export fn demuxer_io_open_memory(io_ptr: ?*c.DemuxerIo, data: [*c]const u8, size: i64) c_int {
+    const io = io_ptr orelse return -1;
+    io.* = std.mem.zeroes(c.DemuxerIo);
+    io.backend = c.DEMUXER_IO_BACKEND_DEFAULT;
+    if (data == null or size <= 0) {
+        return -1;
+    }
+
+    io.memory_base = data;
+    io.size = size;
+    return attachContext(io, c.DEMUXER_IO_BACKEND_MEMORY, memoryReadPacket, ioSeek);
+}
+
+pub export fn demuxer_io_is_http_url(filepath: [*c]const u8) c_int {
+    if (filepath == null) {
+        return 0;
+    }
+    const path: [*:0]const u8 = @ptrCast(filepath);
+    return @intFromBool(HttpRangeCacheMod.isHttpUrl(std.mem.span(path)));
+}
+
+/// Fails for servers that report no length (live or chunked responses) and
+/// when `ZC_HTTP_CACHE=off`; the caller then streams the URL uncached.
+pub export fn demuxer_io_open_http(io_ptr: ?*c.DemuxerIo, url: [*c]const u8) c_int {
+    const io = io_ptr orelse return -1;
+    io.* = std.mem.zeroes(c.DemuxerIo);
+    io.backend = c.DEMUXER_IO_BACKEND_DEFAULT;
+    if (url == null or !httpCacheEnabled()) {
+        return -1;
+    }
+
+    const path: [*:0]const u8 = @ptrCast(url);
+    const cache = HttpRangeCache.create(std.heap.page_allocator, std.mem.span(path), .{}) catch return -1;
+    io.http = cache;
+    io.size = @intCast(cache.size());
+    return attachContext(io, c.DEMUXER_IO_BACKEND_HTTP, httpReadPacket, ioSeek);
+}
+
+pub export fn demuxer_io_cancel(io_ptr: ?*c.DemuxerIo) void {
+    const io = io_ptr orelse return;
+    if (pipeReaderFrom(io)) |reader| {
+        reader.cancel();
+    }
+    if (httpCacheFrom(io)) |cache| {
+        cache.cancel();
+    }
+}
+
+/// Undoes `demuxer_io_cancel` before the demux thread restarts.
+pub export fn demuxer_io_rearm(io_ptr: ?*c.DemuxerIo) void {
+    const io = io_ptr orelse return;
+    if (pipeReaderFrom(io)) |reader| {
+        reader.rearm();
+    }
+    if (httpCacheFrom(io)) |cache| {
+        cache.rearm();
+    }
+}
+
+pub export fn demuxer_io_close(io_ptr: ?*c.DemuxerIo) void {
+    const io = io_ptr orelse return;
+
+    if (io.backend != c.DEMUXER_IO_BACKEND_DEFAULT and debugEnabled()) {
+        var stats: c.DemuxerIoStats = undefined;
+        _ = demuxer_io_get_stats(io, &stats);
+        std.debug.print("demuxer_io_close: backend={d} reads={d} bytes={d} seeks={d} advise={d} hits={d} stalls={d} stall_us={d} failed={d} pipe_reader_stalls={d} pipe_writer_stalls={d} pipe_peak={d} http_hits={d} http_misses={d} http_downloaded={d} http_failed={d}\n", .{
+            io.backend,
+            stats.read_calls,
+            stats.bytes_read,
+            stats.seek_calls,
+            stats.advise_calls,
+            stats.prefetch_hits,
+            stats.prefetch_stalls,
+            stats.prefetch_stall_us,
+            stats.prefetch_failed_reads,
+            stats.pipe_reader_stalls,
+            stats.pipe_writer_stalls,
+            stats.pipe_peak_buffered,
+            stats.http_cache_hits,
+            stats.http_cache_misses,
+            stats.http_bytes_downloaded,
+            stats.http_failed_fetches,
+        });
+        if (stats.prefetch_hits + stats.prefetch_stalls > 0) {
+            std.debug.print("demuxer_io_close: read latency histogram (log2 us buckets) {any}\n", .{stats.latency_us_histogram});
+        }
+    }
+
+    if (io.avio != null) {
+        c.av_freep(@ptrCast(&io.avio.*.buffer));
+        c.avio_context_free(&io.avio);
+    }
+
+    closePrefetcher(io);
+    if (pipeReaderFrom(io)) |reader| {
+        reader.destroy();
+    }
+    io.pipe = null;
+    if (httpCacheFrom(io)) |cache| {
+        cache.destroy();
+    }
+    io.http = null;
+    io.memory_base = null;
+    unmapFile(io);
+    io.position = 0;
+    io.advised_start = 0;
+    io.advised_end = 0;
+    io.backend = c.DEMUXER_IO_BACKEND_DEFAULT;
+}
+
+pub export fn demuxer_io_get_stats(io_ptr: ?*const c.DemuxerIo, out_stats: ?*c.DemuxerIoStats) c_int {
+    const io = io_ptr orelse return -1;
+    const out = out_stats orelse return -1;
+    out.* = io.stats;
+
+    if (prefetcherFrom(io)) |prefetcher| {
+        const stats = prefetcher.stats;
+        out.prefetch_hits = stats.hits;
+        out.prefetch_stalls = stats.stalls;
+        out.prefetch_stall_us = @intCast(stats.stall_ns / std.time.ns_per_us);
+        out.prefetch_failed_reads = stats.failed_reads;
+        for (&out.latency_us_histogram, stats.latency_histogram) |*dst, count| {
+            dst.* = count;
+        }
+    }
+    if (pipeReaderFrom(io)) |reader| {
+        reader.mutex.lock();
+        defer reader.mutex.unlock();
+        out.pipe_reader_stalls = reader.stats.reader_stalls;
+        out.pipe_writer_stalls = reader.stats.writer_stalls;
+        out.pipe_peak_buffered = @intCast(reader.stats.peak_buffered);
+    }
+    if (httpCacheFrom(io)) |cache| {
+        cache.mutex.lock();
+        defer cache.mutex.unlock();
+        out.http_cache_hits = cache.stats.hit_chunks;
+        out.http_cache_misses = cache.stats.miss_chunks;
+        out.http_bytes_downloaded = cache.stats.bytes_downloaded;
+        out.http_failed_fetches = cache.stats.failed_fetches;
+    }
+    return 0;
+}
+
+test "parseIoBackend selects mmap or prefetch and defaults otherwise" {
+    try std.testing.expectEqual(@as(c_int, c.DEMUXER_IO_BACKEND_MMAP), parseIoBackend("mmap"));
+    try std.testing.expectEqual(@as(c_int, c.DEMUXER_IO_BACKEND_MMAP), parseIoBackend(" MMAP "));
+    try std.testing.expectEqual(@as(c_int, c.DEMUXER_IO_BACKEND_PREFETCH), parseIoBackend("Prefetch"));
+    try std.testing.expectEqual(@as(c_int, c.DEMUXER_IO_BACKEND_DEFAULT), parseIoBackend("default"));
+    try std.testing.expectEqual(@as(c_int, c.DEMUXER_IO_BACKEND_DEFAULT), parseIoBackend("bogus"));
+}
+
+fn expectBackendReadsAndSeeks(backend: c_int) !void {
+    var tmp = std.testing.tmpDir(.{});
+    defer tmp.cleanup();
+
+    var contents: [3 * 4096 + 17]u8 = undefined;
+    for (&contents, 0..) |*byte, i| {
+        byte.* = @truncate(i * 7);
+    }
+    try tmp.dir.writeFile(.{ .sub_path = "input.bin", .data = &contents });
+
+    const path = try tmp.dir.realpathAlloc(std.testing.allocator, "input.bin");
+    defer std.testing.allocator.free(path);
+    const path_z = try std.testing.allocator.dupeZ(u8, path);
+    defer std.testing.allocator.free(path_z);
+
+    var io = std.mem.zeroes(c.DemuxerIo);
+    try std.testing.expectEqual(@as(c_int, 0), demuxer_io_open(&io, path_z.ptr, backend));
+    defer demuxer_io_close(&io);
+    try std.testing.expectEqual(backend, io.backend);
+    try std.testing.expectEqual(@as(i64, contents.len), c.avio_size(io.avio));
+
+    var out: [contents.len]u8 = undefined;
+    try std.testing.expectEqual(@as(c_int, contents.len), c.avio_read(io.avio, &out, out.len));
+    try std.testing.expectEqualSlices(u8, &contents, &out);
+
+    try std.testing.expectEqual(@as(i64, 4096), c.avio_seek(io.avio, 4096, c.SEEK_SET));
+    var tail: [16]u8 = undefined;
+    try std.testing.expectEqual(@as(c_int, tail.len), c.avio_read(io.avio, &tail, tail.len));
+    try std.testing.expectEqualSlices(u8, contents[4096 .. 4096 + tail.len], &tail);
+
+    var stats: c.DemuxerIoStats = undefined;
+    try std.testing.expectEqual(@as(c_int, 0), demuxer_io_get_stats(&io, &stats));
+    try std.testing.expect(stats.read_calls > 0);
+    if (backend == c.DEMUXER_IO_BACKEND_MMAP) {
+        try std.testing.expect(stats.advise_calls > 0);
+    } else {
+        try std.testing.expect(stats.prefetch_hits + stats.prefetch_stalls > 0);
+    }
+}
+
+test "mmap backend reads and seeks through the mapped file" {
+    if (comptime !mmap_supported) {
+        return error.SkipZigTest;
+    }
+    try expectBackendReadsAndSeeks(c.DEMUXER_IO_BACKEND_MMAP);
+}
+
+test "prefetch backend reads and seeks through the read-ahead window" {
+    try expectBackendReadsAndSeeks(c.DEMUXER_IO_BACKEND_PREFETCH);
+}
+
+test "parseWindowBytes reads megabytes and clamps" {
+    try std.testing.expectEqual(@as(i64, 32 * 1024 * 1024), parseWindowBytes("32"));
+    try std.testing.expectEqual(default_prefetch_window_bytes, parseWindowBytes("-1"));
+    try std.testing.expectEqual(max_prefetch_window_bytes, parseWindowBytes("100000"));
+}
+
+test "demuxer_io_open falls back for the default backend" {
+    var io = std.mem.zeroes(c.DemuxerIo);
+    try std.testing.expectEqual(@as(c_int, 0), demuxer_io_open(&io, "unused", c.DEMUXER_IO_BACKEND_DEFAULT));
+    try std.testing.expect(io.avio == null);
+    try std.testing.expectEqual(@as(c_int, c.DEMUXER_IO_BACKEND_DEFAULT), io.backend);
+}
+
+test "parsePipeFd accepts stdin aliases and pipe descriptors" {
+    try std.testing.expectEqual(@as(?c_int, 0), parsePipeFd("-"));
+    try std.testing.expectEqual(@as(?c_int, 0), parsePipeFd("pipe:"));
+    try std.testing.expectEqual(@as(?c_int, 5), parsePipeFd("pipe:5"));
+    try std.testing.expectEqual(@as(?c_int, null), parsePipeFd("pipe:x"));
+    try std.testing.expectEqual(@as(?c_int, null), parsePipeFd("/tmp/pipe:3"));
+}
+
+test "memory backend reads and seeks through the caller's buffer" {
+    var contents: [2 * 4096 + 5]u8 = undefined;
+    for (&contents, 0..) |*byte, i| {
+        byte.* = @truncate(i * 3);
+    }
+
+    var io = std.mem.zeroes(c.DemuxerIo);
+    try std.testing.expectEqual(@as(c_int, 0), demuxer_io_open_memory(&io, &contents, contents.len));
+    defer demuxer_io_close(&io);
+    try std.testing.expectEqual(@as(c_int, c.DEMUXER_IO_BACKEND_MEMORY), io.backend);
+    try std.testing.expectEqual(@as(i64, contents.len), c.avio_size(io.avio));
+
+    try std.testing.expectEqual(@as(i64, 4096), c.avio_seek(io.avio, 4096, c.SEEK_SET));
+    var out: [contents.len - 4096]u8 = undefined;
+    try std.testing.expectEqual(@as(c_int, out.len), c.avio_read(io.avio, &out, out.len));
+    try std.testing.expectEqualSlices(u8, contents[4096..], &out);
+}
+
+test "pipe backend streams a pipe and refuses to seek" {
+    if (comptime !PipeReaderMod.supported) {
+        return error.SkipZigTest;
+    }
+
+    const fds = try std.posix.pipe();
+    defer std.posix.close(fds[0]);
+    const payload = "not seekable";
+    _ = try std.posix.write(fds[1], payload);
+    std.posix.close(fds[1]);
+
+    var io = std.mem.zeroes(c.DemuxerIo);
+    try std.testing.expectEqual(@as(c_int, 0), demuxer_io_open_pipe(&io, fds[0]));
+    defer demuxer_io_close(&io);
+    try std.testing.expectEqual(@as(c_int, 0), io.avio.*.seekable);
+
+    var out: [payload.len]u8 = undefined;
+    try std.testing.expectEqual(@as(c_int, payload.len), c.avio_read(io.avio, &out, out.len));
+    try std.testing.expectEqualSlices(u8, payload, &out);
+    // Forward seeks can only skip bytes, and there are none left to skip.
+    try std.testing.expect(c.avio_seek(io.avio, 1 << 20, c.SEEK_SET) < 0);
+}
@@ -1,4 +1,5 @@
 const std = @import("std");
+const MediaReuse = @import("MediaReuse.zig");
 const c = @cImport({
     @cInclude("stdlib.h");
     @cInclude("string.h");
@@ -109,13 +110,8 @@ fn transition(player: ?*c.Player, to: c.PlayerState) c_int {
     return 0;
 }
 
-fn closeMedia(player: *c.Player) void {
-    c.video_decoder_destroy(&player.decoder);
-
-    if (player.has_audio != 0) {
-        c.audio_decoder_destroy(&player.audio_decoder);
-    }
-
+// Leaves the decoders open for the next `openStreams` to reuse.
+fn closeDemuxer(player: *c.Player) void {
     c.demuxer_close(&player.demuxer);
 
     player.has_audio = 0;
@@ -123,6 +119,12 @@ fn closeMedia(player: *c.Player) void {
     player.height = 0;
 }
 
+fn closeMedia(player: *c.Player) void {
+    c.video_decoder_destroy(&player.decoder);
+    c.audio_decoder_destroy(&player.audio_decoder);
+    closeDemuxer(player);
+}
+
 pub export fn player_init(player: ?*c.Player) c_int {
     if (player == null) {
         return -1;
@@ -146,6 +148,8 @@ pub export fn player_init(player: ?*c.Player) c_int {
     setState(player, STATE_STOPPED);
     p.volume = 1.0;
     p.playback_speed = 1.0;
+    p.rate_adjust = 1.0;
+    p.decoder_reuse = if (MediaReuse.enabledFromEnvironment()) 1 else 0;
     return 0;
 }
 
@@ -174,14 +178,78 @@ pub export fn player_destroy(player: ?*c.Player) void {
     }
 }
 
+const OpenResult = enum {
+    ok,
+    demuxer_failed,
+    video_decoder_failed,
+    audio_decoder_failed,
+};
+
+const MemorySource = struct {
+    data: [*c]const u8,
+    size: i64,
+};
+
+fn openStreams(p: *c.Player, filepath: [*c]const u8, probe_mode: c_int, memory: ?MemorySource) OpenResult {
+    const options = c.DemuxerOpenOptions{
+        .io_backend = c.demuxer_io_backend_from_environment(),
+        .probe_mode = probe_mode,
+        .memory_data = if (memory) |m| m.data else null,
+        .memory_size = if (memory) |m| m.size else 0,
+        .live = if (memory == null) c.demuxer_live_mode_from_environment(filepath) else 0,
+    };
+    if (c.demuxer_open_with_options(&p.demuxer, filepath, &options) != 0) {
+        return .demuxer_failed;
+    }
+
+    p.video_decoder_reused = if (c.video_decoder_reuse(&p.decoder, p.demuxer.video_stream) == 0) 1 else 0;
+    if (p.video_decoder_reused == 0) {
+        c.video_decoder_destroy(&p.decoder);
+        if (c.video_decoder_init(&p.decoder, p.demuxer.video_stream) != 0) {
+            return .video_decoder_failed;
+        }
+    }
+
+    p.has_audio = 0;
+    p.audio_decoder_reused = 0;
+    if (p.demuxer.audio_stream == null) {
+        c.audio_decoder_destroy(&p.audio_decoder);
+    } else {
+        p.audio_decoder_reused = if (c.audio_decoder_reuse(&p.audio_decoder, p.demuxer.audio_stream) == 0) 1 else 0;
+        if (p.audio_decoder_reused == 0) {
+            c.audio_decoder_destroy(&p.audio_decoder);
+            if (c.audio_decoder_init(&p.audio_decoder, p.demuxer.audio_stream) != 0) {
+                return .audio_decoder_failed;
+            }
+        }
+        p.has_audio = 1;
+    }
+
+    return .ok;
+}
+
 pub export fn player_open(player: ?*c.Player, filepath: [*c]const u8) c_int {
     if (player == null or filepath == null) {
         return -1;
     }
+    return openMedia(player.?, filepath, null);
+}
 
-    const p = player.?;
+/// `name` labels the source and hints the container by extension; the buffer
+/// must stay valid until the media is closed or replaced.
+pub export fn player_open_memory(player: ?*c.Player, data: [*c]const u8, size: i64, name: [*c]const u8) c_int {
+    if (player == null or data == null or size <= 0) {
+        return -1;
+    }
+    return openMedia(player.?, if (name != null) name else "memory:", .{ .data = data, .size = size });
+}
 
-    closeMedia(p);
+fn openMedia(p: *c.Player, filepath: [*c]const u8, memory: ?MemorySource) c_int {
+    if (p.decoder_reuse != 0) {
+        closeDemuxer(p);
+    } else {
+        closeMedia(p);
+    }
 
     if (p.filepath != null) {
         c.free(p.filepath);
@@ -193,34 +261,50 @@ pub export fn player_open(player: ?*c.Player, filepath: [*c]const u8) c_int {
         return -1;
     }
 
-    if (c.demuxer_open(&p.demuxer, filepath) != 0) {
+    // A pipe cannot be rewound for a second, full probe, so it gets the full
+    // probe up front.
+    const probe_mode = if (memory == null and c.demuxer_io_pipe_fd(filepath) >= 0) c.DEMUXER_PROBE_FULL else c.demuxer_probe_mode_from_environment();
+    var result = openStreams(p, filepath, probe_mode, memory);
+    if ((result == .video_decoder_failed or result == .audio_decoder_failed) and p.demuxer.probe_source != c.DEMUXER_PROBE_SOURCE_FULL) {
+        // Cached or bounded probe results can miss parameters the decoders
+        // need; drop the cache entry and pay for a full probe once.
+        if (p.demuxer.source_kind == c.DEMUXER_SOURCE_FILE) {
+            c.stream_info_cache_invalidate(filepath);
+        }
         closeMedia(p);
-        setState(player, STATE_STOPPED);
-        return -1;
+        result = openStreams(p, filepath, c.DEMUXER_PROBE_FULL, memory);
     }
 
-    if (c.video_decoder_init(&p.decoder, p.demuxer.video_stream) != 0) {
+    if (result == .demuxer_failed or result == .video_decoder_failed) {
         closeMedia(p);
-        setState(player, STATE_STOPPED);
+        setState(p, STATE_STOPPED);
         return -1;
     }
 
-    p.width = p.decoder.width;
-    p.height = p.decoder.height;
+    // Only a full probe is worth replaying: a bounded one may have stopped
+    // before late streams or parameters showed up, and a cache hit never
+    // probes again.
+    if (result == .ok and p.demuxer.source_kind == c.DEMUXER_SOURCE_FILE and p.demuxer.probe_source == c.DEMUXER_PROBE_SOURCE_FULL and p.demuxer.live == 0) {
+        _ = c.stream_info_cache_store(p.demuxer.fmt_ctx, filepath);
+    }
 
-    if (p.demuxer.audio_stream != null and c.audio_decoder_init(&p.audio_decoder, p.demuxer.audio_stream) == 0) {
-        p.has_audio = 1;
-    } else {
-        p.has_audio = 0;
+    if (result == .audio_decoder_failed) {
+        // Nobody would drain the audio ring; stop reading the track instead of
+        // letting it fill up and stall the video stream behind it.
+        p.demuxer.audio_stream_index = -1;
+        p.demuxer.audio_stream = null;
     }
 
+    p.width = p.decoder.width;
+    p.height = p.decoder.height;
+
     if (c.demuxer_start(&p.demuxer) != 0) {
         closeMedia(p);
-        setState(player, STATE_STOPPED);
+        setState(p, STATE_STOPPED);
         return -1;
     }
 
-    setState(player, STATE_STOPPED);
+    setState(p, STATE_STOPPED);
     p.current_time = 0.0;
 
     if (p.demuxer.fmt_ctx != null and p.demuxer.fmt_ctx.*.duration > 0) {
@@ -232,6 +316,8 @@ pub export fn player_open(player: ?*c.Player, filepath: [*c]const u8) c_int {
     p.eof = 0;
     p.seek_pending = 0;
     p.seek_target = 0.0;
+    p.seek_unconfirmed = 0;
+    p.rate_adjust = 1.0;
 
     return 0;
 }
@@ -326,6 +412,10 @@ pub export fn player_apply_seek(player: ?*c.Player) c_int {
             p.audio_decoder.pts = target;
         }
 
+        // A threaded demuxer positions the source later; `player_poll_seek`
+        // learns whether it managed to.
+        p.seek_generation = c.SDL_GetAtomicInt(&p.demuxer.seek_generation);
+        p.seek_unconfirmed = 1;
         p.current_time = target;
         p.eof = 0;
         p.seek_pending = 0;
@@ -345,6 +435,117 @@ pub export fn player_apply_seek(player: ?*c.Player) c_int {
     return result;
 }
 
+/// 1 while the last applied seek is still in flight, 0 once the demuxer has
+/// positioned the source, -1 when it failed to. A failed seek moves the clock
+/// to where the demuxer went on reading, which is past the pre-seek position
+/// by however much was queued and then flushed.
+pub export fn player_poll_seek(player: ?*c.Player) c_int {
+    const p = player orelse return 0;
+    if (p.seek_unconfirmed == 0) {
+        return 0;
+    }
+
+    var resume_time: f64 = 0.0;
+    const result = c.demuxer_get_seek_result(&p.demuxer, p.seek_generation, &resume_time);
+    if (result > 0) {
+        return 1;
+    }
+    p.seek_unconfirmed = 0;
+    if (result == 0) {
+        return 0;
+    }
+
+    if (p.video_decode_mutex != null) {
+        _ = c.SDL_LockMutex(p.video_decode_mutex);
+    }
+
+    if (p.audio_decode_mutex != null) {
+        _ = c.SDL_LockMutex(p.audio_decode_mutex);
+    }
+
+    p.current_time = resume_time;
+    p.decoder.pts = resume_time;
+    if (p.has_audio != 0) {
+        p.audio_decoder.pts = resume_time;
+    }
+
+    if (p.audio_decode_mutex != null) {
+        _ = c.SDL_UnlockMutex(p.audio_decode_mutex);
+    }
+
+    if (p.video_decode_mutex != null) {
+        _ = c.SDL_UnlockMutex(p.video_decode_mutex);
+    }
+
+    return -1;
+}
+
+pub export fn player_select_track(player: ?*c.Player, stream_index: c_int) c_int {
+    const p = player orelse return -1;
+    if (p.demuxer.fmt_ctx == null) {
+        return -1;
+    }
+    if (stream_index == p.demuxer.video_stream_index or stream_index == p.demuxer.audio_stream_index) {
+        return 0;
+    }
+
+    var info: c.DemuxerTrackInfo = undefined;
+    if (c.demuxer_get_track_info(&p.demuxer, stream_index, &info) != 0) {
+        return -1;
+    }
+
+    if (p.video_decode_mutex != null) {
+        _ = c.SDL_LockMutex(p.video_decode_mutex);
+    }
+
+    if (p.audio_decode_mutex != null) {
+        _ = c.SDL_LockMutex(p.audio_decode_mutex);
+    }
+
+    // The switch restarts reading at the playhead, so the decoder that keeps
+    // its track is flushed exactly as for a seek.
+    const target = p.current_time;
+    var result: c_int = -1;
+
+    if (c.demuxer_select_track(&p.demuxer, stream_index, target) == 0) {
+        result = 0;
+        if (info.media_type == c.AVMEDIA_TYPE_AUDIO) {
+            if (p.has_audio != 0) {
+                c.audio_decoder_destroy(&p.audio_decoder);
+            }
+            p.has_audio = if (c.audio_decoder_init(&p.audio_decoder, p.demuxer.audio_stream) == 0) 1 else 0;
+            c.video_decoder_flush(&p.decoder);
+        } else {
+            c.video_decoder_destroy(&p.decoder);
+            if (c.video_decoder_init(&p.decoder, p.demuxer.video_stream) != 0) {
+                result = -1;
+            }
+            p.width = p.decoder.width;
+            p.height = p.decoder.height;
+            if (p.has_audio != 0) {
+                c.audio_decoder_flush(&p.audio_decoder);
+            }
+        }
+
+        p.decoder.pts = target;
+        if (p.has_audio != 0) {
+            p.audio_decoder.pts = target;
+        }
+        p.eof = 0;
+        p.seek_pending = 0;
+    }
+
+    if (p.audio_decode_mutex != null) {
+        _ = c.SDL_UnlockMutex(p.audio_decode_mutex);
+    }
+
+    if (p.video_decode_mutex != null) {
+        _ = c.SDL_UnlockMutex(p.video_decode_mutex);
+    }
+
+    return result;
+}
+
 pub export fn player_set_volume(player: ?*c.Player, volume: f64) void {
     if (player == null) {
         return;
@@ -392,6 +593,26 @@ pub export fn player_get_playback_speed(player: ?*c.Player) f64 {
     return player.?.playback_speed;
 }
 
+/// A small correction on top of the user's speed, used by live playback to
+/// close in on the live edge.
+pub export fn player_set_rate_adjust(player: ?*c.Player, factor: f64) void {
+    const p = player orelse return;
+    p.rate_adjust = std.math.clamp(factor, 0.5, 1.5);
+}
+
+/// The rate the playback clocks run at: the user's speed times the live
+/// correction.
+pub export fn player_get_clock_speed(player: ?*c.Player) f64 {
+    const p = player orelse return 1.0;
+    const adjust = if (p.rate_adjust > 0.0) p.rate_adjust else 1.0;
+    return std.math.clamp(player_get_playback_speed(p) * adjust, 0.25, 2.0);
+}
+
+pub export fn player_is_live(player: ?*c.Player) c_int {
+    const p = player orelse return 0;
+    return @intFromBool(p.demuxer.live != 0);
+}
+
 pub export fn player_get_time(player: ?*c.Player) f64 {
     if (player == null) {
         return 0.0;
@@ -562,3 +783,74 @@ pub export fn player_stop_demuxer(player: ?*c.Player) void {
 
     c.demuxer_stop(&player.?.demuxer);
 }
+
+const test_clip_header = "YUV4MPEG2 W16 H16 F25:1 Ip A1:1 C420jpeg\n";
+const test_clip_frame_len = 16 * 16 * 3 / 2;
+const test_clip_frames = 5;
+const TestClip = [test_clip_header.len + test_clip_frames * ("FRAME\n".len + test_clip_frame_len)]u8;
+
+// Five 16x16 Y4M frames, each a flat shade.
+fn makeTestClip() TestClip {
+    var clip: TestClip = undefined;
+    @memcpy(clip[0..test_clip_header.len], test_clip_header);
+    var offset: usize = test_clip_header.len;
+    for (0..test_clip_frames) |i| {
+        @memcpy(clip[offset..][0.."FRAME\n".len], "FRAME\n");
+        offset += "FRAME\n".len;
+        @memset(clip[offset..][0..test_clip_frame_len], @intCast(i * 40));
+        offset += test_clip_frame_len;
+    }
+    return clip;
+}
+
+test "player_open_memory plays a caller-owned buffer" {
+    const clip = makeTestClip();
+
+    var player: c.Player = undefined;
+    if (player_init(&player) != 0) {
+        return error.SkipZigTest;
+    }
+    defer player_destroy(&player);
+
+    try std.testing.expectEqual(@as(c_int, 0), player_open_memory(&player, &clip, clip.len, "clip.y4m"));
+    try std.testing.expectEqual(@as(c_int, c.DEMUXER_SOURCE_MEMORY), player.demuxer.source_kind);
+    try std.testing.expectEqual(@as(c_int, 16), player.width);
+
+    player_play(&player);
+    var decoded = false;
+    for (0..1000) |_| {
+        if (player_decode_frame(&player) == 0) {
+            decoded = true;
+            break;
+        }
+        std.Thread.sleep(std.time.ns_per_ms);
+    }
+    try std.testing.expect(decoded);
+}
+
+test "a second default open of a file is served from the stream info cache" {
+    var tmp = std.testing.tmpDir(.{});
+    defer tmp.cleanup();
+    const clip = makeTestClip();
+    try tmp.dir.writeFile(.{ .sub_path = "clip.y4m", .data = &clip });
+    const dir_path = try tmp.dir.realpathAlloc(std.testing.allocator, ".");
+    defer std.testing.allocator.free(dir_path);
+    const path = try std.fs.path.joinZ(std.testing.allocator, &.{ dir_path, "clip.y4m" });
+    defer std.testing.allocator.free(path);
+    defer c.stream_info_cache_invalidate(path.ptr);
+
+    if (c.demuxer_probe_mode_from_environment() != c.DEMUXER_PROBE_FAST) {
+        return error.SkipZigTest;
+    }
+    var player: c.Player = undefined;
+    if (player_init(&player) != 0) {
+        return error.SkipZigTest;
+    }
+    defer player_destroy(&player);
+
+    try std.testing.expectEqual(@as(c_int, 0), player_open(&player, path.ptr));
+    try std.testing.expectEqual(@as(c_int, c.DEMUXER_PROBE_SOURCE_FULL), player.demuxer.probe_source);
+    try std.testing.expectEqual(@as(c_int, 0), player_open(&player, path.ptr));
+    try std.testing.expectEqual(@as(c_int, c.DEMUXER_PROBE_SOURCE_CACHE), player.demuxer.probe_source);
+    try std.testing.expectEqual(@as(c_int, 16), player.width);
+}
@@ -0,0 +1,438 @@
+const std = @import("std");
+const FileIdentity = @import("FileIdentity.zig").FileIdentity;
+const c = @cImport({
+    @cInclude("player/stream_info_cache.h");
+});
+
+// Persists what avformat_find_stream_info() learned about a file (codec
+// parameters, frame rates, timings) so a later open of the same file can skip
+// probing. Entries are keyed by FileIdentity; the file stores raw host-endian
+// records because the cache never leaves the machine that wrote it.
+
+const cache_magic = "ZCSI";
+const cache_version: u32 = 1;
+const max_cache_bytes: usize = 16 * 1024 * 1024;
+const max_cached_streams: u32 = 256;
+
+const Header = extern struct {
+    magic: [4]u8,
+    version: u32,
+    record_size: u32,
+    stream_count: u32,
+    file_size: u64,
+    mtime_ns: i64,
+    path_hash: u64,
+    format_name_hash: u64,
+    duration: i64,
+    start_time: i64,
+    bit_rate: i64,
+};
+
+const StreamRecord = extern struct {
+    codec_type: i64,
+    codec_id: i64,
+    codec_tag: i64,
+    format: i64,
+    bit_rate: i64,
+    bits_per_coded_sample: i64,
+    bits_per_raw_sample: i64,
+    profile: i64,
+    level: i64,
+    width: i64,
+    height: i64,
+    sample_aspect_num: i64,
+    sample_aspect_den: i64,
+    field_order: i64,
+    color_range: i64,
+    color_primaries: i64,
+    color_trc: i64,
+    color_space: i64,
+    chroma_location: i64,
+    video_delay: i64,
+    framerate_num: i64,
+    framerate_den: i64,
+    sample_rate: i64,
+    block_align: i64,
+    frame_size: i64,
+    initial_padding: i64,
+    trailing_padding: i64,
+    seek_preroll: i64,
+    ch_order: i64,
+    ch_count: i64,
+    ch_mask: u64,
+    time_base_num: i64,
+    time_base_den: i64,
+    avg_frame_rate_num: i64,
+    avg_frame_rate_den: i64,
+    r_frame_rate_num: i64,
+    r_frame_rate_den: i64,
+    start_time: i64,
+    duration: i64,
+    extradata_size: i64,
+};
+
+fn identityOf(filepath: [*c]const u8) !FileIdentity {
+    if (filepath == null) {
+        return error.InvalidPath;
+    }
+    const path: [*:0]const u8 = @ptrCast(filepath);
+    return FileIdentity.fromPath(std.mem.span(path));
+}
+
+fn cachePath(allocator: std.mem.Allocator, identity: FileIdentity) ![]u8 {
+    return identity.cacheFilePath(allocator, "streaminfo", ".zcsi");
+}
+
+fn formatNameHash(fmt_ctx: *const c.AVFormatContext) u64 {
+    if (fmt_ctx.iformat == null or fmt_ctx.iformat.*.name == null) {
+        return 0;
+    }
+    return std.hash.Wyhash.hash(0, std.mem.span(fmt_ctx.iformat.*.name));
+}
+
+fn assign(field: anytype, value: i64) !void {
+    field.* = std.math.cast(@TypeOf(field.*), value) orelse return error.InvalidCache;
+}
+
+fn rational(num: i64, den: i64) !c.AVRational {
+    return .{
+        .num = std.math.cast(c_int, num) orelse return error.InvalidCache,
+        .den = std.math.cast(c_int, den) orelse return error.InvalidCache,
+    };
+}
+
+fn recordFromStream(stream: *const c.AVStream) StreamRecord {
+    const par = stream.codecpar.*;
+    return .{
+        .codec_type = par.codec_type,
+        .codec_id = par.codec_id,
+        .codec_tag = par.codec_tag,
+        .format = par.format,
+        .bit_rate = par.bit_rate,
+        .bits_per_coded_sample = par.bits_per_coded_sample,
+        .bits_per_raw_sample = par.bits_per_raw_sample,
+        .profile = par.profile,
+        .level = par.level,
+        .width = par.width,
+        .height = par.height,
+        .sample_aspect_num = par.sample_aspect_ratio.num,
+        .sample_aspect_den = par.sample_aspect_ratio.den,
+        .field_order = par.field_order,
+        .color_range = par.color_range,
+        .color_primaries = par.color_primaries,
+        .color_trc = par.color_trc,
+        .color_space = par.color_space,
+        .chroma_location = par.chroma_location,
+        .video_delay = par.video_delay,
+        .framerate_num = par.framerate.num,
+        .framerate_den = par.framerate.den,
+        .sample_rate = par.sample_rate,
+        .block_align = par.block_align,
+        .frame_size = par.frame_size,
+        .initial_padding = par.initial_padding,
+        .trailing_padding = par.trailing_padding,
+        .seek_preroll = par.seek_preroll,
+        // Custom channel maps are not persisted; the count is enough for the
+        // decoder to open and it reports the real layout on the first frame.
+        .ch_order = if (par.ch_layout.order == c.AV_CHANNEL_ORDER_CUSTOM) c.AV_CHANNEL_ORDER_UNSPEC else par.ch_layout.order,
+        .ch_count = par.ch_layout.nb_channels,
+        .ch_mask = if (par.ch_layout.order == c.AV_CHANNEL_ORDER_CUSTOM) 0 else par.ch_layout.u.mask,
+        .time_base_num = stream.time_base.num,
+        .time_base_den = stream.time_base.den,
+        .avg_frame_rate_num = stream.avg_frame_rate.num,
+        .avg_frame_rate_den = stream.avg_frame_rate.den,
+        .r_frame_rate_num = stream.r_frame_rate.num,
+        .r_frame_rate_den = stream.r_frame_rate.den,
+        .start_time = stream.start_time,
+        .duration = stream.duration,
+        .extradata_size = if (par.extradata != null and par.extradata_size > 0) par.extradata_size else 0,
+    };
+}
+
+// Stream layout is decided by the container header, so a cached entry only
+// applies when the header produced the same streams with the same time bases.
+fn recordMatchesStream(record: StreamRecord, stream: *const c.AVStream) bool {
+    if (stream.codecpar == null) {
+        return false;
+    }
+    if (record.time_base_num != stream.time_base.num or record.time_base_den != stream.time_base.den) {
+        return false;
+    }
+
+    const par = stream.codecpar.*;
+    if (par.codec_type != c.AVMEDIA_TYPE_UNKNOWN and record.codec_type != par.codec_type) {
+        return false;
+    }
+    return par.codec_id == c.AV_CODEC_ID_NONE or record.codec_id == par.codec_id;
+}
+
+fn applyRecord(stream: *c.AVStream, record: StreamRecord, extradata: []const u8) !void {
+    const par = stream.codecpar;
+    try assign(&par.*.codec_type, record.codec_type);
+    try assign(&par.*.codec_id, record.codec_id);
+    try assign(&par.*.codec_tag, record.codec_tag);
+    try assign(&par.*.format, record.format);
+    try assign(&par.*.bit_rate, record.bit_rate);
+    try assign(&par.*.bits_per_coded_sample, record.bits_per_coded_sample);
+    try assign(&par.*.bits_per_raw_sample, record.bits_per_raw_sample);
+    try assign(&par.*.profile, record.profile);
+    try assign(&par.*.level, record.level);
+    try assign(&par.*.width, record.width);
+    try assign(&par.*.height, record.height);
+    par.*.sample_aspect_ratio = try rational(record.sample_aspect_num, record.sample_aspect_den);
+    try assign(&par.*.field_order, record.field_order);
+    try assign(&par.*.color_range, record.color_range);
+    try assign(&par.*.color_primaries, record.color_primaries);
+    try assign(&par.*.color_trc, record.color_trc);
+    try assign(&par.*.color_space, record.color_space);
+    try assign(&par.*.chroma_location, record.chroma_location);
+    try assign(&par.*.video_delay, record.video_delay);
+    par.*.framerate = try rational(record.framerate_num, record.framerate_den);
+    try assign(&par.*.sample_rate, record.sample_rate);
+    try assign(&par.*.block_align, record.block_align);
+    try assign(&par.*.frame_size, record.frame_size);
+    try assign(&par.*.initial_padding, record.initial_padding);
+    try assign(&par.*.trailing_padding, record.trailing_padding);
+    try assign(&par.*.seek_preroll, record.seek_preroll);
+
+    c.av_channel_layout_uninit(&par.*.ch_layout);
+    try assign(&par.*.ch_layout.order, record.ch_order);
+    try assign(&par.*.ch_layout.nb_channels, record.ch_count);
+    par.*.ch_layout.u.mask = record.ch_mask;
+
+    stream.avg_frame_rate = try rational(record.avg_frame_rate_num, record.avg_frame_rate_den);
+    stream.r_frame_rate = try rational(record.r_frame_rate_num, record.r_frame_rate_den);
+    stream.start_time = record.start_time;
+    stream.duration = record.duration;
+
+    // Header-provided extradata wins; the cached copy fills in what only
+    // probing would have found (e.g. parameter sets in MPEG-TS).
+    if (extradata.len > 0 and (par.*.extradata == null or par.*.extradata_size == 0)) {
+        const buffer: [*c]u8 = @ptrCast(c.av_mallocz(extradata.len + c.AV_INPUT_BUFFER_PADDING_SIZE));
+        if (buffer == null) {
+            return error.OutOfMemory;
+        }
+        @memcpy(buffer[0..extradata.len], extradata);
+        c.av_freep(@ptrCast(&par.*.extradata));
+        par.*.extradata = buffer;
+        par.*.extradata_size = @intCast(extradata.len);
+    }
+}
+
+fn loadInto(fmt_ctx: *c.AVFormatContext, bytes: []const u8, identity: FileIdentity) !void {
+    if (bytes.len < @sizeOf(Header)) {
+        return error.InvalidCache;
+    }
+
+    const header = std.mem.bytesToValue(Header, bytes[0..@sizeOf(Header)]);
+    if (!std.mem.eql(u8, &header.magic, cache_magic) or header.version != cache_version or header.record_size != @sizeOf(StreamRecord)) {
+        return error.InvalidCache;
+    }
+
+    const cached_identity = FileIdentity{ .size = header.file_size, .mtime_ns = header.mtime_ns, .path_hash = header.path_hash };
+    if (!cached_identity.eql(identity) or header.format_name_hash != formatNameHash(fmt_ctx)) {
+        return error.StaleCache;
+    }
+    if (header.stream_count != fmt_ctx.nb_streams or header.stream_count > max_cached_streams) {
+        return error.StaleCache;
+    }
+
+    const records_len = @as(usize, header.stream_count) * @sizeOf(StreamRecord);
+    if (bytes.len < @sizeOf(Header) + records_len) {
+        return error.InvalidCache;
+    }
+    const records = bytes[@sizeOf(Header) .. @sizeOf(Header) + records_len];
+
+    var extradata_len: usize = 0;
+    for (0..header.stream_count) |i| {
+        const record = std.mem.bytesToValue(StreamRecord, records[i * @sizeOf(StreamRecord) ..][0..@sizeOf(StreamRecord)]);
+        if (record.extradata_size < 0 or fmt_ctx.streams[i] == null or !recordMatchesStream(record, fmt_ctx.streams[i])) {
+            return error.StaleCache;
+        }
+        extradata_len += @intCast(record.extradata_size);
+    }
+    if (bytes.len != @sizeOf(Header) + records_len + extradata_len) {
+        return error.InvalidCache;
+    }
+
+    var extradata_offset: usize = @sizeOf(Header) + records_len;
+    for (0..header.stream_count) |i| {
+        const record = std.mem.bytesToValue(StreamRecord, records[i * @sizeOf(StreamRecord) ..][0..@sizeOf(StreamRecord)]);
+        const size: usize = @intCast(record.extradata_size);
+        try applyRecord(fmt_ctx.streams[i], record, bytes[extradata_offset .. extradata_offset + size]);
+        extradata_offset += size;
+    }
+
+    fmt_ctx.duration = header.duration;
+    fmt_ctx.start_time = header.start_time;
+    fmt_ctx.bit_rate = header.bit_rate;
+}
+
+fn serialize(allocator: std.mem.Allocator, fmt_ctx: *const c.AVFormatContext, identity: FileIdentity) ![]u8 {
+    if (fmt_ctx.nb_streams > max_cached_streams) {
+        return error.TooManyStreams;
+    }
+
+    var bytes: std.ArrayListUnmanaged(u8) = .{};
+    errdefer bytes.deinit(allocator);
+
+    const header = Header{
+        .magic = cache_magic.*,
+        .version = cache_version,
+        .record_size = @sizeOf(StreamRecord),
+        .stream_count = fmt_ctx.nb_streams,
+        .file_size = identity.size,
+        .mtime_ns = identity.mtime_ns,
+        .path_hash = identity.path_hash,
+        .format_name_hash = formatNameHash(fmt_ctx),
+        .duration = fmt_ctx.duration,
+        .start_time = fmt_ctx.start_time,
+        .bit_rate = fmt_ctx.bit_rate,
+    };
+    try bytes.appendSlice(allocator, std.mem.asBytes(&header));
+
+    for (0..fmt_ctx.nb_streams) |i| {
+        const stream = fmt_ctx.streams[i];
+        if (stream == null or stream.*.codecpar == null) {
+            return error.InvalidStream;
+        }
+        const record = recordFromStream(stream);
+        try bytes.appendSlice(allocator, std.mem.asBytes(&record));
+    }
+
+    for (0..fmt_ctx.nb_streams) |i| {
+        const par = fmt_ctx.streams[i].*.codecpar;
+        if (par.*.extradata != null and par.*.extradata_size > 0) {
+            try bytes.appendSlice(allocator, par.*.extradata[0..@intCast(par.*.extradata_size)]);
+        }
+    }
+
+    return bytes.toOwnedSlice(allocator);
+}
+
+pub export fn stream_info_cache_load(fmt_ctx: ?*c.AVFormatContext, filepath: [*c]const u8) c_int {
+    const ctx = fmt_ctx orelse return -1;
+    const allocator = std.heap.page_allocator;
+
+    const identity = identityOf(filepath) catch return -1;
+    const path = cachePath(allocator, identity) catch return -1;
+    defer allocator.free(path);
+
+    const bytes = std.fs.cwd().readFileAlloc(allocator, path, max_cache_bytes) catch return -1;
+    defer allocator.free(bytes);
+
+    loadInto(ctx, bytes, identity) catch return -1;
+    return 0;
+}
+
+pub export fn stream_info_cache_store(fmt_ctx: ?*const c.AVFormatContext, filepath: [*c]const u8) c_int {
+    const ctx = fmt_ctx orelse return -1;
+    const allocator = std.heap.page_allocator;
+
+    const identity = identityOf(filepath) catch return -1;
+    const path = cachePath(allocator, identity) catch return -1;
+    defer allocator.free(path);
+
+    const bytes = serialize(allocator, ctx, identity) catch return -1;
+    defer allocator.free(bytes);
+
+    const tmp_path = std.fmt.allocPrint(allocator, "{s}.tmp", .{path}) catch return -1;
+    defer allocator.free(tmp_path);
+
+    std.fs.cwd().writeFile(.{ .sub_path = tmp_path, .data = bytes }) catch return -1;
+    std.fs.cwd().rename(tmp_path, path) catch return -1;
+    return 0;
+}
+
+pub export fn stream_info_cache_invalidate(filepath: [*c]const u8) void {
+    const allocator = std.heap.page_allocator;
+    const identity = identityOf(filepath) catch return;
+    const path = cachePath(allocator, identity) catch return;
+    defer allocator.free(path);
+    std.fs.cwd().deleteFile(path) catch {};
+}
+
+fn addTestStream(fmt_ctx: *c.AVFormatContext, codec_type: c_int, codec_id: c_int) !*c.AVStream {
+    const stream = c.avformat_new_stream(fmt_ctx, null);
+    if (stream == null) {
+        return error.OutOfMemory;
+    }
+    stream.*.time_base = .{ .num = 1, .den = 90000 };
+    stream.*.codecpar.*.codec_type = codec_type;
+    stream.*.codecpar.*.codec_id = @intCast(codec_id);
+    return stream;
+}
+
+test "stream info round-trips through the cache layout" {
+    var tmp = std.testing.tmpDir(.{});
+    defer tmp.cleanup();
+    try tmp.dir.writeFile(.{ .sub_path = "media.ts", .data = "payload" });
+    const media_path = try tmp.dir.realpathAlloc(std.testing.allocator, "media.ts");
+    defer std.testing.allocator.free(media_path);
+    const identity = try FileIdentity.fromPath(media_path);
+
+    const probed = c.avformat_alloc_context();
+    defer c.avformat_free_context(probed);
+    const video = try addTestStream(probed, c.AVMEDIA_TYPE_VIDEO, c.AV_CODEC_ID_H264);
+    video.*.codecpar.*.width = 1920;
+    video.*.codecpar.*.height = 1080;
+    video.*.codecpar.*.format = c.AV_PIX_FMT_YUV420P;
+    video.*.avg_frame_rate = .{ .num = 30000, .den = 1001 };
+    const extradata = [_]u8{ 0, 0, 0, 1, 0x67, 0x42 };
+    video.*.codecpar.*.extradata = @ptrCast(c.av_mallocz(extradata.len + c.AV_INPUT_BUFFER_PADDING_SIZE));
+    @memcpy(video.*.codecpar.*.extradata[0..extradata.len], &extradata);
+    video.*.codecpar.*.extradata_size = extradata.len;
+    const audio = try addTestStream(probed, c.AVMEDIA_TYPE_AUDIO, c.AV_CODEC_ID_AAC);
+    audio.*.codecpar.*.sample_rate = 48000;
+    c.av_channel_layout_default(&audio.*.codecpar.*.ch_layout, 2);
+    probed.*.duration = 42 * c.AV_TIME_BASE;
+
+    const bytes = try serialize(std.testing.allocator, probed, identity);
+    defer std.testing.allocator.free(bytes);
+
+    // A header-only context: same streams, nothing probed yet.
+    const opened = c.avformat_alloc_context();
+    defer c.avformat_free_context(opened);
+    _ = try addTestStream(opened, c.AVMEDIA_TYPE_VIDEO, c.AV_CODEC_ID_H264);
+    _ = try addTestStream(opened, c.AVMEDIA_TYPE_AUDIO, c.AV_CODEC_ID_AAC);
+
+    try loadInto(opened, bytes, identity);
+    const loaded_video = opened.*.streams[0].*;
+    try std.testing.expectEqual(@as(c_int, 1920), loaded_video.codecpar.*.width);
+    try std.testing.expectEqual(@as(c_int, 1080), loaded_video.codecpar.*.height);
+    try std.testing.expectEqual(@as(c_int, 30000), loaded_video.avg_frame_rate.num);
+    try std.testing.expectEqualSlices(u8, &extradata, loaded_video.codecpar.*.extradata[0..@intCast(loaded_video.codecpar.*.extradata_size)]);
+    try std.testing.expectEqual(@as(c_int, 48000), opened.*.streams[1].*.codecpar.*.sample_rate);
+    try std.testing.expectEqual(@as(c_int, 2), opened.*.streams[1].*.codecpar.*.ch_layout.nb_channels);
+    try std.testing.expectEqual(@as(i64, 42 * c.AV_TIME_BASE), opened.*.duration);
+
+    // A different stream layout must not pick up the cached parameters.
+    const other = c.avformat_alloc_context();
+    defer c.avformat_free_context(other);
+    _ = try addTestStream(other, c.AVMEDIA_TYPE_VIDEO, c.AV_CODEC_ID_HEVC);
+    _ = try addTestStream(other, c.AVMEDIA_TYPE_AUDIO, c.AV_CODEC_ID_AAC);
+    try std.testing.expectError(error.StaleCache, loadInto(other, bytes, identity));
+}
+
+test "a rewritten file misses the cache entry of its old contents" {
+    var tmp = std.testing.tmpDir(.{});
+    defer tmp.cleanup();
+    try tmp.dir.writeFile(.{ .sub_path = "media.ts", .data = "payload" });
+    const media_path = try tmp.dir.realpathAlloc(std.testing.allocator, "media.ts");
+    defer std.testing.allocator.free(media_path);
+    const identity = try FileIdentity.fromPath(media_path);
+
+    const probed = c.avformat_alloc_context();
+    defer c.avformat_free_context(probed);
+    _ = try addTestStream(probed, c.AVMEDIA_TYPE_VIDEO, c.AV_CODEC_ID_H264);
+    const bytes = try serialize(std.testing.allocator, probed, identity);
+    defer std.testing.allocator.free(bytes);
+
+    try tmp.dir.writeFile(.{ .sub_path = "media.ts", .data = "a longer payload" });
+    const rewritten = try FileIdentity.fromPath(media_path);
+
+    const opened = c.avformat_alloc_context();
+    defer c.avformat_free_context(opened);
+    _ = try addTestStream(opened, c.AVMEDIA_TYPE_VIDEO, c.AV_CODEC_ID_H264);
+    try std.testing.expectError(error.StaleCache, loadInto(opened, bytes, rewritten));
+}
@@ -8,6 +8,9 @@ layout(binding = 3) uniform sampler2D video_texture_v;
 
 layout(push_constant) uniform VideoPushConstants {
     int mode;
+    // Rescales 10- and 16-bit samples to the 8-bit range the constants below
+    // assume; 1.0 for 8-bit formats.
+    float sample_scale;
 } video_pc;
 
 layout(location = 0) out vec4 outColor;
@@ -27,13 +30,13 @@ void main() {
     vec2 uv = vec2(fragTexCoord.x, 1.0 - fragTexCoord.y);
 
     if (video_pc.mode == 1) {
-        float y = texture(video_texture_y, uv).r;
-        vec2 uv_sample = texture(video_texture_uv_or_u, uv).rg;
+        float y = texture(video_texture_y, uv).r * video_pc.sample_scale;
+        vec2 uv_sample = texture(video_texture_uv_or_u, uv).rg * video_pc.sample_scale;
         outColor = vec4(yuv_to_rgb(y, uv_sample.r, uv_sample.g), 1.0);
     } else if (video_pc.mode == 2) {
-        float y = texture(video_texture_y, uv).r;
-        float u = texture(video_texture_uv_or_u, uv).r;
-        float v = texture(video_texture_v, uv).r;
+        float y = texture(video_texture_y, uv).r * video_pc.sample_scale;
+        float u = texture(video_texture_uv_or_u, uv).r * video_pc.sample_scale;
+        float v = texture(video_texture_v, uv).r * video_pc.sample_scale;
         outColor = vec4(yuv_to_rgb(y, u, v), 1.0);
     } else {
         outColor = texture(video_texture_rgba, uv);
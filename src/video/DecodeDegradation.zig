@@ -0,0 +1,187 @@
+const std = @import("std");
+
+// Trades picture quality for decode speed when video falls behind the master
+// clock, before the renderer has to drop frames it already paid to decode.
+// Each level adds one of the decoder's own skip options:
+//
+//   loop_filter  skip the deblocking filter (blockier picture)
+//   nonref       also skip frames nothing else references (lower frame rate)
+//   idct         also skip the IDCT on non-keyframes (visible artifacts until
+//                the next keyframe)
+//
+// Levels step up one at a time while the lag persists and step down one at a
+// time once it has been gone for a while, so a short hiccup costs little.
+//
+// Past the catch-up lag no skip level can close the gap in reasonable time;
+// the decoder then jumps to the next keyframe at or after the clock instead.
+
+pub const Level = enum(u8) {
+    none,
+    loop_filter,
+    nonref,
+    idct,
+
+    pub fn label(self: Level) []const u8 {
+        return switch (self) {
+            .none => "none",
+            .loop_filter => "loop filter",
+            .nonref => "non-ref frames",
+            .idct => "idct",
+        };
+    }
+};
+
+pub const Config = struct {
+    /// Smoothed lag above this counts as falling behind.
+    escalate_lag_s: f64 = 0.08,
+    /// Smoothed lag below this counts as recovered.
+    recover_lag_s: f64 = 0.02,
+    /// How long a condition must hold before the next step.
+    escalate_hold_s: f64 = 0.5,
+    recover_hold_s: f64 = 3.0,
+    smoothing_s: f64 = 0.25,
+};
+
+/// `ZC_DECODE_SKIP=off` keeps full quality and leaves lag to frame drops.
+pub fn enabledFromEnvironment() bool {
+    const value = std.process.getEnvVarOwned(std.heap.page_allocator, "ZC_DECODE_SKIP") catch return true;
+    defer std.heap.page_allocator.free(value);
+    return !(std.ascii.eqlIgnoreCase(value, "off") or std.mem.eql(u8, value, "0"));
+}
+
+pub const default_catch_up_lag_s: f64 = 1.0;
+
+/// Milliseconds, or `off`; 0 also disables. Null for anything invalid.
+pub fn parseCatchUpLag(value: []const u8) ?f64 {
+    const trimmed = std.mem.trim(u8, value, " ");
+    if (std.ascii.eqlIgnoreCase(trimmed, "off")) {
+        return 0.0;
+    }
+    const ms = std.fmt.parseFloat(f64, trimmed) catch return null;
+    if (ms == 0.0) {
+        return 0.0;
+    }
+    if (!(ms >= 100.0 and ms <= 60_000.0)) {
+        return null;
+    }
+    return ms / 1000.0;
+}
+
+/// `ZC_VIDEO_CATCHUP_MS`; null when keyframe catch-up is disabled.
+pub fn catchUpLagFromEnvironment() ?f64 {
+    const value = std.process.getEnvVarOwned(std.heap.page_allocator, "ZC_VIDEO_CATCHUP_MS") catch return default_catch_up_lag_s;
+    defer std.heap.page_allocator.free(value);
+    const lag = parseCatchUpLag(value) orelse return default_catch_up_lag_s;
+    return if (lag > 0.0) lag else null;
+}
+
+pub const DegradationController = struct {
+    config: Config = .{},
+    level: Level = .none,
+    smoothed_s: ?f64 = null,
+    held_s: f64 = 0.0,
+    // Which condition `held_s` measures; a flip starts the hold over.
+    held_behind: bool = false,
+
+    pub fn reset(self: *DegradationController) void {
+        self.* = .{ .config = self.config };
+    }
+
+    /// `lag_s` is how far the frame just decoded trails the master clock;
+    /// negative while decode runs ahead.
+    pub fn update(self: *DegradationController, lag_s: f64, dt_s: f64) Level {
+        const previous = self.smoothed_s orelse lag_s;
+        const alpha = std.math.clamp(dt_s / self.config.smoothing_s, 0.0, 1.0);
+        const smoothed = previous + (lag_s - previous) * alpha;
+        self.smoothed_s = smoothed;
+
+        const behind = smoothed > self.config.escalate_lag_s;
+        const recovered = smoothed < self.config.recover_lag_s;
+        if (!behind and !recovered) {
+            self.held_s = 0.0;
+            return self.level;
+        }
+
+        if (behind != self.held_behind) {
+            self.held_behind = behind;
+            self.held_s = 0.0;
+        }
+        self.held_s += dt_s;
+        const max_level = @intFromEnum(Level.idct);
+        const current = @intFromEnum(self.level);
+        if (behind and self.held_s >= self.config.escalate_hold_s and current < max_level) {
+            self.level = @enumFromInt(current + 1);
+            self.held_s = 0.0;
+        } else if (recovered and self.held_s >= self.config.recover_hold_s and current > 0) {
+            self.level = @enumFromInt(current - 1);
+            self.held_s = 0.0;
+        }
+        return self.level;
+    }
+};
+
+test "sustained lag escalates one level per hold period" {
+    var controller = DegradationController{};
+    const dt = 0.05;
+
+    // A single late frame does not degrade anything.
+    try std.testing.expectEqual(Level.none, controller.update(0.3, dt));
+    for (0..10) |_| {
+        _ = controller.update(0.0, dt);
+    }
+    try std.testing.expectEqual(Level.none, controller.level);
+
+    var level = Level.none;
+    for (0..14) |_| {
+        level = controller.update(0.2, dt);
+    }
+    try std.testing.expectEqual(Level.loop_filter, level);
+
+    for (0..40) |_| {
+        level = controller.update(0.2, dt);
+    }
+    try std.testing.expectEqual(Level.idct, level);
+}
+
+test "recovery steps down slowly and the dead band holds the level" {
+    var controller = DegradationController{ .level = .nonref, .smoothed_s = 0.0 };
+    const dt = 0.1;
+
+    for (0..100) |_| {
+        try std.testing.expectEqual(Level.nonref, controller.update(0.05, dt));
+    }
+
+    var level = Level.nonref;
+    for (0..31) |_| {
+        level = controller.update(-0.1, dt);
+    }
+    try std.testing.expectEqual(Level.loop_filter, level);
+
+    controller.reset();
+    try std.testing.expectEqual(Level.none, controller.level);
+    try std.testing.expect(controller.smoothed_s == null);
+}
+
+test "flipping straight between behind and recovered restarts the hold" {
+    var controller = DegradationController{ .level = .loop_filter, .smoothed_s = 0.0 };
+    // Steps long enough that smoothing follows the input exactly.
+    const dt = 0.25;
+
+    for (0..11) |_| {
+        try std.testing.expectEqual(Level.loop_filter, controller.update(-0.1, dt));
+    }
+    // 2.75 s spent recovered must not count towards escalating.
+    try std.testing.expectEqual(Level.loop_filter, controller.update(0.2, dt));
+    try std.testing.expectEqual(Level.nonref, controller.update(0.2, dt));
+
+    // Nor the time spent behind towards recovering.
+    try std.testing.expectEqual(Level.nonref, controller.update(-0.1, dt));
+}
+
+test "parseCatchUpLag reads milliseconds or disables catch-up" {
+    try std.testing.expectApproxEqAbs(@as(f64, 2.5), parseCatchUpLag(" 2500 ").?, 1e-9);
+    try std.testing.expectEqual(@as(f64, 0.0), parseCatchUpLag("off").?);
+    try std.testing.expectEqual(@as(f64, 0.0), parseCatchUpLag("0").?);
+    try std.testing.expect(parseCatchUpLag("20") == null);
+    try std.testing.expect(parseCatchUpLag("later") == null);
+}
@@ -0,0 +1,247 @@
+const std = @import("std");
+const builtin = @import("builtin");
+
+// Software decoder threading: which of libavcodec's frame and slice threading
+// to allow and how many threads to give it. Frame threading scales with cores
+// but holds one frame of delay per thread; slice threading adds no delay but
+// is bounded by the slices the encoder wrote (often one per frame).
+//
+// `ZC_DECODE_THREADS` sets a default and per-codec overrides, e.g.
+// `auto,hevc=frame:12,h264=slice`. Each entry is a mode, a thread count, or
+// `mode:count`; a missing count is derived from the CPU topology and the
+// frame size.
+
+pub const Mode = enum {
+    /// Frame and slice threading; the codec picks what it supports.
+    auto,
+    frame,
+    slice,
+    off,
+};
+
+pub const Policy = struct {
+    mode: Mode = .auto,
+    /// 0 derives the count from the CPU topology.
+    thread_count: u32 = 0,
+};
+
+pub const CpuTopology = struct {
+    logical: u32,
+    physical: u32,
+};
+
+// Frame threading past this stops paying for its memory and delay; it is also
+// libavcodec's own cap for automatic counts.
+pub const max_auto_threads: u32 = 16;
+const max_threads: u32 = 64;
+const max_overrides = 8;
+
+pub const Config = struct {
+    default: Policy = .{},
+    codec_names: [max_overrides][16]u8 = undefined,
+    codec_name_lens: [max_overrides]usize = [_]usize{0} ** max_overrides,
+    codec_policies: [max_overrides]Policy = undefined,
+    override_count: usize = 0,
+
+    /// `names` are the codec's libavcodec name and its decoder's name
+    /// (`av1`, `libdav1d`); either may match an override.
+    pub fn policyFor(self: *const Config, names: []const []const u8) Policy {
+        for (0..self.override_count) |i| {
+            const key = self.codec_names[i][0..self.codec_name_lens[i]];
+            for (names) |name| {
+                if (std.ascii.eqlIgnoreCase(key, name)) {
+                    return self.codec_policies[i];
+                }
+            }
+        }
+        return self.default;
+    }
+};
+
+fn parseMode(text: []const u8) ?Mode {
+    inline for (@typeInfo(Mode).@"enum".fields) |field| {
+        if (std.ascii.eqlIgnoreCase(text, field.name)) {
+            return @enumFromInt(field.value);
+        }
+    }
+    if (std.ascii.eqlIgnoreCase(text, "none")) {
+        return .off;
+    }
+    return null;
+}
+
+pub fn parsePolicy(text: []const u8) ?Policy {
+    const trimmed = std.mem.trim(u8, text, " ");
+    if (trimmed.len == 0) {
+        return null;
+    }
+
+    var parts = std.mem.splitScalar(u8, trimmed, ':');
+    const first = parts.first();
+    const count_text = parts.next();
+    if (parts.next() != null) {
+        return null;
+    }
+
+    if (count_text == null) {
+        if (parseMode(first)) |mode| {
+            return .{ .mode = mode };
+        }
+        const count = std.fmt.parseInt(u32, first, 10) catch return null;
+        return countPolicy(.auto, count);
+    }
+    const mode = parseMode(first) orelse return null;
+    const count = std.fmt.parseInt(u32, std.mem.trim(u8, count_text.?, " "), 10) catch return null;
+    return countPolicy(mode, count);
+}
+
+fn countPolicy(mode: Mode, count: u32) ?Policy {
+    if (count == 0 or count > max_threads) {
+        return null;
+    }
+    if (count == 1) {
+        return .{ .mode = .off, .thread_count = 1 };
+    }
+    return .{ .mode = mode, .thread_count = count };
+}
+
+/// Invalid entries are skipped, so a typo only loses that entry.
+pub fn parseConfig(value: []const u8) Config {
+    var config = Config{};
+    var entries = std.mem.splitScalar(u8, value, ',');
+    while (entries.next()) |entry| {
+        if (std.mem.indexOfScalar(u8, entry, '=')) |eq| {
+            const name = std.mem.trim(u8, entry[0..eq], " ");
+            const policy = parsePolicy(entry[eq + 1 ..]) orelse continue;
+            if (name.len == 0 or name.len > config.codec_names[0].len or config.override_count == max_overrides) {
+                continue;
+            }
+            const i = config.override_count;
+            @memcpy(config.codec_names[i][0..name.len], name);
+            config.codec_name_lens[i] = name.len;
+            config.codec_policies[i] = policy;
+            config.override_count += 1;
+        } else if (parsePolicy(entry)) |policy| {
+            config.default = policy;
+        }
+    }
+    return config;
+}
+
+pub fn configFromEnvironment() Config {
+    const value = std.process.getEnvVarOwned(std.heap.page_allocator, "ZC_DECODE_THREADS") catch return .{};
+    defer std.heap.page_allocator.free(value);
+    return parseConfig(value);
+}
+
+/// SMT siblings share execution units, so they add little to a decoder that
+/// already keeps every core busy.
+pub fn autoThreadCount(topology: CpuTopology, width: i64, height: i64) u32 {
+    const pixels = @max(width, 0) * @max(height, 0);
+    var count = topology.physical;
+    if (pixels > 2560 * 1440) {
+        // UHD frames are large enough that the siblings still add throughput.
+        count = topology.logical;
+    } else if (pixels <= 1280 * 720) {
+        count = @min(count, 4);
+    }
+    return std.math.clamp(count, 1, max_auto_threads);
+}
+
+pub fn detectTopology() CpuTopology {
+    const logical: u32 = @intCast(@max(std.Thread.getCpuCount() catch 1, 1));
+    const physical = physicalCoreCount() orelse logical;
+    return .{ .logical = logical, .physical = std.math.clamp(physical, 1, logical) };
+}
+
+fn physicalCoreCount() ?u32 {
+    switch (builtin.os.tag) {
+        .linux => return linuxPhysicalCores(),
+        .macos => {
+            var value: c_int = 0;
+            var len: usize = @sizeOf(c_int);
+            std.posix.sysctlbynameZ("hw.physicalcpu", &value, &len, null, 0) catch return null;
+            return if (value > 0) @intCast(value) else null;
+        },
+        else => return null,
+    }
+}
+
+// Counts distinct (package, core) pairs across the online CPUs.
+fn linuxPhysicalCores() ?u32 {
+    var online_buf: [256]u8 = undefined;
+    const online = readSysfs("/sys/devices/system/cpu/online", &online_buf) orelse return null;
+
+    var cores: [512]u64 = undefined;
+    var core_count: usize = 0;
+    var ranges = std.mem.splitScalar(u8, online, ',');
+    while (ranges.next()) |range| {
+        var bounds = std.mem.splitScalar(u8, range, '-');
+        const first = std.fmt.parseInt(u32, bounds.first(), 10) catch return null;
+        const last = if (bounds.next()) |text| (std.fmt.parseInt(u32, text, 10) catch return null) else first;
+        var cpu = first;
+        while (cpu <= last) : (cpu += 1) {
+            const package = readCpuTopologyValue(cpu, "physical_package_id") orelse return null;
+            const core = readCpuTopologyValue(cpu, "core_id") orelse return null;
+            const key = (@as(u64, package) << 32) | core;
+            if (std.mem.indexOfScalar(u64, cores[0..core_count], key) == null) {
+                if (core_count == cores.len) {
+                    return null;
+                }
+                cores[core_count] = key;
+                core_count += 1;
+            }
+        }
+    }
+    return if (core_count > 0) @intCast(core_count) else null;
+}
+
+fn readCpuTopologyValue(cpu: u32, name: []const u8) ?u32 {
+    var path_buf: [96]u8 = undefined;
+    const path = std.fmt.bufPrint(&path_buf, "/sys/devices/system/cpu/cpu{d}/topology/{s}", .{ cpu, name }) catch return null;
+    var value_buf: [32]u8 = undefined;
+    const text = readSysfs(path, &value_buf) orelse return null;
+    const value = std.fmt.parseInt(i64, text, 10) catch return null;
+    // Some platforms report -1 for an unknown package.
+    return if (value < 0) 0 else std.math.cast(u32, value);
+}
+
+fn readSysfs(path: []const u8, buf: []u8) ?[]const u8 {
+    const file = std.fs.openFileAbsolute(path, .{}) catch return null;
+    defer file.close();
+    const n = file.readAll(buf) catch return null;
+    return std.mem.trim(u8, buf[0..n], " \n");
+}
+
+test "parseConfig reads a default and per-codec overrides" {
+    const config = parseConfig("frame , hevc=frame:12, libdav1d=8,h264=slice,mpeg2video=1,vp9=bogus");
+    try std.testing.expectEqual(Policy{ .mode = .frame }, config.default);
+    try std.testing.expectEqual(@as(usize, 4), config.override_count);
+
+    try std.testing.expectEqual(Policy{ .mode = .frame, .thread_count = 12 }, config.policyFor(&.{"hevc"}));
+    try std.testing.expectEqual(Policy{ .mode = .auto, .thread_count = 8 }, config.policyFor(&.{ "av1", "libdav1d" }));
+    try std.testing.expectEqual(Policy{ .mode = .slice }, config.policyFor(&.{"H264"}));
+    try std.testing.expectEqual(Policy{ .mode = .off, .thread_count = 1 }, config.policyFor(&.{"mpeg2video"}));
+    try std.testing.expectEqual(Policy{ .mode = .frame }, config.policyFor(&.{"vp9"}));
+
+    try std.testing.expectEqual(Policy{}, parseConfig("").default);
+    try std.testing.expect(parsePolicy("frame:0") == null);
+    try std.testing.expect(parsePolicy("frame:4:2") == null);
+}
+
+test "autoThreadCount scales with frame size and caps at the auto limit" {
+    const smt = CpuTopology{ .logical = 16, .physical = 8 };
+    try std.testing.expectEqual(@as(u32, 4), autoThreadCount(smt, 1280, 720));
+    try std.testing.expectEqual(@as(u32, 8), autoThreadCount(smt, 1920, 1080));
+    try std.testing.expectEqual(@as(u32, 16), autoThreadCount(smt, 3840, 2160));
+
+    const big = CpuTopology{ .logical = 128, .physical = 64 };
+    try std.testing.expectEqual(max_auto_threads, autoThreadCount(big, 7680, 4320));
+    try std.testing.expectEqual(@as(u32, 1), autoThreadCount(.{ .logical = 1, .physical = 1 }, 0, 0));
+}
+
+test "detectTopology reports at least one physical core per logical set" {
+    const topology = detectTopology();
+    try std.testing.expect(topology.logical >= 1);
+    try std.testing.expect(topology.physical >= 1 and topology.physical <= topology.logical);
+}
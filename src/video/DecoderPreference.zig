@@ -0,0 +1,209 @@
+const std = @import("std");
+const cacheDir = @import("../media/FileIdentity.zig").cacheDir;
+
+// Which decoder implementation to open for a codec. FFmpeg can register
+// several decoders per codec (`av1`, `libdav1d`, `libaom-av1`) and
+// `avcodec_find_decoder` returns whichever came first, not the fastest.
+//
+// Preference lists come from `ZC_VIDEO_DECODERS`, e.g.
+// `av1=libdav1d:av1,hevc@uhd=hevc`, and from the rankings `zc-bench decoders
+// --record` writes to the cache directory in the same format, one entry per
+// line. A key is a codec name, optionally with a resolution class; the
+// class-specific entry is tried before the plain one.
+
+pub const ResolutionClass = enum {
+    sd,
+    hd,
+    uhd,
+};
+
+pub const max_candidates = 8;
+const max_name_len = 32;
+const rankings_file = "decoders.txt";
+
+pub fn classify(width: i64, height: i64) ResolutionClass {
+    const pixels = @max(width, 0) * @max(height, 0);
+    if (pixels <= 1280 * 720) {
+        return .sd;
+    }
+    if (pixels <= 1920 * 1088) {
+        return .hd;
+    }
+    return .uhd;
+}
+
+/// Ordered decoder names, first to try first.
+pub const Candidates = struct {
+    names: [max_candidates][max_name_len]u8 = undefined,
+    lens: [max_candidates]usize = [_]usize{0} ** max_candidates,
+    count: usize = 0,
+
+    pub fn get(self: *const Candidates, i: usize) []const u8 {
+        return self.names[i][0..self.lens[i]];
+    }
+
+    pub fn contains(self: *const Candidates, name: []const u8) bool {
+        for (0..self.count) |i| {
+            if (std.mem.eql(u8, self.get(i), name)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    pub fn append(self: *Candidates, name: []const u8) void {
+        if (name.len == 0 or name.len > max_name_len or self.count == max_candidates or self.contains(name)) {
+            return;
+        }
+        @memcpy(self.names[self.count][0..name.len], name);
+        self.lens[self.count] = name.len;
+        self.count += 1;
+    }
+};
+
+/// Appends the decoders `text` lists for `codec` at `class`: the
+/// class-specific entry first, then the plain codec entry. Entries are
+/// separated by commas or newlines; malformed ones are skipped.
+pub fn appendFromList(candidates: *Candidates, text: []const u8, codec: []const u8, class: ResolutionClass) void {
+    appendMatching(candidates, text, codec, class);
+    appendMatching(candidates, text, codec, null);
+}
+
+fn appendMatching(candidates: *Candidates, text: []const u8, codec: []const u8, class: ?ResolutionClass) void {
+    var entries = std.mem.tokenizeAny(u8, text, ",\n");
+    while (entries.next()) |entry| {
+        const eq = std.mem.indexOfScalar(u8, entry, '=') orelse continue;
+        const key = std.mem.trim(u8, entry[0..eq], " \r\t");
+        var key_parts = std.mem.splitScalar(u8, key, '@');
+        const key_codec = key_parts.first();
+        const key_class = key_parts.next();
+        if (!std.ascii.eqlIgnoreCase(key_codec, codec)) {
+            continue;
+        }
+        if (class) |wanted| {
+            const text_class = key_class orelse continue;
+            if (!std.ascii.eqlIgnoreCase(text_class, @tagName(wanted))) {
+                continue;
+            }
+        } else if (key_class != null) {
+            continue;
+        }
+
+        var names = std.mem.splitScalar(u8, entry[eq + 1 ..], ':');
+        while (names.next()) |name| {
+            candidates.append(std.mem.trim(u8, name, " \r\t"));
+        }
+    }
+}
+
+/// `ZC_VIDEO_DECODERS` first, then the recorded benchmark rankings. The
+/// caller falls back to FFmpeg's default decoder after these.
+pub fn candidatesFromEnvironment(codec: []const u8, class: ResolutionClass) Candidates {
+    var candidates = Candidates{};
+    const allocator = std.heap.page_allocator;
+
+    if (std.process.getEnvVarOwned(allocator, "ZC_VIDEO_DECODERS")) |value| {
+        defer allocator.free(value);
+        appendFromList(&candidates, value, codec, class);
+    } else |_| {}
+
+    if (readRankings(allocator)) |rankings| {
+        defer allocator.free(rankings);
+        appendFromList(&candidates, rankings, codec, class);
+    } else |_| {}
+
+    return candidates;
+}
+
+fn rankingsPath(allocator: std.mem.Allocator) ![]u8 {
+    const dir = try cacheDir(allocator, "decoders");
+    defer allocator.free(dir);
+    return std.fs.path.join(allocator, &.{ dir, rankings_file });
+}
+
+fn readRankings(allocator: std.mem.Allocator) ![]u8 {
+    const path = try rankingsPath(allocator);
+    defer allocator.free(path);
+    return std.fs.cwd().readFileAlloc(allocator, path, 64 * 1024);
+}
+
+/// Replaces the `codec@class` line of `existing` with `ranked` (fastest
+/// first) and returns the new file contents.
+pub fn replaceRanking(allocator: std.mem.Allocator, existing: []const u8, codec: []const u8, class: ResolutionClass, ranked: []const []const u8) ![]u8 {
+    var out: std.ArrayListUnmanaged(u8) = .empty;
+    errdefer out.deinit(allocator);
+
+    var key_buf: [max_name_len + 8]u8 = undefined;
+    const key = try std.fmt.bufPrint(&key_buf, "{s}@{s}", .{ codec, @tagName(class) });
+
+    var lines = std.mem.tokenizeScalar(u8, existing, '\n');
+    while (lines.next()) |line| {
+        const eq = std.mem.indexOfScalar(u8, line, '=') orelse continue;
+        if (std.ascii.eqlIgnoreCase(std.mem.trim(u8, line[0..eq], " \r\t"), key)) {
+            continue;
+        }
+        try out.appendSlice(allocator, line);
+        try out.append(allocator, '\n');
+    }
+
+    try out.appendSlice(allocator, key);
+    try out.append(allocator, '=');
+    for (ranked, 0..) |name, i| {
+        if (i > 0) {
+            try out.append(allocator, ':');
+        }
+        try out.appendSlice(allocator, name);
+    }
+    try out.append(allocator, '\n');
+    return out.toOwnedSlice(allocator);
+}
+
+/// Records `ranked` for `codec` at `class` in the cache directory, keeping
+/// the rankings of other codecs and classes. Returns the file path.
+pub fn recordRanking(allocator: std.mem.Allocator, codec: []const u8, class: ResolutionClass, ranked: []const []const u8) ![]u8 {
+    const path = try rankingsPath(allocator);
+    errdefer allocator.free(path);
+
+    const existing = std.fs.cwd().readFileAlloc(allocator, path, 64 * 1024) catch |err| switch (err) {
+        error.FileNotFound => try allocator.dupe(u8, ""),
+        else => return err,
+    };
+    defer allocator.free(existing);
+
+    const updated = try replaceRanking(allocator, existing, codec, class, ranked);
+    defer allocator.free(updated);
+    try std.fs.cwd().writeFile(.{ .sub_path = path, .data = updated });
+    return path;
+}
+
+test "appendFromList orders class-specific entries first and skips duplicates" {
+    const list = "hevc=hevc, av1=libdav1d:av1,av1@uhd=libdav1d:libaom-av1\nbogus,av1@hd=av1";
+
+    var uhd = Candidates{};
+    appendFromList(&uhd, list, "AV1", .uhd);
+    try std.testing.expectEqual(@as(usize, 3), uhd.count);
+    try std.testing.expectEqualStrings("libdav1d", uhd.get(0));
+    try std.testing.expectEqualStrings("libaom-av1", uhd.get(1));
+    try std.testing.expectEqualStrings("av1", uhd.get(2));
+
+    var hd = Candidates{};
+    appendFromList(&hd, list, "av1", .hd);
+    try std.testing.expectEqual(@as(usize, 2), hd.count);
+    try std.testing.expectEqualStrings("av1", hd.get(0));
+    try std.testing.expectEqualStrings("libdav1d", hd.get(1));
+
+    var none = Candidates{};
+    appendFromList(&none, list, "vp9", .sd);
+    try std.testing.expectEqual(@as(usize, 0), none.count);
+}
+
+test "replaceRanking keeps other keys and replaces the recorded one" {
+    const allocator = std.testing.allocator;
+    const updated = try replaceRanking(allocator, "av1@hd=av1:libdav1d\nhevc@hd=hevc\n", "av1", .hd, &.{ "libdav1d", "av1" });
+    defer allocator.free(updated);
+    try std.testing.expectEqualStrings("hevc@hd=hevc\nav1@hd=libdav1d:av1\n", updated);
+
+    try std.testing.expectEqual(ResolutionClass.sd, classify(1280, 720));
+    try std.testing.expectEqual(ResolutionClass.hd, classify(1920, 1080));
+    try std.testing.expectEqual(ResolutionClass.uhd, classify(3840, 2160));
+}
@@ -0,0 +1,476 @@
+const std = @import("std");
+const DecodeThreading = @import("DecodeThreading.zig");
+
+// Decodes intra-only video (ProRes, DNxHD/HR, MJPEG, JPEG 2000) on several
+// independent codec contexts at once. Every frame of such a stream decodes on
+// its own, so packets are dealt out to the instances in stream order and the
+// frames are handed back in that same order, which for an intra-only stream
+// is presentation order. Not every intra decoder implements libavcodec's
+// frame threading, and those that do still run one frame per thread through
+// a single context; separate instances scale with cores either way.
+//
+// `ZC_INTRA_DECODERS` is `auto` (default), `off`, or an instance count.
+
+pub const max_instances: u32 = 32;
+const max_auto_instances: u32 = 16;
+// Each instance holds a decoded frame, and the pool keeps two more queued, so
+// the instance count also bounds memory: 8K 4:2:2 10-bit frames are ~130 MiB.
+const auto_memory_budget: u64 = 2 * 1024 * 1024 * 1024;
+const lookahead_slots: usize = 2;
+
+/// Null means auto; 0 disables.
+pub fn parse(value: []const u8) ?u32 {
+    const trimmed = std.mem.trim(u8, value, " ");
+    if (std.ascii.eqlIgnoreCase(trimmed, "auto") or trimmed.len == 0) {
+        return null;
+    }
+    if (std.ascii.eqlIgnoreCase(trimmed, "off")) {
+        return 0;
+    }
+    const count = std.fmt.parseInt(u32, trimmed, 10) catch return null;
+    return if (count <= 1) 0 else @min(count, max_instances);
+}
+
+/// One instance per physical core for frames above 1080p, within the memory
+/// budget; 0 for smaller frames, which one context decodes fast enough.
+pub fn autoInstanceCount(topology: DecodeThreading.CpuTopology, width: i64, height: i64) u32 {
+    const pixels: u64 = @intCast(@max(width, 0) * @max(height, 0));
+    if (pixels <= 1920 * 1088) {
+        return 0;
+    }
+    const by_memory = auto_memory_budget / (pixels * 4);
+    const count: u32 = @intCast(@min(@min(topology.physical, max_auto_instances), by_memory -| @as(u64, lookahead_slots)));
+    return if (count >= 2) count else 0;
+}
+
+pub fn instanceCountFromEnvironment(width: i64, height: i64) u32 {
+    const value = std.process.getEnvVarOwned(std.heap.page_allocator, "ZC_INTRA_DECODERS") catch null;
+    defer if (value) |v| std.heap.page_allocator.free(v);
+    if (value) |v| {
+        if (parse(v)) |count| {
+            return count;
+        }
+    }
+    return autoInstanceCount(DecodeThreading.detectTopology(), width, height);
+}
+
+/// `c` is the caller's libavcodec import. Mirrors avcodec's send/receive
+/// contract, so the decode loop drives it like a single context.
+/// `applySkipLevel` sets a context's discard options for a skip level; each
+/// worker runs it on its own context between packets.
+pub fn Pool(comptime c: type, comptime applySkipLevel: fn (*c.AVCodecContext, c_int) void) type {
+    return struct {
+        const Self = @This();
+
+        const SlotState = enum {
+            empty,
+            queued,
+            decoding,
+            done,
+            failed,
+        };
+
+        // Packet `n` and its frame live in slot `n % slots.len`.
+        const Slot = struct {
+            state: SlotState = .empty,
+            packet: [*c]c.AVPacket = null,
+            frame: [*c]c.AVFrame = null,
+        };
+
+        allocator: std.mem.Allocator,
+        contexts: []*c.AVCodecContext,
+        threads: []std.Thread,
+        slots: []Slot,
+        mutex: std.Thread.Mutex = .{},
+        work_cond: std.Thread.Condition = .{},
+        done_cond: std.Thread.Condition = .{},
+        submit_seq: u64 = 0,
+        dispatch_seq: u64 = 0,
+        output_seq: u64 = 0,
+        busy: usize = 0,
+        draining: bool = false,
+        stopping: bool = false,
+        // Read by workers as they take a packet; the contexts open at level 0.
+        skip_level: c_int = 0,
+
+        /// `contexts` are open, single-threaded instances of one decoder; the
+        /// pool frees them in `destroy`, or the caller does if this fails.
+        pub fn create(allocator: std.mem.Allocator, contexts: []const *c.AVCodecContext) !*Self {
+            const self = try allocator.create(Self);
+            errdefer allocator.destroy(self);
+
+            const owned = try allocator.dupe(*c.AVCodecContext, contexts);
+            errdefer allocator.free(owned);
+
+            const threads = try allocator.alloc(std.Thread, contexts.len);
+            errdefer allocator.free(threads);
+
+            const slots = try allocator.alloc(Slot, contexts.len + lookahead_slots);
+            errdefer allocator.free(slots);
+            @memset(slots, .{});
+            errdefer for (slots) |*slot| {
+                c.av_frame_free(&slot.frame);
+            }
+            for (slots) |*slot| {
+                slot.frame = c.av_frame_alloc();
+                if (slot.frame == null) {
+                    return error.OutOfMemory;
+                }
+            }
+
+            self.* = .{
+                .allocator = allocator,
+                .contexts = owned,
+                .threads = threads,
+                .slots = slots,
+            };
+
+            var started: usize = 0;
+            errdefer self.stopWorkers(started);
+            while (started < threads.len) : (started += 1) {
+                threads[started] = try std.Thread.spawn(.{}, workerMain, .{ self, owned[started] });
+            }
+            return self;
+        }
+
+        pub fn destroy(self: *Self) void {
+            self.stopWorkers(self.threads.len);
+            for (self.slots) |*slot| {
+                c.av_packet_free(&slot.packet);
+                c.av_frame_free(&slot.frame);
+            }
+            for (self.contexts) |ctx| {
+                var owned: [*c]c.AVCodecContext = ctx;
+                c.avcodec_free_context(&owned);
+            }
+            self.allocator.free(self.slots);
+            self.allocator.free(self.threads);
+            self.allocator.free(self.contexts);
+            self.allocator.destroy(self);
+        }
+
+        fn stopWorkers(self: *Self, count: usize) void {
+            self.mutex.lock();
+            self.stopping = true;
+            self.work_cond.broadcast();
+            self.mutex.unlock();
+            for (self.threads[0..count]) |thread| {
+                thread.join();
+            }
+        }
+
+        fn slotAt(self: *Self, seq: u64) *Slot {
+            return &self.slots[@intCast(seq % self.slots.len)];
+        }
+
+        /// Queues a reference to `packet`; null starts draining. Returns
+        /// AVERROR(EAGAIN) while every slot is taken.
+        pub fn send(self: *Self, packet: [*c]const c.AVPacket) c_int {
+            self.mutex.lock();
+            defer self.mutex.unlock();
+
+            if (self.draining) {
+                return c.AVERROR_EOF;
+            }
+            if (packet == null) {
+                self.draining = true;
+                self.done_cond.broadcast();
+                return 0;
+            }
+            if (self.submit_seq - self.output_seq >= self.slots.len) {
+                return c.AVERROR(c.EAGAIN);
+            }
+
+            const copy = c.av_packet_clone(packet);
+            if (copy == null) {
+                return c.AVERROR(c.ENOMEM);
+            }
+            const slot = self.slotAt(self.submit_seq);
+            slot.packet = copy;
+            slot.state = .queued;
+            self.submit_seq += 1;
+            self.work_cond.signal();
+            return 0;
+        }
+
+        /// Moves the next frame in packet order into `out`. Waits for it only
+        /// when no further packet fits or the pool is draining; returns
+        /// AVERROR(EAGAIN) for more input and AVERROR_EOF once drained.
+        /// Packets that fail to decode are skipped.
+        pub fn receive(self: *Self, out: [*c]c.AVFrame) c_int {
+            self.mutex.lock();
+            defer self.mutex.unlock();
+
+            while (self.output_seq < self.submit_seq) {
+                const slot = self.slotAt(self.output_seq);
+                switch (slot.state) {
+                    .done => {
+                        c.av_frame_unref(out);
+                        c.av_frame_move_ref(out, slot.frame);
+                        slot.state = .empty;
+                        self.output_seq += 1;
+                        return 0;
+                    },
+                    .failed => {
+                        c.av_frame_unref(slot.frame);
+                        slot.state = .empty;
+                        self.output_seq += 1;
+                    },
+                    else => {
+                        if (!self.draining and self.submit_seq - self.output_seq < self.slots.len) {
+                            return c.AVERROR(c.EAGAIN);
+                        }
+                        self.done_cond.wait(&self.mutex);
+                    },
+                }
+            }
+            return if (self.draining) c.AVERROR_EOF else c.AVERROR(c.EAGAIN);
+        }
+
+        /// Packets taken from now on decode at `level`. Workers own their
+        /// contexts while decoding, so they apply it themselves.
+        pub fn setSkipLevel(self: *Self, level: c_int) void {
+            self.mutex.lock();
+            defer self.mutex.unlock();
+            self.skip_level = level;
+        }
+
+        /// Drops queued packets and decoded frames; returns once no instance
+        /// is mid-frame.
+        pub fn flush(self: *Self) void {
+            self.mutex.lock();
+            while (self.dispatch_seq < self.submit_seq) : (self.dispatch_seq += 1) {
+                c.av_packet_free(&self.slotAt(self.dispatch_seq).packet);
+            }
+            while (self.busy > 0) {
+                self.done_cond.wait(&self.mutex);
+            }
+            for (self.slots) |*slot| {
+                c.av_frame_unref(slot.frame);
+                slot.state = .empty;
+            }
+            self.submit_seq = 0;
+            self.dispatch_seq = 0;
+            self.output_seq = 0;
+            self.draining = false;
+            self.mutex.unlock();
+
+            for (self.contexts) |ctx| {
+                c.avcodec_flush_buffers(ctx);
+            }
+        }
+
+        fn decodeOne(ctx: *c.AVCodecContext, packet: [*c]const c.AVPacket, out: [*c]c.AVFrame) bool {
+            var ret = c.avcodec_send_packet(ctx, packet);
+            if (ret == c.AVERROR(c.EAGAIN)) {
+                // A frame left over from an earlier packet; intra decoders
+                // without delay should never produce one.
+                _ = c.avcodec_receive_frame(ctx, out);
+                c.av_frame_unref(out);
+                ret = c.avcodec_send_packet(ctx, packet);
+            }
+            if (ret < 0) {
+                return false;
+            }
+            return c.avcodec_receive_frame(ctx, out) == 0;
+        }
+
+        fn workerMain(self: *Self, ctx: *c.AVCodecContext) void {
+            var applied_level: c_int = 0;
+            self.mutex.lock();
+            defer self.mutex.unlock();
+
+            while (true) {
+                while (!self.stopping and self.dispatch_seq == self.submit_seq) {
+                    self.work_cond.wait(&self.mutex);
+                }
+                if (self.stopping) {
+                    return;
+                }
+
+                const slot = self.slotAt(self.dispatch_seq);
+                self.dispatch_seq += 1;
+                slot.state = .decoding;
+                self.busy += 1;
+                var packet = slot.packet;
+                slot.packet = null;
+                const level = self.skip_level;
+
+                self.mutex.unlock();
+                if (level != applied_level) {
+                    applySkipLevel(ctx, level);
+                    applied_level = level;
+                }
+                const decoded = decodeOne(ctx, packet, slot.frame);
+                c.av_packet_free(&packet);
+                self.mutex.lock();
+
+                self.busy -= 1;
+                slot.state = if (decoded) .done else .failed;
+                self.done_cond.broadcast();
+            }
+        }
+    };
+}
+
+test "parse reads counts, off and auto" {
+    try std.testing.expectEqual(@as(?u32, 12), parse(" 12 "));
+    try std.testing.expectEqual(@as(?u32, 0), parse("off"));
+    try std.testing.expectEqual(@as(?u32, 0), parse("1"));
+    try std.testing.expectEqual(@as(?u32, null), parse("auto"));
+    try std.testing.expectEqual(@as(?u32, null), parse("lots"));
+    try std.testing.expectEqual(max_instances, parse("500").?);
+}
+
+test "autoInstanceCount uses cores above 1080p within the memory budget" {
+    const workstation = DecodeThreading.CpuTopology{ .logical = 64, .physical = 32 };
+    try std.testing.expectEqual(@as(u32, 0), autoInstanceCount(workstation, 1920, 1080));
+    try std.testing.expectEqual(max_auto_instances, autoInstanceCount(workstation, 3840, 2160));
+    try std.testing.expectEqual(@as(u32, 14), autoInstanceCount(workstation, 7680, 4320));
+    try std.testing.expectEqual(@as(u32, 0), autoInstanceCount(.{ .logical = 1, .physical = 1 }, 3840, 2160));
+}
+
+// Just enough of libavcodec for the pool: "decoding" copies the packet's pts
+// to the frame after a delay the packet carries, so instances finish out of
+// order.
+const fake = struct {
+    pub const EAGAIN: c_int = 11;
+    pub const ENOMEM: c_int = 12;
+    pub const AVERROR_EOF: c_int = -0x20464f45;
+    pub fn AVERROR(e: c_int) c_int {
+        return -e;
+    }
+
+    pub const AVPacket = extern struct { pts: i64 = 0, delay_us: u64 = 0 };
+    pub const AVFrame = extern struct { pts: i64 = -1, skip_level: c_int = -1 };
+    pub const AVCodecContext = extern struct { pending: AVPacket = .{}, has_pending: bool = false, skip_level: c_int = 0 };
+
+    pub fn applySkipLevel(ctx: *AVCodecContext, level: c_int) void {
+        ctx.skip_level = level;
+    }
+
+    pub fn av_packet_clone(src: [*c]const AVPacket) [*c]AVPacket {
+        const copy = std.testing.allocator.create(AVPacket) catch return null;
+        copy.* = src.*;
+        return copy;
+    }
+    pub fn av_packet_free(packet: [*c][*c]AVPacket) void {
+        if (packet.* != null) {
+            std.testing.allocator.destroy(@as(*AVPacket, packet.*));
+            packet.* = null;
+        }
+    }
+    pub fn av_frame_alloc() [*c]AVFrame {
+        const frame = std.testing.allocator.create(AVFrame) catch return null;
+        frame.* = .{};
+        return frame;
+    }
+    pub fn av_frame_free(frame: [*c][*c]AVFrame) void {
+        if (frame.* != null) {
+            std.testing.allocator.destroy(@as(*AVFrame, frame.*));
+            frame.* = null;
+        }
+    }
+    pub fn av_frame_unref(frame: [*c]AVFrame) void {
+        frame.* = .{};
+    }
+    pub fn av_frame_move_ref(dst: [*c]AVFrame, src: [*c]AVFrame) void {
+        dst.* = src.*;
+        src.* = .{};
+    }
+    pub fn avcodec_send_packet(ctx: *AVCodecContext, packet: [*c]const AVPacket) c_int {
+        if (ctx.has_pending) {
+            return AVERROR(EAGAIN);
+        }
+        std.Thread.sleep(packet.*.delay_us * std.time.ns_per_us);
+        ctx.pending = packet.*;
+        ctx.has_pending = true;
+        return 0;
+    }
+    pub fn avcodec_receive_frame(ctx: *AVCodecContext, frame: [*c]AVFrame) c_int {
+        if (!ctx.has_pending) {
+            return AVERROR(EAGAIN);
+        }
+        ctx.has_pending = false;
+        frame.*.pts = ctx.pending.pts;
+        frame.*.skip_level = ctx.skip_level;
+        return 0;
+    }
+    pub fn avcodec_flush_buffers(ctx: *AVCodecContext) void {
+        ctx.has_pending = false;
+    }
+    pub fn avcodec_free_context(ctx: [*c][*c]AVCodecContext) void {
+        ctx.* = null;
+    }
+};
+
+test "frames come back in packet order when instances finish out of order" {
+    var instances = [_]fake.AVCodecContext{ .{}, .{}, .{}, .{} };
+    var contexts: [instances.len]*fake.AVCodecContext = undefined;
+    for (&instances, 0..) |*instance, i| {
+        contexts[i] = instance;
+    }
+    const pool = try Pool(fake, fake.applySkipLevel).create(std.testing.allocator, &contexts);
+    defer pool.destroy();
+
+    var frame = fake.AVFrame{};
+    var next_pts: i64 = 0;
+    var sent: i64 = 0;
+    while (sent < 40) {
+        const packet = fake.AVPacket{ .pts = sent, .delay_us = @intCast(@mod(sent * 7, 5) * 300) };
+        if (pool.send(&packet) == fake.AVERROR(fake.EAGAIN)) {
+            try std.testing.expectEqual(@as(c_int, 0), pool.receive(&frame));
+            try std.testing.expectEqual(next_pts, frame.pts);
+            next_pts += 1;
+            continue;
+        }
+        sent += 1;
+    }
+    try std.testing.expectEqual(@as(c_int, 0), pool.send(null));
+    while (pool.receive(&frame) == 0) {
+        try std.testing.expectEqual(next_pts, frame.pts);
+        next_pts += 1;
+    }
+    try std.testing.expectEqual(@as(i64, 40), next_pts);
+
+    pool.flush();
+    const packet = fake.AVPacket{ .pts = 100 };
+    try std.testing.expectEqual(@as(c_int, 0), pool.send(&packet));
+    try std.testing.expectEqual(@as(c_int, 0), pool.send(null));
+    try std.testing.expectEqual(@as(c_int, 0), pool.receive(&frame));
+    try std.testing.expectEqual(@as(i64, 100), frame.pts);
+    try std.testing.expectEqual(fake.AVERROR_EOF, pool.receive(&frame));
+}
+
+test "a new skip level reaches every instance from the next packet" {
+    var instances = [_]fake.AVCodecContext{ .{}, .{}, .{} };
+    var contexts: [instances.len]*fake.AVCodecContext = undefined;
+    for (&instances, 0..) |*instance, i| {
+        contexts[i] = instance;
+    }
+    const pool = try Pool(fake, fake.applySkipLevel).create(std.testing.allocator, &contexts);
+    defer pool.destroy();
+
+    var frame = fake.AVFrame{};
+    var next_pts: i64 = 0;
+    var sent: i64 = 0;
+    while (sent < 24) {
+        const packet = fake.AVPacket{ .pts = sent, .delay_us = @intCast(@mod(sent * 3, 4) * 200) };
+        if (pool.send(&packet) == fake.AVERROR(fake.EAGAIN)) {
+            try std.testing.expectEqual(@as(c_int, 0), pool.receive(&frame));
+            try std.testing.expectEqual(@as(c_int, if (frame.pts < 12) 0 else 2), frame.skip_level);
+            next_pts += 1;
+            continue;
+        }
+        sent += 1;
+        if (sent == 12) {
+            pool.setSkipLevel(2);
+        }
+    }
+    try std.testing.expectEqual(@as(c_int, 0), pool.send(null));
+    while (pool.receive(&frame) == 0) {
+        try std.testing.expectEqual(@as(c_int, if (frame.pts < 12) 0 else 2), frame.skip_level);
+        next_pts += 1;
+    }
+    try std.testing.expectEqual(@as(i64, 24), next_pts);
+}
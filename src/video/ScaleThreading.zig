@@ -0,0 +1,65 @@
+const std = @import("std");
+const DecodeThreading = @import("DecodeThreading.zig");
+
+// Threads for the swscale conversion of frames the renderer cannot sample
+// directly. swscale splits the frame into horizontal slices, one per thread.
+// Conversion is mostly memory bound, so past a handful of threads the slices
+// only contend for bandwidth.
+//
+// `ZC_SCALE_THREADS` is `auto` (default), `off`, or a thread count.
+
+pub const max_auto_threads: u32 = 8;
+const max_threads: u32 = 64;
+
+/// Null means auto.
+pub fn parse(value: []const u8) ?u32 {
+    const trimmed = std.mem.trim(u8, value, " ");
+    if (std.ascii.eqlIgnoreCase(trimmed, "auto") or trimmed.len == 0) {
+        return null;
+    }
+    if (std.ascii.eqlIgnoreCase(trimmed, "off")) {
+        return 1;
+    }
+    const count = std.fmt.parseInt(u32, trimmed, 10) catch return null;
+    return if (count == 0) null else @min(count, max_threads);
+}
+
+/// One thread per physical core for frames above 1080p, up to 4 at 1080p,
+/// and a single thread for 720p and below, where slicing costs more than
+/// it saves.
+pub fn autoThreadCount(topology: DecodeThreading.CpuTopology, width: i64, height: i64) u32 {
+    const pixels = @max(width, 0) * @max(height, 0);
+    if (pixels <= 1280 * 720) {
+        return 1;
+    }
+    const count = if (pixels <= 1920 * 1088) @min(topology.physical, 4) else topology.physical;
+    return std.math.clamp(count, 1, max_auto_threads);
+}
+
+pub fn threadCountFromEnvironment(width: i64, height: i64) u32 {
+    const value = std.process.getEnvVarOwned(std.heap.page_allocator, "ZC_SCALE_THREADS") catch null;
+    defer if (value) |v| std.heap.page_allocator.free(v);
+    if (value) |v| {
+        if (parse(v)) |count| {
+            return count;
+        }
+    }
+    return autoThreadCount(DecodeThreading.detectTopology(), width, height);
+}
+
+test "parse reads counts, off and auto" {
+    try std.testing.expectEqual(@as(?u32, 6), parse(" 6 "));
+    try std.testing.expectEqual(@as(?u32, 1), parse("OFF"));
+    try std.testing.expectEqual(@as(?u32, null), parse("auto"));
+    try std.testing.expectEqual(@as(?u32, null), parse("0"));
+    try std.testing.expectEqual(@as(?u32, null), parse("many"));
+    try std.testing.expectEqual(@as(?u32, 64), parse("500"));
+}
+
+test "autoThreadCount slices only frames above 720p" {
+    const smt = DecodeThreading.CpuTopology{ .logical = 32, .physical = 16 };
+    try std.testing.expectEqual(@as(u32, 1), autoThreadCount(smt, 1280, 720));
+    try std.testing.expectEqual(@as(u32, 4), autoThreadCount(smt, 1920, 1080));
+    try std.testing.expectEqual(max_auto_threads, autoThreadCount(smt, 3840, 2160));
+    try std.testing.expectEqual(@as(u32, 2), autoThreadCount(.{ .logical = 2, .physical = 2 }, 3840, 2160));
+}
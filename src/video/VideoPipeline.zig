@@ -10,6 +10,12 @@ pub const VideoPipeline = struct {
         rgba = c.VIDEO_FRAME_FORMAT_RGBA,
         yuv420p = c.VIDEO_FRAME_FORMAT_YUV420P,
         nv12 = c.VIDEO_FRAME_FORMAT_NV12,
+        p010 = c.VIDEO_FRAME_FORMAT_P010,
+        yuv420p10 = c.VIDEO_FRAME_FORMAT_YUV420P10,
+        yuv422p = c.VIDEO_FRAME_FORMAT_YUV422P,
+        yuv444p = c.VIDEO_FRAME_FORMAT_YUV444P,
+        yuv422p10 = c.VIDEO_FRAME_FORMAT_YUV422P10,
+        yuv444p10 = c.VIDEO_FRAME_FORMAT_YUV444P10,
     };
 
     pub const VideoFrame = struct {
@@ -19,6 +25,9 @@ pub const VideoPipeline = struct {
         width: c_int,
         height: c_int,
         format: FrameFormat,
+        /// The decoded AVFrame the planes belong to, valid until the next
+        /// `getFrameForRender`; 0 when the planes are a pipeline copy.
+        frame_token: u64 = 0,
     };
 
     pub const InteropFrame = struct {
@@ -37,6 +46,12 @@ pub const VideoPipeline = struct {
         return switch (format) {
             c.VIDEO_FRAME_FORMAT_NV12 => .nv12,
             c.VIDEO_FRAME_FORMAT_YUV420P => .yuv420p,
+            c.VIDEO_FRAME_FORMAT_P010 => .p010,
+            c.VIDEO_FRAME_FORMAT_YUV420P10 => .yuv420p10,
+            c.VIDEO_FRAME_FORMAT_YUV422P => .yuv422p,
+            c.VIDEO_FRAME_FORMAT_YUV444P => .yuv444p,
+            c.VIDEO_FRAME_FORMAT_YUV422P10 => .yuv422p10,
+            c.VIDEO_FRAME_FORMAT_YUV444P10 => .yuv444p10,
             else => .rgba,
         };
     }
@@ -116,6 +131,34 @@ pub const VideoPipeline = struct {
         c.video_pipeline_reset(&self.handle);
     }
 
+    pub fn park(self: *VideoPipeline) void {
+        if (!self.initialized) {
+            return;
+        }
+        c.video_pipeline_park(&self.handle);
+    }
+
+    pub fn unpark(self: *VideoPipeline) void {
+        if (!self.initialized) {
+            return;
+        }
+        c.video_pipeline_unpark(&self.handle);
+    }
+
+    pub fn decodeSkipLevel(self: *VideoPipeline) c_int {
+        if (!self.initialized) {
+            return c.VIDEO_DECODE_SKIP_NONE;
+        }
+        return c.video_pipeline_get_decode_skip_level(&self.handle);
+    }
+
+    pub fn catchUpCount(self: *VideoPipeline) c_int {
+        if (!self.initialized) {
+            return 0;
+        }
+        return c.video_pipeline_get_catch_up_count(&self.handle);
+    }
+
     pub fn getFrameForRender(self: *VideoPipeline, master_clock: f64) ?RenderFrame {
         if (!self.initialized) {
             return null;
@@ -146,6 +189,7 @@ pub const VideoPipeline = struct {
         if (ret <= 0) {
             return null;
         }
+        const frame_token = if (source_hw == 0) gpu_token else 0;
 
         if (self.interop) |*interop| {
             const software_frame = SoftwareUploadBackendMod.SoftwarePlaneFrame{
@@ -171,6 +215,7 @@ pub const VideoPipeline = struct {
                             .width = sw.width,
                             .height = sw.height,
                             .format = frameFormatFromTag(sw.format),
+                            .frame_token = frame_token,
                         } };
                     },
                     .interop_handle => |handle| return .{ .interop = .{
@@ -190,6 +235,7 @@ pub const VideoPipeline = struct {
             .width = width,
             .height = height,
             .format = frameFormatFromTag(format),
+            .frame_token = frame_token,
         } };
     }
 };
@@ -198,4 +244,6 @@ test "frameFormatFromTag maps known formats" {
     try std.testing.expectEqual(VideoPipeline.FrameFormat.rgba, VideoPipeline.frameFormatFromTag(c.VIDEO_FRAME_FORMAT_RGBA));
     try std.testing.expectEqual(VideoPipeline.FrameFormat.nv12, VideoPipeline.frameFormatFromTag(c.VIDEO_FRAME_FORMAT_NV12));
     try std.testing.expectEqual(VideoPipeline.FrameFormat.yuv420p, VideoPipeline.frameFormatFromTag(c.VIDEO_FRAME_FORMAT_YUV420P));
+    try std.testing.expectEqual(VideoPipeline.FrameFormat.p010, VideoPipeline.frameFormatFromTag(c.VIDEO_FRAME_FORMAT_P010));
+    try std.testing.expectEqual(VideoPipeline.FrameFormat.yuv444p10, VideoPipeline.frameFormatFromTag(c.VIDEO_FRAME_FORMAT_YUV444P10));
 }
@@ -1,6 +1,11 @@
 const builtin = @import("builtin");
 const std = @import("std");
+const DecodeThreading = @import("DecodeThreading.zig");
+const DecoderPreference = @import("DecoderPreference.zig");
+const IntraDecodePool = @import("IntraDecodePool.zig");
+const ScaleThreading = @import("ScaleThreading.zig");
 const c = @cImport({
+    @cInclude("libavutil/opt.h");
     @cInclude("video/video_decoder.h");
     @cInclude("player/demuxer.h");
 });
@@ -251,41 +256,92 @@ fn tryEnableHardwareDevice(
     return true;
 }
 
-fn ensureRgbaBuffer(decoder: *c.VideoDecoder, width: c_int, height: c_int) c_int {
-    const required_size = c.av_image_get_buffer_size(c.AV_PIX_FMT_RGBA, width, height, 1);
-    if (required_size <= 0) {
-        return -1;
+fn threadModeFromTag(tag: c_int) DecodeThreading.Mode {
+    return switch (tag) {
+        c.VIDEO_DECODE_THREADS_FRAME => .frame,
+        c.VIDEO_DECODE_THREADS_SLICE => .slice,
+        c.VIDEO_DECODE_THREADS_OFF => .off,
+        else => .auto,
+    };
+}
+
+fn threadingPolicy(codec: *const c.AVCodec, codec_ctx: *const c.AVCodecContext, requested: ?*const c.VideoDecodeThreading) DecodeThreading.Policy {
+    if (requested) |r| {
+        return .{ .mode = threadModeFromTag(r.mode), .thread_count = @intCast(@max(r.thread_count, 0)) };
+    }
+    const config = DecodeThreading.configFromEnvironment();
+    const names = [_][]const u8{ std.mem.span(c.avcodec_get_name(codec_ctx.codec_id)), std.mem.span(codec.name) };
+    return config.policyFor(&names);
+}
+
+// Only software decoding is threaded; hardware decoders keep libavcodec's
+// single thread, which is also what a threading policy of `off` gives.
+fn applyThreading(codec_ctx: *c.AVCodecContext, policy: DecodeThreading.Policy) void {
+    if (policy.mode == .off) {
+        codec_ctx.thread_count = 1;
+        return;
     }
 
-    if (decoder.buffer == null or decoder.buffer_size < required_size) {
-        const new_buffer = if (decoder.buffer == null)
-            c.av_malloc(@intCast(required_size))
-        else
-            c.av_realloc(decoder.buffer, @intCast(required_size));
+    const count = if (policy.thread_count > 0)
+        policy.thread_count
+    else
+        DecodeThreading.autoThreadCount(DecodeThreading.detectTopology(), codec_ctx.width, codec_ctx.height);
+    codec_ctx.thread_count = @intCast(count);
+    codec_ctx.thread_type = switch (policy.mode) {
+        .frame => c.FF_THREAD_FRAME,
+        .slice => c.FF_THREAD_SLICE,
+        else => c.FF_THREAD_FRAME | c.FF_THREAD_SLICE,
+    };
+}
 
-        if (new_buffer == null) {
+// The scaler writes into a frame it does not own, so the buffer is kept
+// across frames and only reallocated when the size changes.
+fn ensureRgbaFrame(decoder: *c.VideoDecoder, width: c_int, height: c_int) c_int {
+    if (decoder.rgba_frame == null) {
+        decoder.rgba_frame = c.av_frame_alloc();
+        if (decoder.rgba_frame == null) {
             return -1;
         }
+    }
 
-        decoder.buffer = @ptrCast(new_buffer);
-        decoder.buffer_size = required_size;
+    const frame = decoder.rgba_frame;
+    if (frame.*.buf[0] != null and frame.*.width == width and frame.*.height == height) {
+        return 0;
     }
 
-    if (c.av_image_fill_arrays(
-        &decoder.temp_data,
-        &decoder.temp_linesize,
-        decoder.buffer,
-        c.AV_PIX_FMT_RGBA,
-        width,
-        height,
-        1,
-    ) < 0) {
+    c.av_frame_unref(frame);
+    frame.*.format = c.AV_PIX_FMT_RGBA;
+    frame.*.width = width;
+    frame.*.height = height;
+    if (c.av_frame_get_buffer(frame, 0) < 0) {
         return -1;
     }
-
     return 0;
 }
 
+// `threads` above one makes sws_scale_frame convert horizontal slices in
+// parallel on swscale's own worker pool.
+fn createScaleContext(width: c_int, height: c_int, src_fmt: c.AVPixelFormat, threads: u32) ?*c.SwsContext {
+    const ctx = c.sws_alloc_context();
+    if (ctx == null) {
+        return null;
+    }
+
+    const configured = c.av_opt_set_int(ctx, "srcw", width, 0) >= 0 and
+        c.av_opt_set_int(ctx, "srch", height, 0) >= 0 and
+        c.av_opt_set_int(ctx, "src_format", src_fmt, 0) >= 0 and
+        c.av_opt_set_int(ctx, "dstw", width, 0) >= 0 and
+        c.av_opt_set_int(ctx, "dsth", height, 0) >= 0 and
+        c.av_opt_set_int(ctx, "dst_format", c.AV_PIX_FMT_RGBA, 0) >= 0 and
+        c.av_opt_set_int(ctx, "sws_flags", c.SWS_FAST_BILINEAR, 0) >= 0 and
+        c.av_opt_set_int(ctx, "threads", threads, 0) >= 0;
+    if (!configured or c.sws_init_context(ctx, null, null) < 0) {
+        c.sws_freeContext(ctx);
+        return null;
+    }
+    return ctx;
+}
+
 fn ensureScaleContext(decoder: *c.VideoDecoder, src_frame: *c.AVFrame) c_int {
     if (src_frame.*.width <= 0 or src_frame.*.height <= 0) {
         return -1;
@@ -301,28 +357,26 @@ fn ensureScaleContext(decoder: *c.VideoDecoder, src_frame: *c.AVFrame) c_int {
             decoder.sws_ctx = null;
         }
 
-        decoder.sws_ctx = c.sws_getContext(
-            src_frame.*.width,
-            src_frame.*.height,
-            src_fmt,
-            src_frame.*.width,
-            src_frame.*.height,
-            c.AV_PIX_FMT_RGBA,
-            c.SWS_FAST_BILINEAR,
-            null,
-            null,
-            null,
-        );
+        const threads = ScaleThreading.threadCountFromEnvironment(src_frame.*.width, src_frame.*.height);
+        decoder.sws_ctx = createScaleContext(src_frame.*.width, src_frame.*.height, src_fmt, threads);
         if (decoder.sws_ctx == null) {
             return -1;
         }
 
         decoder.sws_src_fmt = src_fmt;
+        decoder.scale_threads = @intCast(threads);
+        decoder.convert_ms = 0.0;
         decoder.width = src_frame.*.width;
         decoder.height = src_frame.*.height;
     }
 
-    return ensureRgbaBuffer(decoder, src_frame.*.width, src_frame.*.height);
+    return ensureRgbaFrame(decoder, src_frame.*.width, src_frame.*.height);
+}
+
+// Smoothed over roughly the last ten conversions.
+fn recordConvertTime(decoder: *c.VideoDecoder, elapsed_ns: u64) void {
+    const ms = @as(f64, @floatFromInt(elapsed_ns)) / std.time.ns_per_ms;
+    decoder.convert_ms = if (decoder.convert_ms <= 0.0) ms else decoder.convert_ms + (ms - decoder.convert_ms) * 0.1;
 }
 
 fn sourceFrameForScale(decoder: *c.VideoDecoder) ?*c.AVFrame {
@@ -347,6 +401,18 @@ fn sourceFrameForScale(decoder: *c.VideoDecoder) ?*c.AVFrame {
     return decoder.frame;
 }
 
+fn formatBit(format: c_int) u32 {
+    return @as(u32, 1) << @intCast(format);
+}
+
+// Formats the renderer can sample directly; any other frame is converted to
+// RGBA with swscale. The renderer widens this once it knows what the GPU
+// supports.
+const default_native_formats = formatBit(c.VIDEO_FRAME_FORMAT_RGBA) |
+    formatBit(c.VIDEO_FRAME_FORMAT_YUV420P) |
+    formatBit(c.VIDEO_FRAME_FORMAT_NV12);
+var native_formats = std.atomic.Value(u32).init(default_native_formats);
+
 fn decodeFormatTag(pix_fmt: c.AVPixelFormat) c_int {
     return switch (pix_fmt) {
         c.AV_PIX_FMT_YUV420P => c.VIDEO_FRAME_FORMAT_YUV420P,
@@ -354,19 +420,309 @@ fn decodeFormatTag(pix_fmt: c.AVPixelFormat) c_int {
         c.AV_PIX_FMT_VIDEOTOOLBOX => c.VIDEO_FRAME_FORMAT_NV12,
         c.AV_PIX_FMT_D3D11 => c.VIDEO_FRAME_FORMAT_NV12,
         c.AV_PIX_FMT_DXVA2_VLD => c.VIDEO_FRAME_FORMAT_NV12,
+        c.AV_PIX_FMT_P010LE, c.AV_PIX_FMT_P012LE, c.AV_PIX_FMT_P016LE => c.VIDEO_FRAME_FORMAT_P010,
+        c.AV_PIX_FMT_YUV420P10LE => c.VIDEO_FRAME_FORMAT_YUV420P10,
+        c.AV_PIX_FMT_YUV422P => c.VIDEO_FRAME_FORMAT_YUV422P,
+        c.AV_PIX_FMT_YUV444P => c.VIDEO_FRAME_FORMAT_YUV444P,
+        c.AV_PIX_FMT_YUV422P10LE => c.VIDEO_FRAME_FORMAT_YUV422P10,
+        c.AV_PIX_FMT_YUV444P10LE => c.VIDEO_FRAME_FORMAT_YUV444P10,
         else => c.VIDEO_FRAME_FORMAT_RGBA,
     };
 }
 
+fn acceptFormatTag(format: c_int, mask: u32) c_int {
+    return if ((mask & formatBit(format)) != 0) format else c.VIDEO_FRAME_FORMAT_RGBA;
+}
+
+// Hardware frames are tagged by the layout they download to, so a 10-bit
+// surface reports P010 rather than NV12.
+fn frameFormatTag(frame: *const c.AVFrame) c_int {
+    var pix_fmt: c.AVPixelFormat = frame.format;
+    if (frame.hw_frames_ctx != null) {
+        const frames_ctx: *const c.AVHWFramesContext = @ptrCast(@alignCast(frame.hw_frames_ctx.*.data));
+        pix_fmt = frames_ctx.sw_format;
+    }
+    return acceptFormatTag(decodeFormatTag(pix_fmt), native_formats.load(.acquire));
+}
+
 fn planeCountForFormatTag(format: c_int) c_int {
     return switch (format) {
-        c.VIDEO_FRAME_FORMAT_YUV420P => 3,
-        c.VIDEO_FRAME_FORMAT_NV12 => 2,
-        else => 1,
+        c.VIDEO_FRAME_FORMAT_RGBA => 1,
+        c.VIDEO_FRAME_FORMAT_NV12, c.VIDEO_FRAME_FORMAT_P010 => 2,
+        else => 3,
     };
 }
 
+// Set by the renderer, which outlives every decoder. Frames decoded into its
+// memory are copied to the GPU without passing through a staging buffer.
+var frame_allocator: ?c.VideoFrameAllocator = null;
+var frame_allocator_mutex: std.Thread.Mutex = .{};
+
+// FFmpeg's SIMD code wants at least this for rows and plane starts.
+const min_direct_alignment: usize = 64;
+
+fn currentFrameAllocator() ?c.VideoFrameAllocator {
+    frame_allocator_mutex.lock();
+    defer frame_allocator_mutex.unlock();
+    return frame_allocator;
+}
+
+const DirectFrameLayout = struct {
+    linesizes: [4]c_int = .{ 0, 0, 0, 0 },
+    offsets: [4]usize = .{ 0, 0, 0, 0 },
+    plane_count: usize = 0,
+    size: usize = 0,
+};
+
+/// All planes of `pix_fmt` in one block, each row and plane start aligned
+/// to `alignment`. The tail keeps `alignment` spare bytes for SIMD
+/// over-reads past the last row.
+fn directFrameLayout(pix_fmt: c.AVPixelFormat, width: c_int, height: c_int, alignment: usize) ?DirectFrameLayout {
+    if (width <= 0 or height <= 0 or !std.math.isPowerOfTwo(alignment)) {
+        return null;
+    }
+
+    var layout = DirectFrameLayout{};
+    if (c.av_image_fill_linesizes(&layout.linesizes, pix_fmt, width) < 0) {
+        return null;
+    }
+
+    var linesizes: [4]isize = .{ 0, 0, 0, 0 };
+    for (&layout.linesizes, 0..) |*linesize, i| {
+        if (linesize.* <= 0) {
+            break;
+        }
+        const aligned = std.mem.alignForward(usize, @intCast(linesize.*), alignment);
+        linesize.* = std.math.cast(c_int, aligned) orelse return null;
+        linesizes[i] = @intCast(aligned);
+        layout.plane_count = i + 1;
+    }
+
+    var sizes: [4]usize = .{ 0, 0, 0, 0 };
+    if (c.av_image_fill_plane_sizes(&sizes, pix_fmt, height, &linesizes) < 0) {
+        return null;
+    }
+
+    var offset: usize = 0;
+    for (0..layout.plane_count) |i| {
+        layout.offsets[i] = offset;
+        offset = std.mem.alignForward(usize, offset + sizes[i], alignment);
+    }
+    layout.size = offset + alignment;
+    return layout;
+}
+
+// The AVBuffer opaque: a frame goes back to the allocator that handed out
+// its memory, even after the renderer has installed another one.
+const DirectFrameBlock = struct {
+    allocator: c.VideoFrameAllocator,
+    block: ?*anyopaque,
+};
+
+fn releaseDirectFrameBuffer(opaque_ptr: ?*anyopaque, data: [*c]u8) callconv(.c) void {
+    _ = data;
+    const owner: *DirectFrameBlock = @ptrCast(@alignCast(opaque_ptr orelse return));
+    const allocator = owner.allocator;
+    const block = owner.block;
+    c.av_free(owner);
+    allocator.release.?(allocator.userdata, block);
+}
+
+// Software frames the renderer samples natively are decoded straight into
+// renderer memory. Anything else, or a full pool, takes FFmpeg's own buffers.
+fn getDirectFrameBuffer(codec_ctx: [*c]c.AVCodecContext, frame: [*c]c.AVFrame, flags: c_int) callconv(.c) c_int {
+    const allocator = currentFrameAllocator() orelse return c.avcodec_default_get_buffer2(codec_ctx, frame, flags);
+    const format = acceptFormatTag(decodeFormatTag(frame.*.format), native_formats.load(.acquire));
+    if (codec_ctx.*.hw_frames_ctx != null or format == c.VIDEO_FRAME_FORMAT_RGBA) {
+        return c.avcodec_default_get_buffer2(codec_ctx, frame, flags);
+    }
+
+    var width = frame.*.width;
+    var height = frame.*.height;
+    var linesize_align: [c.AV_NUM_DATA_POINTERS]c_int = undefined;
+    c.avcodec_align_dimensions2(codec_ctx, &width, &height, &linesize_align);
+
+    var alignment = @max(allocator.alignment, min_direct_alignment);
+    for (linesize_align) |plane_align| {
+        if (plane_align > 0) {
+            alignment = @max(alignment, @as(usize, @intCast(plane_align)));
+        }
+    }
+
+    const layout = directFrameLayout(frame.*.format, width, height, alignment) orelse return c.avcodec_default_get_buffer2(codec_ctx, frame, flags);
+    var block: ?*anyopaque = null;
+    const data = allocator.acquire.?(allocator.userdata, layout.size, &block);
+    if (data == null) {
+        return c.avcodec_default_get_buffer2(codec_ctx, frame, flags);
+    }
+    if (@intFromPtr(data) % alignment != 0) {
+        allocator.release.?(allocator.userdata, block);
+        return c.avcodec_default_get_buffer2(codec_ctx, frame, flags);
+    }
+
+    const owner: ?*DirectFrameBlock = @ptrCast(@alignCast(c.av_malloc(@sizeOf(DirectFrameBlock))));
+    if (owner == null) {
+        allocator.release.?(allocator.userdata, block);
+        return c.avcodec_default_get_buffer2(codec_ctx, frame, flags);
+    }
+    owner.?.* = .{ .allocator = allocator, .block = block };
+
+    frame.*.buf[0] = c.av_buffer_create(data, layout.size, releaseDirectFrameBuffer, owner, 0);
+    if (frame.*.buf[0] == null) {
+        c.av_free(owner);
+        allocator.release.?(allocator.userdata, block);
+        return c.avcodec_default_get_buffer2(codec_ctx, frame, flags);
+    }
+
+    for (0..layout.plane_count) |i| {
+        frame.*.data[i] = data + layout.offsets[i];
+        frame.*.linesize[i] = layout.linesizes[i];
+    }
+    frame.*.extended_data = &frame.*.data;
+    return 0;
+}
+
 pub export fn video_decoder_init(dec: ?*c.VideoDecoder, stream: ?*c.AVStream) c_int {
+    return video_decoder_init_with_options(dec, stream, null);
+}
+
+pub export fn video_decoder_init_with_threading(dec: ?*c.VideoDecoder, stream: ?*c.AVStream, threading: ?*const c.VideoDecodeThreading) c_int {
+    const options = c.VideoDecoderOptions{ .decoder_name = null, .threading = threading, .intra_instances = 0 };
+    return video_decoder_init_with_options(dec, stream, &options);
+}
+
+fn findDecoderByName(name: []const u8, codec_id: c.AVCodecID) ?*const c.AVCodec {
+    var name_buf: [64]u8 = undefined;
+    const name_z = std.fmt.bufPrintZ(&name_buf, "{s}", .{name}) catch return null;
+    const codec = c.avcodec_find_decoder_by_name(name_z.ptr);
+    if (codec == null or codec.*.id != codec_id) {
+        return null;
+    }
+    return codec;
+}
+
+// Leaves `decoder.codec_ctx` open on success and null on failure, so the
+// caller can move on to the next candidate. A software decoder that will hand
+// its packets to an intra pool opens single-threaded: it only keeps the codec
+// parameters, and frame threads would sit idle next to the pool's instances.
+fn openCodec(decoder: *c.VideoDecoder, codec: *const c.AVCodec, stream: *c.AVStream, threading: ?*const c.VideoDecodeThreading, intra_requested: c_int) bool {
+    decoder.codec_ctx = c.avcodec_alloc_context3(codec);
+    if (decoder.codec_ctx == null) {
+        return false;
+    }
+
+    if (c.avcodec_parameters_to_context(decoder.codec_ctx, stream.codecpar) >= 0) {
+        decoder.codec_ctx.*.pkt_timebase = stream.time_base;
+        configureHardwareDecode(decoder, codec);
+        const policy = threadingPolicy(codec, decoder.codec_ctx, threading);
+        const intra = intraInstanceCount(codec, stream.codecpar, intra_requested) >= 2;
+        if (decoder.hw_enabled == 0) {
+            applySoftwareThreading(decoder.codec_ctx, policy, intra);
+        }
+        if ((codec.capabilities & c.AV_CODEC_CAP_DR1) != 0) {
+            decoder.codec_ctx.*.get_buffer2 = getDirectFrameBuffer;
+        }
+
+        if (c.avcodec_open2(decoder.codec_ctx, codec, null) >= 0) {
+            return true;
+        }
+        if (decoder.hw_enabled != 0) {
+            disableHardwareDecode(decoder);
+            applySoftwareThreading(decoder.codec_ctx, policy, intra);
+            if (c.avcodec_open2(decoder.codec_ctx, codec, null) >= 0) {
+                return true;
+            }
+        }
+    }
+
+    disableHardwareDecode(decoder);
+    c.avcodec_free_context(&decoder.codec_ctx);
+    return false;
+}
+
+fn applySoftwareThreading(ctx: *c.AVCodecContext, policy: DecodeThreading.Policy, intra: bool) void {
+    if (intra) {
+        ctx.thread_count = 1;
+    } else {
+        applyThreading(ctx, policy);
+    }
+}
+
+const IntraPool = IntraDecodePool.Pool(c, applySkipLevel);
+
+fn intraPool(decoder: *const c.VideoDecoder) ?*IntraPool {
+    const pool = decoder.intra_pool orelse return null;
+    return @ptrCast(@alignCast(pool));
+}
+
+// Instances an intra pool would run for `codec`; 0 when the codec does not
+// qualify. Negative `requested` disables the pool, 0 reads the environment.
+fn intraInstanceCount(codec: *const c.AVCodec, par: *const c.AVCodecParameters, requested: c_int) u32 {
+    const descriptor = c.avcodec_descriptor_get(codec.id);
+    if (requested < 0 or descriptor == null) {
+        return 0;
+    }
+    if ((descriptor.*.props & c.AV_CODEC_PROP_INTRA_ONLY) == 0 or (codec.capabilities & c.AV_CODEC_CAP_DELAY) != 0) {
+        return 0;
+    }
+    if (requested > 0) {
+        return @min(@as(u32, @intCast(requested)), IntraDecodePool.max_instances);
+    }
+    return IntraDecodePool.instanceCountFromEnvironment(par.width, par.height);
+}
+
+// Extra single-threaded instances of the open decoder for intra-only streams.
+// When fewer than two instances open, the decoder goes back to a threaded
+// context of its own; false means that reopen failed too.
+fn startIntraPool(decoder: *c.VideoDecoder, stream: *c.AVStream, threading: ?*const c.VideoDecodeThreading, requested: c_int) bool {
+    const codec = decoder.codec_ctx.*.codec;
+    if (decoder.hw_enabled != 0) {
+        return true;
+    }
+    const count = intraInstanceCount(codec, decoder.params, requested);
+    if (count < 2) {
+        return true;
+    }
+
+    var contexts: [IntraDecodePool.max_instances]*c.AVCodecContext = undefined;
+    var opened: usize = 0;
+    while (opened < count) : (opened += 1) {
+        var ctx = c.avcodec_alloc_context3(codec);
+        if (ctx == null) {
+            break;
+        }
+        ctx.*.thread_count = 1;
+        ctx.*.pkt_timebase = decoder.codec_ctx.*.pkt_timebase;
+        if ((codec.*.capabilities & c.AV_CODEC_CAP_DR1) != 0) {
+            ctx.*.get_buffer2 = getDirectFrameBuffer;
+        }
+        if (c.avcodec_parameters_to_context(ctx, decoder.params) < 0 or c.avcodec_open2(ctx, codec, null) < 0) {
+            c.avcodec_free_context(&ctx);
+            break;
+        }
+        contexts[opened] = ctx;
+    }
+
+    if (opened >= 2) {
+        if (IntraPool.create(std.heap.page_allocator, contexts[0..opened])) |pool| {
+            decoder.intra_pool = pool;
+            decoder.intra_instances = @intCast(opened);
+            return true;
+        } else |_| {}
+    }
+    for (contexts[0..opened]) |ctx| {
+        var owned: [*c]c.AVCodecContext = ctx;
+        c.avcodec_free_context(&owned);
+    }
+
+    c.avcodec_free_context(&decoder.codec_ctx);
+    return openCodec(decoder, codec, stream, threading, -1);
+}
+
+/// `options` null (or null fields) reads the decoder preference list, the
+/// threading policy and the intra-only instance count from the environment.
+/// A named decoder is the only one tried.
+pub export fn video_decoder_init_with_options(dec: ?*c.VideoDecoder, stream: ?*c.AVStream, options: ?*const c.VideoDecoderOptions) c_int {
     if (dec == null) {
         return -1;
     }
@@ -380,40 +736,41 @@ pub export fn video_decoder_init(dec: ?*c.VideoDecoder, stream: ?*c.AVStream) c_
         return -1;
     }
 
-    const codec = c.avcodec_find_decoder(stream.?.codecpar.*.codec_id);
-    if (codec == null) {
-        return -1;
-    }
+    const par = stream.?.codecpar.*;
+    const threading: ?*const c.VideoDecodeThreading = if (options) |o| o.threading else null;
+    const decoder_name: [*c]const u8 = if (options) |o| o.decoder_name else null;
+    const intra_requested: c_int = if (options) |o| o.intra_instances else 0;
 
-    d.codec_ctx = c.avcodec_alloc_context3(codec);
-    if (d.codec_ctx == null) {
-        return -1;
-    }
-
-    if (c.avcodec_parameters_to_context(d.codec_ctx, stream.?.codecpar) < 0) {
-        video_decoder_destroy(d);
-        return -1;
-    }
-
-    configureHardwareDecode(d, codec);
+    if (decoder_name != null) {
+        const codec = findDecoderByName(std.mem.span(decoder_name), par.codec_id) orelse return -1;
+        if (!openCodec(d, codec, stream.?, threading, intra_requested)) {
+            return -1;
+        }
+    } else {
+        const class = DecoderPreference.classify(par.width, par.height);
+        const candidates = DecoderPreference.candidatesFromEnvironment(std.mem.span(c.avcodec_get_name(par.codec_id)), class);
+        var opened = false;
+        for (0..candidates.count) |i| {
+            const codec = findDecoderByName(candidates.get(i), par.codec_id) orelse continue;
+            if (openCodec(d, codec, stream.?, threading, intra_requested)) {
+                opened = true;
+                break;
+            }
+        }
 
-    if (c.avcodec_open2(d.codec_ctx, codec, null) < 0) {
-        if (d.hw_enabled != 0) {
-            disableHardwareDecode(d);
-            if (c.avcodec_open2(d.codec_ctx, codec, null) < 0) {
-                video_decoder_destroy(d);
+        if (!opened) {
+            const codec = c.avcodec_find_decoder(par.codec_id);
+            if (codec == null or !openCodec(d, codec, stream.?, threading, intra_requested)) {
                 return -1;
             }
-        } else {
-            video_decoder_destroy(d);
-            return -1;
         }
     }
 
     d.packet = c.av_packet_alloc();
     d.frame = c.av_frame_alloc();
     d.sw_frame = c.av_frame_alloc();
-    if (d.packet == null or d.frame == null or d.sw_frame == null) {
+    d.params = c.avcodec_parameters_alloc();
+    if (d.packet == null or d.frame == null or d.sw_frame == null or d.params == null or c.avcodec_parameters_copy(d.params, stream.?.codecpar) < 0) {
         video_decoder_destroy(d);
         return -1;
     }
@@ -424,8 +781,7 @@ pub export fn video_decoder_init(dec: ?*c.VideoDecoder, stream: ?*c.AVStream) c_
     d.pts = 0.0;
     d.eof = 0;
     d.sent_eof = 0;
-
-    if (d.width > 0 and d.height > 0 and ensureRgbaBuffer(d, d.width, d.height) != 0) {
+    if (!startIntraPool(d, stream.?, threading, intra_requested)) {
         video_decoder_destroy(d);
         return -1;
     }
@@ -447,10 +803,8 @@ pub export fn video_decoder_destroy(dec: ?*c.VideoDecoder) void {
 
     const d = dec.?;
 
-    if (d.buffer != null) {
-        c.av_free(d.buffer);
-        d.buffer = null;
-        d.buffer_size = 0;
+    if (d.rgba_frame != null) {
+        c.av_frame_free(&d.rgba_frame);
     }
 
     if (d.sws_ctx != null) {
@@ -474,10 +828,20 @@ pub export fn video_decoder_destroy(dec: ?*c.VideoDecoder) void {
 
     disableHardwareDecode(d);
 
+    if (intraPool(d)) |pool| {
+        pool.destroy();
+        d.intra_pool = null;
+        d.intra_instances = 0;
+    }
+
     if (d.codec_ctx != null) {
         c.avcodec_free_context(&d.codec_ctx);
     }
 
+    if (d.params != null) {
+        c.avcodec_parameters_free(&d.params);
+    }
+
     d.stream = null;
     d.width = 0;
     d.height = 0;
@@ -487,6 +851,49 @@ pub export fn video_decoder_destroy(dec: ?*c.VideoDecoder) void {
     d.sws_src_fmt = c.AV_PIX_FMT_NONE;
 }
 
+// Parameters that shape the decoder's state: a stream that matches on all of
+// them decodes the same way through an already open codec context.
+fn sameDecoderParameters(a: *const c.AVCodecParameters, b: *const c.AVCodecParameters) bool {
+    if (a.codec_type != b.codec_type or a.codec_id != b.codec_id or a.format != b.format or a.profile != b.profile) {
+        return false;
+    }
+    if (a.width != b.width or a.height != b.height or a.bits_per_raw_sample != b.bits_per_raw_sample) {
+        return false;
+    }
+    if (a.extradata_size != b.extradata_size) {
+        return false;
+    }
+    const len: usize = @intCast(@max(a.extradata_size, 0));
+    return len == 0 or std.mem.eql(u8, a.extradata[0..len], b.extradata[0..len]);
+}
+
+/// Keeps an open decoder (codec context, hardware device, scaler and frames)
+/// for `stream` when its parameters match the stream the decoder was opened
+/// for, and flushes it. Returns -1 otherwise; the caller then destroys and
+/// re-inits. Safe to call after the previous stream's demuxer has closed.
+pub export fn video_decoder_reuse(dec: ?*c.VideoDecoder, stream: ?*c.AVStream) c_int {
+    const d = dec orelse return -1;
+    if (d.codec_ctx == null or d.params == null or stream == null or stream.?.codecpar == null) {
+        return -1;
+    }
+    if (!sameDecoderParameters(d.params, stream.?.codecpar)) {
+        return -1;
+    }
+
+    video_decoder_flush(d);
+    video_decoder_set_skip_level(d, c.VIDEO_DECODE_SKIP_NONE);
+    // Equal codec parameters say nothing about the container's time base.
+    d.codec_ctx.*.pkt_timebase = stream.?.time_base;
+    if (intraPool(d)) |pool| {
+        for (pool.contexts) |ctx| {
+            ctx.pkt_timebase = stream.?.time_base;
+        }
+    }
+    d.stream = stream;
+    d.pts = 0.0;
+    return 0;
+}
+
 pub export fn video_decoder_flush(dec: ?*c.VideoDecoder) void {
     if (dec == null or dec.?.codec_ctx == null) {
         return;
@@ -495,6 +902,9 @@ pub export fn video_decoder_flush(dec: ?*c.VideoDecoder) void {
     const d = dec.?;
 
     c.avcodec_flush_buffers(d.codec_ctx);
+    if (intraPool(d)) |pool| {
+        pool.flush();
+    }
 
     if (d.packet != null) {
         c.av_packet_unref(d.packet);
@@ -526,7 +936,7 @@ pub export fn video_decoder_decode_frame(dec: ?*c.VideoDecoder, demuxer: ?*c.Dem
     }
 
     while (true) {
-        var ret = c.avcodec_receive_frame(d.codec_ctx, d.frame);
+        var ret = video_decoder_receive_frame(d);
 
         if (ret == 0) {
             if (d.hw_enabled != 0 and d.frame.*.format == d.hw_pix_fmt) {
@@ -564,7 +974,7 @@ pub export fn video_decoder_decode_frame(dec: ?*c.VideoDecoder, demuxer: ?*c.Dem
 
             const pop_result = c.demuxer_pop_video_packet(demuxer, d.packet);
             if (pop_result > 0) {
-                ret = c.avcodec_send_packet(d.codec_ctx, d.packet);
+                ret = video_decoder_send_packet(d, d.packet);
                 c.av_packet_unref(d.packet);
                 if (ret < 0 and ret != c.AVERROR(c.EAGAIN)) {
                     return -1;
@@ -573,7 +983,7 @@ pub export fn video_decoder_decode_frame(dec: ?*c.VideoDecoder, demuxer: ?*c.Dem
             }
 
             if (pop_result == 0) {
-                ret = c.avcodec_send_packet(d.codec_ctx, null);
+                ret = video_decoder_send_packet(d, null);
                 if (ret < 0 and ret != c.AVERROR_EOF) {
                     return -1;
                 }
@@ -593,6 +1003,26 @@ pub export fn video_decoder_decode_frame(dec: ?*c.VideoDecoder, demuxer: ?*c.Dem
     }
 }
 
+/// avcodec_send_packet for the decoder, through its intra-only instances when
+/// it has them.
+pub export fn video_decoder_send_packet(dec: ?*c.VideoDecoder, packet: [*c]const c.AVPacket) c_int {
+    const d = dec orelse return c.AVERROR(c.EINVAL);
+    if (intraPool(d)) |pool| {
+        return pool.send(packet);
+    }
+    return c.avcodec_send_packet(d.codec_ctx, packet);
+}
+
+/// avcodec_receive_frame into `dec->frame`, in packet order when the
+/// decoder has intra-only instances.
+pub export fn video_decoder_receive_frame(dec: ?*c.VideoDecoder) c_int {
+    const d = dec orelse return c.AVERROR(c.EINVAL);
+    if (intraPool(d)) |pool| {
+        return pool.receive(d.frame);
+    }
+    return c.avcodec_receive_frame(d.codec_ctx, d.frame);
+}
+
 pub export fn video_decoder_get_image(dec: ?*c.VideoDecoder, data: [*c][*c]u8, linesize: [*c]c_int) c_int {
     if (dec == null or data == null or linesize == null) {
         return -1;
@@ -605,22 +1035,16 @@ pub export fn video_decoder_get_image(dec: ?*c.VideoDecoder, data: [*c][*c]u8, l
         return -1;
     }
 
-    const h = c.sws_scale(
-        d.sws_ctx,
-        @ptrCast(&src_frame.*.data),
-        @ptrCast(&src_frame.*.linesize),
-        0,
-        src_frame.*.height,
-        &d.temp_data,
-        &d.temp_linesize,
-    );
-
-    if (h <= 0) {
+    var timer: ?std.time.Timer = std.time.Timer.start() catch null;
+    if (c.sws_scale_frame(d.sws_ctx, d.rgba_frame, src_frame) < 0) {
         return -1;
     }
+    if (timer) |*t| {
+        recordConvertTime(d, t.read());
+    }
 
-    data.* = d.temp_data[0];
-    linesize.* = d.temp_linesize[0];
+    data.* = d.rgba_frame.*.data[0];
+    linesize.* = d.rgba_frame.*.linesize[0];
     return 0;
 }
 
@@ -633,8 +1057,7 @@ pub export fn video_decoder_get_format(dec: ?*c.VideoDecoder) c_int {
         return c.VIDEO_FRAME_FORMAT_RGBA;
     }
 
-    const pix_fmt: c.AVPixelFormat = dec.?.frame.*.format;
-    return decodeFormatTag(pix_fmt);
+    return frameFormatTag(dec.?.frame);
 }
 
 pub export fn video_decoder_is_hw_enabled(dec: ?*c.VideoDecoder) c_int {
@@ -670,6 +1093,67 @@ pub export fn video_decoder_get_hw_frame_token(dec: ?*c.VideoDecoder) u64 {
     return @intFromPtr(d.hw_frame_ref);
 }
 
+/// Reports the threading the open codec actually runs with, which can be
+/// less than requested when the codec lacks frame or slice support.
+pub export fn video_decoder_get_threading(dec: ?*c.VideoDecoder, threading: [*c]c.VideoDecodeThreading) c_int {
+    const d = dec orelse return -1;
+    if (d.codec_ctx == null or threading == null) {
+        return -1;
+    }
+
+    if (d.intra_pool != null) {
+        threading.*.mode = c.VIDEO_DECODE_THREADS_INSTANCES;
+        threading.*.thread_count = d.intra_instances;
+        return 0;
+    }
+
+    const active = d.codec_ctx.*.active_thread_type;
+    threading.*.mode = if ((active & c.FF_THREAD_FRAME) != 0)
+        c.VIDEO_DECODE_THREADS_FRAME
+    else if ((active & c.FF_THREAD_SLICE) != 0)
+        c.VIDEO_DECODE_THREADS_SLICE
+    else
+        c.VIDEO_DECODE_THREADS_OFF;
+    threading.*.thread_count = if (threading.*.mode == c.VIDEO_DECODE_THREADS_OFF) 1 else d.codec_ctx.*.thread_count;
+    return 0;
+}
+
+/// Each level keeps the skips of the levels below it. Takes effect from the
+/// next packet sent; frame threads pick it up as they start a frame.
+pub export fn video_decoder_set_skip_level(dec: ?*c.VideoDecoder, level: c_int) void {
+    const d = dec orelse return;
+    if (d.codec_ctx == null or d.skip_level == level) {
+        return;
+    }
+
+    applySkipLevel(d.codec_ctx, level);
+    if (intraPool(d)) |pool| {
+        pool.setSkipLevel(level);
+    }
+    d.skip_level = level;
+}
+
+fn applySkipLevel(ctx: *c.AVCodecContext, level: c_int) void {
+    ctx.*.skip_loop_filter = if (level >= c.VIDEO_DECODE_SKIP_LOOP_FILTER) c.AVDISCARD_ALL else c.AVDISCARD_DEFAULT;
+    ctx.*.skip_frame = if (level >= c.VIDEO_DECODE_SKIP_NONREF) c.AVDISCARD_NONREF else c.AVDISCARD_DEFAULT;
+    ctx.*.skip_idct = if (level >= c.VIDEO_DECODE_SKIP_IDCT) c.AVDISCARD_NONKEY else c.AVDISCARD_DEFAULT;
+}
+
+/// `format_mask` has bit `1 << VIDEO_FRAME_FORMAT_*` set for each format the
+/// renderer samples natively. RGBA is always accepted.
+pub export fn video_decoder_set_native_formats(format_mask: u32) void {
+    native_formats.store(format_mask | formatBit(c.VIDEO_FRAME_FORMAT_RGBA), .release);
+}
+
+/// Null reverts to FFmpeg's own frame buffers for decoders opened after the
+/// call. Frames already decoded into the previous allocator's memory are
+/// still handed back to it, so it must stay valid until they are freed.
+pub export fn video_decoder_set_frame_allocator(allocator: ?*const c.VideoFrameAllocator) void {
+    frame_allocator_mutex.lock();
+    defer frame_allocator_mutex.unlock();
+    frame_allocator = if (allocator) |a| a.* else null;
+}
+
 pub export fn video_decoder_get_planes(
     dec: ?*c.VideoDecoder,
     planes: [*c][*c]u8,
@@ -682,7 +1166,7 @@ pub export fn video_decoder_get_planes(
 
     const d = dec.?;
     const src_frame = sourceFrameForScale(d) orelse return -1;
-    const format = decodeFormatTag(src_frame.*.format);
+    const format = frameFormatTag(src_frame);
 
     if (format == c.VIDEO_FRAME_FORMAT_RGBA) {
         var data0: [*c]u8 = null;
@@ -743,6 +1227,101 @@ test "planeCountForFormatTag reports expected yuv plane counts" {
     try std.testing.expectEqual(@as(c_int, 1), planeCountForFormatTag(c.VIDEO_FRAME_FORMAT_RGBA));
     try std.testing.expectEqual(@as(c_int, 3), planeCountForFormatTag(c.VIDEO_FRAME_FORMAT_YUV420P));
     try std.testing.expectEqual(@as(c_int, 2), planeCountForFormatTag(c.VIDEO_FRAME_FORMAT_NV12));
+    try std.testing.expectEqual(@as(c_int, 2), planeCountForFormatTag(c.VIDEO_FRAME_FORMAT_P010));
+    try std.testing.expectEqual(@as(c_int, 3), planeCountForFormatTag(c.VIDEO_FRAME_FORMAT_YUV444P10));
+}
+
+test "decodeFormatTag maps high bit depth and 4:2:2/4:4:4 formats" {
+    try std.testing.expectEqual(@as(c_int, c.VIDEO_FRAME_FORMAT_P010), decodeFormatTag(c.AV_PIX_FMT_P010LE));
+    try std.testing.expectEqual(@as(c_int, c.VIDEO_FRAME_FORMAT_P010), decodeFormatTag(c.AV_PIX_FMT_P016LE));
+    try std.testing.expectEqual(@as(c_int, c.VIDEO_FRAME_FORMAT_YUV420P10), decodeFormatTag(c.AV_PIX_FMT_YUV420P10LE));
+    try std.testing.expectEqual(@as(c_int, c.VIDEO_FRAME_FORMAT_YUV422P), decodeFormatTag(c.AV_PIX_FMT_YUV422P));
+    try std.testing.expectEqual(@as(c_int, c.VIDEO_FRAME_FORMAT_YUV444P10), decodeFormatTag(c.AV_PIX_FMT_YUV444P10LE));
+    // 12-bit planar keeps going through swscale.
+    try std.testing.expectEqual(@as(c_int, c.VIDEO_FRAME_FORMAT_RGBA), decodeFormatTag(c.AV_PIX_FMT_YUV420P12LE));
+
+    try std.testing.expectEqual(@as(c_int, c.VIDEO_FRAME_FORMAT_RGBA), acceptFormatTag(c.VIDEO_FRAME_FORMAT_P010, default_native_formats));
+    try std.testing.expectEqual(@as(c_int, c.VIDEO_FRAME_FORMAT_NV12), acceptFormatTag(c.VIDEO_FRAME_FORMAT_NV12, default_native_formats));
+    const mask = default_native_formats | formatBit(c.VIDEO_FRAME_FORMAT_P010);
+    try std.testing.expectEqual(@as(c_int, c.VIDEO_FRAME_FORMAT_P010), acceptFormatTag(c.VIDEO_FRAME_FORMAT_P010, mask));
+}
+
+test "directFrameLayout aligns rows and plane starts" {
+    const nv12 = directFrameLayout(c.AV_PIX_FMT_NV12, 1920, 1088, 256).?;
+    try std.testing.expectEqual(@as(usize, 2), nv12.plane_count);
+    try std.testing.expectEqual(@as(c_int, 2048), nv12.linesizes[0]);
+    try std.testing.expectEqual(@as(c_int, 2048), nv12.linesizes[1]);
+    try std.testing.expectEqual(@as(usize, 2048 * 1088), nv12.offsets[1]);
+    try std.testing.expectEqual(@as(usize, 2048 * 1088 + 2048 * 544 + 256), nv12.size);
+
+    const yuv = directFrameLayout(c.AV_PIX_FMT_YUV420P10LE, 1000, 563, 64).?;
+    try std.testing.expectEqual(@as(usize, 3), yuv.plane_count);
+    try std.testing.expectEqual(@as(c_int, 2048), yuv.linesizes[0]);
+    try std.testing.expectEqual(@as(c_int, 1024), yuv.linesizes[1]);
+    try std.testing.expectEqual(@as(usize, 2048 * 563), yuv.offsets[1]);
+    try std.testing.expectEqual(@as(usize, 0), yuv.offsets[2] % 64);
+    try std.testing.expect(yuv.offsets[2] >= yuv.offsets[1] + 1024 * 282);
+
+    try std.testing.expect(directFrameLayout(c.AV_PIX_FMT_NV12, 1920, 1080, 48) == null);
+    try std.testing.expect(directFrameLayout(c.AV_PIX_FMT_NV12, 0, 1080, 64) == null);
+}
+
+test "direct frame buffers return to the allocator that handed them out" {
+    const Pool = struct {
+        released: ?*anyopaque = null,
+
+        fn acquire(_: ?*anyopaque, _: usize, _: [*c]?*anyopaque) callconv(.c) [*c]u8 {
+            return null;
+        }
+
+        fn release(userdata: ?*anyopaque, block: ?*anyopaque) callconv(.c) void {
+            const pool: *@This() = @ptrCast(@alignCast(userdata));
+            pool.released = block;
+        }
+    };
+
+    var pool = Pool{};
+    var memory: [64]u8 = undefined;
+    var block_handle: u8 = 0;
+    const owner: *DirectFrameBlock = @ptrCast(@alignCast(c.av_malloc(@sizeOf(DirectFrameBlock)) orelse return error.OutOfMemory));
+    owner.* = .{
+        .allocator = .{ .userdata = &pool, .acquire = Pool.acquire, .release = Pool.release, .alignment = 64 },
+        .block = &block_handle,
+    };
+    var buffer = c.av_buffer_create(&memory, memory.len, releaseDirectFrameBuffer, owner, 0);
+    try std.testing.expect(buffer != null);
+
+    // The renderer swapped allocators while the frame was still referenced.
+    video_decoder_set_frame_allocator(null);
+    c.av_buffer_unref(&buffer);
+    try std.testing.expectEqual(@as(?*anyopaque, &block_handle), pool.released);
+}
+
+test "sameDecoderParameters matches on codec, geometry and extradata" {
+    var extradata_a = [_]u8{ 1, 100, 0, 31 };
+    var extradata_b = [_]u8{ 1, 100, 0, 40 };
+    var a = std.mem.zeroes(c.AVCodecParameters);
+    a.codec_type = c.AVMEDIA_TYPE_VIDEO;
+    a.codec_id = c.AV_CODEC_ID_H264;
+    a.format = c.AV_PIX_FMT_YUV420P;
+    a.width = 1920;
+    a.height = 1080;
+    a.extradata = &extradata_a;
+    a.extradata_size = extradata_a.len;
+
+    var b = a;
+    try std.testing.expect(sameDecoderParameters(&a, &b));
+
+    b.extradata = &extradata_b;
+    try std.testing.expect(!sameDecoderParameters(&a, &b));
+
+    b = a;
+    b.height = 1088;
+    try std.testing.expect(!sameDecoderParameters(&a, &b));
+
+    b = a;
+    b.format = c.AV_PIX_FMT_YUV420P10LE;
+    try std.testing.expect(!sameDecoderParameters(&a, &b));
 }
 
 test "video_decoder true path maps videotoolbox source metadata to nv12" {
@@ -1,4 +1,5 @@
 const std = @import("std");
+const DecodeDegradation = @import("DecodeDegradation.zig");
 const c = @cImport({
     @cInclude("stdlib.h");
     @cInclude("string.h");
@@ -13,6 +14,9 @@ const PLAYING_STATE = switch (@typeInfo(c.PlayerState)) {
 };
 
 const render_late_drop_tolerance = 0.05;
+// Caps a single controller step, so the gap across a pause or a stall does
+// not count as time spent behind.
+const degrade_max_step_s = 0.25;
 
 fn frameCapacity() c_int {
     return c.VIDEO_FRAME_QUEUE_CAPACITY;
@@ -20,36 +24,67 @@ fn frameCapacity() c_int {
 
 fn planeCountForFormat(format: c_int) c_int {
     return switch (format) {
-        c.VIDEO_FRAME_FORMAT_YUV420P => 3,
-        c.VIDEO_FRAME_FORMAT_NV12 => 2,
+        c.VIDEO_FRAME_FORMAT_RGBA => 1,
+        c.VIDEO_FRAME_FORMAT_NV12, c.VIDEO_FRAME_FORMAT_P010 => 2,
+        c.VIDEO_FRAME_FORMAT_YUV420P,
+        c.VIDEO_FRAME_FORMAT_YUV420P10,
+        c.VIDEO_FRAME_FORMAT_YUV422P,
+        c.VIDEO_FRAME_FORMAT_YUV444P,
+        c.VIDEO_FRAME_FORMAT_YUV422P10,
+        c.VIDEO_FRAME_FORMAT_YUV444P10,
+        => 3,
         else => 1,
     };
 }
 
+const YuvLayout = struct {
+    semi_planar: bool,
+    bytes_per_sample: usize,
+    chroma_shift_x: u1,
+    chroma_shift_y: u1,
+};
+
+fn yuvLayout(format: c_int) ?YuvLayout {
+    return switch (format) {
+        c.VIDEO_FRAME_FORMAT_NV12 => .{ .semi_planar = true, .bytes_per_sample = 1, .chroma_shift_x = 1, .chroma_shift_y = 1 },
+        c.VIDEO_FRAME_FORMAT_P010 => .{ .semi_planar = true, .bytes_per_sample = 2, .chroma_shift_x = 1, .chroma_shift_y = 1 },
+        c.VIDEO_FRAME_FORMAT_YUV420P => .{ .semi_planar = false, .bytes_per_sample = 1, .chroma_shift_x = 1, .chroma_shift_y = 1 },
+        c.VIDEO_FRAME_FORMAT_YUV420P10 => .{ .semi_planar = false, .bytes_per_sample = 2, .chroma_shift_x = 1, .chroma_shift_y = 1 },
+        c.VIDEO_FRAME_FORMAT_YUV422P => .{ .semi_planar = false, .bytes_per_sample = 1, .chroma_shift_x = 1, .chroma_shift_y = 0 },
+        c.VIDEO_FRAME_FORMAT_YUV444P => .{ .semi_planar = false, .bytes_per_sample = 1, .chroma_shift_x = 0, .chroma_shift_y = 0 },
+        c.VIDEO_FRAME_FORMAT_YUV422P10 => .{ .semi_planar = false, .bytes_per_sample = 2, .chroma_shift_x = 1, .chroma_shift_y = 0 },
+        c.VIDEO_FRAME_FORMAT_YUV444P10 => .{ .semi_planar = false, .bytes_per_sample = 2, .chroma_shift_x = 0, .chroma_shift_y = 0 },
+        else => null,
+    };
+}
+
+// Subsampled chroma rounds up, as FFmpeg allocates it.
+fn chromaExtent(size: c_int, shift: u1) usize {
+    const extent: usize = @intCast(size);
+    return (extent + shift) >> shift;
+}
+
 fn planeGeometry(format: c_int, width: c_int, height: c_int, plane_idx: c_int) ?struct { row_bytes: usize, rows: usize } {
     if (width <= 0 or height <= 0) {
         return null;
     }
 
-    return switch (format) {
-        c.VIDEO_FRAME_FORMAT_RGBA => if (plane_idx == 0)
-            .{ .row_bytes = @as(usize, @intCast(width)) * 4, .rows = @as(usize, @intCast(height)) }
-        else
-            null,
-        c.VIDEO_FRAME_FORMAT_NV12 => switch (plane_idx) {
-            0 => .{ .row_bytes = @as(usize, @intCast(width)), .rows = @as(usize, @intCast(height)) },
-            1 => .{ .row_bytes = @as(usize, @intCast(width)), .rows = @as(usize, @intCast(@divTrunc(height, 2))) },
-            else => null,
-        },
-        c.VIDEO_FRAME_FORMAT_YUV420P => switch (plane_idx) {
-            0 => .{ .row_bytes = @as(usize, @intCast(width)), .rows = @as(usize, @intCast(height)) },
-            1, 2 => .{ .row_bytes = @as(usize, @intCast(@divTrunc(width, 2))), .rows = @as(usize, @intCast(@divTrunc(height, 2))) },
-            else => null,
-        },
-        else => if (plane_idx == 0)
-            .{ .row_bytes = @as(usize, @intCast(width)) * 4, .rows = @as(usize, @intCast(height)) }
-        else
-            null,
+    const layout = yuvLayout(format) orelse return if (plane_idx == 0)
+        .{ .row_bytes = @as(usize, @intCast(width)) * 4, .rows = @as(usize, @intCast(height)) }
+    else
+        null;
+
+    if (plane_idx == 0) {
+        return .{ .row_bytes = @as(usize, @intCast(width)) * layout.bytes_per_sample, .rows = @as(usize, @intCast(height)) };
+    }
+    if (plane_idx >= planeCountForFormat(format)) {
+        return null;
+    }
+
+    const samples_per_row: usize = if (layout.semi_planar) 2 else 1;
+    return .{
+        .row_bytes = chromaExtent(width, layout.chroma_shift_x) * samples_per_row * layout.bytes_per_sample,
+        .rows = chromaExtent(height, layout.chroma_shift_y),
     };
 }
 
@@ -260,7 +295,9 @@ fn queuePushLocked(
     return 0;
 }
 
-fn materializeSoftwareFrameFromToken(pipeline: *c.VideoPipeline, frame: *const c.VideoPipelineFrame) c_int {
+// Software frames stay in the decoder's buffers until upload; the retained
+// reference keeps them alive while the renderer reads them.
+fn pendingPlanesFromToken(pipeline: *c.VideoPipeline, frame: *const c.VideoPipelineFrame) c_int {
     if (frame.gpu_token == 0) {
         return -1;
     }
@@ -272,29 +309,13 @@ fn materializeSoftwareFrameFromToken(pipeline: *c.VideoPipeline, frame: *const c
     while (plane_idx < expected_plane_count) : (plane_idx += 1) {
         const idx: usize = @intCast(plane_idx);
         const geometry = planeGeometry(frame.format, frame.width, frame.height, plane_idx) orelse return -1;
-        const src_ptr = retained_frame.*.data[idx];
-        const src_linesize = retained_frame.*.linesize[idx];
-        if (src_ptr == null or src_linesize <= 0) {
-            return -1;
-        }
-        if (src_linesize < @as(c_int, @intCast(geometry.row_bytes))) {
+        if (retained_frame.*.data[idx] == null or retained_frame.*.linesize[idx] < @as(c_int, @intCast(geometry.row_bytes))) {
             return -1;
         }
-
-        const required_bytes = requiredPlaneBytes(@as(c_int, @intCast(geometry.row_bytes)), geometry.rows) orelse return -1;
-        if (!ensurePlaneCapacity(&pipeline.upload_planes[idx], &pipeline.upload_plane_sizes[idx], required_bytes)) {
-            return -1;
-        }
-
-        pipeline.pending_linesizes[idx] = @as(c_int, @intCast(geometry.row_bytes));
-        const src_base: [*]const u8 = @ptrCast(src_ptr);
-        const dst_base: [*]u8 = @ptrCast(pipeline.upload_planes[idx]);
-        const src_stride: usize = @intCast(src_linesize);
-        const dst_stride: usize = @intCast(pipeline.pending_linesizes[idx]);
-        copyRows(dst_base, dst_stride, src_base, src_stride, geometry.row_bytes, geometry.rows);
+        pipeline.pending_linesizes[idx] = retained_frame.*.linesize[idx];
     }
 
-    releaseInactiveUploadPlanes(pipeline, expected_plane_count);
+    releaseInactiveUploadPlanes(pipeline, 0);
     pipeline.pending_plane_count = expected_plane_count;
     return 0;
 }
@@ -330,7 +351,7 @@ fn queuePopToUploadLocked(pipeline: *c.VideoPipeline) c_int {
         }
         releaseInactiveUploadPlanes(pipeline, frame.plane_count);
     } else if (frame.source_hw == 0 and frame.gpu_token != 0) {
-        if (materializeSoftwareFrameFromToken(pipeline, frame) != 0) {
+        if (pendingPlanesFromToken(pipeline, frame) != 0) {
             return -1;
         }
     }
@@ -393,15 +414,23 @@ fn dropLateQueuedFramesLocked(pipeline: *c.VideoPipeline, render_clock: f64, tol
 
 fn fallbackVideoClock(pipeline: *c.VideoPipeline, frame_pts: f64) f64 {
     const now_ns = c.SDL_GetTicksNS();
+    const speed = c.player_get_clock_speed(pipeline.player);
 
     if (pipeline.clock_base_pts < 0.0 or frame_pts < pipeline.clock_base_pts) {
         pipeline.clock_base_pts = frame_pts;
         pipeline.clock_base_time_ns = now_ns;
+    } else if (speed != pipeline.clock_speed) {
+        // Rebase, so a new speed applies from now on instead of rescaling
+        // the time already played.
+        const played_ns = now_ns - pipeline.clock_base_time_ns;
+        pipeline.clock_base_pts += @as(f64, @floatFromInt(played_ns)) / 1000000000.0 * pipeline.clock_speed;
+        pipeline.clock_base_time_ns = now_ns;
     }
+    pipeline.clock_speed = speed;
 
     const elapsed_ns = now_ns - pipeline.clock_base_time_ns;
     var elapsed_seconds = @as(f64, @floatFromInt(elapsed_ns)) / 1000000000.0;
-    elapsed_seconds *= c.player_get_playback_speed(pipeline.player);
+    elapsed_seconds *= speed;
     return pipeline.clock_base_pts + elapsed_seconds;
 }
 
@@ -411,6 +440,10 @@ fn decodeThreadMain(userdata: ?*anyopaque) callconv(.c) c_int {
     }
 
     const pipeline: *c.VideoPipeline = @ptrCast(@alignCast(userdata.?));
+    var degradation = DecodeDegradation.DegradationController{};
+    const degrade_enabled = DecodeDegradation.enabledFromEnvironment();
+    const catch_up_lag = DecodeDegradation.catchUpLagFromEnvironment();
+    var degrade_last_ns: u64 = 0;
 
     while (true) {
         if (pipeline.queue_mutex == null) {
@@ -418,9 +451,14 @@ fn decodeThreadMain(userdata: ?*anyopaque) callconv(.c) c_int {
         }
 
         _ = c.SDL_LockMutex(pipeline.queue_mutex);
-        while (pipeline.decode_running != 0 and pipeline.count >= frameCapacity()) {
+        while (pipeline.decode_running != 0 and (pipeline.count >= frameCapacity() or pipeline.decode_parked != 0)) {
+            if (pipeline.decode_parked != 0) {
+                pipeline.decode_idle = 1;
+                _ = c.SDL_BroadcastCondition(pipeline.can_push);
+            }
             _ = c.SDL_WaitCondition(pipeline.can_push, pipeline.queue_mutex);
         }
+        pipeline.decode_idle = 0;
         var running = pipeline.decode_running;
         const true_zero_copy_active = pipeline.true_zero_copy_active;
         _ = c.SDL_UnlockMutex(pipeline.queue_mutex);
@@ -488,6 +526,31 @@ fn decodeThreadMain(userdata: ?*anyopaque) callconv(.c) c_int {
                 }
 
                 const adjusted_pts = pts - pipeline.pts_offset;
+                if (pipeline.degrade_reset != 0) {
+                    degradation.reset();
+                    degrade_last_ns = 0;
+                    pipeline.degrade_reset = 0;
+                }
+                const lag = if (pipeline.render_clock >= 0.0) pipeline.render_clock - adjusted_pts else 0.0;
+                if (degrade_enabled and pipeline.render_clock >= 0.0) {
+                    const now_ns = c.SDL_GetTicksNS();
+                    const dt = if (degrade_last_ns == 0) 0.0 else @min(@as(f64, @floatFromInt(now_ns - degrade_last_ns)) / 1000000000.0, degrade_max_step_s);
+                    degrade_last_ns = now_ns;
+                    const level = degradation.update(lag, dt);
+                    pipeline.decode_skip_level = @intFromEnum(level);
+                }
+                c.video_decoder_set_skip_level(&pipeline.player.*.decoder, pipeline.decode_skip_level);
+
+                if (catch_up_lag != null and lag > catch_up_lag.?) {
+                    // Hopelessly behind: drop this frame and everything up to
+                    // the next keyframe at or after the clock, in stream time.
+                    if (c.demuxer_skip_video_to_keyframe(&pipeline.player.*.demuxer, pipeline.render_clock + pipeline.pts_offset) == 0) {
+                        c.video_decoder_flush(&pipeline.player.*.decoder);
+                        pipeline.catch_ups += 1;
+                        break :blk;
+                    }
+                }
+
                 if (queuePushLocked(pipeline, &planes, &linesizes, plane_count, dimensions.width, dimensions.height, format, source_hw, frame_token, adjusted_pts) == 0) {
                     queued = true;
                 }
@@ -512,6 +575,23 @@ fn decodeThreadMain(userdata: ?*anyopaque) callconv(.c) c_int {
     return 0;
 }
 
+// Queue slots accept frames up to their recorded size; plane buffers keep
+// whatever capacity they already have.
+fn primeFrames(p: *c.VideoPipeline, width: c_int, height: c_int) void {
+    var i: c_int = 0;
+    while (i < frameCapacity()) : (i += 1) {
+        const idx: usize = @intCast(i);
+        p.frames[idx].plane_count = 1;
+        p.frames[idx].format = c.VIDEO_FRAME_FORMAT_RGBA;
+        p.frames[idx].width = width;
+        p.frames[idx].height = height;
+        p.frames[idx].linesizes[0] = 0;
+        p.frames[idx].linesizes[1] = 0;
+        p.frames[idx].linesizes[2] = 0;
+        p.frames[idx].pts = 0.0;
+    }
+}
+
 pub export fn video_pipeline_init(pipeline: ?*c.VideoPipeline, player: ?*c.Player) c_int {
     if (pipeline == null or player == null) {
         return -1;
@@ -524,6 +604,7 @@ pub export fn video_pipeline_init(pipeline: ?*c.VideoPipeline, player: ?*c.Playe
     p.player = pl;
     p.clock_base_pts = -1.0;
     p.expected_start_pts = pl.current_time;
+    p.render_clock = -1.0;
 
     const width = pl.width;
     const height = pl.height;
@@ -543,21 +624,7 @@ pub export fn video_pipeline_init(pipeline: ?*c.VideoPipeline, player: ?*c.Playe
         return -1;
     }
 
-    var i: c_int = 0;
-    while (i < frameCapacity()) : (i += 1) {
-        const idx: usize = @intCast(i);
-        p.frames[idx].plane_count = 1;
-        p.frames[idx].format = c.VIDEO_FRAME_FORMAT_RGBA;
-        p.frames[idx].width = width;
-        p.frames[idx].height = height;
-        p.frames[idx].linesizes[0] = 0;
-        p.frames[idx].linesizes[1] = 0;
-        p.frames[idx].linesizes[2] = 0;
-        p.frames[idx].plane_sizes[0] = 0;
-        p.frames[idx].plane_sizes[1] = 0;
-        p.frames[idx].plane_sizes[2] = 0;
-        p.frames[idx].pts = 0.0;
-    }
+    primeFrames(p, width, height);
 
     p.upload_planes[0] = null;
     p.upload_planes[1] = null;
@@ -651,12 +718,52 @@ pub export fn video_pipeline_reset(pipeline: ?*c.VideoPipeline) void {
     p.expected_start_pts = if (p.player != null) p.player.*.current_time else 0.0;
     p.pts_offset_valid = 0;
     p.pts_offset = 0.0;
+    p.render_clock = -1.0;
+    p.degrade_reset = 1;
+    p.decode_skip_level = c.VIDEO_DECODE_SKIP_NONE;
     if (p.can_push != null) {
         _ = c.SDL_BroadcastCondition(p.can_push);
     }
     _ = c.SDL_UnlockMutex(p.queue_mutex);
 }
 
+/// Holds the decode thread off the player, so the player can swap media
+/// underneath a running pipeline, and drops the queued frames. Returns once
+/// the thread is idle.
+pub export fn video_pipeline_park(pipeline: ?*c.VideoPipeline) void {
+    const p = pipeline orelse return;
+    if (p.queue_mutex == null) {
+        return;
+    }
+
+    _ = c.SDL_LockMutex(p.queue_mutex);
+    p.decode_parked = 1;
+    _ = c.SDL_BroadcastCondition(p.can_push);
+    while (p.decode_thread != null and p.decode_running != 0 and p.decode_idle == 0) {
+        _ = c.SDL_WaitCondition(p.can_push, p.queue_mutex);
+    }
+    _ = c.SDL_UnlockMutex(p.queue_mutex);
+
+    video_pipeline_reset(p);
+}
+
+/// Restarts a parked pipeline on whatever the player has open now.
+pub export fn video_pipeline_unpark(pipeline: ?*c.VideoPipeline) void {
+    const p = pipeline orelse return;
+    if (p.queue_mutex == null) {
+        return;
+    }
+
+    video_pipeline_reset(p);
+
+    _ = c.SDL_LockMutex(p.queue_mutex);
+    primeFrames(p, p.player.*.width, p.player.*.height);
+    p.catch_ups = 0;
+    p.decode_parked = 0;
+    _ = c.SDL_BroadcastCondition(p.can_push);
+    _ = c.SDL_UnlockMutex(p.queue_mutex);
+}
+
 pub export fn video_pipeline_set_true_zero_copy_active(pipeline: ?*c.VideoPipeline, active: c_int) void {
     if (pipeline == null) {
         return;
@@ -673,6 +780,28 @@ pub export fn video_pipeline_set_true_zero_copy_active(pipeline: ?*c.VideoPipeli
     p.true_zero_copy_active = if (active != 0) 1 else 0;
 }
 
+pub export fn video_pipeline_get_decode_skip_level(pipeline: ?*c.VideoPipeline) c_int {
+    const p = pipeline orelse return c.VIDEO_DECODE_SKIP_NONE;
+    if (p.queue_mutex == null) {
+        return p.decode_skip_level;
+    }
+
+    _ = c.SDL_LockMutex(p.queue_mutex);
+    defer _ = c.SDL_UnlockMutex(p.queue_mutex);
+    return p.decode_skip_level;
+}
+
+pub export fn video_pipeline_get_catch_up_count(pipeline: ?*c.VideoPipeline) c_int {
+    const p = pipeline orelse return 0;
+    if (p.queue_mutex == null) {
+        return p.catch_ups;
+    }
+
+    _ = c.SDL_LockMutex(p.queue_mutex);
+    defer _ = c.SDL_UnlockMutex(p.queue_mutex);
+    return p.catch_ups;
+}
+
 pub export fn video_pipeline_destroy(pipeline: ?*c.VideoPipeline) void {
     if (pipeline == null) {
         return;
@@ -746,17 +875,19 @@ pub export fn video_pipeline_get_frame_for_render(
 
     releaseGpuToken(&p.delivered_gpu_token);
 
-    if (p.have_pending_upload == 0) {
-        if (p.queue_mutex != null) {
-            _ = c.SDL_LockMutex(p.queue_mutex);
-            if (p.count > 0) {
-                if (master_clock >= 0.0) {
-                    _ = dropLateQueuedFramesLocked(p, master_clock, render_late_drop_tolerance);
-                }
-                _ = queuePopToUploadLocked(p);
+    if (p.queue_mutex != null) {
+        _ = c.SDL_LockMutex(p.queue_mutex);
+        // The decode thread measures its lag against this.
+        if (master_clock >= 0.0) {
+            p.render_clock = master_clock;
+        }
+        if (p.have_pending_upload == 0 and p.count > 0) {
+            if (master_clock >= 0.0) {
+                _ = dropLateQueuedFramesLocked(p, master_clock, render_late_drop_tolerance);
             }
-            _ = c.SDL_UnlockMutex(p.queue_mutex);
+            _ = queuePopToUploadLocked(p);
         }
+        _ = c.SDL_UnlockMutex(p.queue_mutex);
     }
 
     if (p.have_pending_upload == 0) {
@@ -770,9 +901,16 @@ pub export fn video_pipeline_get_frame_for_render(
 
     const frame_delay = p.pending_pts - render_clock;
     if (frame_delay <= 0.002) {
-        planes[0] = p.upload_planes[0];
-        planes[1] = p.upload_planes[1];
-        planes[2] = p.upload_planes[2];
+        if (p.pending_source_hw == 0 and p.pending_gpu_token != 0) {
+            const token_frame: *c.AVFrame = @ptrFromInt(p.pending_gpu_token);
+            planes[0] = token_frame.*.data[0];
+            planes[1] = token_frame.*.data[1];
+            planes[2] = token_frame.*.data[2];
+        } else {
+            planes[0] = p.upload_planes[0];
+            planes[1] = p.upload_planes[1];
+            planes[2] = p.upload_planes[2];
+        }
         width.* = p.pending_width;
         height.* = p.pending_height;
         linesizes[0] = p.pending_linesizes[0];
@@ -892,6 +1030,44 @@ test "queuePopToUploadLocked preserves multi-plane pending metadata" {
     try std.testing.expect(pipeline.frames[0].planes[1] == upload_uv_ptr);
 }
 
+test "software frame tokens reach the renderer without a copy" {
+    var pipeline: c.VideoPipeline = std.mem.zeroes(c.VideoPipeline);
+    var y: [64 * 4]u8 = undefined;
+    var uv: [64 * 2]u8 = undefined;
+    const token_frame = c.av_frame_alloc();
+    try std.testing.expect(token_frame != null);
+    token_frame.*.data[0] = &y;
+    token_frame.*.data[1] = &uv;
+    token_frame.*.linesize[0] = 64;
+    token_frame.*.linesize[1] = 64;
+
+    pipeline.count = 1;
+    pipeline.tail = 1;
+    pipeline.frames[0].width = 8;
+    pipeline.frames[0].height = 4;
+    pipeline.frames[0].format = c.VIDEO_FRAME_FORMAT_NV12;
+    pipeline.frames[0].gpu_token = @intFromPtr(token_frame);
+
+    try std.testing.expectEqual(@as(c_int, 0), queuePopToUploadLocked(&pipeline));
+    try std.testing.expectEqual(@as(c_int, 2), pipeline.pending_plane_count);
+    try std.testing.expectEqual(@as(c_int, 64), pipeline.pending_linesizes[1]);
+
+    var planes: [3][*c]u8 = .{ null, null, null };
+    var width: c_int = 0;
+    var height: c_int = 0;
+    var linesizes: [3]c_int = .{ 0, 0, 0 };
+    var plane_count: c_int = 0;
+    var format: c_int = 0;
+    var source_hw: c_int = 0;
+    var gpu_token: u64 = 0;
+    try std.testing.expectEqual(@as(c_int, 1), video_pipeline_get_frame_for_render(&pipeline, 1.0, &planes, &width, &height, &linesizes, &plane_count, &format, &source_hw, &gpu_token));
+    try std.testing.expect(planes[0] == @as([*c]u8, &y));
+    try std.testing.expect(planes[1] == @as([*c]u8, &uv));
+    try std.testing.expectEqual(@intFromPtr(token_frame), gpu_token);
+
+    releaseGpuToken(&pipeline.delivered_gpu_token);
+}
+
 test "dropLateQueuedFramesLocked keeps newest frame when queue lags" {
     var pipeline: c.VideoPipeline = std.mem.zeroes(c.VideoPipeline);
     pipeline.count = 3;
@@ -944,6 +1120,26 @@ test "decodeShouldSkipPlaneExtraction requires runtime true-path activation" {
     try std.testing.expect(!decodeShouldSkipPlaneExtraction(0, 1, 0x1));
 }
 
+test "planeGeometry sizes 16-bit and 4:2:2/4:4:4 planes" {
+    const p010 = planeGeometry(c.VIDEO_FRAME_FORMAT_P010, 1919, 1081, 1).?;
+    try std.testing.expectEqual(@as(usize, 960 * 2 * 2), p010.row_bytes);
+    try std.testing.expectEqual(@as(usize, 541), p010.rows);
+
+    const luma10 = planeGeometry(c.VIDEO_FRAME_FORMAT_YUV420P10, 1920, 1080, 0).?;
+    try std.testing.expectEqual(@as(usize, 1920 * 2), luma10.row_bytes);
+
+    const chroma422 = planeGeometry(c.VIDEO_FRAME_FORMAT_YUV422P10, 1920, 1080, 2).?;
+    try std.testing.expectEqual(@as(usize, 960 * 2), chroma422.row_bytes);
+    try std.testing.expectEqual(@as(usize, 1080), chroma422.rows);
+
+    const chroma444 = planeGeometry(c.VIDEO_FRAME_FORMAT_YUV444P, 1920, 1080, 1).?;
+    try std.testing.expectEqual(@as(usize, 1920), chroma444.row_bytes);
+    try std.testing.expectEqual(@as(usize, 1080), chroma444.rows);
+
+    try std.testing.expect(planeGeometry(c.VIDEO_FRAME_FORMAT_P010, 1920, 1080, 2) == null);
+    try std.testing.expect(planeGeometry(c.VIDEO_FRAME_FORMAT_RGBA, 1920, 1080, 1) == null);
+}
+
 fn allocTestGpuFrame(width: c_int, height: c_int) !?*c.AVFrame {
     var frame = c.av_frame_alloc() orelse return error.OutOfMemory;
     errdefer c.av_frame_free(&frame);